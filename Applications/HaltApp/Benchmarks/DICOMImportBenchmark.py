@@ -0,0 +1,47 @@
+"""Measure the import of a DICOM series in a database and its loading in the scene.
+
+A synthetic 300-slice cardiac CT series is written with pydicom, then imported in
+a temporary DICOM database so that the user database is left untouched. The series
+is loaded by the TAVISeries DICOM plugin, which decodes the slices in parallel.
+
+Usage:
+
+    HaltApp --no-main-window --no-splash --python-script DICOMImportBenchmark.py [--output-directory <dir>]
+"""
+
+import os
+import sys
+import tempfile
+
+import slicer
+from DICOMLib import DICOMUtils
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(sys.argv[0])))
+import HaltBenchmark  # noqa: E402
+import HaltBenchmarkData  # noqa: E402
+
+
+def benchmark(run: HaltBenchmark.BenchmarkRun) -> None:
+    with tempfile.TemporaryDirectory() as directory:
+        seriesDirectory = os.path.join(directory, "series")
+        seriesInstanceUID = HaltBenchmarkData.writeDICOMSeries(seriesDirectory)
+
+        def importSeries() -> None:
+            with DICOMUtils.TemporaryDICOMDatabase(os.path.join(directory, "database")):
+                DICOMUtils.importDicom(seriesDirectory)
+
+        run.measure("import", importSeries)
+
+        with DICOMUtils.TemporaryDICOMDatabase(os.path.join(directory, "database")):
+            DICOMUtils.importDicom(seriesDirectory)
+
+            def loadSeries() -> None:
+                slicer.mrmlScene.Clear()
+                DICOMUtils.loadSeriesByUID([seriesInstanceUID])
+
+            run.measure("load", loadSeries)
+            slicer.mrmlScene.Clear()
+
+
+if __name__ == "__main__":
+    HaltBenchmark.run("DICOMImport", sys.argv[1:], benchmark)
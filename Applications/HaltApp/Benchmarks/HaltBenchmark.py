@@ -0,0 +1,115 @@
+"""Shared helpers of the Halt benchmarks: timing, machine-readable results and baseline comparison.
+
+Each benchmark writes ``<output directory>/<name>.json`` and compares its metrics with
+``<baseline directory>/<name>.json``. All metrics are "lower is better": a metric larger
+than its baseline by more than the threshold (relative) is a regression, and the benchmark
+fails. A missing baseline also fails the benchmark: baselines are only recorded with
+``--update-baseline``, so that a regressed build never becomes the reference by accident.
+"""
+
+import argparse
+import json
+import os
+import platform
+import statistics
+import time
+from typing import Any, Callable
+
+import slicer
+
+DEFAULT_THRESHOLD = 0.2
+
+
+class BenchmarkRun:
+    """Metrics measured by one benchmark script."""
+
+    def __init__(self, name: str, argv: list[str]):
+        parser = argparse.ArgumentParser(description=f"Halt {name} benchmark")
+        parser.add_argument("--output-directory", default=".", help="directory receiving the results")
+        parser.add_argument("--baseline-directory", help="directory of the baselines, no comparison if not set")
+        parser.add_argument(
+            "--threshold", type=float, default=DEFAULT_THRESHOLD, help="relative increase reported as a regression"
+        )
+        parser.add_argument("--repeat", type=int, default=3, help="number of runs of each measurement")
+        parser.add_argument("--update-baseline", action="store_true", help="write the results as the new baseline")
+        self.args = parser.parse_args(argv)
+        self.name = name
+        self.metrics: dict[str, dict[str, Any]] = {}
+
+    @property
+    def repeat(self) -> int:
+        return max(1, self.args.repeat)
+
+    def record(self, metric: str, value: float, unit: str = "s") -> None:
+        self.metrics[metric] = {"value": value, "unit": unit}
+        print(f"{self.name}.{metric}: {value:.4g} {unit}")
+
+    def measure(self, metric: str, function: Callable[[], Any], repeat: int = 0) -> float:
+        """Record the median time of ``repeat`` calls of ``function``, in seconds."""
+        times = []
+        for _ in range(repeat or self.repeat):
+            startTime = time.perf_counter()
+            function()
+            times.append(time.perf_counter() - startTime)
+        value = statistics.median(times)
+        self.record(metric, value)
+        return value
+
+    def _machine(self) -> dict[str, Any]:
+        return {
+            "platform": platform.platform(),
+            "processor": platform.processor(),
+            "cpuCount": os.cpu_count(),
+            "application": f"{slicer.app.applicationName} {slicer.app.applicationVersion}",
+            "date": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        }
+
+    def _regressions(self, baseline: dict[str, Any]) -> list[str]:
+        regressions = []
+        for metric, result in self.metrics.items():
+            baselineValue = baseline.get("metrics", {}).get(metric, {}).get("value")
+            if not baselineValue:
+                continue
+            ratio = result["value"] / baselineValue
+            if ratio > 1.0 + self.args.threshold:
+                regressions.append(f"{metric}: {result['value']:.4g} vs {baselineValue:.4g} baseline ({ratio:.2f}x)")
+        return regressions
+
+    def finish(self) -> int:
+        """Write the results, compare them with the baseline and return the exit code."""
+        results = {"benchmark": self.name, "machine": self._machine(), "metrics": self.metrics}
+        os.makedirs(self.args.output_directory, exist_ok=True)
+        with open(os.path.join(self.args.output_directory, f"{self.name}.json"), "w") as resultsFile:
+            json.dump(results, resultsFile, indent=2)
+
+        if not self.args.baseline_directory:
+            return 0
+        baselineFileName = os.path.join(self.args.baseline_directory, f"{self.name}.json")
+        if self.args.update_baseline:
+            os.makedirs(self.args.baseline_directory, exist_ok=True)
+            with open(baselineFileName, "w") as baselineFile:
+                json.dump(results, baselineFile, indent=2)
+            print(f"Baseline written to {baselineFileName}")
+            return 0
+        if not os.path.exists(baselineFileName):
+            print(f"No baseline {baselineFileName}, run with --update-baseline to record it")
+            return 1
+        with open(baselineFileName) as baselineFile:
+            regressions = self._regressions(json.load(baselineFile))
+        for regression in regressions:
+            print(f"Regression of {self.name}.{regression}")
+        return 1 if regressions else 0
+
+
+def run(name: str, argv: list[str], benchmark: Callable[[BenchmarkRun], None]) -> None:
+    """Run ``benchmark`` and exit the application with the result of the comparison."""
+    benchmarkRun = BenchmarkRun(name, argv)
+    try:
+        benchmark(benchmarkRun)
+        exitCode = benchmarkRun.finish()
+    except Exception:
+        import traceback
+
+        traceback.print_exc()
+        exitCode = 1
+    slicer.util.exit(exitCode)
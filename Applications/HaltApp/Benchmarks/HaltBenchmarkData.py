@@ -0,0 +1,120 @@
+"""Synthetic data of the Halt benchmarks, generated locally so that the benchmarks run offline."""
+
+import os
+
+import numpy as np
+import slicer
+import vtk
+
+# Voxel spacing of the synthetic cardiac CT, in mm (columns, rows, slices)
+CT_SPACING = (0.4, 0.4, 0.5)
+
+
+def cardiacCTArray(dimensions: tuple[int, int, int] = (512, 512, 400)) -> np.ndarray:
+    """Return a contrast-enhanced cardiac CT (HU, k-j-i order): noisy soft tissue,
+    a tapered contrast-filled aortic root along the slice axis, and calcifications
+    at the level of the annulus.
+    """
+    rng = np.random.default_rng(0)
+    shape = dimensions[::-1]
+    k, j, i = np.ogrid[: shape[0], : shape[1], : shape[2]]
+    center = np.array(shape) / 2
+    voxels = rng.normal(40, 20, shape).astype(np.int16)
+    radius = 30.0 / CT_SPACING[0] - 0.05 * np.abs(k - center[0])
+    voxels[(j - center[1]) ** 2 + (i - center[2]) ** 2 < radius**2] = 350
+    for angle in (0.0, 2.1, 4.2):
+        cj = center[1] + 0.9 * radius.min() * np.sin(angle)
+        ci = center[2] + 0.9 * radius.min() * np.cos(angle)
+        voxels[((j - cj) ** 2 + (i - ci) ** 2 < 36) & (np.abs(k - center[0]) < 10)] = 900
+    return voxels
+
+
+def addCardiacCT(dimensions: tuple[int, int, int] = (512, 512, 400)) -> slicer.vtkMRMLScalarVolumeNode:
+    volumeNode = slicer.util.addVolumeFromArray(cardiacCTArray(dimensions), name="CT")
+    volumeNode.SetSpacing(CT_SPACING)
+    return volumeNode
+
+
+def addHingePoints(volumeNode: slicer.vtkMRMLScalarVolumeNode) -> slicer.vtkMRMLMarkupsFiducialNode:
+    """Add three hinge points on the annulus plane (middle slice) of the synthetic CT."""
+    bounds = [0.0] * 6
+    volumeNode.GetRASBounds(bounds)
+    center = [(bounds[0] + bounds[1]) / 2, (bounds[2] + bounds[3]) / 2, (bounds[4] + bounds[5]) / 2]
+    hingePointsNode = slicer.mrmlScene.AddNewNodeByClass("vtkMRMLMarkupsFiducialNode", "Hinge points")
+    for angle in (0.0, 2.1, 4.2):
+        hingePointsNode.AddControlPoint(center[0] + 25 * np.cos(angle), center[1] + 25 * np.sin(angle), center[2])
+    return hingePointsNode
+
+
+def addTAVICase() -> None:
+    """Add a representative TAVI case to the scene: CT, label maps, segmentation, models, markups and tables."""
+    volumeNode = addCardiacCT()
+    voxels = slicer.util.arrayFromVolume(volumeNode)
+    for name, mask in (("Lumen", voxels == 350), ("Calcium", voxels == 900)):
+        labelmapNode = slicer.util.addVolumeFromArray(
+            mask.astype(np.uint8), name=name, nodeClassName="vtkMRMLLabelMapVolumeNode"
+        )
+        labelmapNode.SetSpacing(CT_SPACING)
+
+    segmentationNode = slicer.mrmlScene.AddNewNodeByClass("vtkMRMLSegmentationNode", "Aortic root")
+    for labelmapNode in slicer.util.getNodesByClass("vtkMRMLLabelMapVolumeNode"):
+        slicer.modules.segmentations.logic().ImportLabelmapToSegmentationNode(labelmapNode, segmentationNode)
+    segmentationNode.CreateClosedSurfaceRepresentation()
+
+    for index in range(20):
+        source = vtk.vtkSphereSource()
+        source.SetCenter(index * 5.0, 0.0, 0.0)
+        source.SetRadius(10.0)
+        source.SetThetaResolution(128)
+        source.SetPhiResolution(128)
+        source.Update()
+        slicer.modules.models.logic().AddModel(source.GetOutput()).SetName(f"Model {index}")
+
+    addHingePoints(volumeNode)
+    tableNode = slicer.mrmlScene.AddNewNodeByClass("vtkMRMLTableNode", "Measurements")
+    tableNode.AddColumn().SetName("Measurement")
+
+
+def writeDICOMSeries(directory: str, dimensions: tuple[int, int, int] = (512, 512, 300)) -> str:
+    """Write the synthetic CT as a DICOM series (one file per slice) and return its SeriesInstanceUID."""
+    import pydicom
+    from pydicom.dataset import Dataset, FileMetaDataset
+    from pydicom.uid import CTImageStorage, ExplicitVRLittleEndian, generate_uid
+
+    voxels = cardiacCTArray(dimensions) + 1024
+    studyInstanceUID = generate_uid()
+    seriesInstanceUID = generate_uid()
+    os.makedirs(directory, exist_ok=True)
+    for sliceIndex, sliceVoxels in enumerate(voxels):
+        dataset = Dataset()
+        dataset.file_meta = FileMetaDataset()
+        dataset.file_meta.MediaStorageSOPClassUID = CTImageStorage
+        dataset.file_meta.MediaStorageSOPInstanceUID = generate_uid()
+        dataset.file_meta.TransferSyntaxUID = ExplicitVRLittleEndian
+        dataset.SOPClassUID = CTImageStorage
+        dataset.SOPInstanceUID = dataset.file_meta.MediaStorageSOPInstanceUID
+        dataset.StudyInstanceUID = studyInstanceUID
+        dataset.SeriesInstanceUID = seriesInstanceUID
+        dataset.PatientName = "Benchmark^Halt"
+        dataset.PatientID = "HALT-BENCHMARK"
+        dataset.Modality = "CT"
+        dataset.SeriesDescription = "Synthetic cardiac CT"
+        dataset.InstanceNumber = sliceIndex + 1
+        dataset.ImagePositionPatient = [0.0, 0.0, sliceIndex * CT_SPACING[2]]
+        dataset.ImageOrientationPatient = [1.0, 0.0, 0.0, 0.0, 1.0, 0.0]
+        dataset.PixelSpacing = [CT_SPACING[1], CT_SPACING[0]]
+        dataset.SliceThickness = CT_SPACING[2]
+        dataset.Rows, dataset.Columns = sliceVoxels.shape
+        dataset.SamplesPerPixel = 1
+        dataset.PhotometricInterpretation = "MONOCHROME2"
+        dataset.BitsAllocated = 16
+        dataset.BitsStored = 16
+        dataset.HighBit = 15
+        dataset.PixelRepresentation = 0
+        dataset.RescaleIntercept = -1024
+        dataset.RescaleSlope = 1
+        dataset.PixelData = sliceVoxels.astype(np.uint16).tobytes()
+        dataset.is_little_endian = True
+        dataset.is_implicit_VR = False
+        pydicom.dcmwrite(os.path.join(directory, f"{sliceIndex:04d}.dcm"), dataset, write_like_original=False)
+    return seriesInstanceUID
@@ -0,0 +1,113 @@
+"""Measure palette-heavy repaints of the main window with the custom look of qAppStyle.
+
+The main window is repainted with the custom look enabled and disabled, and the
+switch between the two (palette change and repaint of every widget) is timed,
+as well as the same switch through an application style sheet, the way the Home
+module applied its look before qAppStyle. The style sheet is generated from the
+palette of qAppStyle, so that both switches draw the same colors.
+The custom look is also repainted with the palette cache of qAppStyle disabled,
+the palettes being computed on every draw call as before the cache.
+This benchmark needs the main window: do not pass ``--no-main-window``.
+
+Usage:
+
+    HaltApp --no-splash --python-script RepaintBenchmark.py [--output-directory <dir>]
+"""
+
+import os
+import sys
+
+import qt
+import slicer
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(sys.argv[0])))
+import HaltBenchmark  # noqa: E402
+
+REPAINT_COUNT = 20
+
+
+def customStyleSheet() -> str:
+    """Style sheet equivalent to the widget palettes of qAppStyle, generated from its standard palette.
+
+    The colors are derived like qAppStyle::computeWidgetPalette() does, the custom look must be enabled.
+    """
+    palette = slicer.app.style().standardPalette()
+    window = palette.color(qt.QPalette.Active, qt.QPalette.Window)
+    button = palette.color(qt.QPalette.Active, qt.QPalette.Dark)
+    buttonText = palette.color(qt.QPalette.Active, qt.QPalette.Light)
+    disabledButton = qt.QColor.fromHsvF(button.hueF(), button.saturationF() * 0.8, button.valueF() * 0.9)
+    highlight = palette.color(qt.QPalette.Active, qt.QPalette.Highlight)
+    highlightedText = palette.color(qt.QPalette.Active, qt.QPalette.HighlightedText)
+    return f"""
+QMainWindow, QDialog {{ background-color: {window.name()}; }}
+QPushButton {{ background-color: {button.name()}; color: {buttonText.name()}; }}
+QPushButton:disabled {{ background-color: {disabledButton.name()}; color: {disabledButton.name()}; }}
+QMenuBar {{
+  background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1, stop: 0 {button.name()}, stop: 1 {button.darker(120).name()});
+  color: {buttonText.name()};
+}}
+QMenuBar::item:selected {{ background-color: {highlight.name()}; color: {highlightedText.name()}; }}
+"""
+
+
+def repaint(widget: qt.QWidget) -> None:
+    for _ in range(REPAINT_COUNT):
+        widget.repaint()
+    slicer.app.processEvents()
+
+
+def setCustomThemeEnabled(enabled: bool) -> None:
+    slicer.app.style().customThemeEnabled = enabled
+    slicer.app.setPalette(slicer.app.style().standardPalette())
+    slicer.app.processEvents()
+
+
+def benchmark(run: HaltBenchmark.BenchmarkRun) -> None:
+    mainWindow = slicer.util.mainWindow()
+    if mainWindow is None or not hasattr(slicer.app.style(), "customThemeEnabled"):
+        msg = "Repaint benchmark requires the main window and the application style"
+        raise RuntimeError(msg)
+    mainWindow.showMaximized()
+    slicer.app.processEvents()
+    customThemeEnabled = slicer.app.style().customThemeEnabled
+    try:
+        for enabled in (True, False):
+            setCustomThemeEnabled(enabled)
+            run.measure(f"repaint.{'custom' if enabled else 'default'}", lambda: repaint(mainWindow))
+
+        # Palettes computed on every draw call, the reference of the palette cache
+        setCustomThemeEnabled(True)
+        slicer.app.style().paletteCacheEnabled = False
+        try:
+            run.measure("repaint.customUncachedPalettes", lambda: repaint(mainWindow))
+        finally:
+            slicer.app.style().paletteCacheEnabled = True
+
+        def switchTheme() -> None:
+            setCustomThemeEnabled(True)
+            mainWindow.repaint()
+            setCustomThemeEnabled(False)
+            mainWindow.repaint()
+
+        run.measure("switch", switchTheme)
+
+        # Style sheets re-polish every widget of the application
+        setCustomThemeEnabled(True)
+        styleSheet = customStyleSheet()
+
+        def switchStyleSheet() -> None:
+            slicer.app.styleSheet = styleSheet
+            slicer.app.processEvents()
+            mainWindow.repaint()
+            slicer.app.styleSheet = ""
+            slicer.app.processEvents()
+            mainWindow.repaint()
+
+        setCustomThemeEnabled(False)
+        run.measure("switch.styleSheet", switchStyleSheet)
+    finally:
+        setCustomThemeEnabled(customThemeEnabled)
+
+
+if __name__ == "__main__":
+    HaltBenchmark.run("Repaint", sys.argv[1:], benchmark)
@@ -0,0 +1,70 @@
+"""Measure the seeded segmentation of the aortic root: first segmentation and seed moves.
+
+The segmentation runs on the synthetic contrast-enhanced aortic root of the benchmark data,
+from a seed in the lumen. The first segmentation labels all the slabs of the volume, a seed
+move only selects the components of the seeds again: the benchmark fails if it labels slabs
+or if the segment is empty.
+
+Usage:
+
+    HaltApp --no-main-window --no-splash --python-script RootSegmentationBenchmark.py [--output-directory <dir>]
+"""
+
+import os
+import sys
+
+import slicer
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(sys.argv[0])))
+import HaltBenchmark  # noqa: E402
+import HaltBenchmarkData  # noqa: E402
+
+
+def benchmark(run: HaltBenchmark.BenchmarkRun) -> None:
+    rootSegmentation = slicer.modules.tavi.logic().GetRootSegmentation()
+    slicer.mrmlScene.Clear()
+    volumeNode = HaltBenchmarkData.addCardiacCT()
+    bounds = [0.0] * 6
+    volumeNode.GetRASBounds(bounds)
+    center = [(bounds[0] + bounds[1]) / 2, (bounds[2] + bounds[3]) / 2, (bounds[4] + bounds[5]) / 2]
+    seedsNode = slicer.mrmlScene.AddNewNodeByClass("vtkMRMLMarkupsFiducialNode", "Seeds")
+    seedsNode.AddControlPoint(center)
+    segmentationNode = slicer.mrmlScene.AddNewNodeByClass("vtkMRMLSegmentationNode", "Aortic root")
+    rootSegmentation.SetInputVolumeNode(volumeNode)
+    rootSegmentation.SetSeedsNode(seedsNode)
+    rootSegmentation.SetSegmentationNode(segmentationNode)
+
+    def segment() -> None:
+        rootSegmentation.ClearCache()
+        if not rootSegmentation.Update():
+            msg = "Root segmentation failed"
+            raise RuntimeError(msg)
+
+    run.measure("first", segment)
+
+    # Seeds moved along the lumen, updated by the observation of the seeds
+    rootSegmentation.SetAutoUpdate(True)
+    moves = 0
+
+    def moveSeed() -> None:
+        nonlocal moves
+        moves += 1
+        seedsNode.SetNthControlPointPosition(0, center[0], center[1], center[2] + (moves % 2) * 10.0)
+
+    run.measure("seedMove", moveSeed, repeat=max(run.repeat, 10))
+    rootSegmentation.SetAutoUpdate(False)
+    if rootSegmentation.GetNumberOfLabeledSlabs() != 0:
+        msg = f"Seed move labeled {rootSegmentation.GetNumberOfLabeledSlabs()} slabs"
+        raise RuntimeError(msg)
+    if rootSegmentation.GetNumberOfSegmentVoxels() == 0:
+        msg = "Root segment is empty"
+        raise RuntimeError(msg)
+
+    rootSegmentation.SetInputVolumeNode(None)
+    rootSegmentation.SetSeedsNode(None)
+    rootSegmentation.SetSegmentationNode(None)
+    slicer.mrmlScene.Clear()
+
+
+if __name__ == "__main__":
+    HaltBenchmark.run("RootSegmentation", sys.argv[1:], benchmark)
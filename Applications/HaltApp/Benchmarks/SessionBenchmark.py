@@ -0,0 +1,43 @@
+"""Compare the save and load times of Halt session files (.halt) and Medical Reality Bundles (.mrb).
+
+A representative TAVI case is generated (no data is downloaded): a contrast-enhanced
+cardiac CT, label maps, a segmentation, surface models, markups and tables.
+
+Usage:
+
+    HaltApp --no-main-window --no-splash --python-script SessionBenchmark.py [--output-directory <dir>]
+"""
+
+import os
+import sys
+import tempfile
+
+import slicer
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(sys.argv[0])))
+import HaltBenchmark  # noqa: E402
+import HaltBenchmarkData  # noqa: E402
+
+
+def benchmark(run: HaltBenchmark.BenchmarkRun) -> None:
+    ioManager = slicer.app.coreIOManager()
+    with tempfile.TemporaryDirectory() as directory:
+        bundleFile = os.path.join(directory, "case.mrb")
+        sessionFile = os.path.join(directory, "case.halt")
+
+        slicer.mrmlScene.Clear()
+        HaltBenchmarkData.addTAVICase()
+        mrbSave = run.measure("mrb.save", lambda: slicer.util.saveScene(bundleFile))
+        sessionProperties = {"fileName": sessionFile}
+        haltSave = run.measure("halt.save", lambda: ioManager.saveNodes("HaltSessionFile", sessionProperties))
+        run.record("mrb.size", os.path.getsize(bundleFile) / 2**20, "MB")
+        run.record("halt.size", os.path.getsize(sessionFile) / 2**20, "MB")
+        mrbLoad = run.measure("mrb.load", lambda: slicer.util.loadScene(bundleFile, {"clear": True}))
+        sessionProperties["clear"] = True
+        haltLoad = run.measure("halt.load", lambda: ioManager.loadNodes("HaltSessionFile", sessionProperties))
+        slicer.mrmlScene.Clear()
+    print(f"save: halt {mrbSave / haltSave:.1f}x faster than mrb, load: {mrbLoad / haltLoad:.1f}x")
+
+
+if __name__ == "__main__":
+    HaltBenchmark.run("Session", sys.argv[1:], benchmark)
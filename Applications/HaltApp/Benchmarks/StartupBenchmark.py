@@ -0,0 +1,54 @@
+"""Measure the cold and warm startup times of the application.
+
+The application is launched with ``--exit-after-startup`` and its startup trace
+(see qHaltAppStartupTrace) enabled. The first launch is reported as "cold": the
+operating system file caches cannot be dropped without privileges, so this is the
+first launch of the benchmark run rather than a true cold start. Later launches are
+reported as "warm".
+
+Usage:
+
+    HaltApp --no-main-window --no-splash --python-script StartupBenchmark.py [--output-directory <dir>]
+"""
+
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+import slicer
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(sys.argv[0])))
+import HaltBenchmark  # noqa: E402
+
+STARTUP_TIMEOUT = 300
+
+
+def launch(traceFileName: str) -> tuple[float, float]:
+    """Launch the application and return its wall-clock and traced startup times, in seconds."""
+    environment = dict(os.environ, HALT_STARTUP_TRACE_FILE=traceFileName)
+    command = [slicer.app.launcherExecutableFilePath, "--no-splash", "--exit-after-startup"]
+    startTime = time.perf_counter()
+    subprocess.run(command, env=environment, check=True, timeout=STARTUP_TIMEOUT)  # noqa: S603
+    wallTime = time.perf_counter() - startTime
+    with open(traceFileName) as traceFile:
+        events = json.load(traceFile)["traceEvents"]
+    startupEvents = [event for event in events if event["name"] == "Startup"]
+    tracedTime = startupEvents[0]["dur"] / 1e6 if startupEvents else wallTime
+    return wallTime, tracedTime
+
+
+def benchmark(run: HaltBenchmark.BenchmarkRun) -> None:
+    with tempfile.TemporaryDirectory() as directory:
+        launches = [launch(os.path.join(directory, f"startup{index}.json")) for index in range(run.repeat + 1)]
+    run.record("cold.wall", launches[0][0])
+    run.record("cold.startup", launches[0][1])
+    run.record("warm.wall", statistics.median(wallTime for wallTime, _ in launches[1:]))
+    run.record("warm.startup", statistics.median(tracedTime for _, tracedTime in launches[1:]))
+
+
+if __name__ == "__main__":
+    HaltBenchmark.run("Startup", sys.argv[1:], benchmark)
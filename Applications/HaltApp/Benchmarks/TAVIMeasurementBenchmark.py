@@ -0,0 +1,66 @@
+"""Measure the TAVI measurement steps: annulus measurement and calcium scoring.
+
+The measurements run on a synthetic contrast-enhanced aortic root with three
+calcifications at the level of the annulus, with hinge points on the annulus plane.
+The result cache of the TAVI module is not involved: the logic is called directly.
+
+The calcifications are the phantom of the calcium scoring: each one faces a hinge
+point, and the benchmark fails unless the three cusp sectors are scored.
+
+Usage:
+
+    HaltApp --no-main-window --no-splash --python-script TAVIMeasurementBenchmark.py [--output-directory <dir>]
+"""
+
+import os
+import sys
+
+import slicer
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(sys.argv[0])))
+import HaltBenchmark  # noqa: E402
+import HaltBenchmarkData  # noqa: E402
+
+
+def benchmark(run: HaltBenchmark.BenchmarkRun) -> None:
+    logic = slicer.modules.tavi.logic()
+    slicer.mrmlScene.Clear()
+    volumeNode = HaltBenchmarkData.addCardiacCT()
+    hingePointsNode = HaltBenchmarkData.addHingePoints(volumeNode)
+    annulusTableNode = slicer.mrmlScene.AddNewNodeByClass("vtkMRMLTableNode", "Annulus")
+    calciumTableNode = slicer.mrmlScene.AddNewNodeByClass("vtkMRMLTableNode", "Calcium")
+    contourNode = slicer.mrmlScene.AddNewNodeByClass("vtkMRMLMarkupsClosedCurveNode", "Annulus contour")
+    planeNode = slicer.mrmlScene.AddNewNodeByClass("vtkMRMLMarkupsPlaneNode", "Annulus plane")
+
+    def measureAnnulus() -> None:
+        if not logic.MeasureAnnulus(volumeNode, hingePointsNode, annulusTableNode, contourNode, planeNode):
+            msg = "Annulus measurement failed"
+            raise RuntimeError(msg)
+
+    def scoreCalcium() -> None:
+        if not logic.ScoreCalcium(volumeNode, hingePointsNode, calciumTableNode):
+            msg = "Calcium scoring failed"
+            raise RuntimeError(msg)
+
+    run.measure("annulus", measureAnnulus)
+    run.measure("calcium", scoreCalcium)
+    checkCalciumPhantom(calciumTableNode)
+    slicer.mrmlScene.Clear()
+
+
+def checkCalciumPhantom(calciumTableNode: slicer.vtkMRMLTableNode) -> None:
+    """Check that the calcification facing each hinge point is scored in its sector."""
+    table = calciumTableNode.GetTable()
+    agatstonScores = table.GetColumnByName("Agatston score")
+    # Total, then one row per hinge point
+    if table.GetNumberOfRows() != 4:
+        msg = f"Calcium scoring found {table.GetNumberOfRows() - 1} sectors instead of 3"
+        raise RuntimeError(msg)
+    for row in range(1, 4):
+        if agatstonScores.GetValue(row) <= 0.0:
+            msg = f"Calcification of sector {table.GetValue(row, 0).ToString()} is not scored"
+            raise RuntimeError(msg)
+
+
+if __name__ == "__main__":
+    HaltBenchmark.run("TAVIMeasurement", sys.argv[1:], benchmark)
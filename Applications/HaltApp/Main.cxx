@@ -16,17 +16,35 @@
 ==============================================================================*/
 
 // Halt includes
+#include "qHaltAppBatchProcessor.h"
+#include "qHaltAppCLITransport.h"
+#include "qHaltAppDICOMBulkIndexer.h"
 #include "qHaltAppMainWindow.h"
+#include "qHaltAppSessionIO.h"
+#include "qHaltAppStartupTrace.h"
+#include "qHaltAppTaskScheduler.h"
 #include "Widgets/qAppStyle.h"
 
 // Slicer includes
 #include "qSlicerApplication.h"
 #include "qSlicerApplicationHelper.h"
-#include "vtkSlicerConfigure.h" // For Slicer_MAIN_PROJECT_APPLICATION_NAME
+#include "qSlicerCoreIOManager.h"
+#include "qSlicerModuleFactoryManager.h"
+#include "qSlicerModuleManager.h"
+#include "qSlicerStyle.h"
+#include "vtkSlicerConfigure.h" // For Slicer_BUILD_DICOM_SUPPORT, Slicer_MAIN_PROJECT_APPLICATION_NAME, Slicer_USE_PYTHONQT
+#ifdef Slicer_USE_PYTHONQT
+# include "qSlicerPythonManager.h"
+#endif
 #include "vtkSlicerVersionConfigure.h" // For Slicer_MAIN_PROJECT_VERSION_FULL
-// Qt includes (fonts)
+// Qt includes
+#include <QCoreApplication>
 #include <QFont>
 #include <QFontDatabase>
+#include <QTimer>
+
+// STD includes
+#include <vector>
 
 namespace
 {
@@ -36,13 +54,80 @@ int SlicerAppMain(int argc, char* argv[])
 {
   typedef qHaltAppMainWindow SlicerMainWindowType;
 
-  qSlicerApplicationHelper::preInitializeApplication(argv[0], new qAppStyle);
+  // Startup timeline, see qHaltAppStartupTrace
+  qHaltAppStartupTrace* startupTrace = qHaltAppStartupTrace::instance();
+  startupTrace->initialize(argc, argv);
+  startupTrace->beginScope("Startup");
 
+  // Headless batch processing, see qHaltAppBatchProcessor
+  qHaltAppBatchProcessor batchProcessor;
+  batchProcessor.parseArguments(argc, argv);
+  if (batchProcessor.mode() == qHaltAppBatchProcessor::CoordinatorMode)
+    {
+    // The coordinator only spawns and monitors the worker processes
+    QCoreApplication coordinatorApp(argc, argv);
+    return batchProcessor.run();
+    }
+  bool worker = batchProcessor.mode() == qHaltAppBatchProcessor::WorkerMode;
+  std::vector<char*> workerArgv(argv, argv + argc);
+  if (worker)
+    {
+    static char noMainWindow[] = "--no-main-window";
+    static char noSplash[] = "--no-splash";
+    workerArgv.push_back(noMainWindow);
+    workerArgv.push_back(noSplash);
+    argc = static_cast<int>(workerArgv.size());
+    workerArgv.push_back(nullptr);
+    argv = workerArgv.data();
+    }
+
+  startupTrace->beginScope("preInitializeApplication");
+  // Workers do not display anything, skip the custom style and its palettes
+  qSlicerApplicationHelper::preInitializeApplication(argv[0],
+    worker ? new qSlicerStyle : new qAppStyle);
+  startupTrace->endScope();
+
+  startupTrace->beginScope("qSlicerApplication");
   qSlicerApplication app(argc, argv);
+  startupTrace->endScope();
   if (app.returnCode() != -1)
     {
     return app.returnCode();
     }
+  startupTrace->observeModuleFactoryManager(app.moduleManager()->factoryManager());
+
+  // Volumes of the CLI modules exchanged through memory, see qHaltAppCLITransport
+  qHaltAppCLITransport* cliTransport = new qHaltAppCLITransport(&app);
+  cliTransport->observeModuleFactoryManager(app.moduleManager()->factoryManager());
+
+  // Halt session files (.halt), also available without main window
+  qHaltAppSessionReader* sessionReader = new qHaltAppSessionReader(&app);
+  sessionReader->setMRMLScene(app.mrmlScene());
+  app.coreIOManager()->registerIO(sessionReader);
+  qHaltAppSessionWriter* sessionWriter = new qHaltAppSessionWriter(&app);
+  sessionWriter->setMRMLScene(app.mrmlScene());
+  app.coreIOManager()->registerIO(sessionWriter);
+
+#ifdef Slicer_USE_PYTHONQT
+  if (app.pythonManager())
+    {
+    // The interpreter is initialized on the first access to the main
+    // context, unless the application constructor already did
+    startupTrace->beginScope("Python manager initialization");
+    app.pythonManager()->mainContext();
+    // Background tasks of the scripted modules, see qHaltAppTaskScheduler
+    app.pythonManager()->addObjectToPythonMain("_haltTaskScheduler", qHaltAppTaskScheduler::instance());
+    app.pythonManager()->executeString(
+      "import slicer\nslicer.haltTaskScheduler = _haltTaskScheduler\ndel _haltTaskScheduler");
+# ifdef Slicer_BUILD_DICOM_SUPPORT
+    // Bulk indexing of DICOM directory trees, see qHaltAppDICOMBulkIndexer
+    app.pythonManager()->addObjectToPythonMain("_haltDICOMBulkIndexer", new qHaltAppDICOMBulkIndexer(&app));
+    app.pythonManager()->executeString(
+      "import slicer\nslicer.haltDICOMBulkIndexer = _haltDICOMBulkIndexer\ndel _haltDICOMBulkIndexer");
+# endif
+    startupTrace->endScope();
+    }
+#endif
 
 #ifdef Q_OS_WIN
   // Prefer Microsoft YaHei for better CJK rendering on Windows.
@@ -83,8 +168,15 @@ int SlicerAppMain(int argc, char* argv[])
   QScopedPointer<SlicerMainWindowType> window;
   QScopedPointer<QSplashScreen> splashScreen;
 
+  startupTrace->beginScope("postInitializeApplication");
   qSlicerApplicationHelper::postInitializeApplication<SlicerMainWindowType>(
         app, splashScreen, window);
+  startupTrace->endScope();
+
+  if (worker)
+    {
+    return batchProcessor.processStudy(app);
+    }
 
   if (!window.isNull())
     {
@@ -92,6 +184,12 @@ int SlicerAppMain(int argc, char* argv[])
     window->setWindowTitle(windowTitle);
     }
 
+  if (startupTrace->isEnabled())
+    {
+    // Startup is considered complete once the event loop processes its first events
+    QTimer::singleShot(0, [startupTrace]() { startupTrace->write(); });
+    }
+
   return app.exec();
 }
 
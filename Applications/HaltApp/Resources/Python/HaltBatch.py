@@ -0,0 +1,80 @@
+"""Worker side of the HaltApp headless batch mode, see qHaltAppBatchProcessor.
+
+This script is executed in the worker process once the application is initialized
+and ``processStudy`` is called with the study, output directory and analysis.
+"""
+
+import importlib
+import json
+import logging
+import os
+import time
+import traceback
+from typing import Any, Callable
+
+import slicer
+
+_VOLUME_EXTENSIONS = (".nrrd", ".nhdr", ".nii", ".nii.gz", ".mha", ".mhd", ".vtk")
+
+
+def _loadStudy(studyDirectory: str) -> list[str]:
+    """Load the volume files of the study, or its DICOM files if there is no volume file."""
+    volumeFiles = []
+    for root, _, files in os.walk(studyDirectory):
+        volumeFiles += [os.path.join(root, f) for f in sorted(files) if f.lower().endswith(_VOLUME_EXTENSIONS)]
+    if volumeFiles:
+        return [slicer.util.loadVolume(f).GetID() for f in volumeFiles]
+
+    from DICOMLib import DICOMUtils
+
+    loadedNodeIDs = []
+    with DICOMUtils.TemporaryDICOMDatabase() as database:
+        DICOMUtils.importDicom(studyDirectory, database)
+        for patientUID in database.patients():
+            loadedNodeIDs += DICOMUtils.loadPatientByUID(patientUID)
+    return loadedNodeIDs
+
+
+def _resolveAnalysis(analysis: str) -> Callable:
+    moduleName, functionName = analysis.rsplit(".", 1)
+    return getattr(importlib.import_module(moduleName), functionName)
+
+
+def _saveTables(outputDirectory: str) -> None:
+    for tableNode in slicer.util.getNodesByClass("vtkMRMLTableNode"):
+        fileName = "".join(c if c.isalnum() or c in "-_ " else "_" for c in tableNode.GetName())
+        slicer.util.saveNode(tableNode, os.path.join(outputDirectory, f"{fileName}.csv"))
+
+
+def processStudy(studyDirectory: str, outputDirectory: str, analysis: str) -> int:
+    """Load, analyze and save the measurements of one study.
+
+    ``analysis`` is a "module.function" called with the IDs of the loaded nodes and the
+    output directory. Per-stage timings are written to "timings.json" in ``outputDirectory``.
+    Return the process exit code.
+    """
+    timings = {}
+    status = "Success"
+
+    def stage(name: str, function: Callable, *args: Any) -> Any:  # noqa: ANN401
+        startTime = time.perf_counter()
+        try:
+            return function(*args)
+        finally:
+            timings[name] = time.perf_counter() - startTime
+
+    try:
+        loadedNodeIDs = stage("Load", _loadStudy, studyDirectory)
+        if not loadedNodeIDs:
+            msg = f"No volume loaded from {studyDirectory}"
+            raise RuntimeError(msg)
+        analysisFunction = _resolveAnalysis(analysis)
+        stage("Analysis", analysisFunction, loadedNodeIDs, outputDirectory)
+        stage("Save", _saveTables, outputDirectory)
+    except Exception:
+        logging.error(f"Failed to process {studyDirectory}:\n{traceback.format_exc()}")
+        status = "Failed"
+
+    with open(os.path.join(outputDirectory, "timings.json"), "w") as timingsFile:
+        json.dump({"study": studyDirectory, "status": status, "timings": timings}, timingsFile, indent=2)
+    return 0 if status == "Success" else 1
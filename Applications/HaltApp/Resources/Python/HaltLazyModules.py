@@ -0,0 +1,48 @@
+"""Load on demand the modules deferred by the HaltApp lazy module loading, see qHaltAppMainWindow.
+
+This script is executed once the main window deferred the modules. Like the placeholder actions of the
+module selector, ``slicer.modules.<name>``, ``slicer.moduleNames.<Name>`` and ``slicer.util.selectModule()``
+then load a deferred module and its dependencies on first use.
+"""
+
+
+def _installDeferredModuleLoading() -> None:
+    import slicer
+    import slicer.util
+
+    def loadDeferredModule(name: str) -> bool:
+        """Load the deferred module named ``name``, or whose lowercase name is ``name``"""
+        mainWindow = slicer.util.mainWindow()
+        if mainWindow is None:
+            return False
+        for moduleName in mainWindow.deferredModuleNames():
+            if name in (moduleName, moduleName.lower()):
+                return mainWindow.loadModuleOnDemand(moduleName)
+        return False
+
+    def deferredAttributeLoader(namespace):
+        # Only called for the missing attributes of the namespace (PEP 562)
+        def __getattr__(name: str):
+            if not name.startswith("__") and loadDeferredModule(name) and name in namespace.__dict__:
+                return namespace.__dict__[name]
+            msg = f"module {namespace.__name__!r} has no attribute {name!r}"
+            raise AttributeError(msg)
+
+        return __getattr__
+
+    for namespace in (slicer.modules, slicer.moduleNames):
+        namespace.__getattr__ = deferredAttributeLoader(namespace)
+
+    selectModule = slicer.util.selectModule
+
+    def selectDeferredModule(module):
+        if isinstance(module, str):
+            loadDeferredModule(module)
+        selectModule(module)
+
+    selectDeferredModule.__doc__ = selectModule.__doc__
+    slicer.util.selectModule = selectDeferredModule
+
+
+_installDeferredModuleLoading()
+del _installDeferredModuleLoading
@@ -16,6 +16,7 @@
 ==============================================================================*/
 
 // Qt includes
+#include <QApplication>
 #include <QDebug>
 #include <QLinearGradient>
 #include <QMenuBar>
@@ -32,11 +33,25 @@
 // Halt includes
 #include "qAppStyle.h"
 
+namespace
+{
+// Upper bound of the number of tweaked palettes kept in the cache. Widgets
+// with their own palette each contribute a distinct cacheKey().
+const int MaximumPaletteCacheSize = 256;
+
+// Dynamic properties keeping the look of collapsible buttons before polish()
+const char* OriginalFlatProperty = "qAppStyleOriginalFlat";
+const char* OriginalContentsFrameShadowProperty = "qAppStyleOriginalContentsFrameShadow";
+}
+
 // --------------------------------------------------------------------------
 // qAppStyle methods
 
 // --------------------------------------------------------------------------
 qAppStyle::qAppStyle()
+  : CustomThemeEnabled(true)
+  , PaletteCacheEnabled(true)
+  , StandardPaletteValid(false)
 {
   // Slicer uses a QCleanlooksStyle as base style.
   this->setBaseStyle(new QProxyStyle(QStyleFactory::create("fusion")));
@@ -51,6 +66,10 @@ qAppStyle::~qAppStyle()
 QPalette qAppStyle::standardPalette()const
 {
   QPalette palette = this->Superclass::standardPalette();
+  if (!this->CustomThemeEnabled)
+    {
+    return palette;
+    }
 
   palette.setColor(QPalette::Active, QPalette::Window, "#eaebee");
   palette.setColor(QPalette::Inactive, QPalette::Window, "#eaebee");
@@ -81,6 +100,30 @@ QPalette qAppStyle::standardPalette()const
   return palette;
 }
 
+//------------------------------------------------------------------------------
+const QPalette& qAppStyle::cachedStandardPalette()const
+{
+  if (!this->PaletteCacheEnabled)
+    {
+    this->StandardPalette = this->standardPalette();
+    return this->StandardPalette;
+    }
+  if (!this->StandardPaletteValid)
+    {
+    this->StandardPalette = this->standardPalette();
+    this->StandardPaletteValid = true;
+    }
+  return this->StandardPalette;
+}
+
+//------------------------------------------------------------------------------
+void qAppStyle::clearPaletteCache()
+{
+  this->PaletteCache.clear();
+  this->StandardPalette = QPalette();
+  this->StandardPaletteValid = false;
+}
+
 //------------------------------------------------------------------------------
 void qAppStyle::drawComplexControl(ComplexControl control,
                                    const QStyleOptionComplex* option,
@@ -103,7 +146,8 @@ void qAppStyle::drawControl(ControlElement element,
 
   // For some reason the toolbar paint routine is not respecting the palette.
   // here we make sure the background is correctly drawn.
-  if (element == QStyle::CE_ToolBar &&
+  if (this->CustomThemeEnabled &&
+      element == QStyle::CE_ToolBar &&
       qobject_cast<const QToolBar*>(widget))
     {
     painter->fillRect(option->rect, option->palette.brush(QPalette::Window));
@@ -123,19 +167,64 @@ void qAppStyle::drawPrimitive(PrimitiveElement element,
 }
 
 //------------------------------------------------------------------------------
-QPalette qAppStyle::tweakWidgetPalette(QPalette widgetPalette,
-                                       const QWidget* widget)const
+qAppStyle::WidgetPaletteRole qAppStyle::widgetPaletteRole(const QWidget* widget)const
 {
   if (!widget)
     {
-    return widgetPalette;
+    return DefaultPaletteRole;
     }
   const QPushButton* pushButton =
     qobject_cast<const QPushButton*>(widget);
   if (pushButton &&
       !pushButton->text().isEmpty())
     {
-    QColor buttonColor = this->standardPalette().color(QPalette::Dark);
+    return PushButtonPaletteRole;
+    }
+  if (qobject_cast<const QMenuBar*>(widget))
+    {
+    return MenuBarPaletteRole;
+    }
+  return DefaultPaletteRole;
+}
+
+//------------------------------------------------------------------------------
+QPalette qAppStyle::tweakWidgetPalette(QPalette widgetPalette,
+                                       const QWidget* widget)const
+{
+  WidgetPaletteRole role = this->CustomThemeEnabled ?
+    this->widgetPaletteRole(widget) : DefaultPaletteRole;
+  if (role == DefaultPaletteRole)
+    {
+    return widgetPalette;
+    }
+  if (!this->PaletteCacheEnabled)
+    {
+    return this->computeWidgetPalette(widgetPalette, role);
+    }
+  PaletteCacheKey key(role, widgetPalette.cacheKey());
+  QHash<PaletteCacheKey, QPalette>::const_iterator it =
+    this->PaletteCache.constFind(key);
+  if (it != this->PaletteCache.constEnd())
+    {
+    return it.value();
+    }
+  if (this->PaletteCache.size() >= MaximumPaletteCacheSize)
+    {
+    this->PaletteCache.clear();
+    }
+  QPalette tweakedPalette = this->computeWidgetPalette(widgetPalette, role);
+  this->PaletteCache.insert(key, tweakedPalette);
+  return tweakedPalette;
+}
+
+//------------------------------------------------------------------------------
+QPalette qAppStyle::computeWidgetPalette(QPalette widgetPalette,
+                                         WidgetPaletteRole role)const
+{
+  const QPalette& standardPalette = this->cachedStandardPalette();
+  if (role == PushButtonPaletteRole)
+    {
+    QColor buttonColor = standardPalette.color(QPalette::Dark);
     widgetPalette.setColor(QPalette::Active, QPalette::Button, buttonColor);
     widgetPalette.setColor(QPalette::Inactive, QPalette::Button, buttonColor);
     QColor disabledButtonColor = buttonColor.toHsv();
@@ -144,7 +233,7 @@ QPalette qAppStyle::tweakWidgetPalette(QPalette widgetPalette,
                                 disabledButtonColor.valueF() * 0.9);
     widgetPalette.setColor(QPalette::Disabled, QPalette::Button, disabledButtonColor);
     QColor buttonTextColor =
-      this->standardPalette().color(QPalette::Light);
+      standardPalette.color(QPalette::Light);
     widgetPalette.setColor(QPalette::Active, QPalette::ButtonText, buttonTextColor);
     widgetPalette.setColor(QPalette::Inactive, QPalette::ButtonText, buttonTextColor);
     QColor disabledButtonTextColor = buttonTextColor.toHsv();
@@ -153,17 +242,17 @@ QPalette qAppStyle::tweakWidgetPalette(QPalette widgetPalette,
                                     disabledButtonTextColor.valueF() * 0.8);
     widgetPalette.setColor(QPalette::Disabled, QPalette::ButtonText, disabledButtonColor);
     }
-  if (qobject_cast<const QMenuBar*>(widget))
+  if (role == MenuBarPaletteRole)
     {
-    QColor highlightColor = this->standardPalette().color(QPalette::Dark);
-    //QBrush highlightBrush = this->standardPalette().brush(QPalette::Dark);
+    QColor highlightColor = standardPalette.color(QPalette::Dark);
+    //QBrush highlightBrush = standardPalette.brush(QPalette::Dark);
     QColor highlightTextColor =
-      this->standardPalette().color(QPalette::Light);
+      standardPalette.color(QPalette::Light);
     QBrush highlightTextBrush =
-      this->standardPalette().brush(QPalette::Light);
-    QColor darkColor = this->standardPalette().color(QPalette::Highlight);
+      standardPalette.brush(QPalette::Light);
+    QColor darkColor = standardPalette.color(QPalette::Highlight);
     QColor lightColor =
-      this->standardPalette().color(QPalette::HighlightedText);
+      standardPalette.color(QPalette::HighlightedText);
 
     QLinearGradient hilightGradient(0., 0., 0., 1.);
     hilightGradient.setCoordinateMode(QGradient::ObjectBoundingMode);
@@ -235,11 +324,118 @@ QPalette qAppStyle::tweakWidgetPalette(QPalette widgetPalette,
 void qAppStyle::polish(QWidget* widget)
 {
   this->Superclass::polish(widget);
+  ctkCollapsibleButton* collapsibleButton =
+    qobject_cast<ctkCollapsibleButton*>(widget);
+  if (collapsibleButton && this->CustomThemeEnabled)
+    {
+    this->polishCollapsibleButton(collapsibleButton);
+    }
+}
+
+//------------------------------------------------------------------------------
+void qAppStyle::unpolish(QWidget* widget)
+{
   ctkCollapsibleButton* collapsibleButton =
     qobject_cast<ctkCollapsibleButton*>(widget);
   if (collapsibleButton)
     {
-    collapsibleButton->setFlat(true);
-    collapsibleButton->setContentsFrameShadow(QFrame::Sunken);
+    this->unpolishCollapsibleButton(collapsibleButton);
+    }
+  this->Superclass::unpolish(widget);
+}
+
+//------------------------------------------------------------------------------
+void qAppStyle::polishCollapsibleButton(ctkCollapsibleButton* collapsibleButton)
+{
+  if (!collapsibleButton->property(OriginalFlatProperty).isValid())
+    {
+    collapsibleButton->setProperty(OriginalFlatProperty, collapsibleButton->isFlat());
+    collapsibleButton->setProperty(OriginalContentsFrameShadowProperty,
+                                   static_cast<int>(collapsibleButton->contentsFrameShadow()));
+    }
+  collapsibleButton->setFlat(true);
+  collapsibleButton->setContentsFrameShadow(QFrame::Sunken);
+}
+
+//------------------------------------------------------------------------------
+void qAppStyle::unpolishCollapsibleButton(ctkCollapsibleButton* collapsibleButton)
+{
+  QVariant flat = collapsibleButton->property(OriginalFlatProperty);
+  if (!flat.isValid())
+    {
+    return;
+    }
+  collapsibleButton->setFlat(flat.toBool());
+  collapsibleButton->setContentsFrameShadow(static_cast<QFrame::Shadow>(
+    collapsibleButton->property(OriginalContentsFrameShadowProperty).toInt()));
+  collapsibleButton->setProperty(OriginalFlatProperty, QVariant());
+  collapsibleButton->setProperty(OriginalContentsFrameShadowProperty, QVariant());
+}
+
+//------------------------------------------------------------------------------
+void qAppStyle::polish(QApplication* app)
+{
+  // The style is (re)applied to the application when the theme changes.
+  this->clearPaletteCache();
+  this->Superclass::polish(app);
+}
+
+//------------------------------------------------------------------------------
+bool qAppStyle::isCustomThemeEnabled()const
+{
+  return this->CustomThemeEnabled;
+}
+
+//------------------------------------------------------------------------------
+bool qAppStyle::isPaletteCacheEnabled()const
+{
+  return this->PaletteCacheEnabled;
+}
+
+//------------------------------------------------------------------------------
+void qAppStyle::setPaletteCacheEnabled(bool enabled)
+{
+  this->PaletteCacheEnabled = enabled;
+  this->clearPaletteCache();
+}
+
+//------------------------------------------------------------------------------
+void qAppStyle::setCustomThemeEnabled(bool enabled)
+{
+  if (enabled == this->CustomThemeEnabled)
+    {
+    return;
+    }
+  this->CustomThemeEnabled = enabled;
+  this->clearPaletteCache();
+  if (QApplication::style() != this)
+    {
+    return;
+    }
+  // Only the widgets customized in polish() need to be updated, the others
+  // get their colors from the palette.
+  foreach(QWidget* widget, QApplication::allWidgets())
+    {
+    ctkCollapsibleButton* collapsibleButton =
+      qobject_cast<ctkCollapsibleButton*>(widget);
+    if (!collapsibleButton)
+      {
+      continue;
+      }
+    if (enabled)
+      {
+      this->polishCollapsibleButton(collapsibleButton);
+      }
+    else
+      {
+      this->unpolishCollapsibleButton(collapsibleButton);
+      }
+    }
+  QApplication::setPalette(this->standardPalette());
+  // Palettes tweaked while drawing (push buttons, menu bar...) do not
+  // depend on the application palette only, repaint everything.
+  foreach(QWidget* widget, QApplication::topLevelWidgets())
+    {
+    widget->update();
     }
 }
@@ -21,13 +21,28 @@
 // Halt includes
 #include "qHaltAppExport.h"
 
+// Qt includes
+#include <QHash>
+#include <QPair>
+#include <QPalette>
+
 // Slicer includes
 #include "qSlicerStyle.h"
 
+class ctkCollapsibleButton;
+
 class Q_HALT_APP_EXPORT qAppStyle
   : public qSlicerStyle
 {
   Q_OBJECT
+  /// Whether the custom colors and widget tweaks of the application are
+  /// used. When disabled, the style looks like the plain Slicer style.
+  /// True by default.
+  Q_PROPERTY(bool customThemeEnabled READ isCustomThemeEnabled WRITE setCustomThemeEnabled)
+  /// Whether the standard and tweaked palettes are cached. Disabling the
+  /// cache computes them on every draw call, as a reference for the
+  /// repaint benchmark. True by default.
+  Q_PROPERTY(bool paletteCacheEnabled READ isPaletteCacheEnabled WRITE setPaletteCacheEnabled)
 public:
   /// Superclass typedef
   typedef qSlicerStyle Superclass;
@@ -60,14 +75,73 @@ public:
                              QPainter* painter,
                              const QWidget* widget = 0 )const;
 
+  /// Kind of palette tweak applied to a widget.
+  /// \sa widgetPaletteRole(), tweakWidgetPalette()
+  enum WidgetPaletteRole
+  {
+    DefaultPaletteRole = 0,
+    PushButtonPaletteRole,
+    MenuBarPaletteRole
+  };
+
+  /// Return the palette role used to tweak the colors of \a widget.
+  virtual WidgetPaletteRole widgetPaletteRole(const QWidget* widget)const;
+
   /// Tweak the colors of some widgets.
+  /// Tweaked palettes are cached by role and by the cacheKey() of the
+  /// incoming palette, they are only computed once per theme.
+  /// \sa clearPaletteCache()
   virtual QPalette tweakWidgetPalette(QPalette palette,
                                       const QWidget* widget)const;
 
+  /// Discard the cached standard and tweaked palettes.
+  /// Called automatically when the style is applied to the application.
+  void clearPaletteCache();
+
   /// Reimplemented to apply styling to widgets.
   /// \sa QStyle::polish()
   virtual void polish(QWidget* widget);
+  /// Reimplemented to invalidate the palette cache when the theme changes.
+  /// \sa QStyle::polish()
+  virtual void polish(QApplication* app);
   using Superclass::polish;
+  /// Reimplemented to restore the widgets modified by polish().
+  /// \sa QStyle::unpolish()
+  virtual void unpolish(QWidget* widget);
+  using Superclass::unpolish;
+
+  bool isCustomThemeEnabled()const;
+
+  bool isPaletteCacheEnabled()const;
+  void setPaletteCacheEnabled(bool enabled);
+
+public Q_SLOTS:
+  /// Switch between the custom theme and the plain Slicer theme at runtime.
+  /// The application palette is replaced and the widgets tweaked by
+  /// polish() are updated in place: unlike applying a style sheet, widgets
+  /// are not re-polished.
+  void setCustomThemeEnabled(bool enabled);
+
+protected:
+  /// Compute the tweaked palette of \a role from \a palette.
+  /// \sa tweakWidgetPalette()
+  virtual QPalette computeWidgetPalette(QPalette palette,
+                                        WidgetPaletteRole role)const;
+
+  /// Standard palette computed once and reused until the cache is cleared.
+  const QPalette& cachedStandardPalette()const;
+
+  /// Apply (resp. revert) the custom look of collapsible buttons.
+  void polishCollapsibleButton(ctkCollapsibleButton* collapsibleButton);
+  void unpolishCollapsibleButton(ctkCollapsibleButton* collapsibleButton);
+
+private:
+  bool CustomThemeEnabled;
+  bool PaletteCacheEnabled;
+  typedef QPair<int, qint64> PaletteCacheKey;
+  mutable QHash<PaletteCacheKey, QPalette> PaletteCache;
+  mutable QPalette StandardPalette;
+  mutable bool StandardPaletteValid;
 };
 
 #endif
@@ -0,0 +1,363 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTextStream>
+#include <QThread>
+
+// Slicer includes
+#include "qSlicerApplication.h"
+#include "vtkSlicerConfigure.h" // For Slicer_USE_PYTHONQT
+#ifdef Slicer_USE_PYTHONQT
+# include "qSlicerPythonManager.h"
+#endif
+
+// Halt includes
+#include "qHaltAppBatchProcessor.h"
+
+// STD includes
+#include <cstring>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Return the value of "--name <value>" or "--name=<value>" at \a index and
+/// advance \a index past it. Return a null string if argv[index] is not \a name.
+QString takeOption(int& index, int argc, char* argv[], const char* name)
+{
+  const size_t nameLength = strlen(name);
+  if (strcmp(argv[index], name) == 0 && index + 1 < argc)
+    {
+    index += 2;
+    return QString::fromLocal8Bit(argv[index - 1]);
+    }
+  if (strncmp(argv[index], name, nameLength) == 0 && argv[index][nameLength] == '=')
+    {
+    index += 1;
+    return QString::fromLocal8Bit(argv[index - 1] + nameLength + 1);
+    }
+  return QString();
+}
+
+//----------------------------------------------------------------------------
+QString pythonString(QString value)
+{
+  value.replace("\\", "\\\\").replace("'", "\\'");
+  return QString("'%1'").arg(value);
+}
+
+//----------------------------------------------------------------------------
+QString csvField(QString value)
+{
+  if (value.contains(',') || value.contains('"'))
+    {
+    value.replace("\"", "\"\"");
+    value = QString("\"%1\"").arg(value);
+    }
+  return value;
+}
+
+//----------------------------------------------------------------------------
+qint64 directorySize(const QString& path)
+{
+  qint64 size = 0;
+  QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext())
+    {
+    it.next();
+    size += it.fileInfo().size();
+    }
+  return size;
+}
+
+const qint64 MegaByte = 1024 * 1024;
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+// qHaltAppBatchProcessor methods
+
+//-----------------------------------------------------------------------------
+qHaltAppBatchProcessor::qHaltAppBatchProcessor(QObject* parent)
+  : Superclass(parent)
+  , BatchMode(NoBatchMode)
+  , Analysis("tavi_analytics.processBatchStudy")
+  , NumberOfJobs(qMax(1, QThread::idealThreadCount() / 4))
+  , MemoryLimit(8192 * MegaByte)
+  , MemoryEstimateFactor(3.0)
+{
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppBatchProcessor::~qHaltAppBatchProcessor()
+{
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppBatchProcessor::parseArguments(int& argc, char* argv[])
+{
+  int kept = 1;
+  int index = 1;
+  while (index < argc)
+    {
+    QString value;
+    if (!(value = takeOption(index, argc, argv, "--batch-input")).isNull())
+      {
+      this->InputDirectory = value;
+      }
+    else if (!(value = takeOption(index, argc, argv, "--batch-output")).isNull())
+      {
+      this->OutputDirectory = value;
+      }
+    else if (!(value = takeOption(index, argc, argv, "--batch-study")).isNull())
+      {
+      this->StudyDirectory = value;
+      }
+    else if (!(value = takeOption(index, argc, argv, "--batch-analysis")).isNull())
+      {
+      this->Analysis = value;
+      }
+    else if (!(value = takeOption(index, argc, argv, "--batch-jobs")).isNull())
+      {
+      this->NumberOfJobs = qMax(1, value.toInt());
+      }
+    else if (!(value = takeOption(index, argc, argv, "--batch-memory-limit")).isNull())
+      {
+      this->MemoryLimit = value.toLongLong() * MegaByte;
+      }
+    else
+      {
+      argv[kept++] = argv[index++];
+      }
+    }
+  if (kept < argc)
+    {
+    argv[kept] = nullptr;
+    }
+  argc = kept;
+
+  if (!this->StudyDirectory.isEmpty() && !this->OutputDirectory.isEmpty())
+    {
+    this->BatchMode = WorkerMode;
+    }
+  else if (!this->InputDirectory.isEmpty() && !this->OutputDirectory.isEmpty())
+    {
+    this->BatchMode = CoordinatorMode;
+    }
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppBatchProcessor::Mode qHaltAppBatchProcessor::mode()const
+{
+  return this->BatchMode;
+}
+
+//-----------------------------------------------------------------------------
+QList<qHaltAppBatchProcessor::Study> qHaltAppBatchProcessor::findStudies()const
+{
+  QList<Study> studies;
+  QDir inputDirectory(this->InputDirectory);
+  foreach(const QFileInfo& studyInfo,
+          inputDirectory.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name))
+    {
+    Study study;
+    study.Name = studyInfo.fileName();
+    study.InputDirectory = studyInfo.absoluteFilePath();
+    study.OutputDirectory = QDir(this->OutputDirectory).absoluteFilePath(study.Name);
+    // Loaded volumes, segmentations and intermediate images take a multiple
+    // of the size of the study on disk.
+    study.MemoryEstimate = qMax(512 * MegaByte,
+      static_cast<qint64>(directorySize(study.InputDirectory) * this->MemoryEstimateFactor));
+    study.Process = nullptr;
+    study.StartTime = 0;
+    study.WallTime = 0.;
+    study.ExitCode = -1;
+    studies << study;
+    }
+  return studies;
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppBatchProcessor::run()
+{
+  QList<Study> studies = this->findStudies();
+  if (studies.isEmpty())
+    {
+    qCritical() << "No study found in" << this->InputDirectory;
+    return EXIT_FAILURE;
+    }
+  QDir().mkpath(this->OutputDirectory);
+
+  QElapsedTimer timer;
+  timer.start();
+  QList<int> running;
+  qint64 usedMemory = 0;
+  int next = 0;
+  while (next < studies.count() || !running.isEmpty())
+    {
+    // At least one study is always running, even if it exceeds the memory limit
+    while (next < studies.count() && running.count() < this->NumberOfJobs &&
+           (running.isEmpty() || usedMemory + studies[next].MemoryEstimate <= this->MemoryLimit))
+      {
+      Study& study = studies[next];
+      study.StartTime = timer.elapsed();
+      this->startStudy(study);
+      usedMemory += study.MemoryEstimate;
+      running << next++;
+      }
+    foreach(int studyIndex, running)
+      {
+      Study& study = studies[studyIndex];
+      if (study.Process->state() != QProcess::NotRunning &&
+          !study.Process->waitForFinished(100))
+        {
+        continue;
+        }
+      study.WallTime = (timer.elapsed() - study.StartTime) / 1000.;
+      this->finishStudy(study);
+      usedMemory -= study.MemoryEstimate;
+      running.removeOne(studyIndex);
+      }
+    }
+
+  this->writeSummary(studies);
+  int failures = 0;
+  foreach(const Study& study, studies)
+    {
+    failures += (study.ExitCode != 0) ? 1 : 0;
+    }
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppBatchProcessor::startStudy(Study& study)
+{
+  QDir().mkpath(study.OutputDirectory);
+  study.Process = new QProcess(this);
+  study.Process->setProcessChannelMode(QProcess::MergedChannels);
+  study.Process->setStandardOutputFile(QDir(study.OutputDirectory).absoluteFilePath("log.txt"));
+  QStringList arguments;
+  arguments << "--batch-study" << study.InputDirectory
+            << "--batch-output" << study.OutputDirectory
+            << "--batch-analysis" << this->Analysis;
+  study.Process->start(QCoreApplication::applicationFilePath(), arguments);
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppBatchProcessor::finishStudy(Study& study)
+{
+  bool crashed = study.Process->exitStatus() != QProcess::NormalExit ||
+    study.Process->error() == QProcess::FailedToStart;
+  study.ExitCode = crashed ? -1 : study.Process->exitCode();
+  study.Status = crashed ? "Crashed" : (study.ExitCode == 0 ? "Success" : "Failed");
+  delete study.Process;
+  study.Process = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppBatchProcessor::writeSummary(const QList<Study>& studies)const
+{
+  // Stages are reported by the workers, see HaltBatch.py
+  QStringList stages;
+  QList<QJsonObject> timings;
+  foreach(const Study& study, studies)
+    {
+    QFile timingsFile(QDir(study.OutputDirectory).absoluteFilePath("timings.json"));
+    QJsonObject studyTimings;
+    if (timingsFile.open(QIODevice::ReadOnly))
+      {
+      studyTimings = QJsonDocument::fromJson(timingsFile.readAll()).object().value("timings").toObject();
+      }
+    foreach(const QString& stage, studyTimings.keys())
+      {
+      if (!stages.contains(stage))
+        {
+        stages << stage;
+        }
+      }
+    timings << studyTimings;
+    }
+
+  QString summaryFileName = QDir(this->OutputDirectory).absoluteFilePath("summary.csv");
+  QFile summaryFile(summaryFileName);
+  if (!summaryFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+    qCritical() << "Failed to write" << summaryFileName;
+    return false;
+    }
+  QTextStream stream(&summaryFile);
+  stream << "Study,Status,ExitCode,WallTime (s)";
+  foreach(const QString& stage, stages)
+    {
+    stream << "," << csvField(stage + " (s)");
+    }
+  stream << "\n";
+  for (int studyIndex = 0; studyIndex < studies.count(); ++studyIndex)
+    {
+    const Study& study = studies[studyIndex];
+    stream << csvField(study.Name) << "," << study.Status << "," << study.ExitCode
+           << "," << study.WallTime;
+    foreach(const QString& stage, stages)
+      {
+      stream << ",";
+      if (timings[studyIndex].contains(stage))
+        {
+        stream << timings[studyIndex].value(stage).toDouble();
+        }
+      }
+    stream << "\n";
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppBatchProcessor::processStudy(qSlicerApplication& app)
+{
+#ifdef Slicer_USE_PYTHONQT
+  qSlicerPythonManager* pythonManager = app.pythonManager();
+  QFile scriptFile(":/Python/HaltBatch.py");
+  if (!pythonManager || !scriptFile.open(QIODevice::ReadOnly))
+    {
+    qCritical() << "Batch processing requires Python";
+    return EXIT_FAILURE;
+    }
+  pythonManager->executeString(QString::fromUtf8(scriptFile.readAll()));
+  QVariant result = pythonManager->executeString(
+    QString("processStudy(%1, %2, %3)")
+      .arg(pythonString(this->StudyDirectory))
+      .arg(pythonString(this->OutputDirectory))
+      .arg(pythonString(this->Analysis)),
+    ctkAbstractPythonManager::EvalInput);
+  if (pythonManager->pythonErrorOccured())
+    {
+    return EXIT_FAILURE;
+    }
+  return result.toInt();
+#else
+  Q_UNUSED(app);
+  qCritical() << "Batch processing requires Python";
+  return EXIT_FAILURE;
+#endif
+}
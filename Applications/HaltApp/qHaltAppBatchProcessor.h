@@ -0,0 +1,109 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qHaltAppBatchProcessor_h
+#define __qHaltAppBatchProcessor_h
+
+// Qt includes
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+// Halt includes
+#include "qHaltAppExport.h"
+
+class QProcess;
+class qSlicerApplication;
+
+/// \brief Headless batch processing of a directory of studies.
+///
+/// Each sub-directory of the input directory is a study (DICOM files or
+/// volume files). Studies are processed by worker processes, each running
+/// HaltApp without main window, splash screen nor custom style:
+///
+/// \code
+/// HaltApp --batch-input <dir> --batch-output <dir> [--batch-jobs <n>]
+///         [--batch-memory-limit <MB>] [--batch-analysis <module.function>]
+/// \endcode
+///
+/// The coordinator only requires a QCoreApplication. It starts a new worker
+/// as long as the number of running workers is below the number of jobs and
+/// the memory estimated for the running studies stays below the limit.
+///
+/// Each worker writes its measurements (one CSV file per table node) and
+/// a "timings.json" file with per-stage timings in <output>/<study>.
+/// The coordinator writes "summary.csv" in the output directory.
+class Q_HALT_APP_EXPORT qHaltAppBatchProcessor : public QObject
+{
+  Q_OBJECT
+public:
+  typedef QObject Superclass;
+  qHaltAppBatchProcessor(QObject* parent = nullptr);
+  virtual ~qHaltAppBatchProcessor();
+
+  enum Mode
+  {
+    NoBatchMode = 0,
+    CoordinatorMode,
+    WorkerMode
+  };
+
+  /// Parse and remove the batch arguments from \a argv.
+  /// Must be called before creating the application.
+  void parseArguments(int& argc, char* argv[]);
+
+  Mode mode()const;
+
+  /// Process all the studies of the input directory using worker processes.
+  /// Return 0 if all the studies were processed successfully.
+  int run();
+
+  /// Process the study given by "--batch-study" in the current application.
+  /// Called in the worker processes, after the application is initialized.
+  int processStudy(qSlicerApplication& app);
+
+protected:
+  struct Study
+  {
+    QString Name;
+    QString InputDirectory;
+    QString OutputDirectory;
+    qint64 MemoryEstimate; // in bytes
+    QProcess* Process;
+    qint64 StartTime; // in ms
+    double WallTime; // in s
+    int ExitCode;
+    QString Status;
+  };
+
+  QList<Study> findStudies()const;
+  void startStudy(Study& study);
+  void finishStudy(Study& study);
+  bool writeSummary(const QList<Study>& studies)const;
+
+  Mode BatchMode;
+  QString InputDirectory;
+  QString OutputDirectory;
+  QString StudyDirectory;
+  QString Analysis;
+  int NumberOfJobs;
+  qint64 MemoryLimit; // in bytes
+  double MemoryEstimateFactor;
+
+private:
+  Q_DISABLE_COPY(qHaltAppBatchProcessor);
+};
+
+#endif
@@ -0,0 +1,201 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QLibrary>
+#include <QSettings>
+#include <QStorageInfo>
+
+// Slicer includes
+#include "qSlicerCLIModule.h"
+#include "qSlicerCoreApplication.h"
+#include "qSlicerModuleFactoryManager.h"
+#include "vtkSlicerCLIModuleLogic.h"
+
+// SlicerExecutionModel includes
+#include <ModuleDescription.h>
+
+// Halt includes
+#include "qHaltAppCLITransport.h"
+
+// STD includes
+#include <cstdio>
+
+namespace
+{
+/// Default of the "CLI/MinimumSharedMemory" setting, in MB
+const int DefaultMinimumSharedMemory = 4096;
+/// Default of the "CLI/InProcessModules" setting: the resampling of the
+/// volumes, whose transfer through files costs more than the algorithm
+const char* DefaultInProcessModules[] = { "ResampleScalarVectorDWIVolume", "ResampleDTIVolume" };
+}
+
+//-----------------------------------------------------------------------------
+// qHaltAppCLITransport methods
+
+//-----------------------------------------------------------------------------
+qHaltAppCLITransport::qHaltAppCLITransport(QObject* parent)
+  : Superclass(parent)
+  , FactoryManager(nullptr)
+  , SharedMemory(false)
+{
+  QStringList defaultInProcessModules;
+  for (const char* moduleName : DefaultInProcessModules)
+    {
+    defaultInProcessModules << moduleName;
+    }
+  foreach(const QString& moduleName,
+          QSettings().value("CLI/InProcessModules", defaultInProcessModules).toStringList())
+    {
+    this->InProcessModules << moduleName.trimmed();
+    }
+  this->removeStaleExchangeDirectories();
+  this->setupExchangeDirectory();
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppCLITransport::~qHaltAppCLITransport()
+{
+  // Files left by interrupted modules would hold memory until reboot
+  if (this->SharedMemory)
+    {
+    QDir(this->ExchangeDirectory).removeRecursively();
+    }
+}
+
+//-----------------------------------------------------------------------------
+QString qHaltAppCLITransport::exchangeDirectory()const
+{
+  return this->ExchangeDirectory;
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppCLITransport::isSharedMemory()const
+{
+  return this->SharedMemory;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppCLITransport::setupExchangeDirectory()
+{
+  QSettings settings;
+  this->ExchangeDirectory = settings.value("CLI/ExchangeDirectory").toString();
+  if (!this->ExchangeDirectory.isEmpty())
+    {
+    QDir().mkpath(this->ExchangeDirectory);
+    return;
+    }
+
+#ifdef Q_OS_LINUX
+  QStorageInfo sharedMemory("/dev/shm");
+  qint64 minimumSize = settings.value("CLI/MinimumSharedMemory", DefaultMinimumSharedMemory).toLongLong() << 20;
+  if (sharedMemory.isValid() && sharedMemory.fileSystemType() == "tmpfs"
+      && sharedMemory.bytesAvailable() >= minimumSize)
+    {
+    // One directory per process, removed when the application exits
+    QString directory = QString("/dev/shm/%1-CLI-%2")
+      .arg(QCoreApplication::applicationName()).arg(QCoreApplication::applicationPid());
+    if (QDir().mkpath(directory) && QFileInfo(directory).isWritable())
+      {
+      this->ExchangeDirectory = directory;
+      this->SharedMemory = true;
+      return;
+      }
+    }
+#endif
+  // Fallback to files
+  qSlicerCoreApplication* app = qSlicerCoreApplication::application();
+  this->ExchangeDirectory = app ? app->temporaryPath() : QDir::tempPath();
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppCLITransport::removeStaleExchangeDirectories()
+{
+#ifdef Q_OS_LINUX
+  // Directories of crashed or killed processes are never removed otherwise,
+  // their files hold memory until reboot
+  const QString prefix = QString("%1-CLI-").arg(QCoreApplication::applicationName());
+  QDir sharedMemory("/dev/shm");
+  foreach(const QString& directory, sharedMemory.entryList(QStringList() << prefix + "*", QDir::Dirs))
+    {
+    bool ok = false;
+    const qint64 pid = directory.mid(prefix.size()).toLongLong(&ok);
+    if (!ok || pid == QCoreApplication::applicationPid() || QFileInfo::exists(QString("/proc/%1").arg(pid)))
+      {
+      continue;
+      }
+    QDir(sharedMemory.filePath(directory)).removeRecursively();
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppCLITransport::observeModuleFactoryManager(
+  qSlicerModuleFactoryManager* factoryManager)
+{
+  this->FactoryManager = factoryManager;
+  if (!factoryManager)
+    {
+    return;
+    }
+  // Modules loaded on demand are configured when they are loaded
+  QObject::connect(factoryManager, SIGNAL(moduleLoaded(QString)),
+                   this, SLOT(onModuleLoaded(QString)));
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppCLITransport::onModuleLoaded(const QString& moduleName)
+{
+  qSlicerCLIModule* module = qobject_cast<qSlicerCLIModule*>(
+    this->FactoryManager->loadedModule(moduleName));
+  if (!module || !module->cliModuleLogic())
+    {
+    return;
+    }
+  // In-process modules receive the nodes by reference, the directory is
+  // only used by executables.
+  if (module->moduleType() == "CommandLineModule"
+      && !(this->InProcessModules.contains(moduleName) && this->runInProcess(module)))
+    {
+    module->cliModuleLogic()->SetTemporaryDirectory(this->ExchangeDirectory.toUtf8().constData());
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppCLITransport::runInProcess(qSlicerCLIModule* module)
+{
+  // The shared library of a CLI is built next to its executable
+  QFileInfo executable(module->path());
+  QLibrary library(executable.dir().filePath(executable.completeBaseName() + "Lib"));
+  void* entryPoint = library.load() ? reinterpret_cast<void*>(library.resolve("ModuleEntryPoint")) : nullptr;
+  if (!entryPoint)
+    {
+    qWarning() << "Failed to run" << module->name() << "in process, it is run as an executable:"
+               << library.errorString();
+    return false;
+    }
+  // The entry point address is decoded by the CLI module logic using sscanf
+  char target[256];
+  snprintf(target, sizeof(target), "slicer:%p", entryPoint);
+  vtkSlicerCLIModuleLogic* logic = module->cliModuleLogic();
+  ModuleDescription description = logic->GetDefaultModuleDescription();
+  description.SetType("SharedObjectModule");
+  description.SetTarget(target);
+  logic->SetDefaultModuleDescription(description);
+  return true;
+}
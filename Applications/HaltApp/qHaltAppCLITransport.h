@@ -0,0 +1,90 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qHaltAppCLITransport_h
+#define __qHaltAppCLITransport_h
+
+// Qt includes
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+// Halt includes
+#include "qHaltAppExport.h"
+
+class qSlicerCLIModule;
+class qSlicerModuleFactoryManager;
+
+/// \brief Exchange of the volumes of the CLI modules through memory.
+///
+/// CLI modules are run either in process, from their shared library, or as
+/// executables. In process, input and output nodes are passed to the module
+/// by reference ("slicer:" URIs): no data is copied nor written. Executables
+/// are preferred by default, they isolate the application from the crashes
+/// of the modules: the modules listed by the "CLI/InProcessModules" setting
+/// (the resampling modules of the pipeline by default) are switched to their
+/// shared library when they are loaded, if it is installed next to their
+/// executable.
+///
+/// Executables exchange data through files in the temporary directory of
+/// their module logic. This class sets it to a directory backed by shared
+/// memory (/dev/shm on Linux) as long as it has "CLI/MinimumSharedMemory"
+/// MB available, so that writing and reading the files does not cause disk
+/// I/O. Otherwise, or where there is no such file system, the files of the
+/// temporary directory of the application are used. The directory can also
+/// be set with the "CLI/ExchangeDirectory" setting. The shared memory
+/// directories left by the processes that did not exit are removed at
+/// startup.
+class Q_HALT_APP_EXPORT qHaltAppCLITransport : public QObject
+{
+  Q_OBJECT
+public:
+  typedef QObject Superclass;
+  qHaltAppCLITransport(QObject* parent = nullptr);
+  virtual ~qHaltAppCLITransport();
+
+  /// Directory of the files exchanged with the CLI executables.
+  QString exchangeDirectory()const;
+
+  /// Return true if the exchange directory is backed by memory.
+  bool isSharedMemory()const;
+
+  /// Configure the CLI modules as soon as they are loaded.
+  void observeModuleFactoryManager(qSlicerModuleFactoryManager* factoryManager);
+
+protected slots:
+  void onModuleLoaded(const QString& moduleName);
+
+protected:
+  /// Choose and create the exchange directory.
+  void setupExchangeDirectory();
+
+  /// Remove the shared memory exchange directories of the processes that
+  /// are not running anymore.
+  void removeStaleExchangeDirectories();
+
+  /// Run the executable \a module from its shared library, like the CLI
+  /// loadable module factory does. Return false if it is not installed.
+  bool runInProcess(qSlicerCLIModule* module);
+
+  qSlicerModuleFactoryManager* FactoryManager;
+  QString ExchangeDirectory;
+  bool SharedMemory;
+  QStringList InProcessModules;
+
+private:
+  Q_DISABLE_COPY(qHaltAppCLITransport);
+};
+
+#endif
@@ -0,0 +1,447 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QSettings>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QVector>
+
+// CTK includes
+#include <ctkDICOMDatabase.h>
+#include <ctkDICOMItem.h>
+
+// DCMTK includes
+#include <dcmtk/dcmdata/dcdeftag.h>
+#include <dcmtk/dcmdata/dcfilefo.h>
+
+// Slicer includes
+#include "qSlicerCoreApplication.h"
+
+// Halt includes
+#include "qHaltAppDICOMBulkIndexer.h"
+
+// STD includes
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/// Default of the "DICOM/BulkIndexBatchSize" setting
+const int DefaultBatchSize = 1000;
+
+/// Longer values (pixel data, overlays, private blobs) are skipped when parsing
+const Uint32 MaximumHeaderValueLength = 1024;
+
+/// Tags of the patient, study, series and instance tables of the database
+const DcmTagKey HierarchyTags[] = {
+  DCM_SpecificCharacterSet,
+  DCM_PatientName, DCM_PatientID, DCM_PatientBirthDate, DCM_PatientBirthTime, DCM_PatientSex,
+  DCM_PatientAge, DCM_PatientComments,
+  DCM_StudyInstanceUID, DCM_StudyID, DCM_StudyDate, DCM_StudyTime, DCM_AccessionNumber,
+  DCM_ModalitiesInStudy, DCM_InstitutionName, DCM_PerformingPhysicianName, DCM_ReferringPhysicianName,
+  DCM_StudyDescription,
+  DCM_SeriesInstanceUID, DCM_SeriesDate, DCM_SeriesTime, DCM_SeriesDescription, DCM_Modality,
+  DCM_BodyPartExamined, DCM_FrameOfReferenceUID, DCM_AcquisitionNumber, DCM_ContrastBolusAgent,
+  DCM_ScanningSequence, DCM_EchoNumbers, DCM_TemporalPositionIdentifier, DCM_SeriesNumber,
+  DCM_SOPClassUID, DCM_SOPInstanceUID, DCM_InstanceNumber
+};
+
+//----------------------------------------------------------------------------
+struct ParsedFile
+{
+  enum Status
+  {
+    Parsed = 0,
+    Unchanged,
+    Failed
+  };
+  int Index;
+  Status FileStatus;
+  QByteArray Hash;
+  QSharedPointer<ctkDICOMItem> Dataset;
+};
+
+//----------------------------------------------------------------------------
+/// Parse the header of \a filePath, keeping only \a tags, and set \a hash to
+/// the MD5 hash of their values.
+/// Return a null pointer if the file is not a DICOM instance.
+QSharedPointer<ctkDICOMItem> parseHeader(const QString& filePath, const QVector<DcmTagKey>& tags,
+  QByteArray& hash)
+{
+  DcmFileFormat fileFormat;
+  OFCondition status = fileFormat.loadFile(OFFilename(QFile::encodeName(filePath).constData()),
+    EXS_Unknown, EGL_noChange, MaximumHeaderValueLength);
+  DcmDataset* dataset = fileFormat.getDataset();
+  if (status.bad() || !dataset || !dataset->tagExistsWithValue(DCM_SOPInstanceUID))
+    {
+    return QSharedPointer<ctkDICOMItem>();
+    }
+  DcmDataset* header = new DcmDataset;
+  QCryptographicHash headerHash(QCryptographicHash::Md5);
+  for (const DcmTagKey& tag : tags)
+    {
+    DcmElement* element = nullptr;
+    if (dataset->findAndGetElement(tag, element).good() && element)
+      {
+      OFString value;
+      element->getOFStringArray(value);
+      headerHash.addData(QByteArray(tag.toString().c_str()));
+      headerHash.addData(QByteArray(value.c_str(), static_cast<int>(value.length())));
+      header->insert(OFstatic_cast(DcmElement*, element->clone()));
+      }
+    }
+  hash = headerHash.result();
+  QSharedPointer<ctkDICOMItem> item(new ctkDICOMItem);
+  item->InitializeFromDataset(header, /* takeOwnership = */ true);
+  return item;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+// qHaltAppDICOMBulkIndexer methods
+
+//-----------------------------------------------------------------------------
+qHaltAppDICOMBulkIndexer::qHaltAppDICOMBulkIndexer(QObject* parent)
+  : Superclass(parent)
+  , CancelRequested(false)
+  , FoundFileCount(0)
+  , SkippedFileCount(0)
+  , IndexedFileCount(0)
+  , FailedFileCount(0)
+{
+  this->ManifestConnectionName = QString("HaltDICOMBulkIndexer%1").arg(reinterpret_cast<quintptr>(this));
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppDICOMBulkIndexer::~qHaltAppDICOMBulkIndexer()
+{
+  this->closeManifest();
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppDICOMBulkIndexer::setDatabase(ctkDICOMDatabase* database)
+{
+  this->Database = database;
+}
+
+//-----------------------------------------------------------------------------
+ctkDICOMDatabase* qHaltAppDICOMBulkIndexer::database()const
+{
+  if (this->Database)
+    {
+    return this->Database;
+    }
+  qSlicerCoreApplication* app = qSlicerCoreApplication::application();
+  return app ? app->dicomDatabase() : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppDICOMBulkIndexer::foundFileCount()const
+{
+  return this->FoundFileCount;
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppDICOMBulkIndexer::skippedFileCount()const
+{
+  return this->SkippedFileCount;
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppDICOMBulkIndexer::indexedFileCount()const
+{
+  return this->IndexedFileCount;
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppDICOMBulkIndexer::failedFileCount()const
+{
+  return this->FailedFileCount;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppDICOMBulkIndexer::cancel()
+{
+  this->CancelRequested = true;
+}
+
+//-----------------------------------------------------------------------------
+QString qHaltAppDICOMBulkIndexer::manifestFileName()const
+{
+  ctkDICOMDatabase* database = this->database();
+  return database ? QDir(database->databaseDirectory()).filePath("HaltBulkIndex.sql") : QString();
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppDICOMBulkIndexer::openManifest()
+{
+  this->closeManifest();
+  QSqlDatabase manifest = QSqlDatabase::addDatabase("QSQLITE", this->ManifestConnectionName);
+  manifest.setDatabaseName(this->manifestFileName());
+  bool opened = manifest.open();
+  QSqlQuery query(manifest);
+  if (!opened
+      || !query.exec("CREATE TABLE IF NOT EXISTS Files (Path TEXT PRIMARY KEY, Size INTEGER,"
+                     " ModifiedTime INTEGER, Hash BLOB, Indexed INTEGER)")
+      || !query.exec("SELECT Path, Size, ModifiedTime, Hash, Indexed FROM Files"))
+    {
+    qWarning() << "Bulk DICOM indexing: failed to open" << this->manifestFileName() << ":"
+               << manifest.lastError().text();
+    return false;
+    }
+  while (query.next())
+    {
+    FileRecord& record = this->IndexedFiles[query.value(0).toString()];
+    record.Size = query.value(1).toLongLong();
+    record.ModifiedTime = query.value(2).toLongLong();
+    record.Hash = query.value(3).toByteArray();
+    record.Indexed = query.value(4).toBool();
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppDICOMBulkIndexer::closeManifest()
+{
+  this->IndexedFiles.clear();
+  if (QSqlDatabase::contains(this->ManifestConnectionName))
+    {
+    QSqlDatabase::database(this->ManifestConnectionName, false).close();
+    QSqlDatabase::removeDatabase(this->ManifestConnectionName);
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppDICOMBulkIndexer::saveManifest(const QHash<QString, FileRecord>& records)
+{
+  QSqlDatabase manifest = QSqlDatabase::database(this->ManifestConnectionName, false);
+  manifest.transaction();
+  QSqlQuery query(manifest);
+  query.prepare("INSERT OR REPLACE INTO Files (Path, Size, ModifiedTime, Hash, Indexed) VALUES (?, ?, ?, ?, ?)");
+  for (QHash<QString, FileRecord>::const_iterator it = records.constBegin(); it != records.constEnd(); ++it)
+    {
+    query.addBindValue(it.key());
+    query.addBindValue(it.value().Size);
+    query.addBindValue(it.value().ModifiedTime);
+    query.addBindValue(it.value().Hash);
+    query.addBindValue(it.value().Indexed);
+    if (!query.exec())
+      {
+      manifest.rollback();
+      return false;
+      }
+    }
+  return manifest.commit();
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppDICOMBulkIndexer::indexDirectory(const QString& directory)
+{
+  this->FoundFileCount = 0;
+  this->SkippedFileCount = 0;
+  this->IndexedFileCount = 0;
+  this->FailedFileCount = 0;
+  this->CancelRequested = false;
+  ctkDICOMDatabase* database = this->database();
+  if (!database || !database->isOpen())
+    {
+    qCritical() << "Bulk DICOM indexing: the DICOM database is not open";
+    return false;
+    }
+  if (!this->openManifest())
+    {
+    return false;
+    }
+
+  // Files of the database, re-indexed if they were removed from it
+  const QStringList databaseFileList = database->allFiles();
+  const QSet<QString> databaseFiles(databaseFileList.begin(), databaseFileList.end());
+
+  // List the files, skipping the ones with the size and time of their last indexing
+  QStringList filePaths;
+  QVector<FileRecord> fileRecords;
+  QDirIterator it(directory, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+  while (it.hasNext())
+    {
+    it.next();
+    const QFileInfo fileInfo = it.fileInfo();
+    const QString filePath = fileInfo.absoluteFilePath();
+    ++this->FoundFileCount;
+    FileRecord fileRecord;
+    fileRecord.Size = fileInfo.size();
+    fileRecord.ModifiedTime = fileInfo.lastModified().toMSecsSinceEpoch();
+    fileRecord.Indexed = false;
+    QHash<QString, FileRecord>::const_iterator record = this->IndexedFiles.constFind(filePath);
+    if (record != this->IndexedFiles.constEnd() && record->Size == fileRecord.Size
+        && record->ModifiedTime == fileRecord.ModifiedTime
+        && (!record->Indexed || databaseFiles.contains(filePath)))
+      {
+      ++this->SkippedFileCount;
+      continue;
+      }
+    filePaths << filePath;
+    fileRecords << fileRecord;
+    }
+  const int fileCount = filePaths.count();
+  filePaths.squeeze();
+
+  QVector<DcmTagKey> tags(std::begin(HierarchyTags), std::end(HierarchyTags));
+  foreach(const QString& tag, database->tagsToPrecache())
+    {
+    const QStringList groupElement = tag.split(',');
+    if (groupElement.count() == 2)
+      {
+      tags << DcmTagKey(groupElement[0].toUShort(nullptr, 16), groupElement[1].toUShort(nullptr, 16));
+      }
+    }
+
+  // Workers parse the files, the records and the files of the database are
+  // only read until they are joined.
+  QSettings settings;
+  int threadCount = settings.value("DICOM/BulkIndexThreads", 0).toInt();
+  if (threadCount <= 0)
+    {
+    threadCount = QThread::idealThreadCount();
+    }
+  threadCount = qBound(1, threadCount, qMax(1, fileCount));
+  const int batchSize = qMax(1, settings.value("DICOM/BulkIndexBatchSize", DefaultBatchSize).toInt());
+  std::atomic<int> nextFile(0);
+  std::atomic<bool> stopRequested(false);
+  std::mutex resultsMutex;
+  std::condition_variable resultsCondition;
+  std::deque<ParsedFile> results;
+  std::vector<std::thread> workers;
+  const QHash<QString, FileRecord>& indexedFiles = this->IndexedFiles;
+  for (int threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+    workers.emplace_back([&]()
+      {
+      for (int index = nextFile++; index < fileCount && !stopRequested; index = nextFile++)
+        {
+        const QString& filePath = filePaths.at(index);
+        ParsedFile parsedFile;
+        parsedFile.Index = index;
+        parsedFile.Dataset = parseHeader(filePath, tags, parsedFile.Hash);
+        QHash<QString, FileRecord>::const_iterator record = indexedFiles.constFind(filePath);
+        if (!parsedFile.Dataset)
+          {
+          parsedFile.FileStatus = ParsedFile::Failed;
+          }
+        else if (record != indexedFiles.constEnd() && record->Indexed && record->Hash == parsedFile.Hash
+                 && databaseFiles.contains(filePath))
+          {
+          // Touched or copied back, the indexed tags are the same
+          parsedFile.FileStatus = ParsedFile::Unchanged;
+          parsedFile.Dataset.clear();
+          }
+        else
+          {
+          parsedFile.FileStatus = ParsedFile::Parsed;
+          }
+        std::lock_guard<std::mutex> lock(resultsMutex);
+        results.push_back(parsedFile);
+        resultsCondition.notify_one();
+        }
+      });
+    }
+
+  // Insert the parsed files by batches, one transaction each
+  QList<ctkDICOMDatabase::IndexingResult> batch;
+  QHash<QString, FileRecord> batchRecords;
+  int processedFileCount = 0;
+  while (processedFileCount < fileCount && !this->CancelRequested)
+    {
+    std::deque<ParsedFile> newResults;
+      {
+      std::unique_lock<std::mutex> lock(resultsMutex);
+      resultsCondition.wait_for(lock, std::chrono::milliseconds(100), [&results]() { return !results.empty(); });
+      newResults.swap(results);
+      }
+    for (const ParsedFile& parsedFile : newResults)
+      {
+      const QString& filePath = filePaths[parsedFile.Index];
+      FileRecord fileRecord = fileRecords[parsedFile.Index];
+      fileRecord.Hash = parsedFile.Hash;
+      fileRecord.Indexed = parsedFile.FileStatus != ParsedFile::Failed;
+      batchRecords[filePath] = fileRecord;
+      if (parsedFile.FileStatus == ParsedFile::Parsed)
+        {
+        ctkDICOMDatabase::IndexingResult indexingResult;
+        indexingResult.filePath = filePath;
+        indexingResult.dataset = parsedFile.Dataset;
+        indexingResult.copyFile = false;
+        indexingResult.overwriteExistingDataset = indexedFiles.contains(filePath);
+        batch << indexingResult;
+        }
+      else if (parsedFile.FileStatus == ParsedFile::Unchanged)
+        {
+        ++this->SkippedFileCount;
+        }
+      else
+        {
+        ++this->FailedFileCount;
+        }
+      }
+    processedFileCount += static_cast<int>(newResults.size());
+    if (batch.count() >= batchSize || batchRecords.count() >= batchSize || processedFileCount == fileCount)
+      {
+      if (!batch.isEmpty())
+        {
+        database->insert(batch);
+        this->IndexedFileCount += batch.count();
+        batch.clear();
+        }
+      this->saveManifest(batchRecords);
+      batchRecords.clear();
+      }
+    emit this->progress(processedFileCount, fileCount);
+    QCoreApplication::processEvents();
+    }
+  stopRequested = true;
+  for (std::thread& worker : workers)
+    {
+    worker.join();
+    }
+  // Keep the work done before the cancellation
+  if (!batch.isEmpty())
+    {
+    database->insert(batch);
+    this->IndexedFileCount += batch.count();
+    }
+  if (!batchRecords.isEmpty())
+    {
+    this->saveManifest(batchRecords);
+    }
+  this->closeManifest();
+  return !this->CancelRequested;
+}
@@ -0,0 +1,115 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qHaltAppDICOMBulkIndexer_h
+#define __qHaltAppDICOMBulkIndexer_h
+
+// Qt includes
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+// Halt includes
+#include "qHaltAppExport.h"
+
+// STD includes
+#include <atomic>
+
+class ctkDICOMDatabase;
+
+/// \brief Index large directory trees of DICOM files into the DICOM database.
+///
+/// Made for PACS exports of hundreds of studies:
+/// - the files are listed first, then their headers are parsed by a pool of
+///   worker threads ("DICOM/BulkIndexThreads", ideal thread count if 0),
+///   keeping only the tags of the patient/study/series/instance hierarchy and
+///   the tags precached by the database. Pixel data is not read.
+/// - the parsed files are inserted in the database by the calling thread, in
+///   transactions of "DICOM/BulkIndexBatchSize" files.
+/// - indexing is incremental: the size, modification time and the MD5 hash of
+///   the indexed tags of the files are kept next to the database. Files with
+///   the same size and modification time are skipped without being read, files
+///   whose indexed tags have the same hash (touched or copied) are parsed but
+///   not inserted again.
+///
+/// Files are indexed in place (not copied in the database directory).
+/// Events are processed between transactions, indexDirectory() can be
+/// canceled from the progress() signal handlers.
+///
+/// Scripted modules use it through slicer.haltDICOMBulkIndexer:
+/// \code
+/// slicer.haltDICOMBulkIndexer.indexDirectory("/data/pacs-export")
+/// \endcode
+class Q_HALT_APP_EXPORT qHaltAppDICOMBulkIndexer : public QObject
+{
+  Q_OBJECT
+public:
+  typedef QObject Superclass;
+  qHaltAppDICOMBulkIndexer(QObject* parent = nullptr);
+  virtual ~qHaltAppDICOMBulkIndexer();
+
+  /// Database the files are indexed in, the database of the application by default.
+  void setDatabase(ctkDICOMDatabase* database);
+  ctkDICOMDatabase* database()const;
+
+  /// Statistics of the last indexDirectory()
+  Q_INVOKABLE int foundFileCount()const;
+  Q_INVOKABLE int skippedFileCount()const;
+  Q_INVOKABLE int indexedFileCount()const;
+  Q_INVOKABLE int failedFileCount()const;
+
+public slots:
+  /// Index the DICOM files of \a directory and its sub-directories.
+  /// Return false if the database is not open or if indexing was canceled.
+  bool indexDirectory(const QString& directory);
+
+  /// Stop indexDirectory() after the current transaction.
+  void cancel();
+
+signals:
+  /// Emitted after each transaction, \a processed of \a total files to read.
+  void progress(int processed, int total);
+
+protected:
+  struct FileRecord
+  {
+    qint64 Size;
+    qint64 ModifiedTime; // in ms since epoch
+    QByteArray Hash; // of the values of the indexed tags
+    bool Indexed; // false for files that are not DICOM or not readable
+  };
+
+  /// Files read by the previous runs, kept next to the database.
+  QString manifestFileName()const;
+  bool openManifest();
+  void closeManifest();
+  bool saveManifest(const QHash<QString, FileRecord>& records);
+
+  QPointer<ctkDICOMDatabase> Database;
+  QString ManifestConnectionName;
+  QHash<QString, FileRecord> IndexedFiles;
+  std::atomic<bool> CancelRequested;
+
+  int FoundFileCount;
+  int SkippedFileCount;
+  int IndexedFileCount;
+  int FailedFileCount;
+
+private:
+  Q_DISABLE_COPY(qHaltAppDICOMBulkIndexer);
+};
+
+#endif
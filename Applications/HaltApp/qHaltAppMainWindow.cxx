@@ -16,25 +16,57 @@
 ==============================================================================*/
 
 // Halt includes
+#include "qHaltAppDICOMBulkIndexer.h"
 #include "qHaltAppMainWindow.h"
 #include "qHaltAppMainWindow_p.h"
+#include "qHaltAppPerformanceWidget.h"
+#include "qHaltAppSessionFile.h"
+#include "qHaltAppStallWatchdog.h"
+#include "qHaltAppStartupTrace.h"
+#include "qHaltAppTaskProgressWidget.h"
+#include "qHaltAppTaskScheduler.h"
 
 // Qt includes
+#include <QAction>
+#include <QDebug>
 #include <QDesktopWidget>
+#include <QDir>
+#include <QFile>
+#include <QFileDialog>
 #include <QLabel>
+#include <QMenu>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QSettings>
+#include <QStatusBar>
+#include <QTimer>
+#include <QToolBar>
 
 // Slicer includes
+#include "qSlicerAbstractCoreModule.h"
 #include "qSlicerApplication.h"
 #include "qSlicerAboutDialog.h"
 #include "qSlicerMainWindow_p.h"
+#include "qSlicerModuleFactoryManager.h"
+#include "qSlicerModuleManager.h"
+#include "qSlicerModulesMenu.h"
 #include "qSlicerModuleSelectorToolBar.h"
 #include "qMRMLWidget.h"
+#include "vtkSlicerConfigure.h" // For Slicer_BUILD_DICOM_SUPPORT, Slicer_USE_PYTHONQT
+#ifdef Slicer_USE_PYTHONQT
+# include "qSlicerPythonManager.h"
+#endif
 
 //-----------------------------------------------------------------------------
 // qHaltAppMainWindowPrivate methods
 
 qHaltAppMainWindowPrivate::qHaltAppMainWindowPrivate(qHaltAppMainWindow& object)
   : Superclass(object)
+  , LazyModuleLoading(false)
+  , StallWatchdog(nullptr)
+  , PerformanceWidget(nullptr)
+  , ViewPerformanceMonitorAction(nullptr)
+  , TaskProgressWidget(nullptr)
 {
 }
 
@@ -51,11 +83,218 @@ void qHaltAppMainWindowPrivate::init()
 #endif
   Q_Q(qHaltAppMainWindow);
   this->Superclass::init();
+
+  QSettings settings;
+  this->LazyModuleLoading = settings.value("Modules/LazyLoading", true).toBool();
+  if (this->LazyModuleLoading)
+    {
+    this->setupLazyModuleLoading();
+    }
+  QObject::connect(this->ModuleSelectorToolBar, SIGNAL(moduleSelected(QString)),
+                   q, SLOT(onModuleSelected(QString)));
+  this->setupPerformanceMonitoring();
+
+  // Progress of the background tasks of the modules, see qHaltAppTaskScheduler
+  this->TaskProgressWidget = new qHaltAppTaskProgressWidget(q);
+  this->TaskProgressWidget->setTaskScheduler(qHaltAppTaskScheduler::instance());
+  q->statusBar()->addPermanentWidget(this->TaskProgressWidget);
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppMainWindowPrivate::setupPerformanceMonitoring()
+{
+  Q_Q(qHaltAppMainWindow);
+  QSettings settings;
+
+  this->StallWatchdog = new qHaltAppStallWatchdog(q);
+  this->StallWatchdog->setThreshold(settings.value("Performance/StallThreshold", 100).toInt());
+  QString logFileName = settings.value("Performance/StallLogFile").toString();
+  if (logFileName.isEmpty())
+    {
+    logFileName = QDir(qSlicerApplication::application()->temporaryPath()).filePath("HaltStalls.log");
+    }
+  this->StallWatchdog->setLogFileName(logFileName);
+  QObject::connect(this->ModuleSelectorToolBar, SIGNAL(moduleSelected(QString)),
+                   this->StallWatchdog, SLOT(setActiveModule(QString)));
+  // Started with the event loop, startup itself is measured by qHaltAppStartupTrace
+  QTimer::singleShot(0, this->StallWatchdog, SLOT(start()));
+
+  this->PerformanceWidget = new qHaltAppPerformanceWidget(q);
+  this->PerformanceWidget->setStallWatchdog(this->StallWatchdog);
+  this->PerformanceWidget->setVisible(false);
+  q->statusBar()->addPermanentWidget(this->PerformanceWidget);
+  this->ViewPerformanceMonitorAction->setChecked(settings.value("Performance/ShowMonitor", false).toBool());
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppMainWindowPrivate::setupLazyModuleLoading()
+{
+  qHaltAppStartupTraceScope traceScope("qHaltAppMainWindowPrivate::setupLazyModuleLoading");
+
+  qSlicerModuleFactoryManager* factoryManager =
+    qSlicerApplication::application()->moduleManager()->factoryManager();
+
+  QSettings settings;
+  QStringList favoriteModules = settings.value("Modules/FavoriteModules").toStringList();
+
+  // Modules loaded at startup: the home module, the modules listed in
+  // "Modules/LazyLoadingExcludedModules" (e.g. modules registering readers),
+  // hidden modules providing application-wide services, and their dependencies.
+  QStringList startupModules;
+  this->addModuleWithDependencies(settings.value("Modules/HomeModule").toString(), startupModules);
+  foreach(const QString& moduleName,
+          settings.value("Modules/LazyLoadingExcludedModules").toStringList())
+    {
+    this->addModuleWithDependencies(moduleName.trimmed(), startupModules);
+    }
+  foreach(const QString& moduleName, factoryManager->instantiatedModuleNames())
+    {
+    qSlicerAbstractCoreModule* module = factoryManager->moduleInstance(moduleName);
+    if (module && module->isHidden())
+      {
+      this->addModuleWithDependencies(moduleName, startupModules);
+      }
+    }
+
+  foreach(const QString& moduleName, factoryManager->instantiatedModuleNames())
+    {
+    if (startupModules.contains(moduleName))
+      {
+      continue;
+      }
+    // Placeholders are created from the module instance before it is released,
+    // the module is instantiated again when it is first requested.
+    this->addDeferredModuleActions(factoryManager->moduleInstance(moduleName), favoriteModules);
+    factoryManager->uninstantiateModule(moduleName);
+    this->DeferredModules << moduleName;
+    }
+
+#ifdef Slicer_USE_PYTHONQT
+  // Scripts reach the deferred modules through slicer.modules and
+  // slicer.util.selectModule(), see HaltLazyModules.py
+  qSlicerPythonManager* pythonManager = qSlicerApplication::application()->pythonManager();
+  QFile scriptFile(":/Python/HaltLazyModules.py");
+  if (!this->DeferredModules.isEmpty() && pythonManager && scriptFile.open(QIODevice::ReadOnly))
+    {
+    pythonManager->executeString(QString::fromUtf8(scriptFile.readAll()));
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppMainWindowPrivate::addModuleWithDependencies(
+  const QString& moduleName, QStringList& moduleNames)const
+{
+  if (moduleName.isEmpty() || moduleNames.contains(moduleName))
+    {
+    return;
+    }
+  qSlicerModuleFactoryManager* factoryManager =
+    qSlicerApplication::application()->moduleManager()->factoryManager();
+  qSlicerAbstractCoreModule* module = factoryManager->moduleInstance(moduleName);
+  if (!module)
+    {
+    return;
+    }
+  moduleNames << moduleName;
+  foreach(const QString& dependency, module->dependencies())
+    {
+    this->addModuleWithDependencies(dependency, moduleNames);
+    }
+}
+
+//-----------------------------------------------------------------------------
+QMenu* qHaltAppMainWindowPrivate::categoryMenu(QMenu* menu, const QString& category)const
+{
+  if (category.isEmpty())
+    {
+    return menu;
+    }
+  foreach(const QString& subCategory, category.split('.'))
+    {
+    QMenu* subMenu = nullptr;
+    foreach(QAction* action, menu->actions())
+      {
+      if (action->menu() && action->text() == subCategory)
+        {
+        subMenu = action->menu();
+        break;
+        }
+      }
+    if (!subMenu)
+      {
+      subMenu = menu->addMenu(subCategory);
+      }
+    menu = subMenu;
+    }
+  return menu;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppMainWindowPrivate::addDeferredModuleActions(
+  qSlicerAbstractCoreModule* module, const QStringList& favoriteModules)
+{
+  Q_Q(qHaltAppMainWindow);
+  if (!module)
+    {
+    return;
+    }
+  QList<QAction*> actions;
+  qSlicerModulesMenu* modulesMenu = this->ModuleSelectorToolBar->modulesMenu();
+  QStringList categories = module->categories();
+  if (categories.isEmpty())
+    {
+    categories << QString();
+    }
+  foreach(const QString& category, categories)
+    {
+    QAction* action = this->categoryMenu(modulesMenu, category)->addAction(
+      module->icon(), module->title());
+    actions << action;
+    }
+  if (favoriteModules.contains(module->name()))
+    {
+    actions << this->ModuleToolBar->addAction(module->icon(), module->title());
+    }
+  foreach(QAction* action, actions)
+    {
+    action->setData(module->name());
+    action->setToolTip(module->title());
+    QObject::connect(action, SIGNAL(triggered()),
+                     q, SLOT(onDeferredModuleActionTriggered()));
+    }
+  this->DeferredModuleActions[module->name()] = actions;
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppMainWindowPrivate::instantiateDeferredModule(const QString& moduleName)
+{
+  qSlicerModuleFactoryManager* factoryManager =
+    qSlicerApplication::application()->moduleManager()->factoryManager();
+  qSlicerAbstractCoreModule* module = factoryManager->moduleInstance(moduleName);
+  if (!module)
+    {
+    module = factoryManager->instantiateModule(moduleName);
+    }
+  if (!module)
+    {
+    qWarning() << "Failed to instantiate module" << moduleName;
+    return false;
+    }
+  foreach(const QString& dependency, module->dependencies())
+    {
+    if (!this->instantiateDeferredModule(dependency))
+      {
+      return false;
+      }
+    }
+  return true;
 }
 
 //-----------------------------------------------------------------------------
 void qHaltAppMainWindowPrivate::setupUi(QMainWindow * mainWindow)
 {
+  qHaltAppStartupTraceScope traceScope("qHaltAppMainWindowPrivate::setupUi");
   qSlicerApplication * app = qSlicerApplication::application();
 
   //----------------------------------------------------------------------------
@@ -65,6 +304,32 @@ void qHaltAppMainWindowPrivate::setupUi(QMainWindow * mainWindow)
   helpAboutSlicerAppAction->setObjectName("HelpAboutHaltAppAction");
   helpAboutSlicerAppAction->setText(qHaltAppMainWindow::tr("About %1").arg(qSlicerApplication::application()->mainApplicationDisplayName()));
 
+  QAction* fileOpenSessionAction = new QAction(mainWindow);
+  fileOpenSessionAction->setObjectName("FileOpenSessionAction");
+  fileOpenSessionAction->setText(qHaltAppMainWindow::tr("Open Session..."));
+  fileOpenSessionAction->setToolTip(qHaltAppMainWindow::tr("Replace the scene by a Halt session (.halt)"));
+
+  QAction* fileSaveSessionAction = new QAction(mainWindow);
+  fileSaveSessionAction->setObjectName("FileSaveSessionAction");
+  fileSaveSessionAction->setText(qHaltAppMainWindow::tr("Save Session..."));
+  fileSaveSessionAction->setToolTip(qHaltAppMainWindow::tr("Save the scene and its data as a Halt session (.halt)"));
+  fileSaveSessionAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_S));
+
+#ifdef Slicer_BUILD_DICOM_SUPPORT
+  QAction* fileIndexDICOMDirectoryAction = new QAction(mainWindow);
+  fileIndexDICOMDirectoryAction->setObjectName("FileIndexDICOMDirectoryAction");
+  fileIndexDICOMDirectoryAction->setText(qHaltAppMainWindow::tr("Index DICOM Directory..."));
+  fileIndexDICOMDirectoryAction->setToolTip(
+    qHaltAppMainWindow::tr("Add the DICOM files of a directory tree to the DICOM database, skipping unchanged files"));
+#endif
+
+  this->ViewPerformanceMonitorAction = new QAction(mainWindow);
+  this->ViewPerformanceMonitorAction->setObjectName("ViewPerformanceMonitorAction");
+  this->ViewPerformanceMonitorAction->setText(qHaltAppMainWindow::tr("Performance Monitor"));
+  this->ViewPerformanceMonitorAction->setToolTip(
+    qHaltAppMainWindow::tr("Show the event loop latency, render times and memory in the status bar"));
+  this->ViewPerformanceMonitorAction->setCheckable(true);
+
   //----------------------------------------------------------------------------
   // Calling "setupUi()" after adding the actions above allows the call
   // to "QMetaObject::connectSlotsByName()" done in "setupUi()" to
@@ -74,6 +339,15 @@ void qHaltAppMainWindowPrivate::setupUi(QMainWindow * mainWindow)
   // Add Help Menu Action
   this->HelpMenu->addAction(helpAboutSlicerAppAction);
 
+  // Session actions, next to the scene actions
+  this->FileMenu->insertAction(this->FileSaveSceneAction, fileOpenSessionAction);
+  this->FileMenu->insertAction(this->FileSaveSceneAction, fileSaveSessionAction);
+#ifdef Slicer_BUILD_DICOM_SUPPORT
+  this->FileMenu->insertAction(this->FileSaveSceneAction, fileIndexDICOMDirectoryAction);
+#endif
+
+  this->ViewMenu->addAction(this->ViewPerformanceMonitorAction);
+
   //----------------------------------------------------------------------------
   // Configure
   //----------------------------------------------------------------------------
@@ -117,6 +391,92 @@ qHaltAppMainWindow::~qHaltAppMainWindow()
 {
 }
 
+//-----------------------------------------------------------------------------
+bool qHaltAppMainWindow::isLazyModuleLoadingEnabled()const
+{
+  Q_D(const qHaltAppMainWindow);
+  return d->LazyModuleLoading;
+}
+
+//-----------------------------------------------------------------------------
+QStringList qHaltAppMainWindow::deferredModuleNames()const
+{
+  Q_D(const qHaltAppMainWindow);
+  return d->DeferredModules;
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppStallWatchdog* qHaltAppMainWindow::stallWatchdog()const
+{
+  Q_D(const qHaltAppMainWindow);
+  return d->StallWatchdog;
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppMainWindow::loadModuleOnDemand(const QString& moduleName)
+{
+  Q_D(qHaltAppMainWindow);
+  qSlicerModuleFactoryManager* factoryManager =
+    qSlicerApplication::application()->moduleManager()->factoryManager();
+  if (factoryManager->isLoaded(moduleName))
+    {
+    return true;
+    }
+  if (!d->DeferredModules.contains(moduleName))
+    {
+    return false;
+    }
+  // Dependencies may also have been deferred
+  if (!d->instantiateDeferredModule(moduleName) ||
+      !factoryManager->loadModule(moduleName))
+    {
+    qWarning() << "Failed to load module" << moduleName << "on demand";
+    return false;
+    }
+  // Once loaded, the module (and its dependencies) are listed by the
+  // module selector and favorite toolbar, placeholders are not needed anymore.
+  foreach(const QString& deferredModule, d->DeferredModules)
+    {
+    if (!factoryManager->isLoaded(deferredModule))
+      {
+      continue;
+      }
+    // The triggered placeholder may be the sender of the current signal
+    foreach(QAction* action, d->DeferredModuleActions.take(deferredModule))
+      {
+      action->deleteLater();
+      }
+    d->DeferredModules.removeOne(deferredModule);
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppMainWindow::onModuleSelected(const QString& moduleName)
+{
+  Q_D(qHaltAppMainWindow);
+  if (!d->DeferredModules.contains(moduleName))
+    {
+    return;
+    }
+  if (this->loadModuleOnDemand(moduleName))
+    {
+    // The module panel could not show the module while it was not loaded
+    d->ModuleSelectorToolBar->selectModule(moduleName);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppMainWindow::onDeferredModuleActionTriggered()
+{
+  QAction* action = qobject_cast<QAction*>(this->sender());
+  if (!action)
+    {
+    return;
+    }
+  this->onModuleSelected(action->data().toString());
+}
+
 //-----------------------------------------------------------------------------
 void qHaltAppMainWindow::on_HelpAboutHaltAppAction_triggered()
 {
@@ -124,3 +484,105 @@ void qHaltAppMainWindow::on_HelpAboutHaltAppAction_triggered()
   about.setLogo(QPixmap(":/Logo.png"));
   about.exec();
 }
+
+//-----------------------------------------------------------------------------
+void qHaltAppMainWindow::on_FileOpenSessionAction_triggered()
+{
+  QString fileName = QFileDialog::getOpenFileName(this, tr("Open Session"),
+    qSlicerApplication::application()->defaultScenePath(),
+    tr("Halt session (*%1)").arg(qHaltAppSessionFile::extension()));
+  if (!fileName.isEmpty())
+    {
+    this->loadSession(fileName);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppMainWindow::on_FileSaveSessionAction_triggered()
+{
+  QString fileName = QFileDialog::getSaveFileName(this, tr("Save Session"),
+    qSlicerApplication::application()->defaultScenePath(),
+    tr("Halt session (*%1)").arg(qHaltAppSessionFile::extension()));
+  if (fileName.isEmpty())
+    {
+    return;
+    }
+  if (!fileName.endsWith(qHaltAppSessionFile::extension()))
+    {
+    fileName += qHaltAppSessionFile::extension();
+    }
+  this->saveSession(fileName);
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppMainWindow::on_FileIndexDICOMDirectoryAction_triggered()
+{
+#ifdef Slicer_BUILD_DICOM_SUPPORT
+  QString directory = QFileDialog::getExistingDirectory(this, tr("Index DICOM Directory"));
+  if (directory.isEmpty())
+    {
+    return;
+    }
+  qHaltAppDICOMBulkIndexer indexer;
+  QProgressDialog progressDialog(tr("Indexing the DICOM files of %1...").arg(directory), tr("Cancel"), 0, 0, this);
+  progressDialog.setWindowModality(Qt::WindowModal);
+  progressDialog.setMinimumDuration(0);
+  QObject::connect(&indexer, &qHaltAppDICOMBulkIndexer::progress,
+    [&progressDialog](int processed, int total)
+    {
+    progressDialog.setMaximum(total);
+    progressDialog.setValue(processed);
+    });
+  QObject::connect(&progressDialog, SIGNAL(canceled()), &indexer, SLOT(cancel()));
+  bool success = indexer.indexDirectory(directory);
+  progressDialog.reset();
+  if (!success && !progressDialog.wasCanceled())
+    {
+    QMessageBox::critical(this, tr("Index DICOM Directory"),
+      tr("Failed to index %1, the DICOM database is not available").arg(directory));
+    return;
+    }
+  this->statusBar()->showMessage(tr("%1 DICOM files indexed, %2 unchanged, %3 not DICOM")
+    .arg(indexer.indexedFileCount()).arg(indexer.skippedFileCount()).arg(indexer.failedFileCount()), 10000);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppMainWindow::on_ViewPerformanceMonitorAction_toggled(bool visible)
+{
+  Q_D(qHaltAppMainWindow);
+  d->PerformanceWidget->setVisible(visible);
+  QSettings().setValue("Performance/ShowMonitor", visible);
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppMainWindow::saveSession(const QString& fileName)
+{
+  QString errorMessage;
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  bool success = qHaltAppSessionFile::save(
+    qSlicerApplication::application()->mrmlScene(), fileName, &errorMessage);
+  QApplication::restoreOverrideCursor();
+  if (!success)
+    {
+    QMessageBox::critical(this, tr("Save Session"),
+      tr("Failed to save the session to %1:\n%2").arg(fileName).arg(errorMessage));
+    }
+  return success;
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppMainWindow::loadSession(const QString& fileName)
+{
+  QString errorMessage;
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  bool success = qHaltAppSessionFile::load(
+    qSlicerApplication::application()->mrmlScene(), fileName, true, &errorMessage);
+  QApplication::restoreOverrideCursor();
+  if (!success)
+    {
+    QMessageBox::critical(this, tr("Open Session"),
+      tr("Failed to open the session %1:\n%2").arg(fileName).arg(errorMessage));
+    }
+  return success;
+}
@@ -21,6 +21,7 @@
 // Halt includes
 #include "qHaltAppExport.h"
 class qHaltAppMainWindowPrivate;
+class qHaltAppStallWatchdog;
 
 // Slicer includes
 #include "qSlicerMainWindow.h"
@@ -34,8 +35,43 @@ public:
   qHaltAppMainWindow(QWidget *parent=0);
   virtual ~qHaltAppMainWindow();
 
+  /// Return true if modules other than the home module are loaded on demand.
+  /// Controlled by the "Modules/LazyLoading" setting, true by default. The
+  /// modules of "Modules/LazyLoadingExcludedModules", the hidden modules and
+  /// their dependencies are never deferred. A deferred module is loaded when
+  /// it is selected, or when a script accesses it through slicer.modules,
+  /// slicer.moduleNames or slicer.util.selectModule().
+  Q_INVOKABLE bool isLazyModuleLoadingEnabled()const;
+
+  /// Return the names of the modules that are not loaded yet.
+  Q_INVOKABLE QStringList deferredModuleNames()const;
+
+  /// Watchdog logging the stalls of the user interface.
+  /// Configured by the "Performance/StallThreshold" and "Performance/StallLogFile" settings.
+  Q_INVOKABLE qHaltAppStallWatchdog* stallWatchdog()const;
+
 public slots:
   void on_HelpAboutHaltAppAction_triggered();
+  void on_FileOpenSessionAction_triggered();
+  void on_FileSaveSessionAction_triggered();
+  void on_FileIndexDICOMDirectoryAction_triggered();
+  void on_ViewPerformanceMonitorAction_toggled(bool visible);
+
+  /// Save the scene as a Halt session file, see qHaltAppSessionFile.
+  /// Errors are reported in a message box. Return true on success.
+  bool saveSession(const QString& fileName);
+
+  /// Replace the scene by the content of a Halt session file.
+  /// Errors are reported in a message box. Return true on success.
+  bool loadSession(const QString& fileName);
+
+  /// Instantiate and load \a moduleName and its dependencies if it was
+  /// deferred at startup. Return true if the module is loaded.
+  bool loadModuleOnDemand(const QString& moduleName);
+
+protected slots:
+  void onModuleSelected(const QString& moduleName);
+  void onDeferredModuleActionTriggered();
 
 protected:
   qHaltAppMainWindow(qHaltAppMainWindowPrivate* pimpl, QWidget* parent);
@@ -21,9 +21,21 @@
 // Halt includes
 #include "qHaltAppMainWindow.h"
 
+// Qt includes
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
 // Slicer includes
 #include "qSlicerMainWindow_p.h"
 
+class QAction;
+class QMenu;
+class qHaltAppPerformanceWidget;
+class qHaltAppStallWatchdog;
+class qHaltAppTaskProgressWidget;
+class qSlicerAbstractCoreModule;
+
 //-----------------------------------------------------------------------------
 class Q_HALT_APP_EXPORT qHaltAppMainWindowPrivate
   : public qSlicerMainWindowPrivate
@@ -37,6 +49,35 @@ public:
   virtual void init();
   /// Reimplemented for custom behavior
   virtual void setupUi(QMainWindow * mainWindow);
+
+  /// Uninstantiate the modules that are not needed at startup and replace them
+  /// by placeholder actions in the module selector and favorite toolbar.
+  /// Modules are instantiated but not yet loaded when the main window is created.
+  void setupLazyModuleLoading();
+
+  /// Add \a moduleName and its dependencies to \a moduleNames.
+  void addModuleWithDependencies(const QString& moduleName, QStringList& moduleNames)const;
+
+  /// Return the sub-menu of \a menu associated with \a category (e.g "Registration.Specialized").
+  QMenu* categoryMenu(QMenu* menu, const QString& category)const;
+
+  /// Create the placeholder actions of a deferred module.
+  void addDeferredModuleActions(qSlicerAbstractCoreModule* module, const QStringList& favoriteModules);
+
+  /// Instantiate \a moduleName and its dependencies. Return false on failure.
+  bool instantiateDeferredModule(const QString& moduleName);
+
+  /// Create the stall watchdog and the performance monitor of the status bar.
+  void setupPerformanceMonitoring();
+
+  bool LazyModuleLoading;
+  QStringList DeferredModules;
+  QHash<QString, QList<QAction*> > DeferredModuleActions;
+
+  qHaltAppStallWatchdog* StallWatchdog;
+  qHaltAppPerformanceWidget* PerformanceWidget;
+  QAction* ViewPerformanceMonitorAction;
+  qHaltAppTaskProgressWidget* TaskProgressWidget;
 };
 
 #endif
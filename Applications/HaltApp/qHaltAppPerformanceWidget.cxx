@@ -0,0 +1,168 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QStringList>
+
+// Slicer includes
+#include "qMRMLSliceView.h"
+#include "qMRMLSliceWidget.h"
+#include "qMRMLThreeDView.h"
+#include "qMRMLThreeDWidget.h"
+#include "qSlicerApplication.h"
+#include "qSlicerLayoutManager.h"
+
+// Halt includes
+#include "qHaltAppPerformanceWidget.h"
+
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkRenderWindow.h>
+#include <vtksys/SystemInformation.hxx>
+
+// STD includes
+#include <algorithm>
+
+//-----------------------------------------------------------------------------
+// qHaltAppPerformanceWidget methods
+
+//-----------------------------------------------------------------------------
+qHaltAppPerformanceWidget::qHaltAppPerformanceWidget(QWidget* parent)
+  : Superclass(parent)
+  , FrameCount(0)
+  , TotalRenderTime(0)
+  , MaximumRenderTime(0)
+{
+  this->setObjectName("PerformanceWidget");
+  this->setToolTip(tr("Maximum event loop latency, mean and maximum render time of the views, "
+    "rendered frames per second, memory used by the application and number of stalls "
+    "of the user interface, over the last second"));
+  this->Clock.start();
+  this->RefreshTimer.setInterval(1000);
+  QObject::connect(&this->RefreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppPerformanceWidget::~qHaltAppPerformanceWidget()
+{
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppPerformanceWidget::setStallWatchdog(qHaltAppStallWatchdog* watchdog)
+{
+  this->StallWatchdog = watchdog;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppPerformanceWidget::showEvent(QShowEvent* event)
+{
+  this->Superclass::showEvent(event);
+  this->observeRenderWindows();
+  this->RefreshTimer.start();
+  this->RefreshClock.start();
+  this->refresh();
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppPerformanceWidget::hideEvent(QHideEvent* event)
+{
+  this->Superclass::hideEvent(event);
+  this->RefreshTimer.stop();
+  this->qvtkDisconnectAll();
+  this->RenderStartTimes.clear();
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppPerformanceWidget::observeRenderWindows()
+{
+  qSlicerLayoutManager* layoutManager = qSlicerApplication::application()->layoutManager();
+  if (!layoutManager)
+    {
+    return;
+    }
+  QList<vtkRenderWindow*> renderWindows;
+  for (int i = 0; i < layoutManager->threeDViewCount(); ++i)
+    {
+    renderWindows << layoutManager->threeDWidget(i)->threeDView()->renderWindow();
+    }
+  foreach(const QString& sliceViewName, layoutManager->sliceViewNames())
+    {
+    renderWindows << layoutManager->sliceWidget(sliceViewName)->sliceView()->renderWindow();
+    }
+  foreach(vtkRenderWindow* renderWindow, renderWindows)
+    {
+    if (!renderWindow || this->qvtkIsConnected(renderWindow, vtkCommand::StartEvent,
+        this, SLOT(onRenderStarted(vtkObject*))))
+      {
+      continue;
+      }
+    this->qvtkConnect(renderWindow, vtkCommand::StartEvent, this, SLOT(onRenderStarted(vtkObject*)));
+    this->qvtkConnect(renderWindow, vtkCommand::EndEvent, this, SLOT(onRenderEnded(vtkObject*)));
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppPerformanceWidget::onRenderStarted(vtkObject* caller)
+{
+  this->RenderStartTimes[caller] = this->Clock.nsecsElapsed();
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppPerformanceWidget::onRenderEnded(vtkObject* caller)
+{
+  if (!this->RenderStartTimes.contains(caller))
+    {
+    return;
+    }
+  qint64 renderTime = this->Clock.nsecsElapsed() - this->RenderStartTimes.take(caller);
+  ++this->FrameCount;
+  this->TotalRenderTime += renderTime;
+  this->MaximumRenderTime = std::max(this->MaximumRenderTime, renderTime);
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppPerformanceWidget::refresh()
+{
+  // Views may have been added by a layout change
+  this->observeRenderWindows();
+
+  QStringList values;
+  if (this->StallWatchdog && this->StallWatchdog->isRunning())
+    {
+    values << tr("Event loop %1 ms").arg(this->StallWatchdog->takeMaximumLatency());
+    }
+  double elapsedTime = std::max<qint64>(1, this->RefreshClock.restart()) / 1000.;
+  if (this->FrameCount > 0)
+    {
+    values << tr("Render %1 ms (max %2 ms), %3 fps")
+      .arg(this->TotalRenderTime / 1e6 / this->FrameCount, 0, 'f', 1)
+      .arg(this->MaximumRenderTime / 1e6, 0, 'f', 1)
+      .arg(this->FrameCount / elapsedTime, 0, 'f', 0);
+    }
+  else
+    {
+    values << tr("Render idle");
+    }
+  this->FrameCount = 0;
+  this->TotalRenderTime = 0;
+  this->MaximumRenderTime = 0;
+
+  vtksys::SystemInformation systemInformation;
+  values << tr("Memory %1 MB").arg(systemInformation.GetProcMemoryUsed() / 1024);
+  if (this->StallWatchdog && this->StallWatchdog->isRunning())
+    {
+    values << tr("Stalls %1").arg(this->StallWatchdog->stallCount());
+    }
+  this->setText(values.join(" | "));
+}
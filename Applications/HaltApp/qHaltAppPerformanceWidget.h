@@ -0,0 +1,81 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qHaltAppPerformanceWidget_h
+#define __qHaltAppPerformanceWidget_h
+
+// Qt includes
+#include <QElapsedTimer>
+#include <QHash>
+#include <QLabel>
+#include <QPointer>
+#include <QTimer>
+
+// CTK includes
+#include <ctkVTKObject.h>
+
+// Halt includes
+#include "qHaltAppExport.h"
+#include "qHaltAppStallWatchdog.h"
+
+class vtkObject;
+
+/// \brief Status bar monitor of the event loop latency, the render frame
+/// times of the views and the memory used by the process.
+///
+/// Updated every second. The event loop latency is the maximum delay of the
+/// heartbeat of the stall watchdog, render times are measured on the render
+/// windows of the views of the layout. Render windows are only observed
+/// while the widget is visible.
+class Q_HALT_APP_EXPORT qHaltAppPerformanceWidget : public QLabel
+{
+  Q_OBJECT
+  QVTK_OBJECT
+public:
+  typedef QLabel Superclass;
+  qHaltAppPerformanceWidget(QWidget* parent = nullptr);
+  virtual ~qHaltAppPerformanceWidget();
+
+  /// Watchdog providing the event loop latency and the stall count.
+  void setStallWatchdog(qHaltAppStallWatchdog* watchdog);
+
+public slots:
+  /// Update the displayed values and reset the statistics.
+  void refresh();
+
+protected slots:
+  void onRenderStarted(vtkObject* caller);
+  void onRenderEnded(vtkObject* caller);
+
+protected:
+  void showEvent(QShowEvent* event) override;
+  void hideEvent(QHideEvent* event) override;
+
+  /// Observe the render windows of the views not observed yet.
+  void observeRenderWindows();
+
+  QPointer<qHaltAppStallWatchdog> StallWatchdog;
+  QTimer RefreshTimer;
+  QElapsedTimer Clock;
+  QElapsedTimer RefreshClock;
+  QHash<vtkObject*, qint64> RenderStartTimes; // in ns
+  int FrameCount;
+  qint64 TotalRenderTime; // in ns
+  qint64 MaximumRenderTime; // in ns
+
+private:
+  Q_DISABLE_COPY(qHaltAppPerformanceWidget);
+};
+
+#endif
@@ -0,0 +1,649 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QTemporaryDir>
+
+// Slicer includes
+#include "qSlicerCoreApplication.h"
+
+// Halt includes
+#include "qHaltAppSessionFile.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStorableNode.h>
+#include <vtkMRMLStorageNode.h>
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkImageData.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const char SessionMagic[] = "HALTSESS";
+const int SessionMagicLength = 8;
+const quint32 SessionVersion = 1;
+/// Uncompressed size of a chunk
+const qint64 ChunkSize = 4 * 1024 * 1024;
+/// Number of chunks compressed at once while saving, bounds the memory used
+/// by the compressed chunks waiting to be written.
+const int ChunksPerBatch = 64;
+
+//----------------------------------------------------------------------------
+struct Chunk
+{
+  quint64 Offset; // in the session file
+  quint32 StoredSize; // equal to Size if the chunk is not compressed
+  quint32 Size;
+};
+
+//----------------------------------------------------------------------------
+struct Entry
+{
+  enum
+  {
+    FileEntry = 0,
+    ImageEntry
+  };
+  qint32 Type;
+  /// Path relative to the data directory, or ID of the volume node
+  QString Name;
+  qint32 ScalarType;
+  qint32 NumberOfComponents;
+  qint32 Extent[6];
+  quint64 Size;
+  std::vector<Chunk> Chunks;
+};
+
+//----------------------------------------------------------------------------
+QDataStream& operator<<(QDataStream& stream, const Entry& entry)
+{
+  stream << entry.Type << entry.Name << entry.ScalarType << entry.NumberOfComponents;
+  for (int i = 0; i < 6; ++i)
+    {
+    stream << entry.Extent[i];
+    }
+  stream << entry.Size << static_cast<quint32>(entry.Chunks.size());
+  for (const Chunk& chunk : entry.Chunks)
+    {
+    stream << chunk.Offset << chunk.StoredSize << chunk.Size;
+    }
+  return stream;
+}
+
+//----------------------------------------------------------------------------
+QDataStream& operator>>(QDataStream& stream, Entry& entry)
+{
+  stream >> entry.Type >> entry.Name >> entry.ScalarType >> entry.NumberOfComponents;
+  for (int i = 0; i < 6; ++i)
+    {
+    stream >> entry.Extent[i];
+    }
+  quint32 numberOfChunks = 0;
+  stream >> entry.Size >> numberOfChunks;
+  entry.Chunks.resize(stream.status() == QDataStream::Ok ? numberOfChunks : 0);
+  for (Chunk& chunk : entry.Chunks)
+    {
+    stream >> chunk.Offset >> chunk.StoredSize >> chunk.Size;
+    }
+  return stream;
+}
+
+//----------------------------------------------------------------------------
+/// Uncompressed data of a chunk and where it goes.
+struct ChunkTask
+{
+  const char* Data;
+  quint32 Size;
+  size_t EntryIndex;
+  QByteArray Stored;
+  char* Destination;
+};
+
+//----------------------------------------------------------------------------
+/// Split the data of an entry in chunk tasks.
+void addChunkTasks(std::vector<ChunkTask>& tasks, size_t entryIndex,
+  const char* data, char* destination, qint64 size)
+{
+  for (qint64 offset = 0; offset < size; offset += ChunkSize)
+    {
+    ChunkTask task;
+    task.Data = data ? data + offset : nullptr;
+    task.Size = static_cast<quint32>(qMin(ChunkSize, size - offset));
+    task.EntryIndex = entryIndex;
+    task.Destination = destination ? destination + offset : nullptr;
+    tasks.push_back(task);
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Compress the chunks [first, last) of \a tasks on all the cores.
+void compressChunks(std::vector<ChunkTask>& tasks, size_t first, size_t last)
+{
+  vtkSMPTools::For(static_cast<vtkIdType>(first), static_cast<vtkIdType>(last),
+    [&tasks](vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType taskIndex = begin; taskIndex < end; ++taskIndex)
+      {
+      ChunkTask& task = tasks[taskIndex];
+      // Fastest zlib level: the gain of higher levels on CT data is small
+      task.Stored = qCompress(reinterpret_cast<const uchar*>(task.Data), static_cast<int>(task.Size), 1);
+      if (static_cast<quint32>(task.Stored.size()) >= task.Size)
+        {
+        // Incompressible (e.g. noise), store as is
+        task.Stored = QByteArray::fromRawData(task.Data, static_cast<int>(task.Size));
+        }
+      }
+    });
+}
+
+//----------------------------------------------------------------------------
+/// Decompress all the chunks of \a tasks on all the cores, from \a Data
+/// (StoredSize bytes) to \a Destination (Size bytes). Return false on failure.
+bool decompressChunks(std::vector<ChunkTask>& tasks, const std::vector<quint32>& storedSizes)
+{
+  std::atomic<bool> success(true);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(tasks.size()),
+    [&tasks, &storedSizes, &success](vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType taskIndex = begin; taskIndex < end && success; ++taskIndex)
+      {
+      const ChunkTask& task = tasks[taskIndex];
+      if (storedSizes[taskIndex] == task.Size)
+        {
+        memcpy(task.Destination, task.Data, task.Size);
+        continue;
+        }
+      QByteArray data = qUncompress(reinterpret_cast<const uchar*>(task.Data),
+        static_cast<int>(storedSizes[taskIndex]));
+      if (static_cast<quint32>(data.size()) != task.Size)
+        {
+        success = false;
+        return;
+        }
+      memcpy(task.Destination, data.constData(), task.Size);
+      }
+    });
+  return success;
+}
+
+//----------------------------------------------------------------------------
+bool fail(QString* errorMessage, const QString& message)
+{
+  if (errorMessage)
+    {
+    *errorMessage = message;
+    }
+  qWarning() << Q_FUNC_INFO << message;
+  return false;
+}
+
+//----------------------------------------------------------------------------
+QString safeFileName(const char* name)
+{
+  QString fileName = QString::fromUtf8(name ? name : "");
+  for (QChar& character : fileName)
+    {
+    if (!character.isLetterOrNumber() && character != '-' && character != '_')
+      {
+      character = '_';
+      }
+    }
+  return fileName;
+}
+
+//----------------------------------------------------------------------------
+/// Changes made to the scene while it is saved, reverted once saved.
+class SceneSaveState
+{
+public:
+  SceneSaveState(vtkMRMLScene* scene)
+    : Scene(scene)
+    , RootDirectory(scene->GetRootDirectory() ? scene->GetRootDirectory() : "")
+  {
+  }
+
+  ~SceneSaveState()
+  {
+    for (const StorageState& state : this->Storages)
+      {
+      state.Node->ResetFileNameList();
+      state.Node->SetFileName(state.FileName.empty() ? nullptr : state.FileName.c_str());
+      for (const std::string& fileName : state.FileNames)
+        {
+        state.Node->AddFileName(fileName.c_str());
+        }
+      state.Node->SetUseCompression(state.UseCompression);
+      }
+    for (const VolumeState& state : this->Volumes)
+      {
+      state.Node->SetAndObserveStorageNodeID(state.StorageNodeID.c_str());
+      state.StorageNode->SetSaveWithScene(state.SaveWithScene);
+      }
+    this->Scene->SetRootDirectory(this->RootDirectory.c_str());
+  }
+
+  /// Write \a node uncompressed to \a fileName, relative to the scene root directory.
+  bool writeStorableNode(vtkMRMLStorableNode* node, vtkMRMLStorageNode* storageNode, const QString& fileName)
+  {
+    StorageState state;
+    state.Node = storageNode;
+    state.FileName = storageNode->GetFileName() ? storageNode->GetFileName() : "";
+    for (int fileIndex = 0; fileIndex < storageNode->GetNumberOfFileNames(); ++fileIndex)
+      {
+      state.FileNames.push_back(storageNode->GetNthFileName(fileIndex));
+      }
+    state.UseCompression = storageNode->GetUseCompression();
+    this->Storages.push_back(state);
+
+    storageNode->ResetFileNameList();
+    storageNode->SetFileName(fileName.toUtf8().constData());
+    // Chunks are compressed in parallel instead
+    storageNode->SetUseCompression(0);
+    return storageNode->WriteData(node) != 0;
+  }
+
+  /// Store the voxels of \a node in the session instead of writing it with its storage node.
+  void detachStorageNode(vtkMRMLScalarVolumeNode* node)
+  {
+    vtkMRMLStorageNode* storageNode = node->GetStorageNode();
+    if (!storageNode)
+      {
+      return;
+      }
+    VolumeState state;
+    state.Node = node;
+    state.StorageNode = storageNode;
+    state.StorageNodeID = storageNode->GetID();
+    state.SaveWithScene = storageNode->GetSaveWithScene();
+    this->Volumes.push_back(state);
+    node->SetAndObserveStorageNodeID(nullptr);
+    storageNode->SetSaveWithScene(false);
+  }
+
+protected:
+  struct StorageState
+  {
+    vtkSmartPointer<vtkMRMLStorageNode> Node;
+    std::string FileName;
+    std::vector<std::string> FileNames;
+    int UseCompression;
+  };
+  struct VolumeState
+  {
+    vtkSmartPointer<vtkMRMLScalarVolumeNode> Node;
+    vtkSmartPointer<vtkMRMLStorageNode> StorageNode;
+    std::string StorageNodeID;
+    bool SaveWithScene;
+  };
+
+  vtkMRMLScene* Scene;
+  std::string RootDirectory;
+  std::vector<StorageState> Storages;
+  std::vector<VolumeState> Volumes;
+};
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+QString qHaltAppSessionFile::extension()
+{
+  return QString(".halt");
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppSessionFile::save(vtkMRMLScene* scene, const QString& fileName, QString* errorMessage)
+{
+  if (!scene)
+    {
+    return fail(errorMessage, "No scene to save");
+    }
+  QTemporaryDir dataDirectory(
+    QDir(qSlicerCoreApplication::application()->temporaryPath()).filePath("HaltSession-XXXXXX"));
+  if (!dataDirectory.isValid())
+    {
+    return fail(errorMessage, QString("Failed to create a temporary directory: %1").arg(dataDirectory.errorString()));
+    }
+
+  std::vector<Entry> entries;
+  std::vector<ChunkTask> tasks;
+  QByteArray sceneXML;
+  {
+  // Revert the changes made to the scene before returning
+  SceneSaveState saveState(scene);
+  scene->SetRootDirectory(dataDirectory.path().toUtf8().constData());
+
+  std::vector<vtkSmartPointer<vtkImageData> > images;
+  vtkSmartPointer<vtkCollection> nodes = vtkSmartPointer<vtkCollection>::Take(
+    scene->GetNodesByClass("vtkMRMLStorableNode"));
+  for (int nodeIndex = 0; nodeIndex < nodes->GetNumberOfItems(); ++nodeIndex)
+    {
+    vtkMRMLStorableNode* node = vtkMRMLStorableNode::SafeDownCast(nodes->GetItemAsObject(nodeIndex));
+    if (!node || !node->GetSaveWithScene())
+      {
+      continue;
+      }
+    vtkMRMLScalarVolumeNode* volumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(node);
+    if (volumeNode && volumeNode->GetImageData())
+      {
+      // Geometry is saved in the scene, voxels in the chunks
+      vtkImageData* image = volumeNode->GetImageData();
+      Entry entry;
+      entry.Type = Entry::ImageEntry;
+      entry.Name = QString::fromUtf8(volumeNode->GetID());
+      entry.ScalarType = image->GetScalarType();
+      entry.NumberOfComponents = image->GetNumberOfScalarComponents();
+      image->GetExtent(entry.Extent);
+      entry.Size = static_cast<quint64>(image->GetNumberOfPoints()) *
+        image->GetNumberOfScalarComponents() * image->GetScalarSize();
+      images.push_back(image);
+      addChunkTasks(tasks, entries.size(), static_cast<const char*>(image->GetScalarPointer()),
+        nullptr, static_cast<qint64>(entry.Size));
+      entries.push_back(entry);
+      saveState.detachStorageNode(volumeNode);
+      continue;
+      }
+    vtkMRMLStorageNode* storageNode = node->GetStorageNode();
+    if (!storageNode)
+      {
+      node->AddDefaultStorageNode();
+      storageNode = node->GetStorageNode();
+      }
+    if (!storageNode)
+      {
+      // Nodes without data, entirely saved in the scene
+      continue;
+      }
+    QString nodeFileName = QString("Data/%1_%2.%3")
+      .arg(safeFileName(node->GetName()))
+      .arg(nodeIndex)
+      .arg(QString::fromStdString(storageNode->GetDefaultWriteFileExtension()));
+    if (!saveState.writeStorableNode(node, storageNode, nodeFileName))
+      {
+      return fail(errorMessage, QString("Failed to write %1").arg(QString::fromUtf8(node->GetName())));
+      }
+    }
+
+  scene->SetSaveToXMLString(1);
+  scene->Commit();
+  scene->SetSaveToXMLString(0);
+  sceneXML = QByteArray::fromStdString(scene->GetSceneXMLString());
+
+  // Files written by the storage nodes, including additional files (e.g. textures)
+  std::vector<std::unique_ptr<QFile> > dataFiles;
+  QDir dataDir(dataDirectory.path());
+  QDirIterator it(dataDirectory.path(), QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext())
+    {
+    std::unique_ptr<QFile> dataFile(new QFile(it.next()));
+    if (!dataFile->open(QIODevice::ReadOnly))
+      {
+      return fail(errorMessage, QString("Failed to read %1").arg(dataFile->fileName()));
+      }
+    Entry entry;
+    entry.Type = Entry::FileEntry;
+    entry.Name = dataDir.relativeFilePath(dataFile->fileName());
+    entry.ScalarType = 0;
+    entry.NumberOfComponents = 0;
+    std::fill(entry.Extent, entry.Extent + 6, 0);
+    entry.Size = static_cast<quint64>(dataFile->size());
+    const char* data = entry.Size > 0 ?
+      reinterpret_cast<const char*>(dataFile->map(0, dataFile->size())) : nullptr;
+    if (entry.Size > 0 && !data)
+      {
+      return fail(errorMessage, QString("Failed to map %1").arg(dataFile->fileName()));
+      }
+    addChunkTasks(tasks, entries.size(), data, nullptr, static_cast<qint64>(entry.Size));
+    entries.push_back(entry);
+    dataFiles.push_back(std::move(dataFile));
+    }
+
+  // Compress batches of chunks in parallel, write them in order
+  QSaveFile output(fileName);
+  if (!output.open(QIODevice::WriteOnly))
+    {
+    return fail(errorMessage, QString("Failed to open %1: %2").arg(fileName).arg(output.errorString()));
+    }
+  QDataStream stream(&output);
+  stream.setVersion(QDataStream::Qt_5_6);
+  stream.writeRawData(SessionMagic, SessionMagicLength);
+  stream << SessionVersion;
+  for (size_t first = 0; first < tasks.size(); first += ChunksPerBatch)
+    {
+    size_t last = std::min(tasks.size(), first + ChunksPerBatch);
+    compressChunks(tasks, first, last);
+    for (size_t taskIndex = first; taskIndex < last; ++taskIndex)
+      {
+      ChunkTask& task = tasks[taskIndex];
+      Chunk chunk;
+      chunk.Offset = static_cast<quint64>(output.pos());
+      chunk.StoredSize = static_cast<quint32>(task.Stored.size());
+      chunk.Size = task.Size;
+      entries[task.EntryIndex].Chunks.push_back(chunk);
+      stream.writeRawData(task.Stored.constData(), task.Stored.size());
+      task.Stored = QByteArray();
+      }
+    }
+  quint64 indexOffset = static_cast<quint64>(output.pos());
+  stream << sceneXML << static_cast<quint32>(entries.size());
+  for (const Entry& entry : entries)
+    {
+    stream << entry;
+    }
+  stream << indexOffset;
+  if (stream.status() != QDataStream::Ok || !output.commit())
+    {
+    return fail(errorMessage, QString("Failed to write %1: %2").arg(fileName).arg(output.errorString()));
+    }
+  }
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppSessionFile::load(vtkMRMLScene* scene, const QString& fileName, bool clear, QString* errorMessage)
+{
+  if (!scene)
+    {
+    return fail(errorMessage, "No scene to load the session in");
+    }
+  QFile input(fileName);
+  if (!input.open(QIODevice::ReadOnly))
+    {
+    return fail(errorMessage, QString("Failed to open %1: %2").arg(fileName).arg(input.errorString()));
+    }
+  const qint64 fileSize = input.size();
+  const char* mapped = reinterpret_cast<const char*>(input.map(0, fileSize));
+  const qint64 headerSize = SessionMagicLength + static_cast<qint64>(sizeof(quint32));
+  if (!mapped || fileSize < headerSize + static_cast<qint64>(sizeof(quint64)) ||
+      memcmp(mapped, SessionMagic, SessionMagicLength) != 0)
+    {
+    return fail(errorMessage, QString("%1 is not a Halt session file").arg(fileName));
+    }
+
+  QByteArray header = QByteArray::fromRawData(mapped, headerSize);
+  QDataStream headerStream(header);
+  headerStream.setVersion(QDataStream::Qt_5_6);
+  headerStream.skipRawData(SessionMagicLength);
+  quint32 version = 0;
+  headerStream >> version;
+  QByteArray trailer = QByteArray::fromRawData(mapped + fileSize - sizeof(quint64), sizeof(quint64));
+  QDataStream trailerStream(trailer);
+  trailerStream.setVersion(QDataStream::Qt_5_6);
+  quint64 indexOffset = 0;
+  trailerStream >> indexOffset;
+  if (version != SessionVersion || indexOffset < static_cast<quint64>(headerSize) ||
+      indexOffset > static_cast<quint64>(fileSize))
+    {
+    return fail(errorMessage, QString("Unsupported session file version %1").arg(version));
+    }
+
+  QByteArray index = QByteArray::fromRawData(mapped + indexOffset, static_cast<int>(fileSize - indexOffset));
+  QDataStream indexStream(index);
+  indexStream.setVersion(QDataStream::Qt_5_6);
+  QByteArray sceneXML;
+  quint32 numberOfEntries = 0;
+  indexStream >> sceneXML >> numberOfEntries;
+  std::vector<Entry> entries(indexStream.status() == QDataStream::Ok ? numberOfEntries : 0);
+  for (Entry& entry : entries)
+    {
+    indexStream >> entry;
+    }
+  if (indexStream.status() != QDataStream::Ok)
+    {
+    return fail(errorMessage, QString("%1 is corrupted").arg(fileName));
+    }
+
+  // Files are extracted next to the other temporary data, as for .mrb, and
+  // removed once the storage nodes have read them
+  QTemporaryDir temporaryDirectory(
+    QDir(qSlicerCoreApplication::application()->temporaryPath()).filePath("HaltSession-XXXXXX"));
+  if (!temporaryDirectory.isValid())
+    {
+    return fail(errorMessage, QString("Failed to create a temporary directory: %1").arg(temporaryDirectory.errorString()));
+    }
+  QDir dataDirectory(temporaryDirectory.path());
+
+  std::vector<ChunkTask> tasks;
+  std::vector<quint32> storedSizes;
+  std::vector<std::unique_ptr<QFile> > dataFiles;
+  std::vector<vtkSmartPointer<vtkImageData> > images(entries.size());
+  for (size_t entryIndex = 0; entryIndex < entries.size(); ++entryIndex)
+    {
+    const Entry& entry = entries[entryIndex];
+    char* destination = nullptr;
+    if (entry.Type == Entry::ImageEntry)
+      {
+      vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+      image->SetExtent(const_cast<int*>(entry.Extent));
+      image->AllocateScalars(entry.ScalarType, entry.NumberOfComponents);
+      if (static_cast<quint64>(image->GetNumberOfPoints()) * entry.NumberOfComponents *
+          image->GetScalarSize() != entry.Size)
+        {
+        return fail(errorMessage, QString("%1 is corrupted").arg(fileName));
+        }
+      destination = static_cast<char*>(image->GetScalarPointer());
+      images[entryIndex] = image;
+      }
+    else
+      {
+      // Names are relative to the session, a crafted file must not write elsewhere
+      if (entry.Name.isEmpty() || QDir::isAbsolutePath(entry.Name)
+          || entry.Name.split(QRegularExpression("[/\\\\]")).contains(".."))
+        {
+        return fail(errorMessage, QString("%1 is corrupted: invalid file name %2").arg(fileName).arg(entry.Name));
+        }
+      QString dataFileName = dataDirectory.filePath(entry.Name);
+      if (!dataDirectory.mkpath(QFileInfo(dataFileName).path()))
+        {
+        return fail(errorMessage, QString("Failed to create %1").arg(QFileInfo(dataFileName).path()));
+        }
+      // Symbolic links of the temporary directory do not lead out of it either
+      const QString canonicalDirectory = QFileInfo(QFileInfo(dataFileName).path()).canonicalFilePath();
+      const QString canonicalRoot = dataDirectory.canonicalPath();
+      if (canonicalDirectory != canonicalRoot && !canonicalDirectory.startsWith(canonicalRoot + "/"))
+        {
+        return fail(errorMessage, QString("%1 is corrupted: invalid file name %2").arg(fileName).arg(entry.Name));
+        }
+      std::unique_ptr<QFile> dataFile(new QFile(dataFileName));
+      if (!dataFile->open(QIODevice::ReadWrite | QIODevice::Truncate) ||
+          !dataFile->resize(static_cast<qint64>(entry.Size)))
+        {
+        return fail(errorMessage, QString("Failed to write %1").arg(dataFileName));
+        }
+      destination = entry.Size > 0 ?
+        reinterpret_cast<char*>(dataFile->map(0, static_cast<qint64>(entry.Size))) : nullptr;
+      if (entry.Size > 0 && !destination)
+        {
+        return fail(errorMessage, QString("Failed to map %1").arg(dataFileName));
+        }
+      dataFiles.push_back(std::move(dataFile));
+      }
+    quint64 size = 0;
+    for (const Chunk& chunk : entry.Chunks)
+      {
+      if (chunk.Offset + chunk.StoredSize > indexOffset || size + chunk.Size > entry.Size)
+        {
+        return fail(errorMessage, QString("%1 is corrupted").arg(fileName));
+        }
+      ChunkTask task;
+      task.Data = mapped + chunk.Offset;
+      task.Size = chunk.Size;
+      task.EntryIndex = entryIndex;
+      task.Destination = destination + size;
+      tasks.push_back(task);
+      storedSizes.push_back(chunk.StoredSize);
+      size += chunk.Size;
+      }
+    }
+  if (!decompressChunks(tasks, storedSizes))
+    {
+    return fail(errorMessage, QString("%1 is corrupted").arg(fileName));
+    }
+  // Flush the extracted files before the storage nodes read them
+  dataFiles.clear();
+
+  // Storage nodes read their files while the scene is loaded
+  std::string rootDirectory = scene->GetRootDirectory() ? scene->GetRootDirectory() : "";
+  scene->SetRootDirectory(dataDirectory.absolutePath().toUtf8().constData());
+  scene->SetLoadFromXMLString(1);
+  scene->SetSceneXMLString(sceneXML.toStdString());
+  int success = clear ? scene->Connect() : scene->Import();
+  scene->SetLoadFromXMLString(0);
+  scene->SetRootDirectory(rootDirectory.c_str());
+  if (!success)
+    {
+    return fail(errorMessage, QString("Failed to load the scene of %1").arg(fileName));
+    }
+
+  for (size_t entryIndex = 0; entryIndex < entries.size(); ++entryIndex)
+    {
+    if (!images[entryIndex])
+      {
+      continue;
+      }
+    // Node IDs are changed when importing in a scene that already uses them
+    std::string nodeID = entries[entryIndex].Name.toStdString();
+    const char* changedID = scene->GetChangedID(nodeID.c_str());
+    vtkMRMLScalarVolumeNode* volumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(
+      scene->GetNodeByID(changedID ? changedID : nodeID.c_str()));
+    if (volumeNode)
+      {
+      volumeNode->SetAndObserveImageData(images[entryIndex]);
+      }
+    }
+
+  return true;
+}
@@ -0,0 +1,63 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qHaltAppSessionFile_h
+#define __qHaltAppSessionFile_h
+
+// Qt includes
+#include <QString>
+
+// Halt includes
+#include "qHaltAppExport.h"
+
+class vtkMRMLScene;
+
+/// \brief Halt session file (.halt): a scene and all its data in a single file.
+///
+/// A Medical Reality Bundle (.mrb) is written by compressing each data file
+/// with its storage node, then zipping the files, all on a single thread.
+/// A session file instead splits the data in chunks that are compressed and
+/// decompressed independently, on all the cores:
+/// - scalar volumes and label maps are stored as their voxel arrays, and
+///   decompressed on load straight into the image data of the volume nodes;
+/// - other storable nodes (segmentations, models, markups, tables...) are
+///   written uncompressed by their storage nodes and stored as files, which
+///   are extracted on load into a temporary directory, removed once the
+///   storage nodes have read them;
+/// - the scene is stored as MRML.
+///
+/// The session file is memory-mapped on load: chunks are decompressed from
+/// the mapping, the file is never read into an intermediate buffer.
+///
+/// Layout: "HALTSESS" magic, format version, chunks, index (MRML scene,
+/// entries and their chunks), offset of the index.
+///
+/// \sa qHaltAppSessionReader, qHaltAppSessionWriter
+class Q_HALT_APP_EXPORT qHaltAppSessionFile
+{
+public:
+  /// Return ".halt"
+  static QString extension();
+
+  /// Write \a scene and its data to \a fileName.
+  /// Return false on failure, with the reason in \a errorMessage if not null.
+  static bool save(vtkMRMLScene* scene, const QString& fileName, QString* errorMessage = nullptr);
+
+  /// Load the session \a fileName in \a scene, replacing its content if \a clear is true.
+  /// Return false on failure, with the reason in \a errorMessage if not null.
+  static bool load(vtkMRMLScene* scene, const QString& fileName, bool clear = true,
+    QString* errorMessage = nullptr);
+};
+
+#endif
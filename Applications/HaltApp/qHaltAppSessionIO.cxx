@@ -0,0 +1,107 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Halt includes
+#include "qHaltAppSessionFile.h"
+#include "qHaltAppSessionIO.h"
+
+// MRML includes
+#include <vtkMRMLScene.h>
+
+//-----------------------------------------------------------------------------
+// qHaltAppSessionReader methods
+
+//-----------------------------------------------------------------------------
+qHaltAppSessionReader::qHaltAppSessionReader(QObject* parent)
+  : Superclass(parent)
+{
+}
+
+//-----------------------------------------------------------------------------
+QString qHaltAppSessionReader::description()const
+{
+  return "Halt session";
+}
+
+//-----------------------------------------------------------------------------
+qSlicerIO::IOFileType qHaltAppSessionReader::fileType()const
+{
+  return QString("HaltSessionFile");
+}
+
+//-----------------------------------------------------------------------------
+QStringList qHaltAppSessionReader::extensions()const
+{
+  return QStringList() << QString("Halt session (*%1)").arg(qHaltAppSessionFile::extension());
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppSessionReader::load(const IOProperties& properties)
+{
+  Q_ASSERT(properties.contains("fileName"));
+  QString fileName = properties["fileName"].toString();
+  bool clear = properties.value("clear", true).toBool();
+  if (!qHaltAppSessionFile::load(this->mrmlScene(), fileName, clear))
+    {
+    return false;
+    }
+  this->setLoadedNodes(QStringList());
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// qHaltAppSessionWriter methods
+
+//-----------------------------------------------------------------------------
+qHaltAppSessionWriter::qHaltAppSessionWriter(QObject* parent)
+  : Superclass(parent)
+{
+}
+
+//-----------------------------------------------------------------------------
+QString qHaltAppSessionWriter::description()const
+{
+  return "Halt session";
+}
+
+//-----------------------------------------------------------------------------
+qSlicerIO::IOFileType qHaltAppSessionWriter::fileType()const
+{
+  return QString("HaltSessionFile");
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppSessionWriter::canWriteObject(vtkObject* object)const
+{
+  return vtkMRMLScene::SafeDownCast(object) != nullptr;
+}
+
+//-----------------------------------------------------------------------------
+QStringList qHaltAppSessionWriter::extensions(vtkObject* object)const
+{
+  Q_UNUSED(object);
+  return QStringList() << QString("Halt session (*%1)").arg(qHaltAppSessionFile::extension());
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppSessionWriter::write(const qSlicerIO::IOProperties& properties)
+{
+  Q_ASSERT(properties.contains("fileName"));
+  QString fileName = properties["fileName"].toString();
+  if (!fileName.endsWith(qHaltAppSessionFile::extension()))
+    {
+    fileName += qHaltAppSessionFile::extension();
+    }
+  return qHaltAppSessionFile::save(this->mrmlScene(), fileName);
+}
@@ -0,0 +1,79 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qHaltAppSessionIO_h
+#define __qHaltAppSessionIO_h
+
+// Slicer includes
+#include "qSlicerFileReader.h"
+#include "qSlicerFileWriter.h"
+
+// Halt includes
+#include "qHaltAppExport.h"
+
+/// \brief Load Halt session files (.halt) with the IO manager.
+///
+/// The "clear" property (true by default) replaces the content of the scene.
+///
+/// \code{.py}
+/// slicer.app.coreIOManager().loadNodes("HaltSessionFile", {"fileName": "case.halt"})
+/// \endcode
+///
+/// \sa qHaltAppSessionFile
+class Q_HALT_APP_EXPORT qHaltAppSessionReader : public qSlicerFileReader
+{
+  Q_OBJECT
+public:
+  typedef qSlicerFileReader Superclass;
+  qHaltAppSessionReader(QObject* parent = nullptr);
+
+  QString description()const override;
+  IOFileType fileType()const override;
+  QStringList extensions()const override;
+
+  bool load(const IOProperties& properties) override;
+
+private:
+  Q_DISABLE_COPY(qHaltAppSessionReader);
+};
+
+/// \brief Save the scene as a Halt session file (.halt) with the IO manager.
+///
+/// The session format is listed with the scene formats of the save dialog.
+///
+/// \code{.py}
+/// slicer.app.coreIOManager().saveNodes("HaltSessionFile", {"fileName": "case.halt"})
+/// \endcode
+///
+/// \sa qHaltAppSessionFile
+class Q_HALT_APP_EXPORT qHaltAppSessionWriter : public qSlicerFileWriter
+{
+  Q_OBJECT
+public:
+  typedef qSlicerFileWriter Superclass;
+  qHaltAppSessionWriter(QObject* parent = nullptr);
+
+  QString description()const override;
+  IOFileType fileType()const override;
+
+  bool canWriteObject(vtkObject* object)const override;
+  QStringList extensions(vtkObject* object)const override;
+
+  bool write(const qSlicerIO::IOProperties& properties) override;
+
+private:
+  Q_DISABLE_COPY(qHaltAppSessionWriter);
+};
+
+#endif
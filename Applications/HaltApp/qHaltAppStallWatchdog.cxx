@@ -0,0 +1,521 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+
+// Slicer includes
+#include "vtkSlicerConfigure.h" // For Slicer_USE_PYTHONQT
+#ifdef Slicer_USE_PYTHONQT
+# include <PythonQtPythonInclude.h>
+#endif
+
+// Halt includes
+#include "qHaltAppStallWatchdog.h"
+
+// STD includes
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+
+#if defined(Q_OS_WIN)
+# include <io.h>
+# include <sys/stat.h>
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+# include <dbghelp.h>
+# pragma comment(lib, "dbghelp.lib")
+#else
+# include <unistd.h>
+#endif
+#if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
+# define HALT_SIGNAL_STACK_SAMPLING
+# include <csignal>
+# include <cstdlib>
+# include <execinfo.h>
+# include <pthread.h>
+#endif
+
+#ifdef Slicer_USE_PYTHONQT
+// Dump the Python stacks of all the threads of \a interp to \a fd without
+// holding the GIL, as done by the faulthandler module. Exported by the
+// Python library but only declared in its internal headers.
+extern "C" PyAPI_FUNC(const char*) _Py_DumpTracebackThreads(
+  int fd, PyInterpreterState* interp, PyThreadState* current_tstate);
+#endif
+
+namespace
+{
+
+/// Period of the heartbeat, in ms
+const int HeartbeatInterval = 50;
+const int MaximumNativeFrames = 64;
+/// The log is moved to "<log>.old" when larger than this size at startup
+const qint64 MaximumLogSize = 10 * 1024 * 1024;
+
+#ifdef Slicer_USE_PYTHONQT
+PyInterpreterState* PythonInterpreter = nullptr;
+#endif
+
+#if defined(HALT_SIGNAL_STACK_SAMPLING)
+pthread_t MainThread;
+void* NativeFrames[MaximumNativeFrames];
+std::atomic<int> NativeFrameCount(-1);
+bool NativeSamplerInstalled = false;
+struct sigaction PreviousSignalAction;
+
+//----------------------------------------------------------------------------
+void onSampleSignal(int)
+{
+  NativeFrameCount.store(backtrace(NativeFrames, MaximumNativeFrames));
+}
+#elif defined(Q_OS_WIN)
+HANDLE MainThread = nullptr;
+#endif
+
+//----------------------------------------------------------------------------
+/// Prepare the sampling of the stack of the calling thread (the main thread).
+void installNativeSampler()
+{
+#if defined(HALT_SIGNAL_STACK_SAMPLING)
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = onSampleSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGUSR2, &action, &PreviousSignalAction) != 0)
+    {
+    return;
+    }
+  if (PreviousSignalAction.sa_handler != SIG_DFL)
+    {
+    // Do not take over a handler installed by someone else
+    sigaction(SIGUSR2, &PreviousSignalAction, nullptr);
+    qWarning() << "Stall watchdog: SIGUSR2 is already handled, native stacks are not sampled";
+    return;
+    }
+  MainThread = pthread_self();
+  // The first call of backtrace() may load libraries, not in the signal handler
+  void* frame;
+  backtrace(&frame, 1);
+  NativeSamplerInstalled = true;
+#elif defined(Q_OS_WIN)
+  MainThread = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION,
+    FALSE, GetCurrentThreadId());
+  SymSetOptions(SYMOPT_DEFERRED_LOADS | SYMOPT_UNDNAME | SYMOPT_LOAD_LINES);
+  SymInitialize(GetCurrentProcess(), nullptr, TRUE);
+#endif
+}
+
+//----------------------------------------------------------------------------
+void uninstallNativeSampler()
+{
+#if defined(HALT_SIGNAL_STACK_SAMPLING)
+  if (NativeSamplerInstalled)
+    {
+    sigaction(SIGUSR2, &PreviousSignalAction, nullptr);
+    NativeSamplerInstalled = false;
+    }
+#elif defined(Q_OS_WIN)
+  if (MainThread)
+    {
+    SymCleanup(GetCurrentProcess());
+    CloseHandle(MainThread);
+    MainThread = nullptr;
+    }
+#endif
+}
+
+//----------------------------------------------------------------------------
+/// Return the symbolized stack of the main thread, one frame per line.
+/// Called from the watchdog thread.
+QByteArray sampleNativeStack()
+{
+  QByteArray stack;
+#if defined(HALT_SIGNAL_STACK_SAMPLING)
+  if (!NativeSamplerInstalled)
+    {
+    return stack;
+    }
+  NativeFrameCount.store(-1);
+  if (pthread_kill(MainThread, SIGUSR2) != 0)
+    {
+    return stack;
+    }
+  for (int i = 0; i < 100 && NativeFrameCount.load() < 0; ++i)
+    {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  int frameCount = NativeFrameCount.load();
+  if (frameCount <= 0)
+    {
+    return stack;
+    }
+  char** symbols = backtrace_symbols(NativeFrames, frameCount);
+  // Skip the frame of the signal handler
+  for (int i = 1; symbols && i < frameCount; ++i)
+    {
+    stack += QByteArray("  #") + QByteArray::number(i - 1) + " " + symbols[i] + "\n";
+    }
+  free(symbols);
+#elif defined(Q_OS_WIN) && defined(_M_X64)
+  if (!MainThread)
+    {
+    return stack;
+    }
+  // Nothing that may take a lock held by the main thread (e.g. the heap)
+  // must be called while it is suspended: only unwind, then symbolize.
+  DWORD64 addresses[MaximumNativeFrames];
+  int frameCount = 0;
+  if (SuspendThread(MainThread) == static_cast<DWORD>(-1))
+    {
+    return stack;
+    }
+  CONTEXT context;
+  memset(&context, 0, sizeof(context));
+  context.ContextFlags = CONTEXT_FULL;
+  if (GetThreadContext(MainThread, &context))
+    {
+    while (frameCount < MaximumNativeFrames && context.Rip)
+      {
+      addresses[frameCount++] = context.Rip;
+      DWORD64 imageBase = 0;
+      PRUNTIME_FUNCTION function = RtlLookupFunctionEntry(context.Rip, &imageBase, nullptr);
+      if (!function)
+        {
+        // Leaf function: the return address is on top of the stack
+        context.Rip = *reinterpret_cast<DWORD64*>(context.Rsp);
+        context.Rsp += 8;
+        continue;
+        }
+      PVOID handlerData = nullptr;
+      DWORD64 establisherFrame = 0;
+      RtlVirtualUnwind(UNW_FLAG_NHANDLER, imageBase, context.Rip, function,
+        &context, &handlerData, &establisherFrame, nullptr);
+      }
+    }
+  ResumeThread(MainThread);
+
+  char symbolBuffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME];
+  SYMBOL_INFO* symbol = reinterpret_cast<SYMBOL_INFO*>(symbolBuffer);
+  for (int i = 0; i < frameCount; ++i)
+    {
+    memset(symbolBuffer, 0, sizeof(symbolBuffer));
+    symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+    symbol->MaxNameLen = MAX_SYM_NAME;
+    DWORD64 displacement = 0;
+    QByteArray name;
+    if (SymFromAddr(GetCurrentProcess(), addresses[i], &displacement, symbol))
+      {
+      name = symbol->Name;
+      }
+    else
+      {
+      name = "0x" + QByteArray::number(static_cast<qulonglong>(addresses[i]), 16);
+      }
+    IMAGEHLP_LINE64 line;
+    memset(&line, 0, sizeof(line));
+    line.SizeOfStruct = sizeof(line);
+    DWORD lineDisplacement = 0;
+    if (SymGetLineFromAddr64(GetCurrentProcess(), addresses[i], &lineDisplacement, &line))
+      {
+      name += QByteArray(" (") + line.FileName + ":"
+        + QByteArray::number(static_cast<uint>(line.LineNumber)) + ")";
+      }
+    stack += QByteArray("  #") + QByteArray::number(i) + " " + name + "\n";
+    }
+#endif
+  return stack;
+}
+
+//----------------------------------------------------------------------------
+int openLog(const QString& fileName)
+{
+#if defined(Q_OS_WIN)
+  return _wopen(reinterpret_cast<const wchar_t*>(fileName.utf16()),
+    _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+  return open(QFile::encodeName(fileName).constData(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+}
+
+//----------------------------------------------------------------------------
+void writeToLog(int fileDescriptor, const QByteArray& text)
+{
+#if defined(Q_OS_WIN)
+  _write(fileDescriptor, text.constData(), static_cast<unsigned int>(text.size()));
+#else
+  ssize_t written = write(fileDescriptor, text.constData(), static_cast<size_t>(text.size()));
+  Q_UNUSED(written);
+#endif
+}
+
+//----------------------------------------------------------------------------
+void closeLog(int fileDescriptor)
+{
+#if defined(Q_OS_WIN)
+  _close(fileDescriptor);
+#else
+  close(fileDescriptor);
+#endif
+}
+
+//----------------------------------------------------------------------------
+QByteArray timestamp()
+{
+  return QDateTime::currentDateTime().toString(Qt::ISODateWithMs).toUtf8();
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+// qHaltAppStallWatchdog methods
+
+//-----------------------------------------------------------------------------
+qHaltAppStallWatchdog::qHaltAppStallWatchdog(QObject* parent)
+  : Superclass(parent)
+  , Threshold(100)
+  , LogFileDescriptor(-1)
+  , StallCount(0)
+  , MaximumLatency(0)
+  , LastHeartbeat(0)
+  , StopRequested(false)
+{
+  this->Clock.start();
+  this->HeartbeatTimer.setInterval(HeartbeatInterval);
+  QObject::connect(&this->HeartbeatTimer, SIGNAL(timeout()), this, SLOT(onHeartbeat()));
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppStallWatchdog::~qHaltAppStallWatchdog()
+{
+  this->stop();
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppStallWatchdog::threshold()const
+{
+  return this->Threshold;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStallWatchdog::setThreshold(int milliseconds)
+{
+  if (milliseconds == this->Threshold)
+    {
+    return;
+    }
+  // The watchdog thread reads the threshold without synchronization
+  bool running = this->isRunning();
+  this->stop();
+  this->Threshold = milliseconds;
+  if (running)
+    {
+    this->start();
+    }
+}
+
+//-----------------------------------------------------------------------------
+QString qHaltAppStallWatchdog::logFileName()const
+{
+  return this->LogFileName;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStallWatchdog::setLogFileName(const QString& fileName)
+{
+  this->LogFileName = fileName;
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppStallWatchdog::stallCount()const
+{
+  return this->StallCount;
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppStallWatchdog::takeMaximumLatency()
+{
+  int latency = this->MaximumLatency;
+  this->MaximumLatency = 0;
+  return latency;
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppStallWatchdog::isRunning()const
+{
+  return this->WatchdogThread.joinable();
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStallWatchdog::start()
+{
+  if (this->isRunning() || this->Threshold <= 0 || this->LogFileName.isEmpty())
+    {
+    return;
+    }
+  Q_ASSERT(QThread::currentThread() == QCoreApplication::instance()->thread());
+
+  QFileInfo logFileInfo(this->LogFileName);
+  if (logFileInfo.size() > MaximumLogSize)
+    {
+    QFile::remove(this->LogFileName + ".old");
+    QFile::rename(this->LogFileName, this->LogFileName + ".old");
+    }
+  this->LogFileDescriptor = openLog(this->LogFileName);
+  if (this->LogFileDescriptor < 0)
+    {
+    qWarning() << "Stall watchdog: failed to open" << this->LogFileName;
+    return;
+    }
+
+  installNativeSampler();
+#ifdef Slicer_USE_PYTHONQT
+  PythonInterpreter = Py_IsInitialized() ? PyInterpreterState_Main() : nullptr;
+#endif
+
+  this->StallCount = 0;
+  this->MaximumLatency = 0;
+  this->LastHeartbeat.store(this->now());
+  this->HeartbeatTimer.start();
+  this->StopRequested = false;
+  this->WatchdogThread = std::thread(&qHaltAppStallWatchdog::watch, this);
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStallWatchdog::stop()
+{
+  if (!this->isRunning())
+    {
+    return;
+    }
+    {
+    std::lock_guard<std::mutex> lock(this->WatchdogMutex);
+    this->StopRequested = true;
+    }
+  this->WatchdogCondition.notify_all();
+  this->WatchdogThread.join();
+  this->HeartbeatTimer.stop();
+  uninstallNativeSampler();
+  closeLog(this->LogFileDescriptor);
+  this->LogFileDescriptor = -1;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStallWatchdog::setActiveModule(const QString& moduleName)
+{
+  std::lock_guard<std::mutex> lock(this->ActiveModuleMutex);
+  this->ActiveModule = moduleName;
+}
+
+//-----------------------------------------------------------------------------
+QString qHaltAppStallWatchdog::activeModule()const
+{
+  std::lock_guard<std::mutex> lock(this->ActiveModuleMutex);
+  return this->ActiveModule;
+}
+
+//-----------------------------------------------------------------------------
+qint64 qHaltAppStallWatchdog::now()const
+{
+  return this->Clock.elapsed();
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStallWatchdog::onHeartbeat()
+{
+  qint64 current = this->now();
+  qint64 previous = this->LastHeartbeat.exchange(current);
+  int latency = static_cast<int>(std::max<qint64>(0, current - previous - HeartbeatInterval));
+  this->MaximumLatency = std::max(this->MaximumLatency, latency);
+  if (latency < this->Threshold)
+    {
+    return;
+    }
+  ++this->StallCount;
+  QString moduleName = this->activeModule();
+  this->writeLog(timestamp() + " Stall ended after " + QByteArray::number(latency)
+    + " ms, module \"" + moduleName.toUtf8() + "\"\n\n");
+  emit stallDetected(latency, moduleName);
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStallWatchdog::watch()
+{
+  // Check often enough to sample stalls just above the threshold
+  const int checkInterval = std::max(5, std::min(HeartbeatInterval, this->Threshold / 2));
+  qint64 sampledHeartbeat = -1;
+  std::unique_lock<std::mutex> lock(this->WatchdogMutex);
+  while (!this->StopRequested)
+    {
+    this->WatchdogCondition.wait_for(lock, std::chrono::milliseconds(checkInterval));
+    if (this->StopRequested)
+      {
+      break;
+      }
+    qint64 heartbeat = this->LastHeartbeat.load();
+    qint64 stallDuration = this->now() - heartbeat - HeartbeatInterval;
+    if (stallDuration < this->Threshold || heartbeat == sampledHeartbeat)
+      {
+      continue;
+      }
+    // Sample each stall once
+    sampledHeartbeat = heartbeat;
+    lock.unlock();
+    this->logStallBegin(stallDuration);
+    lock.lock();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStallWatchdog::logStallBegin(qint64 stallDuration)
+{
+  QByteArray nativeStack = sampleNativeStack();
+  std::lock_guard<std::mutex> lock(this->LogMutex);
+  writeToLog(this->LogFileDescriptor, timestamp() + " Stall: no events processed for "
+    + QByteArray::number(stallDuration) + " ms, module \"" + this->activeModule().toUtf8() + "\"\n");
+  if (!nativeStack.isEmpty())
+    {
+    writeToLog(this->LogFileDescriptor, "Native stack of the main thread:\n" + nativeStack);
+    }
+#ifdef Slicer_USE_PYTHONQT
+  if (PythonInterpreter)
+    {
+    writeToLog(this->LogFileDescriptor, "Python stacks:\n");
+    const char* errorMessage = _Py_DumpTracebackThreads(this->LogFileDescriptor, PythonInterpreter, nullptr);
+    if (errorMessage)
+      {
+      writeToLog(this->LogFileDescriptor, QByteArray("  ") + errorMessage + "\n");
+      }
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStallWatchdog::writeLog(const QByteArray& text)
+{
+  std::lock_guard<std::mutex> lock(this->LogMutex);
+  if (this->LogFileDescriptor >= 0)
+    {
+    writeToLog(this->LogFileDescriptor, text);
+    }
+}
@@ -0,0 +1,135 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qHaltAppStallWatchdog_h
+#define __qHaltAppStallWatchdog_h
+
+// Qt includes
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+// Halt includes
+#include "qHaltAppExport.h"
+
+// STD includes
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/// \brief Detect and log the stalls of the event loop of the main thread.
+///
+/// A heartbeat timer of the main thread records when the event loop last
+/// processed events. A watchdog thread checks the heartbeat: when the event
+/// loop has not processed events for longer than threshold(), it appends to
+/// the log file the active module, a native stack sample of the main thread
+/// and a Python stack sample of all the Python threads. The duration of the
+/// stall is logged once the event loop processes events again.
+///
+/// Stack samples are taken from the watchdog thread without waiting for the
+/// main thread nor the Python GIL:
+/// - native stacks are sampled with a SIGUSR2 handler (Linux, macOS) or by
+///   suspending the main thread (Windows x64);
+/// - Python stacks are dumped by the Python interpreter the same way as the
+///   faulthandler module does.
+///
+/// Configured by the "Performance/StallThreshold" (ms, 0 to disable) and
+/// "Performance/StallLogFile" (default: HaltStalls.log in the temporary
+/// directory) settings.
+class Q_HALT_APP_EXPORT qHaltAppStallWatchdog : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(int threshold READ threshold WRITE setThreshold)
+  Q_PROPERTY(QString logFileName READ logFileName WRITE setLogFileName)
+  Q_PROPERTY(int stallCount READ stallCount)
+public:
+  typedef QObject Superclass;
+  qHaltAppStallWatchdog(QObject* parent = nullptr);
+  virtual ~qHaltAppStallWatchdog();
+
+  /// Minimum duration, in ms, without processed events reported as a stall.
+  /// Default is 100 ms.
+  int threshold()const;
+  void setThreshold(int milliseconds);
+
+  /// File the stalls are appended to.
+  /// Must be set before start().
+  QString logFileName()const;
+  void setLogFileName(const QString& fileName);
+
+  /// Number of stalls since start().
+  int stallCount()const;
+
+  /// Return the maximum event loop latency, in ms, measured since the
+  /// last call, and reset it. The latency is the delay of the heartbeat.
+  Q_INVOKABLE int takeMaximumLatency();
+
+  bool isRunning()const;
+
+public slots:
+  /// Start the heartbeat and the watchdog thread.
+  /// Must be called from the main thread.
+  void start();
+  void stop();
+
+  /// Module reported in the stall log entries.
+  void setActiveModule(const QString& moduleName);
+
+signals:
+  /// Emitted once the event loop processes events again after a stall.
+  void stallDetected(int durationInMilliseconds, const QString& moduleName);
+
+protected slots:
+  void onHeartbeat();
+
+protected:
+  /// Loop of the watchdog thread.
+  void watch();
+
+  /// Log the beginning of a stall with stack samples. Called from the watchdog thread.
+  void logStallBegin(qint64 stallDuration);
+
+  /// Append \a text to the log. Thread-safe.
+  void writeLog(const QByteArray& text);
+
+  qint64 now()const;
+  QString activeModule()const;
+
+  int Threshold;
+  QString LogFileName;
+  int LogFileDescriptor;
+  int StallCount;
+  int MaximumLatency;
+
+  QElapsedTimer Clock;
+  QTimer HeartbeatTimer;
+  std::atomic<qint64> LastHeartbeat;
+
+  std::thread WatchdogThread;
+  bool StopRequested;
+  std::mutex WatchdogMutex;
+  std::condition_variable WatchdogCondition;
+
+  mutable std::mutex ActiveModuleMutex;
+  QString ActiveModule;
+
+  std::mutex LogMutex;
+
+private:
+  Q_DISABLE_COPY(qHaltAppStallWatchdog);
+};
+
+#endif
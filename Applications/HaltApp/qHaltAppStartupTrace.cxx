@@ -0,0 +1,238 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+// Slicer includes
+#include "qSlicerAbstractModuleFactoryManager.h"
+#include "vtkSlicerVersionConfigure.h" // For Slicer_MAIN_PROJECT_VERSION_FULL
+
+// Halt includes
+#include "qHaltAppStartupTrace.h"
+
+// STD includes
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+// qHaltAppStartupTrace methods
+
+//-----------------------------------------------------------------------------
+qHaltAppStartupTrace::qHaltAppStartupTrace(QObject* parent)
+  : Superclass(parent)
+  , Enabled(false)
+  , LastEventTime(0)
+{
+  this->Timer.start();
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppStartupTrace* qHaltAppStartupTrace::instance()
+{
+  static qHaltAppStartupTrace trace;
+  return &trace;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStartupTrace::initialize(int& argc, char* argv[])
+{
+  QString fileName = QString::fromLocal8Bit(qgetenv("HALT_STARTUP_TRACE_FILE"));
+
+  // Remove "--startup-trace <file>" and "--startup-trace=<file>" from argv
+  const char* option = "--startup-trace";
+  const size_t optionLength = strlen(option);
+  int kept = 1;
+  for (int i = 1; i < argc; ++i)
+    {
+    if (strcmp(argv[i], option) == 0 && i + 1 < argc)
+      {
+      fileName = QString::fromLocal8Bit(argv[++i]);
+      continue;
+      }
+    if (strncmp(argv[i], option, optionLength) == 0 && argv[i][optionLength] == '=')
+      {
+      fileName = QString::fromLocal8Bit(argv[i] + optionLength + 1);
+      continue;
+      }
+    argv[kept++] = argv[i];
+    }
+  if (kept < argc)
+    {
+    argv[kept] = nullptr;
+    }
+  argc = kept;
+
+  this->FileName = fileName;
+  this->Enabled = !fileName.isEmpty();
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppStartupTrace::isEnabled()const
+{
+  return this->Enabled;
+}
+
+//-----------------------------------------------------------------------------
+QString qHaltAppStartupTrace::fileName()const
+{
+  return this->FileName;
+}
+
+//-----------------------------------------------------------------------------
+qint64 qHaltAppStartupTrace::now()const
+{
+  return this->Timer.nsecsElapsed() / 1000;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStartupTrace::beginScope(const QString& name, const QString& category)
+{
+  if (!this->Enabled)
+    {
+    return;
+    }
+  Event event;
+  event.Name = name;
+  event.Category = category;
+  event.Begin = this->now();
+  event.Duration = -1;
+  this->OpenScopes.append(this->Events.size());
+  this->Events.append(event);
+  this->LastEventTime = event.Begin;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStartupTrace::endScope()
+{
+  if (!this->Enabled || this->OpenScopes.isEmpty())
+    {
+    return;
+    }
+  Event& event = this->Events[this->OpenScopes.takeLast()];
+  qint64 end = this->now();
+  event.Duration = end - event.Begin;
+  this->LastEventTime = end;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStartupTrace::addEventSinceLastEvent(const QString& name, const QString& category)
+{
+  if (!this->Enabled)
+    {
+    return;
+    }
+  Event event;
+  event.Name = name;
+  event.Category = category;
+  event.Begin = this->LastEventTime;
+  qint64 end = this->now();
+  event.Duration = end - event.Begin;
+  this->Events.append(event);
+  this->LastEventTime = end;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStartupTrace::observeModuleFactoryManager(
+  qSlicerAbstractModuleFactoryManager* factoryManager)
+{
+  if (!this->Enabled || !factoryManager)
+    {
+    return;
+    }
+  // Signals are emitted synchronously once each module is processed.
+  QObject::connect(factoryManager, SIGNAL(moduleRegistered(QString)),
+                   this, SLOT(onModuleRegistered(QString)));
+  QObject::connect(factoryManager, SIGNAL(modulesRegistered(QStringList)),
+                   this, SLOT(onModulesProcessed()));
+  QObject::connect(factoryManager, SIGNAL(moduleInstantiated(QString)),
+                   this, SLOT(onModuleInstantiated(QString)));
+  QObject::connect(factoryManager, SIGNAL(modulesInstantiated(QStringList)),
+                   this, SLOT(onModulesProcessed()));
+  QObject::connect(factoryManager, SIGNAL(moduleLoaded(QString)),
+                   this, SLOT(onModuleLoaded(QString)));
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStartupTrace::onModuleRegistered(const QString& moduleName)
+{
+  this->addEventSinceLastEvent(QString("Register %1").arg(moduleName), "module-registration");
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStartupTrace::onModuleInstantiated(const QString& moduleName)
+{
+  this->addEventSinceLastEvent(QString("Instantiate %1").arg(moduleName), "module-instantiation");
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStartupTrace::onModuleLoaded(const QString& moduleName)
+{
+  this->addEventSinceLastEvent(QString("Load %1").arg(moduleName), "module-load");
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppStartupTrace::onModulesProcessed()
+{
+  this->LastEventTime = this->now();
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppStartupTrace::write()
+{
+  if (!this->Enabled)
+    {
+    return false;
+    }
+  while (!this->OpenScopes.isEmpty())
+    {
+    this->endScope();
+    }
+
+  const qint64 pid = QCoreApplication::applicationPid();
+  QJsonArray traceEvents;
+  foreach(const Event& event, this->Events)
+    {
+    QJsonObject traceEvent;
+    traceEvent["name"] = event.Name;
+    traceEvent["cat"] = event.Category;
+    traceEvent["ph"] = "X";
+    traceEvent["ts"] = event.Begin;
+    traceEvent["dur"] = event.Duration;
+    traceEvent["pid"] = pid;
+    traceEvent["tid"] = 1;
+    traceEvents.append(traceEvent);
+    }
+
+  QJsonObject otherData;
+  otherData["version"] = QString(Slicer_MAIN_PROJECT_VERSION_FULL);
+
+  QJsonObject trace;
+  trace["traceEvents"] = traceEvents;
+  trace["displayTimeUnit"] = "ms";
+  trace["otherData"] = otherData;
+
+  QFile file(this->FileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+    qWarning() << "Failed to write startup trace" << this->FileName << ":" << file.errorString();
+    return false;
+    }
+  file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+  return true;
+}
@@ -0,0 +1,119 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qHaltAppStartupTrace_h
+#define __qHaltAppStartupTrace_h
+
+// Qt includes
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+// Halt includes
+#include "qHaltAppExport.h"
+
+class qSlicerAbstractModuleFactoryManager;
+
+/// \brief Record named, nested timing scopes during application startup.
+///
+/// Scopes are written as a Chrome/Perfetto trace ("Trace Event Format") JSON
+/// file that can be opened in chrome://tracing or https://ui.perfetto.dev.
+///
+/// Tracing is enabled by setting the environment variable
+/// HALT_STARTUP_TRACE_FILE or by passing "--startup-trace <file>" on the
+/// command line. When disabled, beginScope() and endScope() are no-ops.
+///
+/// \sa qHaltAppStartupTraceScope
+class Q_HALT_APP_EXPORT qHaltAppStartupTrace : public QObject
+{
+  Q_OBJECT
+public:
+  typedef QObject Superclass;
+
+  /// Return the application-wide instance.
+  static qHaltAppStartupTrace* instance();
+
+  /// Enable the trace if requested by the environment or command line.
+  /// The "--startup-trace <file>" arguments are removed from \a argv so that
+  /// they are not interpreted by the application command line parser.
+  /// Must be called before creating the application.
+  void initialize(int& argc, char* argv[]);
+
+  bool isEnabled()const;
+  QString fileName()const;
+
+  /// Open a scope named \a name. Scopes must be closed in reverse order.
+  void beginScope(const QString& name, const QString& category = "startup");
+  /// Close the most recently opened scope.
+  void endScope();
+
+  /// Record a complete event from the end of the previous recorded event to now.
+  /// Used to attribute time to modules reported through factory signals.
+  void addEventSinceLastEvent(const QString& name, const QString& category);
+
+  /// Attribute registration, instantiation and loading time to each module.
+  void observeModuleFactoryManager(qSlicerAbstractModuleFactoryManager* factoryManager);
+
+  /// Write the recorded events to fileName(). Open scopes are closed first.
+  /// Return false if the trace is disabled or the file could not be written.
+  bool write();
+
+protected slots:
+  void onModuleRegistered(const QString& moduleName);
+  void onModuleInstantiated(const QString& moduleName);
+  void onModuleLoaded(const QString& moduleName);
+  void onModulesProcessed();
+
+protected:
+  qHaltAppStartupTrace(QObject* parent = nullptr);
+
+  struct Event
+  {
+    QString Name;
+    QString Category;
+    qint64 Begin; // in microseconds
+    qint64 Duration; // in microseconds, -1 while the scope is open
+  };
+
+  qint64 now()const;
+
+  bool Enabled;
+  QString FileName;
+  QElapsedTimer Timer;
+  QList<Event> Events;
+  QList<int> OpenScopes;
+  qint64 LastEventTime;
+
+private:
+  Q_DISABLE_COPY(qHaltAppStartupTrace);
+};
+
+/// \brief Scoped helper opening a startup trace scope for its lifetime.
+class Q_HALT_APP_EXPORT qHaltAppStartupTraceScope
+{
+public:
+  qHaltAppStartupTraceScope(const QString& name, const QString& category = "startup")
+    {
+    qHaltAppStartupTrace::instance()->beginScope(name, category);
+    }
+  ~qHaltAppStartupTraceScope()
+    {
+    qHaltAppStartupTrace::instance()->endScope();
+    }
+private:
+  Q_DISABLE_COPY(qHaltAppStartupTraceScope);
+};
+
+#endif
@@ -0,0 +1,112 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QProgressBar>
+#include <QStyle>
+#include <QToolButton>
+
+// Halt includes
+#include "qHaltAppTaskProgressWidget.h"
+
+//-----------------------------------------------------------------------------
+// qHaltAppTaskProgressWidget methods
+
+//-----------------------------------------------------------------------------
+qHaltAppTaskProgressWidget::qHaltAppTaskProgressWidget(QWidget* parent)
+  : Superclass(parent)
+{
+  this->setObjectName("TaskProgressWidget");
+
+  this->TaskLabel = new QLabel(this);
+  this->ProgressBar = new QProgressBar(this);
+  this->ProgressBar->setRange(0, 100);
+  this->ProgressBar->setMaximumWidth(150);
+  this->ProgressBar->setTextVisible(false);
+  this->CancelButton = new QToolButton(this);
+  this->CancelButton->setIcon(this->style()->standardIcon(QStyle::SP_DialogCancelButton));
+  this->CancelButton->setAutoRaise(true);
+  this->CancelButton->setToolTip(tr("Cancel all the background tasks"));
+  QObject::connect(this->CancelButton, SIGNAL(clicked()), this, SLOT(cancelAllTasks()));
+
+  QHBoxLayout* layout = new QHBoxLayout(this);
+  layout->setContentsMargins(0, 0, 0, 0);
+  layout->addWidget(this->TaskLabel);
+  layout->addWidget(this->ProgressBar);
+  layout->addWidget(this->CancelButton);
+
+  this->RefreshTimer.setInterval(200);
+  QObject::connect(&this->RefreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+  this->setVisible(false);
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppTaskProgressWidget::~qHaltAppTaskProgressWidget()
+{
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskProgressWidget::setTaskScheduler(qHaltAppTaskScheduler* scheduler)
+{
+  if (this->TaskScheduler)
+    {
+    QObject::disconnect(this->TaskScheduler, nullptr, this, nullptr);
+    }
+  this->TaskScheduler = scheduler;
+  if (scheduler)
+    {
+    QObject::connect(scheduler, SIGNAL(activeTaskCountChanged(int)),
+                     this, SLOT(onActiveTaskCountChanged(int)));
+    }
+  this->onActiveTaskCountChanged(scheduler ? scheduler->activeTaskCount() : 0);
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskProgressWidget::onActiveTaskCountChanged(int count)
+{
+  this->setVisible(count > 0);
+  if (count > 0)
+    {
+    this->RefreshTimer.start();
+    this->refresh();
+    }
+  else
+    {
+    this->RefreshTimer.stop();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskProgressWidget::refresh()
+{
+  if (!this->TaskScheduler)
+    {
+    return;
+    }
+  QStringList taskNames = this->TaskScheduler->activeTaskNames();
+  this->TaskLabel->setText(taskNames.count() == 1 ? taskNames.first() : tr("%1 tasks").arg(taskNames.count()));
+  this->TaskLabel->setToolTip(taskNames.join("\n"));
+  this->ProgressBar->setValue(qRound(this->TaskScheduler->progress() * 100));
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskProgressWidget::cancelAllTasks()
+{
+  if (this->TaskScheduler)
+    {
+    this->TaskScheduler->cancelAll();
+    }
+}
@@ -0,0 +1,63 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qHaltAppTaskProgressWidget_h
+#define __qHaltAppTaskProgressWidget_h
+
+// Qt includes
+#include <QPointer>
+#include <QTimer>
+#include <QWidget>
+
+// Halt includes
+#include "qHaltAppExport.h"
+#include "qHaltAppTaskScheduler.h"
+
+class QLabel;
+class QProgressBar;
+class QToolButton;
+
+/// \brief Status bar progress of the tasks of a qHaltAppTaskScheduler.
+///
+/// Visible while tasks are active: it shows the active tasks, their mean
+/// progress and a button canceling all of them.
+class Q_HALT_APP_EXPORT qHaltAppTaskProgressWidget : public QWidget
+{
+  Q_OBJECT
+public:
+  typedef QWidget Superclass;
+  qHaltAppTaskProgressWidget(QWidget* parent = nullptr);
+  virtual ~qHaltAppTaskProgressWidget();
+
+  void setTaskScheduler(qHaltAppTaskScheduler* scheduler);
+
+public slots:
+  void refresh();
+
+protected slots:
+  void onActiveTaskCountChanged(int count);
+  void cancelAllTasks();
+
+protected:
+  QPointer<qHaltAppTaskScheduler> TaskScheduler;
+  QLabel* TaskLabel;
+  QProgressBar* ProgressBar;
+  QToolButton* CancelButton;
+  QTimer RefreshTimer;
+
+private:
+  Q_DISABLE_COPY(qHaltAppTaskProgressWidget);
+};
+
+#endif
@@ -0,0 +1,715 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QAbstractEventDispatcher>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QPointer>
+#include <QThread>
+
+// Halt includes
+#include "qHaltAppTaskScheduler.h"
+
+#ifdef Slicer_USE_PYTHONQT
+# include <PythonQt.h>
+#endif
+
+// STD includes
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+//-----------------------------------------------------------------------------
+struct qHaltAppTaskScheduler::Task
+{
+  Task()
+    : Id(-1)
+    , State(Waiting)
+    , PendingDependencies(0)
+    , CancelRequested(false)
+    , Progress(0.)
+    , Reported(false)
+    , Python(false)
+    {
+    }
+
+  int Id;
+  QString Name;
+  TaskFunction Function;
+  TaskState State;
+  QList<int> Dependencies;
+  QList<int> Dependents;
+  int PendingDependencies;
+  std::atomic<bool> CancelRequested;
+  double Progress;
+  QVariant Result;
+  QString ErrorMessage;
+  /// True once the completion signal was emitted
+  bool Reported;
+  bool Python;
+#ifdef Slicer_USE_PYTHONQT
+  std::shared_ptr<PyObject> PythonResult;
+#endif
+};
+
+#ifdef Slicer_USE_PYTHONQT
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Hold the GIL for the lifetime of the scope, whether or not the calling
+/// thread already holds it.
+class GILScope
+{
+public:
+  GILScope()
+    : State(PyGILState_Ensure())
+    {
+    }
+  ~GILScope()
+    {
+    PyGILState_Release(this->State);
+    }
+private:
+  PyGILState_STATE State;
+};
+
+//----------------------------------------------------------------------------
+/// Return a reference to \a object that can be released on any thread.
+/// \a newReference is true if the reference of \a object is transferred.
+std::shared_ptr<PyObject> pythonReference(PyObject* object, bool newReference)
+{
+  if (!newReference)
+    {
+    GILScope gil;
+    Py_XINCREF(object);
+    }
+  return std::shared_ptr<PyObject>(object, [](PyObject* referencedObject)
+    {
+    GILScope gil;
+    Py_XDECREF(referencedObject);
+    });
+}
+
+//----------------------------------------------------------------------------
+/// Print the current Python exception and return its message. Requires the GIL.
+QString takePythonError()
+{
+  PyObject* type = nullptr;
+  PyObject* value = nullptr;
+  PyObject* traceback = nullptr;
+  PyErr_Fetch(&type, &value, &traceback);
+  PyErr_NormalizeException(&type, &value, &traceback);
+  QString message = "Python error";
+  PyObject* valueString = value ? PyObject_Str(value) : nullptr;
+  if (valueString)
+    {
+    message = QString::fromUtf8(PyUnicode_AsUTF8(valueString));
+    Py_DECREF(valueString);
+    }
+  PyErr_Restore(type, value, traceback);
+  PyErr_Print();
+  return message;
+}
+
+} // end of anonymous namespace
+#endif
+
+//-----------------------------------------------------------------------------
+// qHaltAppTaskScheduler methods
+
+//-----------------------------------------------------------------------------
+qHaltAppTaskScheduler* qHaltAppTaskScheduler::instance()
+{
+  static QPointer<qHaltAppTaskScheduler> scheduler;
+  if (!scheduler)
+    {
+    scheduler = new qHaltAppTaskScheduler(QCoreApplication::instance());
+    }
+  return scheduler;
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppTaskScheduler::qHaltAppTaskScheduler(QObject* parent)
+  : Superclass(parent)
+  , NextTaskId(1)
+  , ActiveTaskCount(0)
+  , PythonTaskCount(0)
+  , NextWorkerQueue(0)
+  , ReadyTaskCount(0)
+  , StopRequested(false)
+  , MainThreadState(nullptr)
+{
+  QCoreApplication* app = QCoreApplication::instance();
+  if (app)
+    {
+    // Python objects must be released before Python is finalized
+    QObject::connect(app, SIGNAL(aboutToQuit()), this, SLOT(shutdown()));
+    QAbstractEventDispatcher* dispatcher = QAbstractEventDispatcher::instance(app->thread());
+    if (dispatcher)
+      {
+      QObject::connect(dispatcher, SIGNAL(aboutToBlock()),
+                       this, SLOT(onEventLoopAboutToBlock()), Qt::DirectConnection);
+      QObject::connect(dispatcher, SIGNAL(awake()),
+                       this, SLOT(onEventLoopAwake()), Qt::DirectConnection);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppTaskScheduler::~qHaltAppTaskScheduler()
+{
+  this->shutdown();
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppTaskScheduler::workerCount()const
+{
+  return std::max(1, QThread::idealThreadCount() - 1);
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppTaskScheduler::activeTaskCount()const
+{
+  std::lock_guard<std::mutex> lock(this->TasksMutex);
+  return this->ActiveTaskCount;
+}
+
+//-----------------------------------------------------------------------------
+QStringList qHaltAppTaskScheduler::activeTaskNames()const
+{
+  std::lock_guard<std::mutex> lock(this->TasksMutex);
+  QStringList names;
+  foreach(const TaskPointer& task, this->Tasks)
+    {
+    if (task->State < Finished)
+      {
+      names << task->Name;
+      }
+    }
+  return names;
+}
+
+//-----------------------------------------------------------------------------
+double qHaltAppTaskScheduler::progress()const
+{
+  std::lock_guard<std::mutex> lock(this->TasksMutex);
+  double progress = 0.;
+  int count = 0;
+  foreach(const TaskPointer& task, this->Tasks)
+    {
+    if (task->State < Finished)
+      {
+      progress += task->Progress;
+      ++count;
+      }
+    }
+  return count ? progress / count : 1.;
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppTaskScheduler::TaskPointer qHaltAppTaskScheduler::task(int taskId)const
+{
+  std::lock_guard<std::mutex> lock(this->TasksMutex);
+  return this->Tasks.value(taskId);
+}
+
+//-----------------------------------------------------------------------------
+QString qHaltAppTaskScheduler::taskName(int taskId)const
+{
+  TaskPointer task = this->task(taskId);
+  return task ? task->Name : QString();
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppTaskScheduler::taskState(int taskId)const
+{
+  std::lock_guard<std::mutex> lock(this->TasksMutex);
+  TaskPointer task = this->Tasks.value(taskId);
+  if (task)
+    {
+    return task->State;
+    }
+  return this->CompletedTaskStates.value(taskId, -1);
+}
+
+//-----------------------------------------------------------------------------
+QVariant qHaltAppTaskScheduler::result(int taskId)const
+{
+  std::lock_guard<std::mutex> lock(this->TasksMutex);
+  TaskPointer task = this->Tasks.value(taskId);
+  return task && task->State == Finished ? task->Result : QVariant();
+}
+
+//-----------------------------------------------------------------------------
+QString qHaltAppTaskScheduler::errorMessage(int taskId)const
+{
+  std::lock_guard<std::mutex> lock(this->TasksMutex);
+  TaskPointer task = this->Tasks.value(taskId);
+  return task ? task->ErrorMessage : QString();
+}
+
+//-----------------------------------------------------------------------------
+bool qHaltAppTaskScheduler::isCanceled(int taskId)const
+{
+  TaskPointer task = this->task(taskId);
+  return !task || task->CancelRequested.load();
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::setProgress(int taskId, double progress)
+{
+  std::lock_guard<std::mutex> lock(this->TasksMutex);
+  TaskPointer task = this->Tasks.value(taskId);
+  if (task)
+    {
+    task->Progress = std::min(1., std::max(0., progress));
+    }
+}
+
+//-----------------------------------------------------------------------------
+int qHaltAppTaskScheduler::submit(const QString& name, TaskFunction function, const QList<int>& dependencies)
+{
+  TaskPointer task(new Task);
+  task->Name = name;
+  task->Function = function;
+  return this->addTask(task, dependencies);
+}
+
+#ifdef Slicer_USE_PYTHONQT
+//-----------------------------------------------------------------------------
+int qHaltAppTaskScheduler::submit(const QString& name, PyObject* callable, const QList<int>& dependencies)
+{
+  if (!callable || !PyCallable_Check(callable))
+    {
+    qWarning() << Q_FUNC_INFO << ": task" << name << "is not callable";
+    return -1;
+    }
+  // Python is called from the worker threads while the main thread runs:
+  // PythonQt must acquire the GIL when it calls Python.
+  PythonQt::self()->setEnableThreadSupport(true);
+
+  TaskPointer task(new Task);
+  task->Name = name;
+  task->Python = true;
+  std::shared_ptr<PyObject> pythonCallable = pythonReference(callable, false);
+  // The task owns its function, it outlives the calls of the function
+  Task* calledTask = task.data();
+  task->Function = [pythonCallable, calledTask](int taskId)
+    {
+    GILScope gil;
+    PyObject* value = PyObject_CallFunction(pythonCallable.get(), "i", taskId);
+    if (!value)
+      {
+      throw std::runtime_error(takePythonError().toStdString());
+      }
+    calledTask->PythonResult = pythonReference(value, true);
+    return QVariant();
+    };
+  return this->addTask(task, dependencies);
+}
+
+//-----------------------------------------------------------------------------
+PythonQtObjectPtr qHaltAppTaskScheduler::pythonResult(int taskId)const
+{
+  TaskPointer task = this->task(taskId);
+  GILScope gil;
+  PythonQtObjectPtr result;
+  if (task && task->State == Finished && task->PythonResult)
+    {
+    result = task->PythonResult.get();
+    }
+  return result;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+int qHaltAppTaskScheduler::addTask(TaskPointer task, const QList<int>& dependencies)
+{
+  this->startWorkers();
+  int activeTaskCount = 0;
+  int taskId = -1;
+    {
+    std::lock_guard<std::mutex> lock(this->TasksMutex);
+    taskId = this->NextTaskId++;
+    task->Id = taskId;
+    bool canceled = false;
+    foreach(int dependencyId, dependencies)
+      {
+      TaskPointer dependency = this->Tasks.value(dependencyId);
+      if (!dependency)
+        {
+        // Already completed and released
+        if (!this->CompletedTaskStates.contains(dependencyId))
+          {
+          qWarning() << Q_FUNC_INFO << ": unknown dependency" << dependencyId << "of task" << task->Name;
+          }
+        canceled |= this->CompletedTaskStates.value(dependencyId, Finished) != Finished;
+        continue;
+        }
+      if (dependency->State == Failed || dependency->State == Canceled)
+        {
+        canceled = true;
+        continue;
+        }
+      // Finished dependencies are kept until the task completes, for their result
+      task->Dependencies << dependencyId;
+      dependency->Dependents << taskId;
+      if (dependency->State != Finished)
+        {
+        ++task->PendingDependencies;
+        }
+      }
+    this->Tasks[taskId] = task;
+    ++this->ActiveTaskCount;
+    if (task->Python)
+      {
+      ++this->PythonTaskCount;
+      }
+    if (canceled)
+      {
+      task->CancelRequested = true;
+      this->completeTask(task, Canceled, -1);
+      }
+    else if (task->PendingDependencies == 0)
+      {
+      task->State = Ready;
+      this->pushReadyTask(task, -1);
+      }
+    activeTaskCount = this->ActiveTaskCount;
+    }
+  emit activeTaskCountChanged(activeTaskCount);
+  return taskId;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::startWorkers()
+{
+  std::lock_guard<std::mutex> lock(this->TasksMutex);
+  if (!this->Workers.empty())
+    {
+    return;
+    }
+  this->StopRequested = false;
+  this->ReadyTaskCount = 0;
+  const int workerCount = this->workerCount();
+  for (int i = 0; i < workerCount; ++i)
+    {
+    this->WorkerQueues.emplace_back(new WorkerQueue);
+    }
+  for (int i = 0; i < workerCount; ++i)
+    {
+    this->Workers.emplace_back(&qHaltAppTaskScheduler::work, this, i);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::pushReadyTask(TaskPointer task, int workerIndex)
+{
+  if (workerIndex < 0)
+    {
+    workerIndex = this->NextWorkerQueue++ % static_cast<int>(this->WorkerQueues.size());
+    }
+    {
+    WorkerQueue& queue = *this->WorkerQueues[workerIndex];
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    queue.Tasks.push_back(task);
+    }
+    {
+    std::lock_guard<std::mutex> lock(this->SleepMutex);
+    ++this->ReadyTaskCount;
+    }
+  this->SleepCondition.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+qHaltAppTaskScheduler::TaskPointer qHaltAppTaskScheduler::takeReadyTask(int workerIndex)
+{
+  TaskPointer task;
+  const int queueCount = static_cast<int>(this->WorkerQueues.size());
+  for (int i = 0; i < queueCount && !task; ++i)
+    {
+    WorkerQueue& queue = *this->WorkerQueues[(workerIndex + i) % queueCount];
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    if (queue.Tasks.empty())
+      {
+      continue;
+      }
+    if (i == 0)
+      {
+      // Own queue: most recent first, its data is likely still in cache
+      task = queue.Tasks.back();
+      queue.Tasks.pop_back();
+      }
+    else
+      {
+      task = queue.Tasks.front();
+      queue.Tasks.pop_front();
+      }
+    }
+  if (task)
+    {
+    std::lock_guard<std::mutex> lock(this->SleepMutex);
+    --this->ReadyTaskCount;
+    }
+  return task;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::work(int workerIndex)
+{
+  while (true)
+    {
+    TaskPointer task = this->takeReadyTask(workerIndex);
+    if (task)
+      {
+      this->runTask(task, workerIndex);
+      continue;
+      }
+    std::unique_lock<std::mutex> lock(this->SleepMutex);
+    this->SleepCondition.wait(lock, [this]() { return this->StopRequested || this->ReadyTaskCount > 0; });
+    if (this->StopRequested)
+      {
+      return;
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::runTask(TaskPointer task, int workerIndex)
+{
+    {
+    std::lock_guard<std::mutex> lock(this->TasksMutex);
+    if (task->CancelRequested)
+      {
+      this->completeTask(task, Canceled, workerIndex);
+      return;
+      }
+    task->State = Running;
+    }
+
+  QVariant result;
+  QString errorMessage;
+  TaskState state = Finished;
+  try
+    {
+    result = task->Function(task->Id);
+    }
+  catch (const std::exception& exception)
+    {
+    state = Failed;
+    errorMessage = QString::fromStdString(exception.what());
+    }
+  catch (...)
+    {
+    state = Failed;
+    errorMessage = "Unknown error";
+    }
+  if (state == Finished && task->CancelRequested)
+    {
+    state = Canceled;
+    }
+
+  std::lock_guard<std::mutex> lock(this->TasksMutex);
+  task->Result = result;
+  task->ErrorMessage = errorMessage;
+  task->Progress = 1.;
+  this->completeTask(task, state, workerIndex);
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::completeTask(TaskPointer task, TaskState state, int workerIndex)
+{
+  if (task->State >= Finished)
+    {
+    return;
+    }
+  task->State = state;
+  --this->ActiveTaskCount;
+  QMetaObject::invokeMethod(this, "onTaskCompleted", Qt::QueuedConnection, Q_ARG(int, task->Id));
+
+  foreach(int dependentId, task->Dependents)
+    {
+    TaskPointer dependent = this->Tasks.value(dependentId);
+    if (!dependent || dependent->State != Waiting)
+      {
+      continue;
+      }
+    if (state != Finished)
+      {
+      dependent->CancelRequested = true;
+      this->completeTask(dependent, Canceled, workerIndex);
+      }
+    else if (--dependent->PendingDependencies == 0)
+      {
+      dependent->State = Ready;
+      this->pushReadyTask(dependent, workerIndex);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::onTaskCompleted(int taskId)
+{
+  TaskPointer task = this->task(taskId);
+  if (!task)
+    {
+    return;
+    }
+  switch (task->State)
+    {
+    case Finished:
+      emit taskFinished(taskId);
+      break;
+    case Failed:
+      emit taskFailed(taskId, task->ErrorMessage);
+      break;
+    default:
+      emit taskCanceled(taskId);
+      break;
+    }
+  emit activeTaskCountChanged(this->activeTaskCount());
+
+  // Released outside of the lock: releasing Python objects acquires the GIL
+  QList<TaskPointer> releasedTasks;
+    {
+    std::lock_guard<std::mutex> lock(this->TasksMutex);
+    task->Reported = true;
+    if (task->Python)
+      {
+      --this->PythonTaskCount;
+      }
+    this->releaseTask(task, releasedTasks);
+    foreach(int dependencyId, task->Dependencies)
+      {
+      this->releaseTask(this->Tasks.value(dependencyId), releasedTasks);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::releaseTask(TaskPointer task, QList<TaskPointer>& releasedTasks)
+{
+  if (!task || !task->Reported)
+    {
+    return;
+    }
+  foreach(int dependentId, task->Dependents)
+    {
+    TaskPointer dependent = this->Tasks.value(dependentId);
+    if (dependent && dependent->State < Finished)
+      {
+      return;
+      }
+    }
+  this->Tasks.remove(task->Id);
+  this->CompletedTaskStates[task->Id] = task->State;
+  releasedTasks << task;
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::cancel(int taskId)
+{
+  std::lock_guard<std::mutex> lock(this->TasksMutex);
+  TaskPointer task = this->Tasks.value(taskId);
+  if (!task || task->State >= Finished)
+    {
+    return;
+    }
+  task->CancelRequested = true;
+  if (task->State == Waiting)
+    {
+    this->completeTask(task, Canceled, -1);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::cancelAll()
+{
+  QList<int> taskIds;
+    {
+    std::lock_guard<std::mutex> lock(this->TasksMutex);
+    taskIds = this->Tasks.keys();
+    }
+  foreach(int taskId, taskIds)
+    {
+    this->cancel(taskId);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::shutdown()
+{
+  this->cancelAll();
+    {
+    std::lock_guard<std::mutex> lock(this->SleepMutex);
+    this->StopRequested = true;
+    }
+  this->SleepCondition.notify_all();
+
+#ifdef Slicer_USE_PYTHONQT
+  // Running Python tasks may be waiting for the GIL
+  PyThreadState* threadState = nullptr;
+  if (Py_IsInitialized() && PyGILState_Check())
+    {
+    threadState = PyEval_SaveThread();
+    }
+#endif
+  for (std::thread& worker : this->Workers)
+    {
+    worker.join();
+    }
+#ifdef Slicer_USE_PYTHONQT
+  if (threadState)
+    {
+    PyEval_RestoreThread(threadState);
+    }
+#endif
+
+  QList<TaskPointer> releasedTasks;
+    {
+    std::lock_guard<std::mutex> lock(this->TasksMutex);
+    releasedTasks = this->Tasks.values();
+    this->Tasks.clear();
+    this->Workers.clear();
+    this->WorkerQueues.clear();
+    this->ActiveTaskCount = 0;
+    this->PythonTaskCount = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::onEventLoopAboutToBlock()
+{
+#ifdef Slicer_USE_PYTHONQT
+  // Let the Python tasks run while the main thread waits for events
+  if (this->PythonTaskCount > 0 && !this->MainThreadState && Py_IsInitialized() && PyGILState_Check())
+    {
+    this->MainThreadState = PyEval_SaveThread();
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void qHaltAppTaskScheduler::onEventLoopAwake()
+{
+#ifdef Slicer_USE_PYTHONQT
+  if (this->MainThreadState)
+    {
+    PyEval_RestoreThread(static_cast<PyThreadState*>(this->MainThreadState));
+    this->MainThreadState = nullptr;
+    }
+#endif
+}
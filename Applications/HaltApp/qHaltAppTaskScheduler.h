@@ -0,0 +1,217 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qHaltAppTaskScheduler_h
+#define __qHaltAppTaskScheduler_h
+
+// Qt includes
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+// Slicer includes
+#include "vtkSlicerConfigure.h" // For Slicer_USE_PYTHONQT
+#ifdef Slicer_USE_PYTHONQT
+# include <PythonQtObjectPtr.h>
+#endif
+
+// Halt includes
+#include "qHaltAppExport.h"
+
+// STD includes
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// \brief Application-wide pool of worker threads running tasks with dependencies.
+///
+/// A task runs once all the tasks it depends on have finished. If one of them
+/// fails or is canceled, the task is canceled without running. Each worker
+/// has its own queue of ready tasks: it runs the most recently queued ones
+/// first (tasks made ready by a task it just finished) and steals the oldest
+/// ones from the other workers when its queue is empty.
+///
+/// Completion is reported on the main thread by the taskFinished(), taskFailed()
+/// and taskCanceled() signals. Cancellation is cooperative: running tasks
+/// check isCanceled() and return early.
+///
+/// Scripted modules use it through slicer.haltTaskScheduler:
+/// \code
+/// scheduler = slicer.haltTaskScheduler
+/// def scoreCalcium(taskId):
+///     for step in range(steps):
+///         if scheduler.isCanceled(taskId):
+///             return None
+///         ...
+///         scheduler.setProgress(taskId, (step + 1) / steps)
+///     return scores
+/// calcium = scheduler.submit("Calcium scoring", scoreCalcium)
+/// centerline = scheduler.submit("Centerline", extractCenterline)
+/// report = scheduler.submit("Report", makeReport, [calcium, centerline])
+/// scheduler.connect("taskFinished(int)", onTaskFinished)  # scheduler.pythonResult(taskId)
+/// \endcode
+///
+/// Python tasks acquire the GIL to run: they run concurrently with each other
+/// and with the main thread while Python code releases the GIL (numpy, VTK
+/// filters) and while the event loop of the main thread is idle. Python tasks
+/// must not create or modify widgets nor MRML nodes of the scene.
+class Q_HALT_APP_EXPORT qHaltAppTaskScheduler : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(int workerCount READ workerCount)
+  Q_PROPERTY(int activeTaskCount READ activeTaskCount)
+public:
+  typedef QObject Superclass;
+
+  /// Return the application-wide scheduler, owned by the application.
+  static qHaltAppTaskScheduler* instance();
+
+  enum TaskState
+  {
+    Waiting = 0, ///< waiting for its dependencies
+    Ready,
+    Running,
+    Finished,
+    Failed,
+    Canceled
+  };
+  Q_ENUM(TaskState)
+
+  /// Work of a task, called on a worker thread with the task identifier.
+  /// Throwing an exception fails the task.
+  typedef std::function<QVariant(int taskId)> TaskFunction;
+
+  /// Submit \a function, to be run once the tasks \a dependencies have finished.
+  /// Return the identifier of the task.
+  int submit(const QString& name, TaskFunction function, const QList<int>& dependencies = QList<int>());
+
+  int workerCount()const;
+
+  /// Number of tasks submitted and not completed yet.
+  int activeTaskCount()const;
+
+  /// Names of the tasks submitted and not completed yet.
+  Q_INVOKABLE QStringList activeTaskNames()const;
+
+  /// Mean progress, between 0 and 1, of the tasks submitted and not completed yet.
+  Q_INVOKABLE double progress()const;
+
+  Q_INVOKABLE QString taskName(int taskId)const;
+  Q_INVOKABLE int taskState(int taskId)const;
+
+  /// Result of a finished task (for Python tasks, see pythonResult()).
+  /// Results are available until the completion signal handlers return and
+  /// the tasks depending on the task are completed.
+  Q_INVOKABLE QVariant result(int taskId)const;
+  Q_INVOKABLE QString errorMessage(int taskId)const;
+
+  /// Return true if the cancellation of \a taskId was requested.
+  /// Thread-safe, called by the running tasks.
+  Q_INVOKABLE bool isCanceled(int taskId)const;
+
+public slots:
+#ifdef Slicer_USE_PYTHONQT
+  /// Submit the Python callable \a callable, called with the task identifier.
+  /// Return the identifier of the task.
+  int submit(const QString& name, PyObject* callable, const QList<int>& dependencies = QList<int>());
+
+  /// Value returned by the Python callable of a finished task.
+  PythonQtObjectPtr pythonResult(int taskId)const;
+#endif
+
+  /// Set the progress, between 0 and 1, of a running task. Thread-safe.
+  void setProgress(int taskId, double progress);
+
+  /// Request the cancellation of a task and of the tasks depending on it.
+  void cancel(int taskId);
+  void cancelAll();
+
+  /// Cancel all the tasks, wait for the running ones and stop the workers.
+  /// Called when the application is about to quit.
+  void shutdown();
+
+signals:
+  void taskFinished(int taskId);
+  void taskFailed(int taskId, const QString& errorMessage);
+  void taskCanceled(int taskId);
+  void activeTaskCountChanged(int count);
+
+protected slots:
+  void onTaskCompleted(int taskId);
+  void onEventLoopAboutToBlock();
+  void onEventLoopAwake();
+
+protected:
+  qHaltAppTaskScheduler(QObject* parent = nullptr);
+  virtual ~qHaltAppTaskScheduler();
+
+  struct Task;
+  typedef QSharedPointer<Task> TaskPointer;
+
+  int addTask(TaskPointer task, const QList<int>& dependencies);
+  void startWorkers();
+  void work(int workerIndex);
+  TaskPointer takeReadyTask(int workerIndex);
+  void pushReadyTask(TaskPointer task, int workerIndex);
+  void runTask(TaskPointer task, int workerIndex);
+
+  /// Set the final state of \a task and schedule or cancel its dependents.
+  /// Must be called with TasksMutex locked.
+  void completeTask(TaskPointer task, TaskState state, int workerIndex);
+
+  /// Remove \a task once reported and not needed by its dependents anymore,
+  /// and add it to \a releasedTasks. Must be called with TasksMutex locked.
+  void releaseTask(TaskPointer task, QList<TaskPointer>& releasedTasks);
+
+  TaskPointer task(int taskId)const;
+
+  struct WorkerQueue
+  {
+    std::mutex Mutex;
+    std::deque<TaskPointer> Tasks;
+  };
+
+  mutable std::mutex TasksMutex;
+  QHash<int, TaskPointer> Tasks;
+  /// Final state of the released tasks
+  QHash<int, int> CompletedTaskStates;
+  int NextTaskId;
+  int ActiveTaskCount;
+  std::atomic<int> PythonTaskCount;
+
+  std::vector<std::thread> Workers;
+  std::vector<std::unique_ptr<WorkerQueue> > WorkerQueues;
+  std::atomic<int> NextWorkerQueue;
+  std::mutex SleepMutex;
+  std::condition_variable SleepCondition;
+  int ReadyTaskCount;
+  bool StopRequested;
+
+  /// Thread state of the main thread while it released the GIL
+  void* MainThreadState;
+
+private:
+  Q_DISABLE_COPY(qHaltAppTaskScheduler);
+};
+
+#endif
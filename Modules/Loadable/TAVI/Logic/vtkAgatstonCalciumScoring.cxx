@@ -0,0 +1,532 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkAgatstonCalciumScoring.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkAgatstonCalciumScoring);
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+struct SliceScores
+{
+  std::vector<double> Agatston;
+  std::vector<double> Volume;
+  std::vector<double> Mass;
+  int NumberOfLesions = 0;
+};
+
+//----------------------------------------------------------------------------
+/// Position of the voxels of an image row relative to the region of interest,
+/// as polynomials of the column index.
+struct RowGeometry
+{
+  float Axial0;
+  float Axial1;
+  float Distance0; // squared distance to the center
+  float Distance1;
+  float Distance2;
+};
+
+//----------------------------------------------------------------------------
+/// Set mask[i] to 1 if row[i] is above \a threshold and inside the region of
+/// interest, 0 otherwise. The loop has no branch nor dependency between
+/// iterations so that the compiler vectorizes it.
+template <class T>
+void ThresholdRow(const T* row, int count, float threshold, const RowGeometry& geometry,
+  float axialMinimum, float axialMaximum, float radius2, unsigned char* mask)
+{
+  for (int i = 0; i < count; ++i)
+    {
+    const float x = static_cast<float>(i);
+    const float axial = geometry.Axial0 + x * geometry.Axial1;
+    const float distance2 = geometry.Distance0 + x * (geometry.Distance1 + x * geometry.Distance2);
+    const float radial2 = distance2 - axial * axial;
+    mask[i] = static_cast<unsigned char>((static_cast<float>(row[i]) >= threshold)
+      & (axial >= axialMinimum) & (axial <= axialMaximum) & (radial2 <= radius2));
+    }
+}
+
+//----------------------------------------------------------------------------
+int DensityWeight(double peak)
+{
+  return peak < 200.0 ? 1 : (peak < 300.0 ? 2 : (peak < 400.0 ? 3 : 4));
+}
+
+//----------------------------------------------------------------------------
+/// Region of interest and scoring parameters, independent of the scalar type.
+struct ScoringGeometry
+{
+  vtkIdType Increments[3];
+  int Begin[3]; // first voxel of the region bounding box
+  int End[3]; // last voxel of the region bounding box + 1
+  double IJKToRAS[3][4];
+  double Center[3];
+  double Axis[3];
+  double U[3];
+  double V[3];
+  float AxialMinimum;
+  float AxialMaximum;
+  float Radius2;
+  float Threshold;
+  double PixelArea;
+  double VoxelVolume;
+  double SliceThicknessFactor;
+  double MinimumLesionArea;
+  double MassCalibrationFactor;
+  std::vector<double> SectorAzimuths;
+};
+
+//----------------------------------------------------------------------------
+template <class T>
+class ScoreSlicesFunctor
+{
+public:
+  ScoreSlicesFunctor(const T* scalars, const ScoringGeometry& geometry,
+    std::vector<SliceScores>& results)
+    : Scalars(scalars)
+    , Geometry(geometry)
+    , Results(results)
+    {
+    }
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+    {
+    const ScoringGeometry& geometry = this->Geometry;
+    std::vector<unsigned char> mask(static_cast<size_t>(geometry.End[0] - geometry.Begin[0])
+      * (geometry.End[1] - geometry.Begin[1]));
+    std::vector<int> stack;
+    for (vtkIdType k = begin; k < end; ++k)
+      {
+      this->ScoreSlice(static_cast<int>(k), mask, stack, this->Results[k - geometry.Begin[2]]);
+      }
+    }
+
+  void ComputeRowGeometry(int j, int k, RowGeometry& rowGeometry) const
+    {
+    const ScoringGeometry& geometry = this->Geometry;
+    double relative[3];
+    double step[3];
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      const double* m = geometry.IJKToRAS[axis];
+      relative[axis] = m[0] * geometry.Begin[0] + m[1] * j + m[2] * k + m[3] - geometry.Center[axis];
+      step[axis] = m[0];
+      }
+    rowGeometry.Axial0 = static_cast<float>(vtkMath::Dot(relative, geometry.Axis));
+    rowGeometry.Axial1 = static_cast<float>(vtkMath::Dot(step, geometry.Axis));
+    rowGeometry.Distance0 = static_cast<float>(vtkMath::Dot(relative, relative));
+    rowGeometry.Distance1 = static_cast<float>(2.0 * vtkMath::Dot(relative, step));
+    rowGeometry.Distance2 = static_cast<float>(vtkMath::Dot(step, step));
+    }
+
+  int Sector(double i, double j, double k) const
+    {
+    const ScoringGeometry& geometry = this->Geometry;
+    if (geometry.SectorAzimuths.size() < 2)
+      {
+      return 0;
+      }
+    double relative[3];
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      const double* m = geometry.IJKToRAS[axis];
+      relative[axis] = m[0] * i + m[1] * j + m[2] * k + m[3] - geometry.Center[axis];
+      }
+    double azimuth = atan2(vtkMath::Dot(relative, geometry.V), vtkMath::Dot(relative, geometry.U));
+    int sector = 0;
+    double closestDistance = VTK_DOUBLE_MAX;
+    for (size_t index = 0; index < geometry.SectorAzimuths.size(); ++index)
+      {
+      double distance = std::fabs(std::remainder(azimuth - geometry.SectorAzimuths[index], 2.0 * vtkMath::Pi()));
+      if (distance < closestDistance)
+        {
+        closestDistance = distance;
+        sector = static_cast<int>(index);
+        }
+      }
+    return sector;
+    }
+
+  void ScoreSlice(int k, std::vector<unsigned char>& mask, std::vector<int>& stack,
+    SliceScores& scores) const
+    {
+    const ScoringGeometry& geometry = this->Geometry;
+    const int numberOfSectors = std::max<int>(1, static_cast<int>(geometry.SectorAzimuths.size()));
+    scores.Agatston.assign(numberOfSectors, 0.0);
+    scores.Volume.assign(numberOfSectors, 0.0);
+    scores.Mass.assign(numberOfSectors, 0.0);
+    scores.NumberOfLesions = 0;
+
+    // Threshold
+    const int width = geometry.End[0] - geometry.Begin[0];
+    const int height = geometry.End[1] - geometry.Begin[1];
+    const T* slice = this->Scalars + geometry.Begin[0] * geometry.Increments[0]
+      + geometry.Begin[1] * geometry.Increments[1] + k * geometry.Increments[2];
+    for (int row = 0; row < height; ++row)
+      {
+      RowGeometry rowGeometry;
+      this->ComputeRowGeometry(geometry.Begin[1] + row, k, rowGeometry);
+      ThresholdRow(slice + row * geometry.Increments[1], width, geometry.Threshold, rowGeometry,
+        geometry.AxialMinimum, geometry.AxialMaximum, geometry.Radius2, &mask[static_cast<size_t>(row) * width]);
+      }
+
+    // Label 8-connected lesions, visited voxels are cleared from the mask
+    for (int seed = 0; seed < width * height; ++seed)
+      {
+      if (!mask[seed])
+        {
+        continue;
+        }
+      int count = 0;
+      double peak = VTK_DOUBLE_MIN;
+      double sum = 0.0;
+      double sumI = 0.0;
+      double sumJ = 0.0;
+      mask[seed] = 0;
+      stack.assign(1, seed);
+      while (!stack.empty())
+        {
+        const int index = stack.back();
+        stack.pop_back();
+        const int column = index % width;
+        const int row = index / width;
+        const double value = static_cast<double>(slice[column * geometry.Increments[0] + row * geometry.Increments[1]]);
+        ++count;
+        peak = std::max(peak, value);
+        sum += value;
+        sumI += column;
+        sumJ += row;
+        for (int neighborRow = std::max(0, row - 1); neighborRow <= std::min(height - 1, row + 1); ++neighborRow)
+          {
+          for (int neighborColumn = std::max(0, column - 1); neighborColumn <= std::min(width - 1, column + 1); ++neighborColumn)
+            {
+            const int neighbor = neighborRow * width + neighborColumn;
+            if (mask[neighbor])
+              {
+              mask[neighbor] = 0;
+              stack.push_back(neighbor);
+              }
+            }
+          }
+        }
+
+      const double area = count * geometry.PixelArea;
+      if (area < geometry.MinimumLesionArea)
+        {
+        continue;
+        }
+      const int sector = this->Sector(geometry.Begin[0] + sumI / count, geometry.Begin[1] + sumJ / count, k);
+      const double volume = count * geometry.VoxelVolume;
+      scores.Agatston[sector] += area * DensityWeight(peak) * geometry.SliceThicknessFactor;
+      scores.Volume[sector] += volume;
+      // Volume in cm3 times mean density
+      scores.Mass[sector] += geometry.MassCalibrationFactor * volume / 1000.0 * sum / count;
+      ++scores.NumberOfLesions;
+      }
+    }
+
+private:
+  const T* Scalars;
+  const ScoringGeometry& Geometry;
+  std::vector<SliceScores>& Results;
+};
+
+//----------------------------------------------------------------------------
+template <class T>
+void ScoreSlices(vtkImageData* image, const ScoringGeometry& geometry,
+  std::vector<SliceScores>& results)
+{
+  ScoreSlicesFunctor<T> functor(static_cast<const T*>(image->GetScalarPointer()), geometry, results);
+  vtkSMPTools::For(geometry.Begin[2], geometry.End[2], functor);
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkAgatstonCalciumScoring::vtkAgatstonCalciumScoring()
+  : InputImage(nullptr)
+  , RASToIJKMatrix(nullptr)
+  , Radius(20.0)
+  , AxialMinimum(-10.0)
+  , AxialMaximum(10.0)
+  , Threshold(130.0)
+  , MinimumLesionArea(1.0)
+  , ReferenceSliceThickness(3.0)
+  , MassCalibrationFactor(0.8)
+  , AgatstonScore(0.0)
+  , VolumeScore(0.0)
+  , MassScore(0.0)
+  , NumberOfLesions(0)
+{
+  this->Center[0] = this->Center[1] = this->Center[2] = 0.0;
+  this->Axis[0] = this->Axis[1] = 0.0;
+  this->Axis[2] = 1.0;
+  this->SectorPoints = vtkSmartPointer<vtkPoints>::New();
+}
+
+//----------------------------------------------------------------------------
+vtkAgatstonCalciumScoring::~vtkAgatstonCalciumScoring()
+{
+  this->SetInputImage(nullptr);
+  this->SetRASToIJKMatrix(nullptr);
+}
+
+//----------------------------------------------------------------------------
+vtkCxxSetObjectMacro(vtkAgatstonCalciumScoring, InputImage, vtkImageData);
+vtkCxxSetObjectMacro(vtkAgatstonCalciumScoring, RASToIJKMatrix, vtkMatrix4x4);
+
+//----------------------------------------------------------------------------
+void vtkAgatstonCalciumScoring::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Center: " << this->Center[0] << " " << this->Center[1] << " " << this->Center[2] << "\n";
+  os << indent << "Axis: " << this->Axis[0] << " " << this->Axis[1] << " " << this->Axis[2] << "\n";
+  os << indent << "Radius: " << this->Radius << "\n";
+  os << indent << "AxialMinimum: " << this->AxialMinimum << "\n";
+  os << indent << "AxialMaximum: " << this->AxialMaximum << "\n";
+  os << indent << "NumberOfSectorPoints: " << this->SectorPoints->GetNumberOfPoints() << "\n";
+  os << indent << "Threshold: " << this->Threshold << "\n";
+  os << indent << "MinimumLesionArea: " << this->MinimumLesionArea << "\n";
+  os << indent << "ReferenceSliceThickness: " << this->ReferenceSliceThickness << "\n";
+  os << indent << "MassCalibrationFactor: " << this->MassCalibrationFactor << "\n";
+  os << indent << "AgatstonScore: " << this->AgatstonScore << "\n";
+  os << indent << "VolumeScore: " << this->VolumeScore << "\n";
+  os << indent << "MassScore: " << this->MassScore << "\n";
+  os << indent << "NumberOfLesions: " << this->NumberOfLesions << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkAgatstonCalciumScoring::SetSectorPoints(vtkPoints* points)
+{
+  this->SectorPoints->Reset();
+  if (points)
+    {
+    this->SectorPoints->DeepCopy(points);
+    }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkPoints* vtkAgatstonCalciumScoring::GetSectorPoints()
+{
+  return this->SectorPoints;
+}
+
+//----------------------------------------------------------------------------
+int vtkAgatstonCalciumScoring::GetNumberOfSectors()
+{
+  return static_cast<int>(this->SectorAgatstonScores.size());
+}
+
+//----------------------------------------------------------------------------
+double vtkAgatstonCalciumScoring::GetSectorAgatstonScore(int sector)
+{
+  if (sector < 0 || sector >= this->GetNumberOfSectors())
+    {
+    vtkErrorMacro("GetSectorAgatstonScore: Invalid sector " << sector);
+    return 0.0;
+    }
+  return this->SectorAgatstonScores[sector];
+}
+
+//----------------------------------------------------------------------------
+double vtkAgatstonCalciumScoring::GetSectorVolumeScore(int sector)
+{
+  if (sector < 0 || sector >= this->GetNumberOfSectors())
+    {
+    vtkErrorMacro("GetSectorVolumeScore: Invalid sector " << sector);
+    return 0.0;
+    }
+  return this->SectorVolumeScores[sector];
+}
+
+//----------------------------------------------------------------------------
+double vtkAgatstonCalciumScoring::GetSectorMassScore(int sector)
+{
+  if (sector < 0 || sector >= this->GetNumberOfSectors())
+    {
+    vtkErrorMacro("GetSectorMassScore: Invalid sector " << sector);
+    return 0.0;
+    }
+  return this->SectorMassScores[sector];
+}
+
+//----------------------------------------------------------------------------
+bool vtkAgatstonCalciumScoring::Update()
+{
+  this->AgatstonScore = 0.0;
+  this->VolumeScore = 0.0;
+  this->MassScore = 0.0;
+  this->NumberOfLesions = 0;
+  this->SectorAgatstonScores.clear();
+  this->SectorVolumeScores.clear();
+  this->SectorMassScores.clear();
+  if (!this->InputImage || !this->InputImage->GetPointData() ||
+      !this->InputImage->GetPointData()->GetScalars() || !this->RASToIJKMatrix)
+    {
+    vtkErrorMacro("Update: Invalid input image");
+    return false;
+    }
+  if (this->InputImage->GetNumberOfScalarComponents() != 1)
+    {
+    vtkErrorMacro("Update: Input image must have a single component");
+    return false;
+    }
+  double axis[3] = { this->Axis[0], this->Axis[1], this->Axis[2] };
+  if (vtkMath::Normalize(axis) == 0.0 || this->Radius <= 0.0 || this->AxialMaximum < this->AxialMinimum)
+    {
+    vtkErrorMacro("Update: Invalid region of interest");
+    return false;
+    }
+
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  vtkMatrix4x4::Invert(this->RASToIJKMatrix, ijkToRAS);
+
+  // Geometry shared by all slices
+  ScoringGeometry geometry;
+  for (int row = 0; row < 3; ++row)
+    {
+    for (int column = 0; column < 4; ++column)
+      {
+      geometry.IJKToRAS[row][column] = ijkToRAS->GetElement(row, column);
+      }
+    geometry.Center[row] = this->Center[row];
+    geometry.Axis[row] = axis[row];
+    }
+  vtkMath::Perpendiculars(axis, geometry.U, geometry.V, 0.0);
+  geometry.AxialMinimum = static_cast<float>(this->AxialMinimum);
+  geometry.AxialMaximum = static_cast<float>(this->AxialMaximum);
+  geometry.Radius2 = static_cast<float>(this->Radius * this->Radius);
+  geometry.Threshold = static_cast<float>(this->Threshold);
+  geometry.MinimumLesionArea = this->MinimumLesionArea;
+  geometry.MassCalibrationFactor = this->MassCalibrationFactor;
+
+  double columnStep[3], rowStep[3], sliceStep[3], sliceNormal[3];
+  for (int axisIndex = 0; axisIndex < 3; ++axisIndex)
+    {
+    columnStep[axisIndex] = geometry.IJKToRAS[axisIndex][0];
+    rowStep[axisIndex] = geometry.IJKToRAS[axisIndex][1];
+    sliceStep[axisIndex] = geometry.IJKToRAS[axisIndex][2];
+    }
+  vtkMath::Cross(columnStep, rowStep, sliceNormal);
+  geometry.PixelArea = vtkMath::Norm(sliceNormal);
+  geometry.VoxelVolume = std::fabs(vtkMath::Dot(sliceNormal, sliceStep));
+  if (geometry.PixelArea <= 0.0 || geometry.VoxelVolume <= 0.0)
+    {
+    vtkErrorMacro("Update: Invalid RASToIJK matrix");
+    return false;
+    }
+  const double sliceThickness = geometry.VoxelVolume / geometry.PixelArea;
+  geometry.SliceThicknessFactor = this->ReferenceSliceThickness > 0.0
+    ? sliceThickness / this->ReferenceSliceThickness : 1.0;
+
+  for (vtkIdType pointIndex = 0; pointIndex < this->SectorPoints->GetNumberOfPoints(); ++pointIndex)
+    {
+    double relative[3];
+    vtkMath::Subtract(this->SectorPoints->GetPoint(pointIndex), this->Center, relative);
+    geometry.SectorAzimuths.push_back(atan2(vtkMath::Dot(relative, geometry.V), vtkMath::Dot(relative, geometry.U)));
+    }
+
+  // Bounding box of the region of interest in IJK
+  int dimensions[3];
+  this->InputImage->GetDimensions(dimensions);
+  double ijkMinimum[3] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX };
+  double ijkMaximum[3] = { VTK_DOUBLE_MIN, VTK_DOUBLE_MIN, VTK_DOUBLE_MIN };
+  for (int corner = 0; corner < 8; ++corner)
+    {
+    double axial = (corner & 1) ? this->AxialMaximum : this->AxialMinimum;
+    double u = (corner & 2) ? this->Radius : -this->Radius;
+    double v = (corner & 4) ? this->Radius : -this->Radius;
+    double ras[4] = { 0.0, 0.0, 0.0, 1.0 };
+    for (int axisIndex = 0; axisIndex < 3; ++axisIndex)
+      {
+      ras[axisIndex] = this->Center[axisIndex] + axial * axis[axisIndex]
+        + u * geometry.U[axisIndex] + v * geometry.V[axisIndex];
+      }
+    double ijk[4];
+    this->RASToIJKMatrix->MultiplyPoint(ras, ijk);
+    for (int axisIndex = 0; axisIndex < 3; ++axisIndex)
+      {
+      ijkMinimum[axisIndex] = std::min(ijkMinimum[axisIndex], ijk[axisIndex]);
+      ijkMaximum[axisIndex] = std::max(ijkMaximum[axisIndex], ijk[axisIndex]);
+      }
+    }
+  bool empty = false;
+  for (int axisIndex = 0; axisIndex < 3; ++axisIndex)
+    {
+    geometry.Begin[axisIndex] = std::max(0, static_cast<int>(std::floor(ijkMinimum[axisIndex])));
+    geometry.End[axisIndex] = std::min(dimensions[axisIndex], static_cast<int>(std::ceil(ijkMaximum[axisIndex])) + 1);
+    empty = empty || geometry.End[axisIndex] <= geometry.Begin[axisIndex];
+    }
+  int numberOfSectors = std::max<int>(1, static_cast<int>(geometry.SectorAzimuths.size()));
+  this->SectorAgatstonScores.assign(numberOfSectors, 0.0);
+  this->SectorVolumeScores.assign(numberOfSectors, 0.0);
+  this->SectorMassScores.assign(numberOfSectors, 0.0);
+  if (empty)
+    {
+    // Region of interest outside of the image
+    this->Modified();
+    return true;
+    }
+  this->InputImage->GetIncrements(geometry.Increments);
+
+  // Score slices in parallel, each slice has its own result
+  std::vector<SliceScores> sliceScores(geometry.End[2] - geometry.Begin[2]);
+  switch (this->InputImage->GetScalarType())
+    {
+    vtkTemplateMacro(ScoreSlices<VTK_TT>(this->InputImage, geometry, sliceScores));
+    default:
+      vtkErrorMacro("Update: Unsupported scalar type " << this->InputImage->GetScalarTypeAsString());
+      return false;
+    }
+
+  // Sum slices in order so that the result does not depend on the number of threads
+  for (const SliceScores& scores : sliceScores)
+    {
+    for (int sector = 0; sector < numberOfSectors; ++sector)
+      {
+      this->SectorAgatstonScores[sector] += scores.Agatston[sector];
+      this->SectorVolumeScores[sector] += scores.Volume[sector];
+      this->SectorMassScores[sector] += scores.Mass[sector];
+      }
+    this->NumberOfLesions += scores.NumberOfLesions;
+    }
+  for (int sector = 0; sector < numberOfSectors; ++sector)
+    {
+    this->AgatstonScore += this->SectorAgatstonScores[sector];
+    this->VolumeScore += this->SectorVolumeScores[sector];
+    this->MassScore += this->SectorMassScores[sector];
+    }
+  this->Modified();
+  return true;
+}
@@ -0,0 +1,151 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkAgatstonCalciumScoring_h
+#define __vtkAgatstonCalciumScoring_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkImageData;
+class vtkMatrix4x4;
+class vtkPoints;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Agatston, volume and mass calcium scores in a cylindrical region
+/// around the aortic valve.
+///
+/// The region of interest is a cylinder of axis (Center, Axis) and radius
+/// Radius, between AxialMinimum and AxialMaximum along the axis, typically
+/// centered on the annulus to include the valve and the left ventricular
+/// outflow tract.
+///
+/// Image slices (k index) are processed in parallel using vtkSMPTools. On each
+/// slice, the voxels inside the region and above Threshold are found in a
+/// single branch-free pass per row, then labeled into 8-connected lesions.
+/// Lesions smaller than MinimumLesionArea are ignored. Following Agatston,
+/// the area of each lesion is weighted by its peak density (1 for 130-199 HU,
+/// 2 for 200-299 HU, 3 for 300-399 HU and 4 above) and scaled by the ratio
+/// between the slice thickness and ReferenceSliceThickness.
+///
+/// If sector points are set (typically the hinge points of the cusps), each
+/// lesion is assigned to the sector of the closest point, by azimuth around
+/// the axis, and scores are also reported per sector.
+///
+/// The image is expected to be in Hounsfield units, with a single component
+/// and an extent starting at 0.
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkAgatstonCalciumScoring : public vtkObject
+{
+public:
+  static vtkAgatstonCalciumScoring* New();
+  vtkTypeMacro(vtkAgatstonCalciumScoring, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Image to score, in Hounsfield units.
+  void SetInputImage(vtkImageData* image);
+  vtkGetObjectMacro(InputImage, vtkImageData);
+
+  /// Transform from RAS to the IJK coordinates of the input image.
+  void SetRASToIJKMatrix(vtkMatrix4x4* matrix);
+  vtkGetObjectMacro(RASToIJKMatrix, vtkMatrix4x4);
+
+  /// Center and axis of the cylindrical region of interest, in RAS.
+  vtkSetVector3Macro(Center, double);
+  vtkGetVector3Macro(Center, double);
+  vtkSetVector3Macro(Axis, double);
+  vtkGetVector3Macro(Axis, double);
+  /// Radius of the region of interest, in mm.
+  vtkSetMacro(Radius, double);
+  vtkGetMacro(Radius, double);
+  /// Extent of the region of interest along the axis, relative to the center, in mm.
+  vtkSetMacro(AxialMinimum, double);
+  vtkGetMacro(AxialMinimum, double);
+  vtkSetMacro(AxialMaximum, double);
+  vtkGetMacro(AxialMaximum, double);
+
+  /// Points defining the sectors, in RAS. Optional.
+  void SetSectorPoints(vtkPoints* points);
+  vtkPoints* GetSectorPoints();
+
+  /// Calcium threshold, in HU.
+  vtkSetMacro(Threshold, double);
+  vtkGetMacro(Threshold, double);
+  /// Minimum area of a lesion on a slice, in mm2.
+  vtkSetMacro(MinimumLesionArea, double);
+  vtkGetMacro(MinimumLesionArea, double);
+  /// Slice thickness of the original Agatston protocol, in mm.
+  vtkSetMacro(ReferenceSliceThickness, double);
+  vtkGetMacro(ReferenceSliceThickness, double);
+  /// Calcium mass per volume and per HU, in mg/(cm3.HU).
+  /// It depends on the scanner and should be measured on a calibration phantom.
+  vtkSetMacro(MassCalibrationFactor, double);
+  vtkGetMacro(MassCalibrationFactor, double);
+
+  /// Compute the scores. Return false if the inputs are invalid.
+  bool Update();
+
+  /// Scores of the whole region, valid after a successful Update().
+  vtkGetMacro(AgatstonScore, double);
+  /// Calcium volume, in mm3.
+  vtkGetMacro(VolumeScore, double);
+  /// Calcium mass, in mg.
+  vtkGetMacro(MassScore, double);
+  /// Number of lesions, counted on each slice.
+  vtkGetMacro(NumberOfLesions, int);
+
+  /// Number of sectors scored by the last successful Update(), 1 if there
+  /// are no sector points. 0 before Update() or if it failed.
+  int GetNumberOfSectors();
+  double GetSectorAgatstonScore(int sector);
+  double GetSectorVolumeScore(int sector);
+  double GetSectorMassScore(int sector);
+
+protected:
+  vtkAgatstonCalciumScoring();
+  ~vtkAgatstonCalciumScoring() override;
+
+  vtkImageData* InputImage;
+  vtkMatrix4x4* RASToIJKMatrix;
+  vtkSmartPointer<vtkPoints> SectorPoints;
+
+  double Center[3];
+  double Axis[3];
+  double Radius;
+  double AxialMinimum;
+  double AxialMaximum;
+  double Threshold;
+  double MinimumLesionArea;
+  double ReferenceSliceThickness;
+  double MassCalibrationFactor;
+
+  double AgatstonScore;
+  double VolumeScore;
+  double MassScore;
+  int NumberOfLesions;
+  std::vector<double> SectorAgatstonScores;
+  std::vector<double> SectorVolumeScores;
+  std::vector<double> SectorMassScores;
+
+private:
+  vtkAgatstonCalciumScoring(const vtkAgatstonCalciumScoring&) = delete;
+  void operator=(const vtkAgatstonCalciumScoring&) = delete;
+};
+
+#endif
@@ -0,0 +1,585 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkAorticAnnulusMeasurement.h"
+
+// VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
+#include <vtkTable.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkAorticAnnulusMeasurement);
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+struct CandidatePlane
+{
+  double Center[3];
+  double Normal[3];
+  double U[3];
+  double V[3];
+  double Tilt; // degrees
+  double Azimuth; // degrees
+  double Offset; // mm
+};
+
+//----------------------------------------------------------------------------
+struct CandidateResult
+{
+  bool Valid = false;
+  double ValidRayFraction = 0.0;
+  double Area = 0.0;
+  double Perimeter = 0.0;
+  double MinimumDiameter = 0.0;
+  double MaximumDiameter = 0.0;
+  double EllipseMajorDiameter = 0.0;
+  double EllipseMinorDiameter = 0.0;
+  double EllipseAngle = 0.0; // major axis angle in the (U, V) basis, radians
+  double Centroid[2] = { 0.0, 0.0 }; // in the (U, V) basis
+  std::vector<double> Radii;
+};
+
+//----------------------------------------------------------------------------
+/// Trilinear interpolation of the first component of an image given in RAS.
+template <class T>
+class ImageSampler
+{
+public:
+  ImageSampler(vtkImageData* image, vtkMatrix4x4* rasToIJK)
+    {
+    this->Scalars = static_cast<const T*>(image->GetScalarPointer());
+    image->GetDimensions(this->Dimensions);
+    vtkIdType increments[3];
+    image->GetIncrements(increments);
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      this->Increments[axis] = increments[axis];
+      for (int column = 0; column < 4; ++column)
+        {
+        this->RASToIJK[axis][column] = rasToIJK->GetElement(axis, column);
+        }
+      }
+    }
+
+  /// Return false if \a ras is outside of the image.
+  bool Sample(const double ras[3], double& value) const
+    {
+    double ijk[3];
+    int index0[3];
+    int index1[3];
+    double weight[3];
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      const double* m = this->RASToIJK[axis];
+      ijk[axis] = m[0] * ras[0] + m[1] * ras[1] + m[2] * ras[2] + m[3];
+      if (ijk[axis] < 0.0 || ijk[axis] > this->Dimensions[axis] - 1)
+        {
+        return false;
+        }
+      index0[axis] = std::min(static_cast<int>(ijk[axis]), this->Dimensions[axis] - 1);
+      index1[axis] = std::min(index0[axis] + 1, this->Dimensions[axis] - 1);
+      weight[axis] = ijk[axis] - index0[axis];
+      }
+    double corners[2][2][2];
+    for (int k = 0; k < 2; ++k)
+      {
+      for (int j = 0; j < 2; ++j)
+        {
+        for (int i = 0; i < 2; ++i)
+          {
+          vtkIdType offset = (i ? index1[0] : index0[0]) * this->Increments[0]
+            + (j ? index1[1] : index0[1]) * this->Increments[1]
+            + (k ? index1[2] : index0[2]) * this->Increments[2];
+          corners[k][j][i] = static_cast<double>(this->Scalars[offset]);
+          }
+        }
+      }
+    double c00 = corners[0][0][0] + weight[0] * (corners[0][0][1] - corners[0][0][0]);
+    double c01 = corners[0][1][0] + weight[0] * (corners[0][1][1] - corners[0][1][0]);
+    double c10 = corners[1][0][0] + weight[0] * (corners[1][0][1] - corners[1][0][0]);
+    double c11 = corners[1][1][0] + weight[0] * (corners[1][1][1] - corners[1][1][0]);
+    double c0 = c00 + weight[1] * (c01 - c00);
+    double c1 = c10 + weight[1] * (c11 - c10);
+    value = c0 + weight[2] * (c1 - c0);
+    return true;
+    }
+
+private:
+  const T* Scalars;
+  int Dimensions[3];
+  vtkIdType Increments[3];
+  double RASToIJK[3][4];
+};
+
+//----------------------------------------------------------------------------
+/// Compute the contour measurements from the radii found along each ray.
+/// Radii of invalid rays (NaN) are interpolated from their valid neighbors,
+/// at least one ray must be valid.
+void MeasureContour(CandidateResult& result)
+{
+  const std::vector<double> measuredRadii = result.Radii;
+  std::vector<double>& radii = result.Radii;
+  const int numberOfRays = static_cast<int>(radii.size());
+  for (int ray = 0; ray < numberOfRays; ++ray)
+    {
+    if (!std::isnan(measuredRadii[ray]))
+      {
+      continue;
+      }
+    int previous = ray;
+    int next = ray;
+    int previousDistance = 0;
+    int nextDistance = 0;
+    do
+      {
+      previous = (previous + numberOfRays - 1) % numberOfRays;
+      ++previousDistance;
+      } while (std::isnan(measuredRadii[previous]));
+    do
+      {
+      next = (next + 1) % numberOfRays;
+      ++nextDistance;
+      } while (std::isnan(measuredRadii[next]));
+    double t = static_cast<double>(previousDistance) / (previousDistance + nextDistance);
+    radii[ray] = measuredRadii[previous] + t * (measuredRadii[next] - measuredRadii[previous]);
+    }
+
+  // Polygon area, perimeter and second moments of area (Green's theorem)
+  double area = 0.0;
+  double perimeter = 0.0;
+  double cx = 0.0, cy = 0.0;
+  double ixx = 0.0, iyy = 0.0, ixy = 0.0;
+  const double angleStep = 2.0 * vtkMath::Pi() / numberOfRays;
+  for (int ray = 0; ray < numberOfRays; ++ray)
+    {
+    int nextRay = (ray + 1) % numberOfRays;
+    double x0 = radii[ray] * cos(ray * angleStep);
+    double y0 = radii[ray] * sin(ray * angleStep);
+    double x1 = radii[nextRay] * cos(nextRay * angleStep);
+    double y1 = radii[nextRay] * sin(nextRay * angleStep);
+    double cross = x0 * y1 - x1 * y0;
+    area += cross;
+    perimeter += sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+    cx += (x0 + x1) * cross;
+    cy += (y0 + y1) * cross;
+    ixx += (x0 * x0 + x0 * x1 + x1 * x1) * cross;
+    iyy += (y0 * y0 + y0 * y1 + y1 * y1) * cross;
+    ixy += (x0 * y1 + 2.0 * x0 * y0 + 2.0 * x1 * y1 + x1 * y0) * cross;
+    }
+  area *= 0.5;
+  if (area <= 0.0)
+    {
+    result.Valid = false;
+    return;
+    }
+  cx /= 6.0 * area;
+  cy /= 6.0 * area;
+  double sxx = ixx / (12.0 * area) - cx * cx;
+  double syy = iyy / (12.0 * area) - cy * cy;
+  double sxy = ixy / (24.0 * area) - cx * cy;
+
+  // For an ellipse of semi-axis a, the variance along that axis is a^2/4
+  double trace = sxx + syy;
+  double delta = sqrt(std::max(0.0, (sxx - syy) * (sxx - syy) / 4.0 + sxy * sxy));
+  double lambda1 = trace / 2.0 + delta;
+  double lambda2 = std::max(0.0, trace / 2.0 - delta);
+
+  result.Area = area;
+  result.Perimeter = perimeter;
+  result.Centroid[0] = cx;
+  result.Centroid[1] = cy;
+  result.EllipseMajorDiameter = 4.0 * sqrt(lambda1);
+  result.EllipseMinorDiameter = 4.0 * sqrt(lambda2);
+  result.EllipseAngle = 0.5 * atan2(2.0 * sxy, sxx - syy);
+
+  // Diameters through the plane center
+  const int halfNumberOfRays = numberOfRays / 2;
+  result.MinimumDiameter = std::numeric_limits<double>::max();
+  result.MaximumDiameter = 0.0;
+  for (int ray = 0; ray < halfNumberOfRays; ++ray)
+    {
+    double diameter = radii[ray] + radii[ray + halfNumberOfRays];
+    result.MinimumDiameter = std::min(result.MinimumDiameter, diameter);
+    result.MaximumDiameter = std::max(result.MaximumDiameter, diameter);
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+class MeasurePlanesFunctor
+{
+public:
+  MeasurePlanesFunctor(const ImageSampler<T>& sampler,
+    const std::vector<CandidatePlane>& planes, std::vector<CandidateResult>& results,
+    int numberOfRays, double maximumRadius, double stepSize, double threshold,
+    double minimumValidRayFraction)
+    : Sampler(sampler)
+    , Planes(planes)
+    , Results(results)
+    , NumberOfRays(numberOfRays)
+    , MaximumRadius(maximumRadius)
+    , StepSize(stepSize)
+    , Threshold(threshold)
+    , MinimumValidRayFraction(minimumValidRayFraction)
+    {
+    }
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+    {
+    for (vtkIdType planeIndex = begin; planeIndex < end; ++planeIndex)
+      {
+      this->MeasurePlane(this->Planes[planeIndex], this->Results[planeIndex]);
+      }
+    }
+
+  void MeasurePlane(const CandidatePlane& plane, CandidateResult& result) const
+    {
+    result.Radii.assign(this->NumberOfRays, std::numeric_limits<double>::quiet_NaN());
+    int numberOfValidRays = 0;
+    const double angleStep = 2.0 * vtkMath::Pi() / this->NumberOfRays;
+    for (int ray = 0; ray < this->NumberOfRays; ++ray)
+      {
+      double c = cos(ray * angleStep);
+      double s = sin(ray * angleStep);
+      double direction[3] = {
+        c * plane.U[0] + s * plane.V[0],
+        c * plane.U[1] + s * plane.V[1],
+        c * plane.U[2] + s * plane.V[2] };
+      double previousRadius = 0.0;
+      double previousValue = 0.0;
+      double position[3];
+      if (!this->Sampler.Sample(plane.Center, previousValue) || previousValue < this->Threshold)
+        {
+        // Plane center is not in the lumen
+        continue;
+        }
+      for (double radius = this->StepSize; radius <= this->MaximumRadius; radius += this->StepSize)
+        {
+        double value = 0.0;
+        position[0] = plane.Center[0] + radius * direction[0];
+        position[1] = plane.Center[1] + radius * direction[1];
+        position[2] = plane.Center[2] + radius * direction[2];
+        if (!this->Sampler.Sample(position, value))
+          {
+          break;
+          }
+        if (value < this->Threshold)
+          {
+          // Sub-sample boundary position
+          double t = (previousValue - this->Threshold) / (previousValue - value);
+          result.Radii[ray] = previousRadius + t * (radius - previousRadius);
+          ++numberOfValidRays;
+          break;
+          }
+        previousRadius = radius;
+        previousValue = value;
+        }
+      }
+    result.ValidRayFraction = static_cast<double>(numberOfValidRays) / this->NumberOfRays;
+    result.Valid = numberOfValidRays > 0
+      && result.ValidRayFraction >= this->MinimumValidRayFraction;
+    if (result.Valid)
+      {
+      MeasureContour(result);
+      }
+    }
+
+private:
+  const ImageSampler<T>& Sampler;
+  const std::vector<CandidatePlane>& Planes;
+  std::vector<CandidateResult>& Results;
+  int NumberOfRays;
+  double MaximumRadius;
+  double StepSize;
+  double Threshold;
+  double MinimumValidRayFraction;
+};
+
+//----------------------------------------------------------------------------
+template <class T>
+void MeasurePlanes(vtkImageData* image, vtkMatrix4x4* rasToIJK,
+  const std::vector<CandidatePlane>& planes, std::vector<CandidateResult>& results,
+  int numberOfRays, double maximumRadius, double stepSize, double threshold,
+  double minimumValidRayFraction)
+{
+  ImageSampler<T> sampler(image, rasToIJK);
+  MeasurePlanesFunctor<T> functor(sampler, planes, results,
+    numberOfRays, maximumRadius, stepSize, threshold, minimumValidRayFraction);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(planes.size()), functor);
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkAorticAnnulusMeasurement::vtkAorticAnnulusMeasurement()
+  : InputImage(nullptr)
+  , RASToIJKMatrix(nullptr)
+  , NumberOfTiltSamples(5)
+  , NumberOfAzimuthSamples(12)
+  , MaximumTiltAngle(20.0)
+  , NumberOfOffsetSamples(5)
+  , MaximumOffset(2.0)
+  , NumberOfRays(180)
+  , MaximumRadius(25.0)
+  , RayStepSize(0.25)
+  , LumenThreshold(200.0)
+  , MinimumValidRayFraction(0.9)
+  , Area(0.0)
+  , Perimeter(0.0)
+  , MinimumDiameter(0.0)
+  , MaximumDiameter(0.0)
+  , EllipseMajorDiameter(0.0)
+  , EllipseMinorDiameter(0.0)
+  , TiltAngle(0.0)
+{
+  this->SeedCenter[0] = this->SeedCenter[1] = this->SeedCenter[2] = 0.0;
+  this->SeedNormal[0] = this->SeedNormal[1] = 0.0;
+  this->SeedNormal[2] = 1.0;
+  this->Center[0] = this->Center[1] = this->Center[2] = 0.0;
+  this->Normal[0] = this->Normal[1] = 0.0;
+  this->Normal[2] = 1.0;
+  this->EllipseMajorAxis[0] = 1.0;
+  this->EllipseMajorAxis[1] = this->EllipseMajorAxis[2] = 0.0;
+  this->Contour = vtkSmartPointer<vtkPoints>::New();
+  this->CandidatesTable = vtkSmartPointer<vtkTable>::New();
+}
+
+//----------------------------------------------------------------------------
+vtkAorticAnnulusMeasurement::~vtkAorticAnnulusMeasurement()
+{
+  this->SetInputImage(nullptr);
+  this->SetRASToIJKMatrix(nullptr);
+}
+
+//----------------------------------------------------------------------------
+vtkCxxSetObjectMacro(vtkAorticAnnulusMeasurement, InputImage, vtkImageData);
+vtkCxxSetObjectMacro(vtkAorticAnnulusMeasurement, RASToIJKMatrix, vtkMatrix4x4);
+
+//----------------------------------------------------------------------------
+void vtkAorticAnnulusMeasurement::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "SeedCenter: " << this->SeedCenter[0] << " " << this->SeedCenter[1] << " " << this->SeedCenter[2] << "\n";
+  os << indent << "SeedNormal: " << this->SeedNormal[0] << " " << this->SeedNormal[1] << " " << this->SeedNormal[2] << "\n";
+  os << indent << "NumberOfTiltSamples: " << this->NumberOfTiltSamples << "\n";
+  os << indent << "NumberOfAzimuthSamples: " << this->NumberOfAzimuthSamples << "\n";
+  os << indent << "MaximumTiltAngle: " << this->MaximumTiltAngle << "\n";
+  os << indent << "NumberOfOffsetSamples: " << this->NumberOfOffsetSamples << "\n";
+  os << indent << "MaximumOffset: " << this->MaximumOffset << "\n";
+  os << indent << "NumberOfRays: " << this->NumberOfRays << "\n";
+  os << indent << "MaximumRadius: " << this->MaximumRadius << "\n";
+  os << indent << "RayStepSize: " << this->RayStepSize << "\n";
+  os << indent << "LumenThreshold: " << this->LumenThreshold << "\n";
+  os << indent << "MinimumValidRayFraction: " << this->MinimumValidRayFraction << "\n";
+  os << indent << "Area: " << this->Area << "\n";
+  os << indent << "Perimeter: " << this->Perimeter << "\n";
+  os << indent << "MinimumDiameter: " << this->MinimumDiameter << "\n";
+  os << indent << "MaximumDiameter: " << this->MaximumDiameter << "\n";
+  os << indent << "TiltAngle: " << this->TiltAngle << "\n";
+}
+
+//----------------------------------------------------------------------------
+double vtkAorticAnnulusMeasurement::GetAreaDerivedDiameter()
+{
+  return 2.0 * sqrt(this->Area / vtkMath::Pi());
+}
+
+//----------------------------------------------------------------------------
+double vtkAorticAnnulusMeasurement::GetPerimeterDerivedDiameter()
+{
+  return this->Perimeter / vtkMath::Pi();
+}
+
+//----------------------------------------------------------------------------
+vtkPoints* vtkAorticAnnulusMeasurement::GetContour()
+{
+  return this->Contour;
+}
+
+//----------------------------------------------------------------------------
+vtkTable* vtkAorticAnnulusMeasurement::GetCandidatesTable()
+{
+  return this->CandidatesTable;
+}
+
+//----------------------------------------------------------------------------
+int vtkAorticAnnulusMeasurement::GetNumberOfCandidates()
+{
+  return static_cast<int>(this->CandidatesTable->GetNumberOfRows());
+}
+
+//----------------------------------------------------------------------------
+bool vtkAorticAnnulusMeasurement::Update()
+{
+  this->Contour->Reset();
+  this->CandidatesTable->Initialize();
+  if (!this->InputImage || !this->InputImage->GetPointData() ||
+      !this->InputImage->GetPointData()->GetScalars() || !this->RASToIJKMatrix)
+    {
+    vtkErrorMacro("Update: Invalid input image");
+    return false;
+    }
+  double seedNormal[3] = { this->SeedNormal[0], this->SeedNormal[1], this->SeedNormal[2] };
+  if (vtkMath::Normalize(seedNormal) == 0.0)
+    {
+    vtkErrorMacro("Update: Invalid seed normal");
+    return false;
+    }
+  if (this->RayStepSize <= 0.0 || this->MaximumRadius <= this->RayStepSize)
+    {
+    vtkErrorMacro("Update: Invalid ray step size or maximum radius");
+    return false;
+    }
+
+  // Generate candidate planes
+  double seedU[3];
+  double seedV[3];
+  vtkMath::Perpendiculars(seedNormal, seedU, seedV, 0.0);
+  std::vector<CandidatePlane> planes;
+  for (int offsetIndex = 0; offsetIndex < this->NumberOfOffsetSamples; ++offsetIndex)
+    {
+    double offset = 0.0;
+    if (this->NumberOfOffsetSamples > 1)
+      {
+      offset = -this->MaximumOffset
+        + 2.0 * this->MaximumOffset * offsetIndex / (this->NumberOfOffsetSamples - 1);
+      }
+    for (int tiltIndex = 0; tiltIndex <= this->NumberOfTiltSamples; ++tiltIndex)
+      {
+      double tilt = this->NumberOfTiltSamples > 0
+        ? this->MaximumTiltAngle * tiltIndex / this->NumberOfTiltSamples : 0.0;
+      // A single azimuth is needed for the untilted plane
+      int numberOfAzimuths = (tiltIndex == 0) ? 1 : this->NumberOfAzimuthSamples;
+      for (int azimuthIndex = 0; azimuthIndex < numberOfAzimuths; ++azimuthIndex)
+        {
+        CandidatePlane plane;
+        plane.Tilt = tilt;
+        plane.Azimuth = 360.0 * azimuthIndex / this->NumberOfAzimuthSamples;
+        plane.Offset = offset;
+        double tiltRadians = vtkMath::RadiansFromDegrees(tilt);
+        double azimuthRadians = vtkMath::RadiansFromDegrees(plane.Azimuth);
+        for (int i = 0; i < 3; ++i)
+          {
+          plane.Normal[i] = cos(tiltRadians) * seedNormal[i] + sin(tiltRadians)
+            * (cos(azimuthRadians) * seedU[i] + sin(azimuthRadians) * seedV[i]);
+          plane.Center[i] = this->SeedCenter[i] + offset * seedNormal[i];
+          }
+        vtkMath::Normalize(plane.Normal);
+        vtkMath::Perpendiculars(plane.Normal, plane.U, plane.V, 0.0);
+        planes.push_back(plane);
+        }
+      }
+    }
+
+  // Measure candidate planes in parallel
+  int numberOfRays = this->NumberOfRays + (this->NumberOfRays % 2);
+  std::vector<CandidateResult> results(planes.size());
+  switch (this->InputImage->GetScalarType())
+    {
+    vtkTemplateMacro(MeasurePlanes<VTK_TT>(this->InputImage, this->RASToIJKMatrix,
+      planes, results, numberOfRays, this->MaximumRadius, this->RayStepSize,
+      this->LumenThreshold, this->MinimumValidRayFraction));
+    default:
+      vtkErrorMacro("Update: Unsupported scalar type " << this->InputImage->GetScalarTypeAsString());
+      return false;
+    }
+
+  // Candidates table
+  const char* columnNames[] = { "Tilt", "Azimuth", "Offset", "ValidRayFraction",
+    "Area", "Perimeter", "MinimumDiameter", "MaximumDiameter" };
+  const int numberOfColumns = sizeof(columnNames) / sizeof(columnNames[0]);
+  std::vector<vtkDoubleArray*> columns;
+  for (int column = 0; column < numberOfColumns; ++column)
+    {
+    vtkNew<vtkDoubleArray> array;
+    array->SetName(columnNames[column]);
+    array->SetNumberOfValues(static_cast<vtkIdType>(planes.size()));
+    this->CandidatesTable->AddColumn(array);
+    columns.push_back(array);
+    }
+  vtkNew<vtkIntArray> validArray;
+  validArray->SetName("Valid");
+  validArray->SetNumberOfValues(static_cast<vtkIdType>(planes.size()));
+  this->CandidatesTable->AddColumn(validArray);
+
+  int selected = -1;
+  for (size_t planeIndex = 0; planeIndex < planes.size(); ++planeIndex)
+    {
+    const CandidatePlane& plane = planes[planeIndex];
+    const CandidateResult& result = results[planeIndex];
+    double values[] = { plane.Tilt, plane.Azimuth, plane.Offset, result.ValidRayFraction,
+      result.Area, result.Perimeter, result.MinimumDiameter, result.MaximumDiameter };
+    for (int column = 0; column < numberOfColumns; ++column)
+      {
+      columns[column]->SetValue(static_cast<vtkIdType>(planeIndex), values[column]);
+      }
+    validArray->SetValue(static_cast<vtkIdType>(planeIndex), result.Valid ? 1 : 0);
+    if (result.Valid && (selected < 0 || result.Area < results[selected].Area))
+      {
+      selected = static_cast<int>(planeIndex);
+      }
+    }
+  if (selected < 0)
+    {
+    vtkWarningMacro("Update: No valid annulus plane found, check the seed and the lumen threshold");
+    return false;
+    }
+
+  // Selected plane
+  const CandidatePlane& plane = planes[selected];
+  const CandidateResult& result = results[selected];
+  const double angleStep = 2.0 * vtkMath::Pi() / numberOfRays;
+  for (int i = 0; i < 3; ++i)
+    {
+    this->Normal[i] = plane.Normal[i];
+    this->Center[i] = plane.Center[i] + result.Centroid[0] * plane.U[i] + result.Centroid[1] * plane.V[i];
+    this->EllipseMajorAxis[i] = cos(result.EllipseAngle) * plane.U[i] + sin(result.EllipseAngle) * plane.V[i];
+    }
+  for (int ray = 0; ray < numberOfRays; ++ray)
+    {
+    double x = result.Radii[ray] * cos(ray * angleStep);
+    double y = result.Radii[ray] * sin(ray * angleStep);
+    this->Contour->InsertNextPoint(
+      plane.Center[0] + x * plane.U[0] + y * plane.V[0],
+      plane.Center[1] + x * plane.U[1] + y * plane.V[1],
+      plane.Center[2] + x * plane.U[2] + y * plane.V[2]);
+    }
+  this->Area = result.Area;
+  this->Perimeter = result.Perimeter;
+  this->MinimumDiameter = result.MinimumDiameter;
+  this->MaximumDiameter = result.MaximumDiameter;
+  this->EllipseMajorDiameter = result.EllipseMajorDiameter;
+  this->EllipseMinorDiameter = result.EllipseMinorDiameter;
+  this->TiltAngle = plane.Tilt;
+  this->Modified();
+  return true;
+}
@@ -0,0 +1,171 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkAorticAnnulusMeasurement_h
+#define __vtkAorticAnnulusMeasurement_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkImageData;
+class vtkMatrix4x4;
+class vtkPoints;
+class vtkTable;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Measure the aortic annulus on oblique planes of a contrast CT.
+///
+/// Starting from a seed plane (typically defined by the three hinge points),
+/// candidate planes are sampled by tilting the seed normal in every direction
+/// and by shifting the plane along the normal. Candidates are processed in
+/// parallel using vtkSMPTools.
+///
+/// On each candidate plane, rays are cast from the plane center to find the
+/// boundary of the contrast-filled lumen (first sample below LumenThreshold).
+/// The resulting contour gives the area, perimeter, minimum and maximum
+/// diameters (through the plane center) and the ellipse having the same
+/// second moments of area.
+///
+/// The annulus is the valid candidate with the smallest area, i.e. the
+/// cross-section that is the most orthogonal to the aortic root.
+///
+/// Coordinates are in RAS (millimeters), the image is sampled using the
+/// RASToIJK matrix with trilinear interpolation.
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkAorticAnnulusMeasurement : public vtkObject
+{
+public:
+  static vtkAorticAnnulusMeasurement* New();
+  vtkTypeMacro(vtkAorticAnnulusMeasurement, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Image to sample, in Hounsfield units.
+  void SetInputImage(vtkImageData* image);
+  vtkGetObjectMacro(InputImage, vtkImageData);
+
+  /// Transform from RAS to the IJK coordinates of the input image.
+  void SetRASToIJKMatrix(vtkMatrix4x4* matrix);
+  vtkGetObjectMacro(RASToIJKMatrix, vtkMatrix4x4);
+
+  /// Center and normal of the seed plane.
+  vtkSetVector3Macro(SeedCenter, double);
+  vtkGetVector3Macro(SeedCenter, double);
+  vtkSetVector3Macro(SeedNormal, double);
+  vtkGetVector3Macro(SeedNormal, double);
+
+  /// Number of tilt angles sampled between 0 and MaximumTiltAngle (excluded 0).
+  vtkSetClampMacro(NumberOfTiltSamples, int, 0, 90);
+  vtkGetMacro(NumberOfTiltSamples, int);
+  /// Number of directions in which the seed normal is tilted.
+  vtkSetClampMacro(NumberOfAzimuthSamples, int, 1, 360);
+  vtkGetMacro(NumberOfAzimuthSamples, int);
+  /// Maximum angle between a candidate normal and the seed normal, in degrees.
+  vtkSetClampMacro(MaximumTiltAngle, double, 0.0, 89.0);
+  vtkGetMacro(MaximumTiltAngle, double);
+  /// Number of plane positions sampled along the normal, in [-MaximumOffset, MaximumOffset].
+  vtkSetClampMacro(NumberOfOffsetSamples, int, 1, 101);
+  vtkGetMacro(NumberOfOffsetSamples, int);
+  vtkSetMacro(MaximumOffset, double);
+  vtkGetMacro(MaximumOffset, double);
+
+  /// Number of rays cast on each plane to extract the contour. Rounded up to an even number.
+  vtkSetClampMacro(NumberOfRays, int, 8, 3600);
+  vtkGetMacro(NumberOfRays, int);
+  /// Maximum distance from the plane center at which the lumen boundary is searched, in mm.
+  vtkSetMacro(MaximumRadius, double);
+  vtkGetMacro(MaximumRadius, double);
+  /// Distance between two samples along a ray, in mm.
+  vtkSetMacro(RayStepSize, double);
+  vtkGetMacro(RayStepSize, double);
+  /// Intensity below which a sample is considered outside the lumen, in HU.
+  vtkSetMacro(LumenThreshold, double);
+  vtkGetMacro(LumenThreshold, double);
+  /// Minimum fraction of rays that must reach the lumen boundary for a plane to be valid.
+  vtkSetClampMacro(MinimumValidRayFraction, double, 0.0, 1.0);
+  vtkGetMacro(MinimumValidRayFraction, double);
+
+  /// Sample all candidate planes and select the annulus.
+  /// Return false if the inputs are invalid or no candidate plane is valid.
+  bool Update();
+
+  /// Measurements of the selected plane, valid after a successful Update().
+  vtkGetVector3Macro(Center, double);
+  vtkGetVector3Macro(Normal, double);
+  vtkGetMacro(Area, double);
+  vtkGetMacro(Perimeter, double);
+  vtkGetMacro(MinimumDiameter, double);
+  vtkGetMacro(MaximumDiameter, double);
+  /// Diameters of the ellipse with the same second moments of area as the contour.
+  vtkGetMacro(EllipseMajorDiameter, double);
+  vtkGetMacro(EllipseMinorDiameter, double);
+  vtkGetVector3Macro(EllipseMajorAxis, double);
+  /// Angle between the selected plane normal and the seed normal, in degrees.
+  vtkGetMacro(TiltAngle, double);
+
+  /// Diameter of the circle having the same area (resp. perimeter) as the contour.
+  double GetAreaDerivedDiameter();
+  double GetPerimeterDerivedDiameter();
+
+  /// Contour of the selected plane, in RAS.
+  vtkPoints* GetContour();
+
+  /// One row per candidate plane, for quality control.
+  vtkTable* GetCandidatesTable();
+
+  /// Number of candidate planes sampled by Update().
+  int GetNumberOfCandidates();
+
+protected:
+  vtkAorticAnnulusMeasurement();
+  ~vtkAorticAnnulusMeasurement() override;
+
+  vtkImageData* InputImage;
+  vtkMatrix4x4* RASToIJKMatrix;
+
+  double SeedCenter[3];
+  double SeedNormal[3];
+  int NumberOfTiltSamples;
+  int NumberOfAzimuthSamples;
+  double MaximumTiltAngle;
+  int NumberOfOffsetSamples;
+  double MaximumOffset;
+
+  int NumberOfRays;
+  double MaximumRadius;
+  double RayStepSize;
+  double LumenThreshold;
+  double MinimumValidRayFraction;
+
+  double Center[3];
+  double Normal[3];
+  double Area;
+  double Perimeter;
+  double MinimumDiameter;
+  double MaximumDiameter;
+  double EllipseMajorDiameter;
+  double EllipseMinorDiameter;
+  double EllipseMajorAxis[3];
+  double TiltAngle;
+
+  vtkSmartPointer<vtkPoints> Contour;
+  vtkSmartPointer<vtkTable> CandidatesTable;
+
+private:
+  vtkAorticAnnulusMeasurement(const vtkAorticAnnulusMeasurement&) = delete;
+  void operator=(const vtkAorticAnnulusMeasurement&) = delete;
+};
+
+#endif
@@ -0,0 +1,511 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkAgatstonCalciumScoring.h"
+#include "vtkAorticAnnulusMeasurement.h"
+#include "vtkSlicerTAVILogic.h"
+#include "vtkTAVICinePlayer.h"
+#include "vtkTAVICurvedPlanarReformation.h"
+#include "vtkTAVIDICOMSeriesReader.h"
+#include "vtkTAVIMeasurementGraph.h"
+#include "vtkTAVIModelLOD.h"
+#include "vtkTAVIPhaseManager.h"
+#include "vtkTAVIProsthesisFitting.h"
+#include "vtkTAVIRenderGovernor.h"
+#include "vtkTAVIResultCache.h"
+#include "vtkTAVIRootSegmentation.h"
+#include "vtkTAVIVolumePyramid.h"
+
+// MRML includes
+#include <vtkMRMLMarkupsClosedCurveNode.h>
+#include <vtkMRMLMarkupsNode.h>
+#include <vtkMRMLMarkupsPlaneNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLTableNode.h>
+#include <vtkMRMLTransformNode.h>
+
+// VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkGeneralTransform.h>
+#include <vtkImageData.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPlane.h>
+#include <vtkPoints.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <algorithm>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerTAVILogic);
+
+//----------------------------------------------------------------------------
+vtkSlicerTAVILogic::vtkSlicerTAVILogic()
+{
+  this->AnnulusMeasurement = vtkAorticAnnulusMeasurement::New();
+  this->CalciumScoring = vtkAgatstonCalciumScoring::New();
+  this->MeasurementGraph = vtkTAVIMeasurementGraph::New();
+  this->ResultCache = vtkTAVIResultCache::New();
+  this->PhaseManager = vtkTAVIPhaseManager::New();
+  this->CinePlayer = vtkTAVICinePlayer::New();
+  this->CinePlayer->SetPhaseManager(this->PhaseManager);
+  this->CurvedPlanarReformation = vtkTAVICurvedPlanarReformation::New();
+  this->VolumePyramid = vtkTAVIVolumePyramid::New();
+  this->ProsthesisFitting = vtkTAVIProsthesisFitting::New();
+  this->ModelLOD = vtkTAVIModelLOD::New();
+  this->RenderGovernor = vtkTAVIRenderGovernor::New();
+  this->RootSegmentation = vtkTAVIRootSegmentation::New();
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerTAVILogic::~vtkSlicerTAVILogic()
+{
+  // Stopping the playback unpins the phases
+  this->CinePlayer->Delete();
+  this->AnnulusMeasurement->Delete();
+  this->CalciumScoring->Delete();
+  this->MeasurementGraph->Delete();
+  this->ResultCache->Delete();
+  this->PhaseManager->Delete();
+  this->CurvedPlanarReformation->Delete();
+  this->VolumePyramid->Delete();
+  this->ProsthesisFitting->Delete();
+  this->ModelLOD->Delete();
+  this->RenderGovernor->Delete();
+  this->RootSegmentation->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTAVILogic::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "AnnulusMeasurement:\n";
+  this->AnnulusMeasurement->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "CalciumScoring:\n";
+  this->CalciumScoring->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "MeasurementGraph:\n";
+  this->MeasurementGraph->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "ResultCache:\n";
+  this->ResultCache->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "PhaseManager:\n";
+  this->PhaseManager->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "CinePlayer:\n";
+  this->CinePlayer->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "CurvedPlanarReformation:\n";
+  this->CurvedPlanarReformation->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "VolumePyramid:\n";
+  this->VolumePyramid->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "ProsthesisFitting:\n";
+  this->ProsthesisFitting->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "ModelLOD:\n";
+  this->ModelLOD->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "RenderGovernor:\n";
+  this->RenderGovernor->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "RootSegmentation:\n";
+  this->RootSegmentation->PrintSelf(os, indent.GetNextIndent());
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTAVILogic::SetMRMLSceneInternal(vtkMRMLScene* newScene)
+{
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLScene::EndCloseEvent);
+  this->SetAndObserveMRMLSceneEventsInternal(newScene, events.GetPointer());
+  this->PhaseManager->SetScene(newScene);
+  this->VolumePyramid->SetMRMLApplicationLogic(this->GetMRMLApplicationLogic());
+  this->VolumePyramid->SetScene(newScene);
+  this->ModelLOD->SetScene(newScene);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTAVILogic::OnMRMLSceneEndClose()
+{
+  // Phase volume nodes have been removed with the scene content
+  this->CinePlayer->Stop();
+  this->PhaseManager->RemoveAllPhases();
+  this->CurvedPlanarReformation->SetInputVolumeNode(nullptr);
+  this->CurvedPlanarReformation->SetCurveNode(nullptr);
+  this->CurvedPlanarReformation->SetOutputVolumeNode(nullptr);
+  this->VolumePyramid->Stop();
+  this->ProsthesisFitting->SetRootModelNode(nullptr);
+  this->ProsthesisFitting->SetValveModelNode(nullptr);
+  this->ProsthesisFitting->SetOstiaNode(nullptr);
+  this->ModelLOD->Stop();
+  this->ModelLOD->RemoveAllModels();
+  this->RootSegmentation->SetInputVolumeNode(nullptr);
+  this->RootSegmentation->SetSeedsNode(nullptr);
+  this->RootSegmentation->SetSegmentationNode(nullptr);
+  this->MeasurementGraph->RemoveAllMeasurements();
+}
+
+//----------------------------------------------------------------------------
+vtkAorticAnnulusMeasurement* vtkSlicerTAVILogic::GetAnnulusMeasurement()
+{
+  return this->AnnulusMeasurement;
+}
+
+//----------------------------------------------------------------------------
+vtkAgatstonCalciumScoring* vtkSlicerTAVILogic::GetCalciumScoring()
+{
+  return this->CalciumScoring;
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIMeasurementGraph* vtkSlicerTAVILogic::GetMeasurementGraph()
+{
+  return this->MeasurementGraph;
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIResultCache* vtkSlicerTAVILogic::GetResultCache()
+{
+  return this->ResultCache;
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIPhaseManager* vtkSlicerTAVILogic::GetPhaseManager()
+{
+  return this->PhaseManager;
+}
+
+//----------------------------------------------------------------------------
+vtkTAVICinePlayer* vtkSlicerTAVILogic::GetCinePlayer()
+{
+  return this->CinePlayer;
+}
+
+//----------------------------------------------------------------------------
+vtkTAVICurvedPlanarReformation* vtkSlicerTAVILogic::GetCurvedPlanarReformation()
+{
+  return this->CurvedPlanarReformation;
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIVolumePyramid* vtkSlicerTAVILogic::GetVolumePyramid()
+{
+  return this->VolumePyramid;
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIProsthesisFitting* vtkSlicerTAVILogic::GetProsthesisFitting()
+{
+  return this->ProsthesisFitting;
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIModelLOD* vtkSlicerTAVILogic::GetModelLOD()
+{
+  return this->ModelLOD;
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIRenderGovernor* vtkSlicerTAVILogic::GetRenderGovernor()
+{
+  return this->RenderGovernor;
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIRootSegmentation* vtkSlicerTAVILogic::GetRootSegmentation()
+{
+  return this->RootSegmentation;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkSlicerTAVILogic::LoadDICOMSeries(const char* name, vtkStringArray* fileNames)
+{
+  if (!this->GetMRMLScene() || !fileNames || fileNames->GetNumberOfValues() == 0)
+    {
+    vtkErrorMacro("LoadDICOMSeries: No scene or no file");
+    return nullptr;
+    }
+  std::vector<std::string> seriesFileNames;
+  for (vtkIdType fileIndex = 0; fileIndex < fileNames->GetNumberOfValues(); ++fileIndex)
+    {
+    seriesFileNames.push_back(fileNames->GetValue(fileIndex));
+    }
+  vtkMRMLScalarVolumeNode* volumeNode = vtkTAVIDICOMSeriesReader::ReadSeries(
+    this->GetMRMLScene(), name ? name : "", seriesFileNames);
+  if (!volumeNode)
+    {
+    vtkErrorMacro("LoadDICOMSeries: Failed to read " << seriesFileNames[0]);
+    }
+  return volumeNode;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTAVILogic::FitPlaneToControlPoints(vtkMRMLMarkupsNode* markupsNode,
+  double center[3], double normal[3])
+{
+  if (!markupsNode || markupsNode->GetNumberOfControlPoints() < 3)
+    {
+    return false;
+    }
+  vtkNew<vtkPoints> points;
+  markupsNode->GetControlPointPositionsWorld(points);
+  if (!vtkPlane::ComputeBestFittingPlane(points, center, normal))
+    {
+    return false;
+    }
+  // Orient the normal consistently with the order of the first three points
+  double p0[3], p1[3], p2[3], v1[3], v2[3], orientation[3];
+  points->GetPoint(0, p0);
+  points->GetPoint(1, p1);
+  points->GetPoint(2, p2);
+  vtkMath::Subtract(p1, p0, v1);
+  vtkMath::Subtract(p2, p0, v2);
+  vtkMath::Cross(v1, v2, orientation);
+  if (vtkMath::Dot(orientation, normal) < 0.0)
+    {
+    vtkMath::MultiplyScalar(normal, -1.0);
+    }
+  return vtkMath::Normalize(normal) > 0.0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTAVILogic::GetWorldToIJKMatrix(vtkMRMLScalarVolumeNode* volumeNode, vtkMatrix4x4* worldToIJK)
+{
+  if (!volumeNode || !worldToIJK)
+    {
+    return false;
+    }
+  vtkNew<vtkGeneralTransform> worldToRAS;
+  vtkMRMLTransformNode::GetTransformBetweenNodes(nullptr, volumeNode->GetParentTransformNode(), worldToRAS);
+  vtkNew<vtkTransform> worldToRASLinear;
+  if (!vtkMRMLTransformNode::IsGeneralTransformLinear(worldToRAS, worldToRASLinear))
+    {
+    return false;
+    }
+  vtkNew<vtkMatrix4x4> rasToIJK;
+  volumeNode->GetRASToIJKMatrix(rasToIJK);
+  vtkMatrix4x4::Multiply4x4(rasToIJK, worldToRASLinear->GetMatrix(), worldToIJK);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTAVILogic::MeasureAnnulus(vtkMRMLScalarVolumeNode* volumeNode,
+  vtkMRMLMarkupsNode* hingePointsNode,
+  vtkMRMLTableNode* tableNode,
+  vtkMRMLMarkupsClosedCurveNode* contourNode,
+  vtkMRMLMarkupsPlaneNode* planeNode)
+{
+  if (!volumeNode || !volumeNode->GetImageData())
+    {
+    vtkErrorMacro("MeasureAnnulus: Invalid volume node");
+    return false;
+    }
+  double seedCenter[3];
+  double seedNormal[3];
+  if (!vtkSlicerTAVILogic::FitPlaneToControlPoints(hingePointsNode, seedCenter, seedNormal))
+    {
+    vtkErrorMacro("MeasureAnnulus: At least 3 non-collinear hinge points are required");
+    return false;
+    }
+
+  // The hinge points, contour and plane are in world coordinates
+  vtkNew<vtkMatrix4x4> worldToIJK;
+  if (!vtkSlicerTAVILogic::GetWorldToIJKMatrix(volumeNode, worldToIJK))
+    {
+    vtkErrorMacro("MeasureAnnulus: The volume is under a non-linear transform, harden it first");
+    return false;
+    }
+
+  vtkAorticAnnulusMeasurement* measurement = this->AnnulusMeasurement;
+  measurement->SetInputImage(volumeNode->GetImageData());
+  measurement->SetRASToIJKMatrix(worldToIJK);
+  measurement->SetSeedCenter(seedCenter);
+  measurement->SetSeedNormal(seedNormal);
+  bool success = measurement->Update();
+  // Do not keep a reference to the image after the measurement
+  measurement->SetInputImage(nullptr);
+  if (!success)
+    {
+    return false;
+    }
+
+  if (tableNode)
+    {
+    this->WriteAnnulusTable(tableNode);
+    }
+  if (contourNode)
+    {
+    // Display one control point every 5 degrees, the contour itself is sampled
+    // more finely by the measurement.
+    vtkPoints* contour = measurement->GetContour();
+    vtkIdType step = std::max<vtkIdType>(1, contour->GetNumberOfPoints() / 72);
+    vtkNew<vtkPoints> controlPoints;
+    for (vtkIdType pointIndex = 0; pointIndex < contour->GetNumberOfPoints(); pointIndex += step)
+      {
+      controlPoints->InsertNextPoint(contour->GetPoint(pointIndex));
+      }
+    contourNode->SetControlPointPositionsWorld(controlPoints);
+    contourNode->SetLocked(true);
+    }
+  if (planeNode)
+    {
+    int wasModifying = planeNode->StartModify();
+    planeNode->SetCenterWorld(measurement->GetCenter());
+    planeNode->SetNormalWorld(measurement->GetNormal());
+    planeNode->EndModify(wasModifying);
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTAVILogic::WriteAnnulusTable(vtkMRMLTableNode* tableNode)
+{
+  vtkAorticAnnulusMeasurement* measurement = this->AnnulusMeasurement;
+
+  vtkNew<vtkStringArray> nameColumn;
+  nameColumn->SetName("Measurement");
+  vtkNew<vtkDoubleArray> valueColumn;
+  valueColumn->SetName("Value");
+  vtkNew<vtkStringArray> unitColumn;
+  unitColumn->SetName("Unit");
+
+  struct
+  {
+    const char* Name;
+    double Value;
+    const char* Unit;
+  } rows[] = {
+    { "Area", measurement->GetArea(), "mm2" },
+    { "Perimeter", measurement->GetPerimeter(), "mm" },
+    { "Minimum diameter", measurement->GetMinimumDiameter(), "mm" },
+    { "Maximum diameter", measurement->GetMaximumDiameter(), "mm" },
+    { "Area-derived diameter", measurement->GetAreaDerivedDiameter(), "mm" },
+    { "Perimeter-derived diameter", measurement->GetPerimeterDerivedDiameter(), "mm" },
+    { "Ellipse major diameter", measurement->GetEllipseMajorDiameter(), "mm" },
+    { "Ellipse minor diameter", measurement->GetEllipseMinorDiameter(), "mm" },
+    { "Plane tilt", measurement->GetTiltAngle(), "deg" },
+    };
+  for (const auto& row : rows)
+    {
+    nameColumn->InsertNextValue(row.Name);
+    valueColumn->InsertNextValue(row.Value);
+    unitColumn->InsertNextValue(row.Unit);
+    }
+
+  vtkNew<vtkTable> table;
+  table->AddColumn(nameColumn);
+  table->AddColumn(valueColumn);
+  table->AddColumn(unitColumn);
+
+  int wasModifying = tableNode->StartModify();
+  tableNode->SetAndObserveTable(table);
+  tableNode->SetUseColumnNameAsColumnHeader(true);
+  tableNode->SetLocked(true);
+  tableNode->EndModify(wasModifying);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTAVILogic::ScoreCalcium(vtkMRMLScalarVolumeNode* volumeNode,
+  vtkMRMLMarkupsNode* hingePointsNode,
+  vtkMRMLTableNode* tableNode)
+{
+  if (!volumeNode || !volumeNode->GetImageData())
+    {
+    vtkErrorMacro("ScoreCalcium: Invalid volume node");
+    return false;
+    }
+  double center[3];
+  double normal[3];
+  if (!vtkSlicerTAVILogic::FitPlaneToControlPoints(hingePointsNode, center, normal))
+    {
+    vtkErrorMacro("ScoreCalcium: At least 3 non-collinear hinge points are required");
+    return false;
+    }
+
+  // The hinge points are in world coordinates
+  vtkNew<vtkMatrix4x4> worldToIJK;
+  if (!vtkSlicerTAVILogic::GetWorldToIJKMatrix(volumeNode, worldToIJK))
+    {
+    vtkErrorMacro("ScoreCalcium: The volume is under a non-linear transform, harden it first");
+    return false;
+    }
+  vtkNew<vtkPoints> hingePoints;
+  hingePointsNode->GetControlPointPositionsWorld(hingePoints);
+
+  vtkAgatstonCalciumScoring* scoring = this->CalciumScoring;
+  scoring->SetInputImage(volumeNode->GetImageData());
+  scoring->SetRASToIJKMatrix(worldToIJK);
+  scoring->SetCenter(center);
+  scoring->SetAxis(normal);
+  scoring->SetSectorPoints(hingePoints);
+  bool success = scoring->Update();
+  // Do not keep a reference to the image after the scoring
+  scoring->SetInputImage(nullptr);
+  if (!success)
+    {
+    return false;
+    }
+  if (tableNode)
+    {
+    this->WriteCalciumTable(tableNode, hingePointsNode);
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTAVILogic::WriteCalciumTable(vtkMRMLTableNode* tableNode,
+  vtkMRMLMarkupsNode* hingePointsNode)
+{
+  vtkAgatstonCalciumScoring* scoring = this->CalciumScoring;
+
+  vtkNew<vtkStringArray> regionColumn;
+  regionColumn->SetName("Region");
+  vtkNew<vtkDoubleArray> agatstonColumn;
+  agatstonColumn->SetName("Agatston score");
+  vtkNew<vtkDoubleArray> volumeColumn;
+  volumeColumn->SetName("Volume (mm3)");
+  vtkNew<vtkDoubleArray> massColumn;
+  massColumn->SetName("Mass (mg)");
+
+  regionColumn->InsertNextValue("Total");
+  agatstonColumn->InsertNextValue(scoring->GetAgatstonScore());
+  volumeColumn->InsertNextValue(scoring->GetVolumeScore());
+  massColumn->InsertNextValue(scoring->GetMassScore());
+  if (scoring->GetNumberOfSectors() > 1)
+    {
+    // One sector per hinge point, named after the control point
+    for (int sector = 0; sector < scoring->GetNumberOfSectors(); ++sector)
+      {
+      regionColumn->InsertNextValue(hingePointsNode->GetNthControlPointLabel(sector));
+      agatstonColumn->InsertNextValue(scoring->GetSectorAgatstonScore(sector));
+      volumeColumn->InsertNextValue(scoring->GetSectorVolumeScore(sector));
+      massColumn->InsertNextValue(scoring->GetSectorMassScore(sector));
+      }
+    }
+
+  vtkNew<vtkTable> table;
+  table->AddColumn(regionColumn);
+  table->AddColumn(agatstonColumn);
+  table->AddColumn(volumeColumn);
+  table->AddColumn(massColumn);
+
+  int wasModifying = tableNode->StartModify();
+  tableNode->SetAndObserveTable(table);
+  tableNode->SetUseColumnNameAsColumnHeader(true);
+  tableNode->SetLocked(true);
+  tableNode->EndModify(wasModifying);
+}
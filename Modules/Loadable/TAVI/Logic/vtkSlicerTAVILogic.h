@@ -0,0 +1,183 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerTAVILogic_h
+#define __vtkSlicerTAVILogic_h
+
+// Slicer includes
+#include "vtkSlicerModuleLogic.h"
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkAgatstonCalciumScoring;
+class vtkAorticAnnulusMeasurement;
+class vtkMRMLMarkupsClosedCurveNode;
+class vtkMRMLMarkupsNode;
+class vtkMRMLMarkupsPlaneNode;
+class vtkMRMLScalarVolumeNode;
+class vtkMRMLTableNode;
+class vtkMatrix4x4;
+class vtkStringArray;
+class vtkTAVICinePlayer;
+class vtkTAVICurvedPlanarReformation;
+class vtkTAVIMeasurementGraph;
+class vtkTAVIModelLOD;
+class vtkTAVIPhaseManager;
+class vtkTAVIProsthesisFitting;
+class vtkTAVIRenderGovernor;
+class vtkTAVIResultCache;
+class vtkTAVIRootSegmentation;
+class vtkTAVIVolumePyramid;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Native TAVI measurements, usable from scripted modules such as tavi_analytics.
+///
+/// Example:
+/// \code{.py}
+/// logic = slicer.modules.tavi.logic()
+/// logic.MeasureAnnulus(volumeNode, hingePointsNode, tableNode, contourNode, planeNode)
+/// logic.ScoreCalcium(volumeNode, hingePointsNode, calciumTableNode)
+/// \endcode
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkSlicerTAVILogic :
+  public vtkSlicerModuleLogic
+{
+public:
+  static vtkSlicerTAVILogic *New();
+  vtkTypeMacro(vtkSlicerTAVILogic, vtkSlicerModuleLogic);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Measurement engine used by MeasureAnnulus(). Its sampling parameters
+  /// (number of candidate planes, lumen threshold...) can be customized.
+  vtkAorticAnnulusMeasurement* GetAnnulusMeasurement();
+
+  /// Measure the aortic annulus of \a volumeNode.
+  /// The seed plane is fitted to the control points of \a hingePointsNode
+  /// (at least 3, typically the three hinge points of the aortic cusps).
+  /// Measurements are written to \a tableNode, the annulus contour to
+  /// \a contourNode and the annulus plane to \a planeNode. Output nodes are
+  /// optional. Return false on failure.
+  bool MeasureAnnulus(vtkMRMLScalarVolumeNode* volumeNode,
+    vtkMRMLMarkupsNode* hingePointsNode,
+    vtkMRMLTableNode* tableNode,
+    vtkMRMLMarkupsClosedCurveNode* contourNode = nullptr,
+    vtkMRMLMarkupsPlaneNode* planeNode = nullptr);
+
+  /// Calcium scoring engine used by ScoreCalcium(). Its parameters
+  /// (region radius and height, threshold, mass calibration...) can be customized.
+  vtkAgatstonCalciumScoring* GetCalciumScoring();
+
+  /// Compute the Agatston, volume and mass calcium scores of \a volumeNode
+  /// around the plane fitted to the control points of \a hingePointsNode.
+  /// Scores are reported in \a tableNode for the whole region and for each
+  /// cusp sector, a sector being the region closest (by azimuth) to one of the
+  /// hinge points. Return false on failure.
+  bool ScoreCalcium(vtkMRMLScalarVolumeNode* volumeNode,
+    vtkMRMLMarkupsNode* hingePointsNode,
+    vtkMRMLTableNode* tableNode);
+
+  /// Dependency graph of the measurements, recomputing only the measurements
+  /// invalidated by an edit. The TAVI module updates it once the pending
+  /// events are processed. Its measurements are removed when the scene is closed.
+  vtkTAVIMeasurementGraph* GetMeasurementGraph();
+
+  /// Persistent cache of derived results, shared by the scripted analyses.
+  /// It is configured from the application settings by the module.
+  vtkTAVIResultCache* GetResultCache();
+
+  /// Application-wide manager of the phases of 4D cardiac series, loading
+  /// them on demand under a memory budget. Phases are loaded in the scene
+  /// of the logic and unregistered when the scene is closed.
+  vtkTAVIPhaseManager* GetPhaseManager();
+
+  /// Cine playback of the phases of the phase manager in a slice view.
+  /// Playback is stopped when the scene is closed.
+  vtkTAVICinePlayer* GetCinePlayer();
+
+  /// Straightened curved planar reformation along a centerline (for example
+  /// the aorto-iliofemoral access route), updated as the curve is edited.
+  /// Its nodes are released when the scene is closed.
+  vtkTAVICurvedPlanarReformation* GetCurvedPlanarReformation();
+
+  /// Progressive loading of large series through downsampled levels, shown
+  /// in the slice views of the application. Loading is stopped when the
+  /// scene is closed.
+  vtkTAVIVolumePyramid* GetVolumePyramid();
+
+  /// Interference map of a virtual valve prosthesis against the aortic root
+  /// surface, updated as the valve is positioned. Its nodes are released
+  /// when the scene is closed.
+  vtkTAVIProsthesisFitting* GetProsthesisFitting();
+
+  /// Decimated levels of detail of the large models of the scene, shown in
+  /// a 3D view while it is interacted with. Building stops when the scene
+  /// is closed.
+  vtkTAVIModelLOD* GetModelLOD();
+
+  /// Frame rate governor of the volume rendering of a 3D view while it is
+  /// interacted with. It is configured from the application settings by the module.
+  vtkTAVIRenderGovernor* GetRenderGovernor();
+
+  /// Seeded segmentation of the aortic root, LVOT and ascending aorta into a
+  /// segmentation node, labeled slab by slab in parallel and updated as the
+  /// seeds are edited. Its nodes are released when the scene is closed.
+  vtkTAVIRootSegmentation* GetRootSegmentation();
+
+  /// Read the single-frame DICOM files \a fileNames, sorted along the slice
+  /// axis, into a new scalar volume node named \a name, decoding the slices
+  /// in parallel (see vtkTAVIDICOMSeriesReader). Used by the TAVISeries DICOM
+  /// plugin without main window, which otherwise loads the series through
+  /// GetVolumePyramid(). Return nullptr if the series could not be read.
+  vtkMRMLScalarVolumeNode* LoadDICOMSeries(const char* name, vtkStringArray* fileNames);
+
+  /// Fit a plane to the control points of \a markupsNode, in world coordinates.
+  /// Return false if there are less than 3 control points or they are collinear.
+  static bool FitPlaneToControlPoints(vtkMRMLMarkupsNode* markupsNode,
+    double center[3], double normal[3]);
+
+  /// Matrix from world coordinates to the voxel indices of \a volumeNode,
+  /// through its parent transforms. Return false if they are not linear.
+  static bool GetWorldToIJKMatrix(vtkMRMLScalarVolumeNode* volumeNode, vtkMatrix4x4* worldToIJK);
+
+protected:
+  vtkSlicerTAVILogic();
+  ~vtkSlicerTAVILogic() override;
+
+  void SetMRMLSceneInternal(vtkMRMLScene* newScene) override;
+  void OnMRMLSceneEndClose() override;
+
+  /// Write the current annulus measurements to \a tableNode.
+  void WriteAnnulusTable(vtkMRMLTableNode* tableNode);
+
+  /// Write the current calcium scores to \a tableNode.
+  void WriteCalciumTable(vtkMRMLTableNode* tableNode, vtkMRMLMarkupsNode* hingePointsNode);
+
+  vtkAorticAnnulusMeasurement* AnnulusMeasurement;
+  vtkAgatstonCalciumScoring* CalciumScoring;
+  vtkTAVIMeasurementGraph* MeasurementGraph;
+  vtkTAVIResultCache* ResultCache;
+  vtkTAVIPhaseManager* PhaseManager;
+  vtkTAVICinePlayer* CinePlayer;
+  vtkTAVICurvedPlanarReformation* CurvedPlanarReformation;
+  vtkTAVIVolumePyramid* VolumePyramid;
+  vtkTAVIProsthesisFitting* ProsthesisFitting;
+  vtkTAVIModelLOD* ModelLOD;
+  vtkTAVIRenderGovernor* RenderGovernor;
+  vtkTAVIRootSegmentation* RootSegmentation;
+
+private:
+  vtkSlicerTAVILogic(const vtkSlicerTAVILogic&) = delete;
+  void operator=(const vtkSlicerTAVILogic&) = delete;
+};
+
+#endif
@@ -0,0 +1,661 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkTAVICinePlayer.h"
+#include "vtkTAVIImageSampling.h"
+#include "vtkTAVIPhaseManager.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeDisplayNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSliceNode.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+using vtkTAVIImageSampling::InterpolateTrilinear;
+using vtkTAVIImageSampling::RoundToScalar;
+
+//----------------------------------------------------------------------------
+/// Trilinear resampling of the slice defined by \a xyToIJK.
+/// Pixels outside of the input are set to \a background.
+template <class T>
+void ResampleSlice(vtkImageData* input, const double xyToIJK[16],
+  const int dimensions[2], double background, T* output)
+{
+  const T* inputPointer = static_cast<const T*>(input->GetScalarPointer());
+  int extent[6];
+  input->GetExtent(extent);
+  vtkIdType increments[3];
+  input->GetIncrements(increments);
+  const double maximum[3] = {
+    static_cast<double>(extent[1] - extent[0]),
+    static_cast<double>(extent[3] - extent[2]),
+    static_cast<double>(extent[5] - extent[4]) };
+  const T backgroundValue = RoundToScalar<T>(background);
+
+  for (int y = 0; y < dimensions[1]; ++y)
+    {
+    // Continuous index of the first pixel of the row, relative to the extent
+    const double rowOrigin[3] = {
+      xyToIJK[1] * y + xyToIJK[3] - extent[0],
+      xyToIJK[5] * y + xyToIJK[7] - extent[2],
+      xyToIJK[9] * y + xyToIJK[11] - extent[4] };
+    for (int x = 0; x < dimensions[0]; ++x)
+      {
+      double index[3];
+      bool inside = true;
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        index[axis] = rowOrigin[axis] + xyToIJK[4 * axis] * x;
+        inside = inside && index[axis] >= 0.0 && index[axis] <= maximum[axis];
+        }
+      if (!inside)
+        {
+        *output++ = backgroundValue;
+        continue;
+        }
+      int index0[3];
+      vtkIdType step[3];
+      double weight[3];
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        index0[axis] = static_cast<int>(index[axis]);
+        weight[axis] = index[axis] - index0[axis];
+        step[axis] = index0[axis] < maximum[axis] ? increments[axis] : 0;
+        }
+      const T* p = inputPointer + index0[0] * increments[0] + index0[1] * increments[1] + index0[2] * increments[2];
+      *output++ = RoundToScalar<T>(InterpolateTrilinear(p, step, weight));
+      }
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTAVICinePlayer);
+
+//----------------------------------------------------------------------------
+vtkTAVICinePlayer::vtkTAVICinePlayer()
+  : FrameRate(25.0)
+  , NumberOfThreads(0)
+  , NumberOfPrefetchedPhases(4)
+  , Playing(false)
+  , CurrentPhase(-1)
+  , TotalResampleTime(0.0)
+  , NumberOfResampledFrames(0)
+  , ShownGeneration(-1)
+{
+  this->SliceNodeCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->SliceNodeCallback->SetCallback(vtkTAVICinePlayer::OnSliceNodeModified);
+  this->SliceNodeCallback->SetClientData(this);
+  this->Geometry.Dimensions[0] = 0;
+  this->Geometry.Dimensions[1] = 0;
+  vtkMatrix4x4::Identity(this->Geometry.XYToRAS);
+  this->Geometry.Generation = 0;
+  this->ResetFrameStatistics();
+}
+
+//----------------------------------------------------------------------------
+vtkTAVICinePlayer::~vtkTAVICinePlayer()
+{
+  this->Stop();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICinePlayer::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FrameRate: " << this->FrameRate << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "NumberOfPrefetchedPhases: " << this->NumberOfPrefetchedPhases << "\n";
+  os << indent << "Playing: " << this->Playing << "\n";
+  os << indent << "NumberOfShownFrames: " << this->NumberOfShownFrames << "\n";
+  os << indent << "NumberOfDroppedFrames: " << this->NumberOfDroppedFrames << "\n";
+  os << indent << "MeanFrameInterval: " << this->GetMeanFrameInterval() << " ms\n";
+  os << indent << "MaximumFrameInterval: " << this->MaximumFrameInterval << " ms\n";
+  os << indent << "MeanResampleTime: " << this->GetMeanResampleTime() << " ms\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICinePlayer::SetPhaseManager(vtkTAVIPhaseManager* phaseManager)
+{
+  if (this->PhaseManager == phaseManager)
+    {
+    return;
+    }
+  this->Stop();
+  this->PhaseManager = phaseManager;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIPhaseManager* vtkTAVICinePlayer::GetPhaseManager()
+{
+  return this->PhaseManager;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICinePlayer::SetSliceNode(vtkMRMLSliceNode* sliceNode)
+{
+  if (this->SliceNode == sliceNode)
+    {
+    return;
+    }
+  if (this->SliceNode && this->Playing)
+    {
+    this->SliceNode->RemoveObserver(this->SliceNodeCallback);
+    }
+  this->SliceNode = sliceNode;
+  if (this->SliceNode && this->Playing)
+    {
+    this->SliceNode->AddObserver(vtkCommand::ModifiedEvent, this->SliceNodeCallback);
+    this->UpdateFrameGeometry();
+    }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSliceNode* vtkTAVICinePlayer::GetSliceNode()
+{
+  return this->SliceNode;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkTAVICinePlayer::GetFrameVolumeNode()
+{
+  return this->FrameVolumeNode;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVICinePlayer::IsPlaying()
+{
+  return this->Playing;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVICinePlayer::GetCurrentPhase()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->CurrentPhase;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVICinePlayer::Start()
+{
+  if (this->Playing)
+    {
+    return true;
+    }
+  vtkTAVIPhaseManager* phaseManager = this->PhaseManager;
+  vtkMRMLScene* scene = phaseManager ? phaseManager->GetScene() : nullptr;
+  if (!scene || phaseManager->GetNumberOfPhases() == 0)
+    {
+    vtkErrorMacro("Start: No phase to play");
+    return false;
+    }
+  if (!this->SliceNode)
+    {
+    vtkErrorMacro("Start: No slice node");
+    return false;
+    }
+
+  // Phases are loaded and pinned ahead of the playback, starting from the first one
+  const int numberOfPhases = phaseManager->GetNumberOfPhases();
+  this->Phases.resize(numberOfPhases);
+  for (int phaseIndex = 0; phaseIndex < numberOfPhases; ++phaseIndex)
+    {
+    Phase& phase = this->Phases[phaseIndex];
+    phase.Image = nullptr;
+    phase.WasPinned = false;
+    phase.Pinned = false;
+    }
+  this->CurrentPhase = -1;
+  if (!this->UpdatePrefetchedPhases())
+    {
+    for (int phaseIndex = 0; phaseIndex < numberOfPhases; ++phaseIndex)
+      {
+      if (this->Phases[phaseIndex].Pinned)
+        {
+        phaseManager->SetPhasePinned(phaseIndex, this->Phases[phaseIndex].WasPinned);
+        }
+      }
+    this->Phases.clear();
+    return false;
+    }
+  vtkMRMLScalarVolumeNode* firstVolumeNode = phaseManager->GetPhaseVolumeNode(0);
+  vtkMRMLScalarVolumeDisplayNode* phaseDisplayNode =
+    firstVolumeNode ? firstVolumeNode->GetScalarVolumeDisplayNode() : nullptr;
+
+  vtkNew<vtkMRMLScalarVolumeNode> frameVolumeNode;
+  frameVolumeNode->SetName(scene->GetUniqueNameByString("Cine"));
+  frameVolumeNode->SetHideFromEditors(true);
+  scene->AddNode(frameVolumeNode);
+  frameVolumeNode->CreateDefaultDisplayNodes();
+  vtkMRMLScalarVolumeDisplayNode* frameDisplayNode = frameVolumeNode->GetScalarVolumeDisplayNode();
+  if (phaseDisplayNode && frameDisplayNode)
+    {
+    frameDisplayNode->SetAndObserveColorNodeID(phaseDisplayNode->GetColorNodeID());
+    frameDisplayNode->SetAutoWindowLevel(false);
+    frameDisplayNode->SetWindowLevel(phaseDisplayNode->GetWindow(), phaseDisplayNode->GetLevel());
+    }
+  this->FrameVolumeNode = frameVolumeNode;
+
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  Frame invalidFrame;
+  invalidFrame.Geometry.Generation = -1;
+  invalidFrame.InProgress = false;
+  this->Frames.assign(numberOfPhases, invalidFrame);
+  this->TotalResampleTime = 0.0;
+  this->NumberOfResampledFrames = 0;
+  this->Playing = true;
+  }
+  this->ShownGeneration = -1;
+  this->ResetFrameStatistics();
+  this->UpdateFrameGeometry();
+  this->SliceNode->AddObserver(vtkCommand::ModifiedEvent, this->SliceNodeCallback);
+
+  int numberOfThreads = this->NumberOfThreads;
+  if (numberOfThreads <= 0)
+    {
+    numberOfThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    }
+  numberOfThreads = std::min(numberOfThreads, numberOfPhases);
+  for (int threadIndex = 0; threadIndex < numberOfThreads; ++threadIndex)
+    {
+    this->Threads.emplace_back(&vtkTAVICinePlayer::ResampleFrames, this);
+    }
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICinePlayer::Stop()
+{
+  if (!this->Playing)
+    {
+    return;
+    }
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Playing = false;
+  }
+  this->FramesInvalidated.notify_all();
+  for (std::thread& thread : this->Threads)
+    {
+    thread.join();
+    }
+  this->Threads.clear();
+  this->Frames.clear();
+  this->CurrentPhase = -1;
+
+  if (this->SliceNode)
+    {
+    this->SliceNode->RemoveObserver(this->SliceNodeCallback);
+    }
+  vtkMRMLScalarVolumeNode* frameVolumeNode = this->FrameVolumeNode;
+  vtkMRMLScene* scene = frameVolumeNode ? frameVolumeNode->GetScene() : nullptr;
+  if (scene)
+    {
+    if (frameVolumeNode->GetDisplayNode())
+      {
+      scene->RemoveNode(frameVolumeNode->GetDisplayNode());
+      }
+    scene->RemoveNode(frameVolumeNode);
+    }
+  this->FrameVolumeNode = nullptr;
+
+  // Restore the pinned state of the prefetched phases, if they are still registered
+  vtkTAVIPhaseManager* phaseManager = this->PhaseManager;
+  if (phaseManager && phaseManager->GetNumberOfPhases() == static_cast<int>(this->Phases.size()))
+    {
+    for (int phaseIndex = 0; phaseIndex < static_cast<int>(this->Phases.size()); ++phaseIndex)
+      {
+      if (this->Phases[phaseIndex].Pinned)
+        {
+        phaseManager->SetPhasePinned(phaseIndex, this->Phases[phaseIndex].WasPinned);
+        }
+      }
+    }
+  this->Phases.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICinePlayer::OnSliceNodeModified(vtkObject* vtkNotUsed(caller),
+  unsigned long vtkNotUsed(eid), void* clientData, void* vtkNotUsed(callData))
+{
+  static_cast<vtkTAVICinePlayer*>(clientData)->UpdateFrameGeometry();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICinePlayer::UpdateFrameGeometry()
+{
+  vtkMRMLSliceNode* sliceNode = this->SliceNode;
+  if (!this->Playing || !sliceNode)
+    {
+    return;
+    }
+  FrameGeometry geometry;
+  geometry.Dimensions[0] = sliceNode->GetDimensions()[0];
+  geometry.Dimensions[1] = sliceNode->GetDimensions()[1];
+  vtkMatrix4x4::DeepCopy(geometry.XYToRAS, sliceNode->GetXYToRAS());
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  if (geometry.Dimensions[0] == this->Geometry.Dimensions[0] &&
+      geometry.Dimensions[1] == this->Geometry.Dimensions[1] &&
+      std::equal(geometry.XYToRAS, geometry.XYToRAS + 16, this->Geometry.XYToRAS))
+    {
+    // The slice node was modified without moving (e.g. its annotations)
+    return;
+    }
+  geometry.Generation = this->Geometry.Generation + 1;
+  this->Geometry = geometry;
+  }
+  this->FramesInvalidated.notify_all();
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVICinePlayer::UpdatePrefetchedPhases()
+{
+  vtkTAVIPhaseManager* phaseManager = this->PhaseManager;
+  const int numberOfPhases = static_cast<int>(this->Phases.size());
+  if (!phaseManager || phaseManager->GetNumberOfPhases() != numberOfPhases)
+    {
+    vtkErrorMacro("UpdatePrefetchedPhases: The phases were modified while playing");
+    return false;
+    }
+  // CurrentPhase is only modified by the main thread
+  const int firstPhase = (this->CurrentPhase + 1) % numberOfPhases;
+  const int numberOfPrefetchedPhases = std::min(this->NumberOfPrefetchedPhases, numberOfPhases);
+
+  // Release the phases left behind first, so that the phase manager can unload them
+  for (int phaseIndex = 0; phaseIndex < numberOfPhases; ++phaseIndex)
+    {
+    Phase& phase = this->Phases[phaseIndex];
+    if (!phase.Pinned || (phaseIndex - firstPhase + numberOfPhases) % numberOfPhases < numberOfPrefetchedPhases)
+      {
+      continue;
+      }
+    {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    phase.Image = nullptr;
+    }
+    phaseManager->SetPhasePinned(phaseIndex, phase.WasPinned);
+    phase.Pinned = false;
+    }
+
+  // Then load the phases ahead, in playback order
+  bool loaded = false;
+  for (int offset = 0; offset < numberOfPrefetchedPhases; ++offset)
+    {
+    const int phaseIndex = (firstPhase + offset) % numberOfPhases;
+    Phase& phase = this->Phases[phaseIndex];
+    if (phase.Pinned)
+      {
+      continue;
+      }
+    // Pinned before loading, so that loading the next phases does not unload it
+    phase.WasPinned = phaseManager->GetPhasePinned(phaseIndex);
+    phaseManager->SetPhasePinned(phaseIndex, true);
+    phase.Pinned = true;
+    vtkMRMLScalarVolumeNode* volumeNode = phaseManager->GetPhaseVolumeNode(phaseIndex);
+    vtkImageData* image = volumeNode ? volumeNode->GetImageData() : nullptr;
+    if (!image || image->GetNumberOfScalarComponents() != 1)
+      {
+      vtkErrorMacro("UpdatePrefetchedPhases: Phase " << phaseManager->GetPhaseName(phaseIndex)
+        << " is not a scalar volume");
+      return false;
+      }
+    vtkNew<vtkMatrix4x4> rasToIJK;
+    volumeNode->GetRASToIJKMatrix(rasToIJK);
+    {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    phase.Image = image;
+    vtkMatrix4x4::DeepCopy(phase.RASToIJK, rasToIJK);
+    phase.Background = image->GetScalarRange()[0];
+    }
+    loaded = true;
+    }
+  if (loaded)
+    {
+    this->FramesInvalidated.notify_all();
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVICinePlayer::GetNextFrameToResample()
+{
+  // Frames are needed in playback order, starting after the current frame.
+  // Only the frames of the prefetched phases can be resampled.
+  const int numberOfFrames = static_cast<int>(this->Frames.size());
+  for (int offset = 1; offset <= numberOfFrames; ++offset)
+    {
+    const int frameIndex = (this->CurrentPhase + offset + numberOfFrames) % numberOfFrames;
+    const Frame& frame = this->Frames[frameIndex];
+    if (!frame.InProgress && this->Phases[frameIndex].Image
+        && (!frame.Image || frame.Geometry.Generation != this->Geometry.Generation))
+      {
+      return frameIndex;
+      }
+    }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICinePlayer::ResampleFrames()
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  while (true)
+    {
+    this->FramesInvalidated.wait(lock, [this]()
+      {
+      return !this->Playing || this->GetNextFrameToResample() >= 0;
+      });
+    if (!this->Playing)
+      {
+      return;
+      }
+    const int frameIndex = this->GetNextFrameToResample();
+    this->Frames[frameIndex].InProgress = true;
+    const FrameGeometry geometry = this->Geometry;
+    // The copy keeps the image of the phase while it is resampled, even if
+    // the main thread releases it meanwhile
+    const Phase phase = this->Phases[frameIndex];
+    lock.unlock();
+
+    const double startTime = vtkTimerLog::GetUniversalTime();
+    vtkSmartPointer<vtkImageData> image = vtkTAVICinePlayer::ResampleFrame(phase, geometry);
+    const double resampleTime = vtkTimerLog::GetUniversalTime() - startTime;
+
+    lock.lock();
+    Frame& frame = this->Frames[frameIndex];
+    frame.InProgress = false;
+    this->TotalResampleTime += resampleTime;
+    ++this->NumberOfResampledFrames;
+    // Discard the frame if the slice moved in the meantime, it is resampled again
+    if (geometry.Generation == this->Geometry.Generation)
+      {
+      frame.Image = image;
+      frame.Geometry = geometry;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> vtkTAVICinePlayer::ResampleFrame(const Phase& phase, const FrameGeometry& geometry)
+{
+  double xyToIJK[16];
+  vtkMatrix4x4::Multiply4x4(phase.RASToIJK, geometry.XYToRAS, xyToIJK);
+
+  const int dimensions[2] = { std::max(geometry.Dimensions[0], 1), std::max(geometry.Dimensions[1], 1) };
+  vtkSmartPointer<vtkImageData> frameImage = vtkSmartPointer<vtkImageData>::New();
+  frameImage->SetDimensions(dimensions[0], dimensions[1], 1);
+  frameImage->AllocateScalars(phase.Image->GetScalarType(), 1);
+  switch (phase.Image->GetScalarType())
+    {
+    vtkTemplateMacro(ResampleSlice<VTK_TT>(phase.Image, xyToIJK, dimensions, phase.Background,
+      static_cast<VTK_TT*>(frameImage->GetScalarPointer())));
+    }
+  return frameImage;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVICinePlayer::ShowNextFrame()
+{
+  if (!this->Playing)
+    {
+    return -1;
+    }
+  const double now = vtkTimerLog::GetUniversalTime();
+  if (this->LastFrameTime > 0.0)
+    {
+    const double interval = (now - this->LastFrameTime) * 1000.0;
+    this->SumOfFrameIntervals += interval;
+    this->SumOfSquaredFrameIntervals += interval * interval;
+    this->MaximumFrameInterval = std::max(this->MaximumFrameInterval, interval);
+    ++this->NumberOfFrameIntervals;
+    }
+  this->LastFrameTime = now;
+
+  int phaseIndex = -1;
+  vtkSmartPointer<vtkImageData> image;
+  FrameGeometry geometry;
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  const int nextPhase = (this->CurrentPhase + 1) % static_cast<int>(this->Frames.size());
+  const Frame& frame = this->Frames[nextPhase];
+  if (frame.Image && frame.Geometry.Generation == this->Geometry.Generation)
+    {
+    phaseIndex = nextPhase;
+    image = frame.Image;
+    geometry = frame.Geometry;
+    this->CurrentPhase = nextPhase;
+    }
+  }
+  if (phaseIndex < 0)
+    {
+    ++this->NumberOfDroppedFrames;
+    return -1;
+    }
+  if (!this->UpdatePrefetchedPhases())
+    {
+    this->Stop();
+    return -1;
+    }
+  // The slice shown is only resampled again by the slice view
+  vtkMRMLScalarVolumeNode* frameVolumeNode = this->FrameVolumeNode;
+  if (frameVolumeNode)
+    {
+    int wasModifying = frameVolumeNode->StartModify();
+    if (geometry.Generation != this->ShownGeneration)
+      {
+      vtkNew<vtkMatrix4x4> ijkToRAS;
+      ijkToRAS->DeepCopy(geometry.XYToRAS);
+      frameVolumeNode->SetIJKToRASMatrix(ijkToRAS);
+      this->ShownGeneration = geometry.Generation;
+      }
+    frameVolumeNode->SetAndObserveImageData(image);
+    frameVolumeNode->EndModify(wasModifying);
+    }
+  ++this->NumberOfShownFrames;
+  return phaseIndex;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVICinePlayer::GetNumberOfReadyFrames()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  int numberOfReadyFrames = 0;
+  for (const Frame& frame : this->Frames)
+    {
+    if (frame.Image && frame.Geometry.Generation == this->Geometry.Generation)
+      {
+      ++numberOfReadyFrames;
+      }
+    }
+  return numberOfReadyFrames;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICinePlayer::ResetFrameStatistics()
+{
+  this->NumberOfShownFrames = 0;
+  this->NumberOfDroppedFrames = 0;
+  this->LastFrameTime = 0.0;
+  this->SumOfFrameIntervals = 0.0;
+  this->SumOfSquaredFrameIntervals = 0.0;
+  this->MaximumFrameInterval = 0.0;
+  this->NumberOfFrameIntervals = 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVICinePlayer::GetNumberOfShownFrames()
+{
+  return this->NumberOfShownFrames;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVICinePlayer::GetNumberOfDroppedFrames()
+{
+  return this->NumberOfDroppedFrames;
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVICinePlayer::GetMeanFrameInterval()
+{
+  return this->NumberOfFrameIntervals > 0 ? this->SumOfFrameIntervals / this->NumberOfFrameIntervals : 0.0;
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVICinePlayer::GetFrameIntervalStandardDeviation()
+{
+  if (this->NumberOfFrameIntervals == 0)
+    {
+    return 0.0;
+    }
+  const double mean = this->GetMeanFrameInterval();
+  const double variance = this->SumOfSquaredFrameIntervals / this->NumberOfFrameIntervals - mean * mean;
+  return std::sqrt(std::max(variance, 0.0));
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVICinePlayer::GetMaximumFrameInterval()
+{
+  return this->MaximumFrameInterval;
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVICinePlayer::GetMeanResampleTime()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->NumberOfResampledFrames > 0 ?
+    this->TotalResampleTime * 1000.0 / this->NumberOfResampledFrames : 0.0;
+}
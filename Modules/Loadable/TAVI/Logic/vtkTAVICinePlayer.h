@@ -0,0 +1,208 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVICinePlayer_h
+#define __vtkTAVICinePlayer_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkCallbackCommand;
+class vtkImageData;
+class vtkMRMLScalarVolumeNode;
+class vtkMRMLSliceNode;
+class vtkTAVIPhaseManager;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Cine playback of the phases of a 4D cardiac series in a slice view.
+///
+/// Reslicing a full volume for each frame is too slow for a steady frame
+/// rate. Instead, the current slice of every phase is resampled by background
+/// threads into a ring buffer of 2D frames, and showing a frame only swaps
+/// the image of a single-slice volume node (see GetFrameVolumeNode()) that
+/// lies in the slice plane.
+///
+/// When the slice node is moved or rotated, frames are invalidated and
+/// resampled again starting from the frame being shown, so that playback
+/// resumes as soon as the next frames are ready. Frames that are not ready
+/// in time are dropped: the previous frame stays displayed.
+///
+/// Playback is driven by the caller, typically a timer calling ShowNextFrame()
+/// at FrameRate. Only the NumberOfPrefetchedPhases phases after the frame
+/// being shown are loaded and pinned in the phase manager, so that playing a
+/// long series stays within its memory budget: the phases left behind are
+/// unpinned and unloaded by the phase manager as needed. Their frames are
+/// kept, and resampled again when they come back ahead of the playback if
+/// the slice moved meanwhile.
+///
+/// Example:
+/// \code{.py}
+/// player = slicer.modules.tavi.logic().GetCinePlayer()
+/// player.SetSliceNode(slicer.app.layoutManager().sliceWidget("Red").mrmlSliceNode())
+/// player.Start()
+/// slicer.util.setSliceViewerLayers(background=player.GetFrameVolumeNode())
+/// timer = qt.QTimer()
+/// timer.connect("timeout()", player.ShowNextFrame)
+/// timer.start(1000 / player.GetFrameRate())
+/// \endcode
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkTAVICinePlayer : public vtkObject
+{
+public:
+  static vtkTAVICinePlayer* New();
+  vtkTypeMacro(vtkTAVICinePlayer, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Phases played, in order. Their scene is used for the frame volume node.
+  void SetPhaseManager(vtkTAVIPhaseManager* phaseManager);
+  vtkTAVIPhaseManager* GetPhaseManager();
+
+  /// Slice whose geometry is resampled.
+  void SetSliceNode(vtkMRMLSliceNode* sliceNode);
+  vtkMRMLSliceNode* GetSliceNode();
+
+  /// Number of frames shown per second, for the caller driving the playback.
+  vtkSetClampMacro(FrameRate, double, 1.0, 60.0);
+  vtkGetMacro(FrameRate, double);
+
+  /// Number of background resampling threads. 0 means one less than the
+  /// number of cores.
+  vtkSetClampMacro(NumberOfThreads, int, 0, 64);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Number of phases ahead of the playback that are loaded and pinned.
+  vtkSetClampMacro(NumberOfPrefetchedPhases, int, 1, 64);
+  vtkGetMacro(NumberOfPrefetchedPhases, int);
+
+  /// Load and pin the first phases, then start resampling them.
+  /// Return false if there are no phases, no slice node, or if a phase
+  /// could not be loaded.
+  bool Start();
+  /// Stop resampling, release the frames and the phases.
+  void Stop();
+  bool IsPlaying();
+
+  /// Show the frame of the next phase if it is ready.
+  /// Return the phase shown, or -1 if the frame was dropped.
+  int ShowNextFrame();
+  /// Phase of the frame currently shown, -1 if none.
+  int GetCurrentPhase();
+
+  /// Single-slice volume node showing the current frame.
+  /// It is created by Start() and removed by Stop().
+  vtkMRMLScalarVolumeNode* GetFrameVolumeNode();
+
+  /// Number of frames resampled for the current slice geometry.
+  int GetNumberOfReadyFrames();
+
+  /// Frame statistics, since Start() or ResetFrameStatistics().
+  /// Intervals are measured between ShowNextFrame() calls, in ms.
+  void ResetFrameStatistics();
+  int GetNumberOfShownFrames();
+  int GetNumberOfDroppedFrames();
+  double GetMeanFrameInterval();
+  double GetFrameIntervalStandardDeviation();
+  double GetMaximumFrameInterval();
+  /// Mean time to resample one frame in a background thread, in ms.
+  double GetMeanResampleTime();
+
+protected:
+  vtkTAVICinePlayer();
+  ~vtkTAVICinePlayer() override;
+
+  /// Geometry of the frames: dimensions of the slice and its XY to RAS matrix.
+  struct FrameGeometry
+  {
+    int Dimensions[2];
+    double XYToRAS[16];
+    int Generation;
+  };
+
+  struct Phase
+  {
+    vtkSmartPointer<vtkImageData> Image;
+    double RASToIJK[16];
+    double Background;
+    bool WasPinned;
+    bool Pinned; // by the player, while the phase is prefetched
+  };
+
+  struct Frame
+  {
+    vtkSmartPointer<vtkImageData> Image;
+    FrameGeometry Geometry;
+    bool InProgress;
+  };
+
+  static void OnSliceNodeModified(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+  /// Invalidate the frames if the slice geometry changed.
+  void UpdateFrameGeometry();
+  /// Load and pin the phases of the next NumberOfPrefetchedPhases frames,
+  /// release and unpin the others. Return false if a phase could not be loaded.
+  bool UpdatePrefetchedPhases();
+
+  /// Resampling thread: resample invalid frames, closest to the current phase first.
+  void ResampleFrames();
+  /// Index of the next frame to resample, -1 if all frames are valid or in progress.
+  /// Must be called with the mutex locked.
+  int GetNextFrameToResample();
+  static vtkSmartPointer<vtkImageData> ResampleFrame(const Phase& phase, const FrameGeometry& geometry);
+
+  vtkWeakPointer<vtkTAVIPhaseManager> PhaseManager;
+  vtkWeakPointer<vtkMRMLSliceNode> SliceNode;
+  vtkSmartPointer<vtkCallbackCommand> SliceNodeCallback;
+  vtkWeakPointer<vtkMRMLScalarVolumeNode> FrameVolumeNode;
+  double FrameRate;
+  int NumberOfThreads;
+  int NumberOfPrefetchedPhases;
+
+  // Threads are only modified by Start() and Stop()
+  std::vector<std::thread> Threads;
+
+  // Shared with the resampling threads
+  std::mutex Mutex;
+  std::vector<Phase> Phases; // resized by Start() and Stop() only
+  std::condition_variable FramesInvalidated;
+  bool Playing;
+  FrameGeometry Geometry;
+  std::vector<Frame> Frames;
+  int CurrentPhase;
+  double TotalResampleTime;
+  int NumberOfResampledFrames;
+
+  // Only used by the main thread
+  int ShownGeneration;
+  int NumberOfShownFrames;
+  int NumberOfDroppedFrames;
+  double LastFrameTime;
+  double SumOfFrameIntervals;
+  double SumOfSquaredFrameIntervals;
+  double MaximumFrameInterval;
+  int NumberOfFrameIntervals;
+
+private:
+  vtkTAVICinePlayer(const vtkTAVICinePlayer&) = delete;
+  void operator=(const vtkTAVICinePlayer&) = delete;
+};
+
+#endif
@@ -0,0 +1,901 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkTAVICurvedPlanarReformation.h"
+#include "vtkTAVIImageSampling.h"
+
+// MRML includes
+#include <vtkMRMLMarkupsCurveNode.h>
+#include <vtkMRMLScalarVolumeDisplayNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLTableNode.h>
+#include <vtkMRMLTransformNode.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkDoubleArray.h>
+#include <vtkGeneralTransform.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+#include <vtkTable.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTAVICurvedPlanarReformation);
+
+namespace
+{
+
+using vtkTAVIImageSampling::InterpolateTrilinear;
+using vtkTAVIImageSampling::RoundToScalar;
+
+//----------------------------------------------------------------------------
+/// Cross-section to resample: pixel to continuous index matrix and output.
+struct SliceJob
+{
+  double XYToIJK[16];
+  void* Output;
+};
+
+//----------------------------------------------------------------------------
+/// Offset and weights of the pixels of a row, per thread.
+struct RowSamples
+{
+  std::vector<vtkIdType> Offsets;
+  std::vector<double> Weights[3];
+  std::vector<unsigned char> Inside;
+};
+
+//----------------------------------------------------------------------------
+/// Trilinear resampling of cross-sections, one row at a time: the continuous
+/// indices of a row are computed without branches, which lets the compiler
+/// vectorize the loop, then the voxels are gathered and blended.
+template <class T>
+class ResampleSlicesFunctor
+{
+public:
+  ResampleSlicesFunctor(vtkImageData* input, const std::vector<SliceJob>& jobs, int size, double background)
+    : Input(static_cast<const T*>(input->GetScalarPointer()))
+    , Jobs(jobs)
+    , Size(size)
+    , Background(RoundToScalar<T>(background))
+    {
+    int extent[6];
+    input->GetExtent(extent);
+    input->GetIncrements(this->Increments);
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      this->ExtentOrigin[axis] = extent[2 * axis];
+      this->Maximum[axis] = static_cast<double>(extent[2 * axis + 1] - extent[2 * axis]);
+      // Last index of the lower corner of the interpolation cell
+      this->LastIndex[axis] = std::max(0, extent[2 * axis + 1] - extent[2 * axis] - 1);
+      // Single-slice axes are not interpolated
+      this->Steps[axis] = this->Maximum[axis] > 0.0 ? this->Increments[axis] : 0;
+      }
+    }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    RowSamples& samples = this->Samples.Local();
+    samples.Offsets.resize(this->Size);
+    samples.Inside.resize(this->Size);
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      samples.Weights[axis].resize(this->Size);
+      }
+    for (vtkIdType jobIndex = begin; jobIndex < end; ++jobIndex)
+      {
+      this->ResampleSlice(this->Jobs[jobIndex], samples);
+      }
+    }
+
+  void ResampleSlice(const SliceJob& job, RowSamples& samples)
+    {
+    const double* m = job.XYToIJK;
+    T* output = static_cast<T*>(job.Output);
+    vtkIdType* offsets = samples.Offsets.data();
+    unsigned char* inside = samples.Inside.data();
+    double* weightI = samples.Weights[0].data();
+    double* weightJ = samples.Weights[1].data();
+    double* weightK = samples.Weights[2].data();
+    for (int y = 0; y < this->Size; ++y)
+      {
+      const double rowOrigin[3] = {
+        m[1] * y + m[3] - this->ExtentOrigin[0],
+        m[5] * y + m[7] - this->ExtentOrigin[1],
+        m[9] * y + m[11] - this->ExtentOrigin[2] };
+      for (int x = 0; x < this->Size; ++x)
+        {
+        const double i = rowOrigin[0] + m[0] * x;
+        const double j = rowOrigin[1] + m[4] * x;
+        const double k = rowOrigin[2] + m[8] * x;
+        inside[x] = (i >= 0.0) & (i <= this->Maximum[0]) & (j >= 0.0) & (j <= this->Maximum[1])
+          & (k >= 0.0) & (k <= this->Maximum[2]);
+        const int i0 = std::min(static_cast<int>(std::max(i, 0.0)), this->LastIndex[0]);
+        const int j0 = std::min(static_cast<int>(std::max(j, 0.0)), this->LastIndex[1]);
+        const int k0 = std::min(static_cast<int>(std::max(k, 0.0)), this->LastIndex[2]);
+        weightI[x] = i - i0;
+        weightJ[x] = j - j0;
+        weightK[x] = k - k0;
+        offsets[x] = i0 * this->Increments[0] + j0 * this->Increments[1] + k0 * this->Increments[2];
+        }
+      const vtkIdType* step = this->Steps;
+      for (int x = 0; x < this->Size; ++x)
+        {
+        if (!inside[x])
+          {
+          *output++ = this->Background;
+          continue;
+          }
+        const double weight[3] = { weightI[x], weightJ[x], weightK[x] };
+        *output++ = RoundToScalar<T>(InterpolateTrilinear(this->Input + offsets[x], step, weight));
+        }
+      }
+    }
+
+private:
+  const T* Input;
+  const std::vector<SliceJob>& Jobs;
+  int Size;
+  T Background;
+  int ExtentOrigin[3];
+  double Maximum[3];
+  int LastIndex[3];
+  vtkIdType Increments[3];
+  vtkIdType Steps[3];
+  vtkSMPThreadLocal<RowSamples> Samples;
+};
+
+//----------------------------------------------------------------------------
+template <class T>
+void ResampleSlices(vtkImageData* input, const std::vector<SliceJob>& jobs, int size, double background)
+{
+  ResampleSlicesFunctor<T> functor(input, jobs, size, background);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(jobs.size()), functor);
+}
+
+//----------------------------------------------------------------------------
+/// Cross-section to measure: resampled pixels and minimum and maximum lumen diameters.
+struct LumenJob
+{
+  const void* Image;
+  double* Diameters;
+};
+
+//----------------------------------------------------------------------------
+/// Diameters of the lumen through the center of the cross-sections, from
+/// the length of rays cast from the center to the first sample below the
+/// threshold, as vtkAorticAnnulusMeasurement does in the annulus plane.
+template <class T>
+class MeasureLumenFunctor
+{
+public:
+  MeasureLumenFunctor(const std::vector<LumenJob>& jobs, int size, double spacing, double threshold)
+    : Jobs(jobs)
+    , Size(size)
+    , Spacing(spacing)
+    , Threshold(threshold)
+    {
+    }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType jobIndex = begin; jobIndex < end; ++jobIndex)
+      {
+      this->Measure(this->Jobs[jobIndex]);
+      }
+    }
+
+  /// Bilinear interpolation of \a image at pixel (\a x, \a y), inside the cross-section.
+  double Sample(const T* image, double x, double y) const
+    {
+    const int last = std::max(0, this->Size - 2);
+    const int x0 = std::min(static_cast<int>(x), last);
+    const int y0 = std::min(static_cast<int>(y), last);
+    const int dx = this->Size > 1 ? 1 : 0;
+    const int dy = this->Size > 1 ? this->Size : 0;
+    const T* p = image + y0 * this->Size + x0;
+    const double wx = x - x0;
+    const double wy = y - y0;
+    const double c0 = p[0] + wx * (p[dx] - p[0]);
+    const double c1 = p[dy] + wx * (p[dy + dx] - p[dy]);
+    return c0 + wy * (c1 - c0);
+    }
+
+  void Measure(const LumenJob& job) const
+    {
+    const T* image = static_cast<const T*>(job.Image);
+    const double center = 0.5 * (this->Size - 1);
+    job.Diameters[0] = 0.0;
+    job.Diameters[1] = 0.0;
+    if (this->Sample(image, center, center) < this->Threshold)
+      {
+      // The centerline is outside the lumen
+      return;
+      }
+    // Rays that leave the cross-section are clipped to its border
+    const double step = 0.5;
+    double radii[NumberOfRays];
+    for (int ray = 0; ray < NumberOfRays; ++ray)
+      {
+      const double angle = 2.0 * vtkMath::Pi() * ray / NumberOfRays;
+      const double direction[2] = { std::cos(angle), std::sin(angle) };
+      double radius = 0.0;
+      for (double t = step; t <= center; t += step)
+        {
+        if (this->Sample(image, center + t * direction[0], center + t * direction[1]) < this->Threshold)
+          {
+          break;
+          }
+        radius = t;
+        }
+      radii[ray] = radius * this->Spacing;
+      }
+    job.Diameters[0] = std::numeric_limits<double>::max();
+    for (int ray = 0; ray < NumberOfRays / 2; ++ray)
+      {
+      const double diameter = radii[ray] + radii[ray + NumberOfRays / 2];
+      job.Diameters[0] = std::min(job.Diameters[0], diameter);
+      job.Diameters[1] = std::max(job.Diameters[1], diameter);
+      }
+    }
+
+private:
+  enum
+  {
+    NumberOfRays = 72
+  };
+  const std::vector<LumenJob>& Jobs;
+  int Size;
+  double Spacing;
+  double Threshold;
+};
+
+//----------------------------------------------------------------------------
+template <class T>
+void MeasureLumen(const std::vector<LumenJob>& jobs, int size, double spacing, double threshold)
+{
+  MeasureLumenFunctor<T> functor(jobs, size, spacing, threshold);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(jobs.size()), functor);
+}
+
+//----------------------------------------------------------------------------
+/// Point at arc length \a s of a polyline of cumulative lengths \a lengths.
+void PointAtLength(const std::vector<double>& points, const std::vector<double>& lengths, double s,
+  double point[3])
+{
+  if (lengths.size() < 2)
+    {
+    std::copy(points.begin(), points.begin() + 3, point);
+    return;
+    }
+  const size_t last = lengths.size() - 1;
+  size_t index = std::upper_bound(lengths.begin(), lengths.end(), s) - lengths.begin();
+  index = std::min(std::max<size_t>(index, 1), last);
+  const double segmentLength = lengths[index] - lengths[index - 1];
+  const double t = segmentLength > 0.0 ? std::min(std::max((s - lengths[index - 1]) / segmentLength, 0.0), 1.0) : 0.0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    point[axis] = points[3 * (index - 1) + axis] + t * (points[3 * index + axis] - points[3 * (index - 1) + axis]);
+    }
+}
+
+//----------------------------------------------------------------------------
+/// First axis of the cross-section at \a center of tangent \a tangent, transported
+/// from the cross-section at \a previousCenter along a rotation minimizing frame by
+/// the double reflection method (Wang et al., ACM Transactions on Graphics 27(1), 2008).
+/// The result is in the plane of the cross-section, not normalized.
+void TransportAxis(const double previousCenter[3], const double previousAxis0[3],
+  const double previousTangent[3], const double center[3], const double tangent[3], double axis0[3])
+{
+  double v1[3];
+  vtkMath::Subtract(center, previousCenter, v1);
+  const double c1 = vtkMath::Dot(v1, v1);
+  double reflectedAxis[3] = { previousAxis0[0], previousAxis0[1], previousAxis0[2] };
+  double reflectedTangent[3] = { previousTangent[0], previousTangent[1], previousTangent[2] };
+  if (c1 > 0.0)
+    {
+    const double axisFactor = 2.0 / c1 * vtkMath::Dot(v1, previousAxis0);
+    const double tangentFactor = 2.0 / c1 * vtkMath::Dot(v1, previousTangent);
+    for (int component = 0; component < 3; ++component)
+      {
+      reflectedAxis[component] -= axisFactor * v1[component];
+      reflectedTangent[component] -= tangentFactor * v1[component];
+      }
+    }
+  double v2[3];
+  vtkMath::Subtract(tangent, reflectedTangent, v2);
+  const double c2 = vtkMath::Dot(v2, v2);
+  const double axisFactor = c2 > 0.0 ? 2.0 / c2 * vtkMath::Dot(v2, reflectedAxis) : 0.0;
+  for (int component = 0; component < 3; ++component)
+    {
+    axis0[component] = reflectedAxis[component] - axisFactor * v2[component];
+    }
+  // Remove the numerical drift from the plane of the cross-section
+  const double drift = vtkMath::Dot(axis0, tangent);
+  for (int component = 0; component < 3; ++component)
+    {
+    axis0[component] -= drift * tangent[component];
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkTAVICurvedPlanarReformation::vtkTAVICurvedPlanarReformation()
+  : SliceSize(40.0)
+  , Spacing(0.5)
+  , LumenThreshold(200.0)
+  , AutoUpdate(false)
+  , Updating(false)
+  , CachedImageTime(0)
+  , CachedSliceSize(0.0)
+  , CachedSpacing(0.0)
+  , CachedLumenThreshold(0.0)
+  , NumberOfUpdatedSegments(0)
+  , UpdateTime(0.0)
+{
+  this->NodeCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->NodeCallback->SetCallback(vtkTAVICurvedPlanarReformation::OnNodeModified);
+  this->NodeCallback->SetClientData(this);
+  vtkMatrix4x4::Identity(this->CachedWorldToIJK);
+}
+
+//----------------------------------------------------------------------------
+vtkTAVICurvedPlanarReformation::~vtkTAVICurvedPlanarReformation()
+{
+  this->AutoUpdate = false;
+  this->UpdateObservers();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICurvedPlanarReformation::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "SliceSize: " << this->SliceSize << "\n";
+  os << indent << "Spacing: " << this->Spacing << "\n";
+  os << indent << "LumenThreshold: " << this->LumenThreshold << "\n";
+  os << indent << "AutoUpdate: " << this->AutoUpdate << "\n";
+  os << indent << "NumberOfSegments: " << this->Segments.size() << "\n";
+  os << indent << "NumberOfUpdatedSegments: " << this->NumberOfUpdatedSegments << "\n";
+  os << indent << "UpdateTime: " << this->UpdateTime << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICurvedPlanarReformation::SetInputVolumeNode(vtkMRMLScalarVolumeNode* volumeNode)
+{
+  if (this->InputVolumeNode == volumeNode)
+    {
+    return;
+    }
+  if (this->InputVolumeNode)
+    {
+    this->InputVolumeNode->RemoveObserver(this->NodeCallback);
+    }
+  this->InputVolumeNode = volumeNode;
+  this->ClearCache();
+  this->UpdateObservers();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkTAVICurvedPlanarReformation::GetInputVolumeNode()
+{
+  return this->InputVolumeNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICurvedPlanarReformation::SetCurveNode(vtkMRMLMarkupsCurveNode* curveNode)
+{
+  if (this->CurveNode == curveNode)
+    {
+    return;
+    }
+  if (this->CurveNode)
+    {
+    this->CurveNode->RemoveObserver(this->NodeCallback);
+    }
+  this->CurveNode = curveNode;
+  this->ClearCache();
+  this->UpdateObservers();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLMarkupsCurveNode* vtkTAVICurvedPlanarReformation::GetCurveNode()
+{
+  return this->CurveNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICurvedPlanarReformation::SetOutputVolumeNode(vtkMRMLScalarVolumeNode* volumeNode)
+{
+  if (this->OutputVolumeNode == volumeNode)
+    {
+    return;
+    }
+  this->OutputVolumeNode = volumeNode;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkTAVICurvedPlanarReformation::GetOutputVolumeNode()
+{
+  return this->OutputVolumeNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICurvedPlanarReformation::SetLumenTableNode(vtkMRMLTableNode* tableNode)
+{
+  if (this->LumenTableNode == tableNode)
+    {
+    return;
+    }
+  this->LumenTableNode = tableNode;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLTableNode* vtkTAVICurvedPlanarReformation::GetLumenTableNode()
+{
+  return this->LumenTableNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICurvedPlanarReformation::SetAutoUpdate(bool autoUpdate)
+{
+  if (this->AutoUpdate == autoUpdate)
+    {
+    return;
+    }
+  this->AutoUpdate = autoUpdate;
+  this->UpdateObservers();
+  this->Modified();
+  if (autoUpdate)
+    {
+    this->Update();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICurvedPlanarReformation::UpdateObservers()
+{
+  if (this->CurveNode)
+    {
+    this->CurveNode->RemoveObserver(this->NodeCallback);
+    }
+  if (this->InputVolumeNode)
+    {
+    this->InputVolumeNode->RemoveObserver(this->NodeCallback);
+    }
+  if (!this->AutoUpdate)
+    {
+    return;
+    }
+  if (this->CurveNode)
+    {
+    this->CurveNode->AddObserver(vtkMRMLMarkupsNode::PointModifiedEvent, this->NodeCallback);
+    this->CurveNode->AddObserver(vtkMRMLMarkupsNode::PointAddedEvent, this->NodeCallback);
+    this->CurveNode->AddObserver(vtkMRMLMarkupsNode::PointRemovedEvent, this->NodeCallback);
+    this->CurveNode->AddObserver(vtkMRMLTransformableNode::TransformModifiedEvent, this->NodeCallback);
+    }
+  if (this->InputVolumeNode)
+    {
+    this->InputVolumeNode->AddObserver(vtkMRMLVolumeNode::ImageDataModifiedEvent, this->NodeCallback);
+    this->InputVolumeNode->AddObserver(vtkMRMLTransformableNode::TransformModifiedEvent, this->NodeCallback);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICurvedPlanarReformation::OnNodeModified(vtkObject* vtkNotUsed(caller),
+  unsigned long vtkNotUsed(eid), void* clientData, void* vtkNotUsed(callData))
+{
+  vtkTAVICurvedPlanarReformation* self = static_cast<vtkTAVICurvedPlanarReformation*>(clientData);
+  self->Update();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICurvedPlanarReformation::ClearCache()
+{
+  this->Segments.clear();
+  this->CachedImage = nullptr;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVICurvedPlanarReformation::GetNumberOfSegments()
+{
+  return static_cast<int>(this->Segments.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICurvedPlanarReformation::ComputeSlicePlanes(Segment& segment, std::vector<double>& planes)
+{
+  const std::vector<double>& points = segment.CurvePoints;
+  const size_t numberOfPoints = points.size() / 3;
+  std::vector<double> lengths(numberOfPoints, 0.0);
+  for (size_t pointIndex = 1; pointIndex < numberOfPoints; ++pointIndex)
+    {
+    lengths[pointIndex] = lengths[pointIndex - 1]
+      + std::sqrt(vtkMath::Distance2BetweenPoints(&points[3 * (pointIndex - 1)], &points[3 * pointIndex]));
+    }
+  const double length = lengths.back();
+  const double h = this->Spacing;
+  // Cross-sections every h from the first point, the end point being the
+  // first point of the next segment. At least one cross-section.
+  const int numberOfSlices = segment.IncludesEnd ?
+    1 + static_cast<int>(std::floor(length / h + 1e-6)) :
+    std::max(1, static_cast<int>(std::ceil(length / h - 1e-6)));
+  segment.Length = length;
+  segment.SliceDistances.resize(numberOfSlices);
+
+  // Tangent, from the points of the segment only
+  const double anterior[3] = { 0.0, 1.0, 0.0 };
+  const double superior[3] = { 0.0, 0.0, 1.0 };
+  auto tangentAt = [&](double s, double tangent[3])
+    {
+    double before[3];
+    double after[3];
+    PointAtLength(points, lengths, std::max(s - h, 0.0), before);
+    PointAtLength(points, lengths, std::min(s + h, length), after);
+    vtkMath::Subtract(after, before, tangent);
+    if (vtkMath::Normalize(tangent) == 0.0)
+      {
+      vtkMath::Subtract(&points[3 * (numberOfPoints - 1)], &points[0], tangent);
+      if (vtkMath::Normalize(tangent) == 0.0)
+        {
+        std::copy(superior, superior + 3, tangent);
+        }
+      }
+    };
+
+  planes.resize(9 * static_cast<size_t>(numberOfSlices));
+  for (int slice = 0; slice < numberOfSlices; ++slice)
+    {
+    const double s = std::min(slice * h, length);
+    segment.SliceDistances[slice] = s;
+    double* center = &planes[9 * slice];
+    double* axis0 = center + 3;
+    double* axis1 = center + 6;
+    PointAtLength(points, lengths, s, center);
+    double tangent[3];
+    tangentAt(s, tangent);
+
+    if (slice > 0)
+      {
+      // Rotation minimizing frame: the first axis of the previous cross-section
+      // is transported along the curve
+      double previousTangent[3];
+      vtkMath::Cross(center - 6, center - 3, previousTangent);
+      TransportAxis(center - 9, center - 6, previousTangent, center, tangent, axis0);
+      }
+    else
+      {
+      // First axis transported from the end of the previous segment, brought
+      // into the plane of the cross-section
+      const double drift = vtkMath::Dot(segment.IncomingAxis, tangent);
+      for (int component = 0; component < 3; ++component)
+        {
+        axis0[component] = segment.IncomingAxis[component] - drift * tangent[component];
+        }
+      }
+    if (vtkMath::Normalize(axis0) == 0.0)
+      {
+      // First axis of the curve (or after a degenerate transport) perpendicular
+      // to the anterior direction, or to the superior direction where the curve
+      // runs antero-posteriorly
+      const double* reference = std::fabs(vtkMath::Dot(tangent, anterior)) < 0.9 ? anterior : superior;
+      vtkMath::Cross(reference, tangent, axis0);
+      vtkMath::Normalize(axis0);
+      }
+    vtkMath::Cross(tangent, axis0, axis1);
+    }
+
+  // Frame at the end point, carried into the next segment
+  const double* lastCenter = &planes[9 * (numberOfSlices - 1)];
+  double lastTangent[3];
+  vtkMath::Cross(lastCenter + 3, lastCenter + 6, lastTangent);
+  double endTangent[3];
+  tangentAt(length, endTangent);
+  TransportAxis(lastCenter, lastCenter + 3, lastTangent, &points[3 * (numberOfPoints - 1)], endTangent,
+    segment.EndAxis);
+  if (vtkMath::Normalize(segment.EndAxis) == 0.0)
+    {
+    std::copy(lastCenter + 3, lastCenter + 6, segment.EndAxis);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVICurvedPlanarReformation::WriteLumenTable(vtkMRMLTableNode* tableNode)
+{
+  vtkNew<vtkDoubleArray> distanceColumn;
+  distanceColumn->SetName("Distance");
+  vtkNew<vtkDoubleArray> minimumColumn;
+  minimumColumn->SetName("Minimum diameter");
+  vtkNew<vtkDoubleArray> maximumColumn;
+  maximumColumn->SetName("Maximum diameter");
+  double segmentStart = 0.0;
+  for (const Segment& segment : this->Segments)
+    {
+    for (size_t slice = 0; slice < segment.SliceDistances.size(); ++slice)
+      {
+      distanceColumn->InsertNextValue(segmentStart + segment.SliceDistances[slice]);
+      minimumColumn->InsertNextValue(segment.Diameters[2 * slice]);
+      maximumColumn->InsertNextValue(segment.Diameters[2 * slice + 1]);
+      }
+    segmentStart += segment.Length;
+    }
+
+  vtkNew<vtkTable> table;
+  table->AddColumn(distanceColumn);
+  table->AddColumn(minimumColumn);
+  table->AddColumn(maximumColumn);
+
+  int wasModifying = tableNode->StartModify();
+  tableNode->SetAndObserveTable(table);
+  tableNode->SetUseColumnNameAsColumnHeader(true);
+  tableNode->SetColumnUnitLabel("Distance", "mm");
+  tableNode->SetColumnUnitLabel("Minimum diameter", "mm");
+  tableNode->SetColumnUnitLabel("Maximum diameter", "mm");
+  tableNode->SetLocked(true);
+  tableNode->EndModify(wasModifying);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVICurvedPlanarReformation::Update()
+{
+  vtkMRMLScalarVolumeNode* inputVolumeNode = this->InputVolumeNode;
+  vtkMRMLMarkupsCurveNode* curveNode = this->CurveNode;
+  vtkMRMLScalarVolumeNode* outputVolumeNode = this->OutputVolumeNode;
+  vtkImageData* inputImage = inputVolumeNode ? inputVolumeNode->GetImageData() : nullptr;
+  if (!inputImage || !inputImage->GetPointData()->GetScalars() || !curveNode
+      || curveNode->GetNumberOfControlPoints() < 2 || !outputVolumeNode || outputVolumeNode == inputVolumeNode)
+    {
+    return false;
+    }
+  if (this->Updating)
+    {
+    return false;
+    }
+  this->Updating = true;
+  const double startTime = vtkTimerLog::GetUniversalTime();
+
+  // Cross-sections are resampled again if the input, its transforms or their
+  // size changed. The curve points are in world coordinates.
+  vtkNew<vtkGeneralTransform> worldToRAS;
+  vtkMRMLTransformNode::GetTransformBetweenNodes(nullptr, inputVolumeNode->GetParentTransformNode(), worldToRAS);
+  vtkNew<vtkTransform> worldToRASLinear;
+  if (!vtkMRMLTransformNode::IsGeneralTransformLinear(worldToRAS, worldToRASLinear))
+    {
+    vtkErrorMacro("Update: The input volume is under a non-linear transform, harden it first");
+    this->Updating = false;
+    return false;
+    }
+  vtkNew<vtkMatrix4x4> rasToIJKMatrix;
+  inputVolumeNode->GetRASToIJKMatrix(rasToIJKMatrix);
+  vtkNew<vtkMatrix4x4> worldToIJKMatrix;
+  vtkMatrix4x4::Multiply4x4(rasToIJKMatrix, worldToRASLinear->GetMatrix(), worldToIJKMatrix);
+  double worldToIJK[16];
+  vtkMatrix4x4::DeepCopy(worldToIJK, worldToIJKMatrix);
+  if (this->CachedImage != inputImage || this->CachedImageTime != inputImage->GetMTime()
+      || !std::equal(worldToIJK, worldToIJK + 16, this->CachedWorldToIJK)
+      || this->CachedSliceSize != this->SliceSize || this->CachedSpacing != this->Spacing)
+    {
+    this->ClearCache();
+    this->CachedImage = inputImage;
+    this->CachedImageTime = inputImage->GetMTime();
+    std::copy(worldToIJK, worldToIJK + 16, this->CachedWorldToIJK);
+    this->CachedSliceSize = this->SliceSize;
+    this->CachedSpacing = this->Spacing;
+    }
+  if (this->CachedLumenThreshold != this->LumenThreshold)
+    {
+    for (Segment& cachedSegment : this->Segments)
+      {
+      cachedSegment.Diameters.clear();
+      }
+    this->CachedLumenThreshold = this->LumenThreshold;
+    }
+  const double h = this->Spacing;
+  const int size = std::max(1, static_cast<int>(std::floor(this->SliceSize / h + 0.5)));
+  const int scalarType = inputImage->GetScalarType();
+  const vtkIdType sliceBytes = static_cast<vtkIdType>(size) * size * inputImage->GetScalarSize();
+
+  // Segments between consecutive control points, reused if their points did not move
+  vtkPoints* curvePoints = curveNode->GetCurvePointsWorld();
+  const int numberOfSegments = curveNode->GetNumberOfControlPoints() - 1;
+  std::vector<Segment> segments(numberOfSegments);
+  std::vector<SliceJob> jobs;
+  std::vector<double> planes;
+  this->NumberOfUpdatedSegments = 0;
+  for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
+    {
+    Segment& segment = segments[segmentIndex];
+    const int begin = curveNode->GetCurvePointIndexFromControlPointIndex(segmentIndex);
+    const int end = curveNode->GetCurvePointIndexFromControlPointIndex(segmentIndex + 1);
+    if (!curvePoints || begin < 0 || end < begin || end >= curvePoints->GetNumberOfPoints())
+      {
+      vtkErrorMacro("Update: Invalid curve points of " << (curveNode->GetName() ? curveNode->GetName() : ""));
+      this->Updating = false;
+      return false;
+      }
+    segment.CurvePoints.resize(3 * static_cast<size_t>(end - begin + 1));
+    for (int pointIndex = begin; pointIndex <= end; ++pointIndex)
+      {
+      curvePoints->GetPoint(pointIndex, &segment.CurvePoints[3 * (pointIndex - begin)]);
+      }
+    segment.IncludesEnd = segmentIndex == numberOfSegments - 1;
+    if (segmentIndex > 0)
+      {
+      std::copy(segments[segmentIndex - 1].EndAxis, segments[segmentIndex - 1].EndAxis + 3, segment.IncomingAxis);
+      }
+    for (const Segment& cachedSegment : this->Segments)
+      {
+      if (cachedSegment.Image && cachedSegment.IncludesEnd == segment.IncludesEnd
+          && cachedSegment.CurvePoints == segment.CurvePoints
+          && std::equal(cachedSegment.IncomingAxis, cachedSegment.IncomingAxis + 3, segment.IncomingAxis))
+        {
+        segment = cachedSegment;
+        break;
+        }
+      }
+    if (segment.Image)
+      {
+      continue;
+      }
+
+    this->ComputeSlicePlanes(segment, planes);
+    const int numberOfSlices = static_cast<int>(planes.size() / 9);
+    segment.Image = vtkSmartPointer<vtkImageData>::New();
+    segment.Image->SetDimensions(size, size, numberOfSlices);
+    segment.Image->AllocateScalars(scalarType, 1);
+    char* scalars = static_cast<char*>(segment.Image->GetScalarPointer());
+    for (int slice = 0; slice < numberOfSlices; ++slice)
+      {
+      const double* center = &planes[9 * slice];
+      const double* axis0 = center + 3;
+      const double* axis1 = center + 6;
+      const double halfWidth = 0.5 * (size - 1) * h;
+      double xyToWorld[16];
+      vtkMatrix4x4::Identity(xyToWorld);
+      for (int row = 0; row < 3; ++row)
+        {
+        xyToWorld[4 * row] = axis0[row] * h;
+        xyToWorld[4 * row + 1] = axis1[row] * h;
+        xyToWorld[4 * row + 3] = center[row] - halfWidth * (axis0[row] + axis1[row]);
+        }
+      SliceJob job;
+      vtkMatrix4x4::Multiply4x4(worldToIJK, xyToWorld, job.XYToIJK);
+      job.Output = scalars + slice * sliceBytes;
+      jobs.push_back(job);
+      }
+    ++this->NumberOfUpdatedSegments;
+    }
+  this->Segments.swap(segments);
+
+  if (!jobs.empty())
+    {
+    const double background = inputImage->GetScalarRange()[0];
+    switch (scalarType)
+      {
+      vtkTemplateMacro(ResampleSlices<VTK_TT>(inputImage, jobs, size, background));
+      }
+    }
+
+  // Lumen diameters of the cross-sections that are not measured yet
+  vtkMRMLTableNode* lumenTableNode = this->LumenTableNode;
+  if (lumenTableNode)
+    {
+    std::vector<LumenJob> lumenJobs;
+    for (Segment& segment : this->Segments)
+      {
+      if (!segment.Diameters.empty())
+        {
+        continue;
+        }
+      const int numberOfSegmentSlices = segment.Image->GetDimensions()[2];
+      segment.Diameters.resize(2 * static_cast<size_t>(numberOfSegmentSlices));
+      const char* scalars = static_cast<const char*>(segment.Image->GetScalarPointer());
+      for (int slice = 0; slice < numberOfSegmentSlices; ++slice)
+        {
+        LumenJob job;
+        job.Image = scalars + slice * sliceBytes;
+        job.Diameters = &segment.Diameters[2 * slice];
+        lumenJobs.push_back(job);
+        }
+      }
+    switch (scalarType)
+      {
+      vtkTemplateMacro(MeasureLumen<VTK_TT>(lumenJobs, size, h, this->LumenThreshold));
+      }
+    }
+
+  // Stack the segments in the output, reusing its image while its size does not change
+  int numberOfSlices = 0;
+  for (const Segment& segment : this->Segments)
+    {
+    numberOfSlices += segment.Image->GetDimensions()[2];
+    }
+  vtkSmartPointer<vtkImageData> outputImage = outputVolumeNode->GetImageData();
+  const bool newImage = !outputImage || outputImage->GetScalarType() != scalarType
+    || outputImage->GetNumberOfScalarComponents() != 1 || outputImage->GetDimensions()[0] != size
+    || outputImage->GetDimensions()[1] != size || outputImage->GetDimensions()[2] != numberOfSlices;
+  if (newImage)
+    {
+    outputImage = vtkSmartPointer<vtkImageData>::New();
+    outputImage->SetDimensions(size, size, numberOfSlices);
+    outputImage->AllocateScalars(scalarType, 1);
+    }
+  char* outputScalars = static_cast<char*>(outputImage->GetScalarPointer());
+  for (const Segment& segment : this->Segments)
+    {
+    const vtkIdType segmentBytes = sliceBytes * segment.Image->GetDimensions()[2];
+    std::memcpy(outputScalars, segment.Image->GetScalarPointer(), segmentBytes);
+    outputScalars += segmentBytes;
+    }
+
+  int wasModifying = outputVolumeNode->StartModify();
+  outputVolumeNode->SetOrigin(0.0, 0.0, 0.0);
+  outputVolumeNode->SetSpacing(h, h, h);
+  outputVolumeNode->SetIToRASDirection(1.0, 0.0, 0.0);
+  outputVolumeNode->SetJToRASDirection(0.0, 1.0, 0.0);
+  outputVolumeNode->SetKToRASDirection(0.0, 0.0, 1.0);
+  if (newImage)
+    {
+    outputVolumeNode->SetAndObserveImageData(outputImage);
+    }
+  else
+    {
+    outputImage->Modified();
+    }
+  if (!outputVolumeNode->GetDisplayNode() && outputVolumeNode->GetScene())
+    {
+    outputVolumeNode->CreateDefaultDisplayNodes();
+    vtkMRMLScalarVolumeDisplayNode* inputDisplayNode = inputVolumeNode->GetScalarVolumeDisplayNode();
+    vtkMRMLScalarVolumeDisplayNode* outputDisplayNode = outputVolumeNode->GetScalarVolumeDisplayNode();
+    if (inputDisplayNode && outputDisplayNode)
+      {
+      outputDisplayNode->SetAndObserveColorNodeID(inputDisplayNode->GetColorNodeID());
+      outputDisplayNode->SetAutoWindowLevel(false);
+      outputDisplayNode->SetWindowLevel(inputDisplayNode->GetWindow(), inputDisplayNode->GetLevel());
+      }
+    }
+  outputVolumeNode->EndModify(wasModifying);
+
+  if (lumenTableNode)
+    {
+    this->WriteLumenTable(lumenTableNode);
+    }
+
+  this->UpdateTime = (vtkTimerLog::GetUniversalTime() - startTime) * 1000.0;
+  vtkDebugMacro("Update: Resampled " << this->NumberOfUpdatedSegments << " of " << numberOfSegments
+    << " segments in " << this->UpdateTime << " ms");
+  this->Updating = false;
+  return true;
+}
@@ -0,0 +1,190 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVICurvedPlanarReformation_h
+#define __vtkTAVICurvedPlanarReformation_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkCallbackCommand;
+class vtkImageData;
+class vtkMRMLMarkupsCurveNode;
+class vtkMRMLScalarVolumeNode;
+class vtkMRMLTableNode;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Straightened curved planar reformation along a centerline, updated segment by segment.
+///
+/// The output volume is the stack of the cross-sections of the input volume
+/// perpendicular to the curve, sampled every Spacing mm along the curve: its
+/// axial slices are the cross-sections (for lumen diameters), its sagittal and
+/// coronal slices are the straightened views. It lies in its own space, with
+/// an identity orientation.
+///
+/// The curve is split in segments between consecutive control points. The
+/// cross-sections of each segment are cached, and only the segments whose
+/// interpolated points changed are resampled, in parallel along the curve.
+/// The cross-sections follow a rotation minimizing frame (parallel transport
+/// of the first axis along the curve), so that the straightened image does
+/// not twist or tear where the curve turns. The frame starts at the first
+/// point of the curve (its first axis is perpendicular to the anterior
+/// direction, or to the superior direction where the curve runs
+/// antero-posteriorly) and is carried from each segment into the next one:
+/// a segment is also resampled when the frame at its first point changed,
+/// so moving a control point resamples the segments that follow it.
+/// The curve points are in world coordinates: the input volume may be under
+/// a linear transform.
+/// Each segment is sampled from its first point: the spacing of the last
+/// cross-section of a segment to the first one of the next segment is
+/// shorter than Spacing.
+///
+/// If LumenTableNode is set, it receives the minimum and maximum diameters of
+/// the lumen through the centerline in each cross-section, with the distance
+/// of the cross-section along the curve. Diameters are measured on rays cast
+/// from the centerline to the first sample below LumenThreshold, like the
+/// annulus diameters of vtkAorticAnnulusMeasurement, and are cached with the
+/// segments. A centerline point outside the lumen has diameters of 0.
+///
+/// With AutoUpdate, the output is updated whenever the curve or the input
+/// volume is modified, which makes it follow the edits of the centerline.
+///
+/// Example:
+/// \code{.py}
+/// cpr = slicer.modules.tavi.logic().GetCurvedPlanarReformation()
+/// cpr.SetInputVolumeNode(volumeNode)
+/// cpr.SetCurveNode(centerlineCurveNode)
+/// cpr.SetOutputVolumeNode(straightenedVolumeNode)
+/// cpr.SetLumenTableNode(lumenTableNode)
+/// cpr.SetAutoUpdate(True)
+/// \endcode
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkTAVICurvedPlanarReformation : public vtkObject
+{
+public:
+  static vtkTAVICurvedPlanarReformation* New();
+  vtkTypeMacro(vtkTAVICurvedPlanarReformation, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  void SetInputVolumeNode(vtkMRMLScalarVolumeNode* volumeNode);
+  vtkMRMLScalarVolumeNode* GetInputVolumeNode();
+
+  /// Centerline, with at least 2 control points.
+  void SetCurveNode(vtkMRMLMarkupsCurveNode* curveNode);
+  vtkMRMLMarkupsCurveNode* GetCurveNode();
+
+  /// Volume node receiving the straightened image. A display node is
+  /// created if it has none, with the window/level of the input volume.
+  void SetOutputVolumeNode(vtkMRMLScalarVolumeNode* volumeNode);
+  vtkMRMLScalarVolumeNode* GetOutputVolumeNode();
+
+  /// Width and height of the cross-sections, in mm.
+  vtkSetClampMacro(SliceSize, double, 1.0, 500.0);
+  vtkGetMacro(SliceSize, double);
+
+  /// Spacing of the pixels of the cross-sections and of the cross-sections
+  /// along the curve, in mm.
+  vtkSetClampMacro(Spacing, double, 0.05, 10.0);
+  vtkGetMacro(Spacing, double);
+
+  /// Table node receiving the lumen diameters of each cross-section, optional.
+  void SetLumenTableNode(vtkMRMLTableNode* tableNode);
+  vtkMRMLTableNode* GetLumenTableNode();
+
+  /// Intensity below which a sample is considered outside the lumen, in HU.
+  vtkSetMacro(LumenThreshold, double);
+  vtkGetMacro(LumenThreshold, double);
+
+  /// Update the output when the curve or the input volume is modified.
+  void SetAutoUpdate(bool autoUpdate);
+  vtkGetMacro(AutoUpdate, bool);
+  vtkBooleanMacro(AutoUpdate, bool);
+
+  /// Resample the segments that changed and update the output volume.
+  /// Return false if the input, curve or output is missing or invalid.
+  bool Update();
+
+  /// Release the cached cross-sections.
+  void ClearCache();
+
+  /// Statistics of the last Update().
+  int GetNumberOfSegments();
+  vtkGetMacro(NumberOfUpdatedSegments, int);
+  /// Time of the last Update(), in ms.
+  vtkGetMacro(UpdateTime, double);
+
+protected:
+  vtkTAVICurvedPlanarReformation();
+  ~vtkTAVICurvedPlanarReformation() override;
+
+  /// Cross-sections of the curve between two consecutive control points.
+  struct Segment
+  {
+    std::vector<double> CurvePoints; // interpolated points of the segment, in world coordinates
+    bool IncludesEnd; // the last segment also has a cross-section at its end
+    double IncomingAxis[3] = { 0.0, 0.0, 0.0 }; // first axis at the end of the previous segment, 0 for the first one
+    double EndAxis[3] = { 0.0, 0.0, 0.0 }; // first axis transported to the end point
+    vtkSmartPointer<vtkImageData> Image;
+    double Length; // in mm
+    std::vector<double> SliceDistances; // distance of each cross-section from the first point, in mm
+    std::vector<double> Diameters; // minimum and maximum lumen diameters of each cross-section, in mm
+  };
+
+  static void OnNodeModified(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+  void UpdateObservers();
+
+  /// Position and axes of the cross-sections of \a segment, in world coordinates:
+  /// 9 values (center, first axis, second axis) per cross-section, the frame
+  /// starting from its IncomingAxis. Also set the length, the distances of the
+  /// cross-sections and the EndAxis of \a segment.
+  void ComputeSlicePlanes(Segment& segment, std::vector<double>& planes);
+
+  /// Write the lumen diameters of the segments to \a tableNode.
+  void WriteLumenTable(vtkMRMLTableNode* tableNode);
+
+  vtkWeakPointer<vtkMRMLScalarVolumeNode> InputVolumeNode;
+  vtkWeakPointer<vtkMRMLMarkupsCurveNode> CurveNode;
+  vtkWeakPointer<vtkMRMLScalarVolumeNode> OutputVolumeNode;
+  vtkWeakPointer<vtkMRMLTableNode> LumenTableNode;
+  vtkSmartPointer<vtkCallbackCommand> NodeCallback;
+  double SliceSize;
+  double Spacing;
+  double LumenThreshold;
+  bool AutoUpdate;
+  bool Updating;
+
+  std::vector<Segment> Segments;
+  // Input the cached segments were resampled from
+  vtkWeakPointer<vtkImageData> CachedImage;
+  vtkMTimeType CachedImageTime;
+  double CachedWorldToIJK[16];
+  double CachedSliceSize;
+  double CachedSpacing;
+  double CachedLumenThreshold;
+
+  int NumberOfUpdatedSegments;
+  double UpdateTime;
+
+private:
+  vtkTAVICurvedPlanarReformation(const vtkTAVICurvedPlanarReformation&) = delete;
+  void operator=(const vtkTAVICurvedPlanarReformation&) = delete;
+};
+
+#endif
@@ -0,0 +1,643 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkTAVIDICOMSeriesReader.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLVolumeArchetypeStorageNode.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// GDCM includes
+#include <gdcmImage.h>
+#include <gdcmImageReader.h>
+#include <gdcmPixelFormat.h>
+
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTAVIDICOMSeriesReader);
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// How the stored values are converted into the volume
+enum RescaleMode
+{
+  NoRescale = 0,  ///< values are decoded into the volume as stored
+  ShortRescale,   ///< 16-bit values are decoded into the volume, then the intercept is added in place, saturated
+  FloatRescale    ///< values are decoded into a buffer, then rescaled into the float volume
+};
+
+//----------------------------------------------------------------------------
+struct SeriesFormat
+{
+  unsigned int Columns;
+  unsigned int Rows;
+  gdcm::PixelFormat PixelFormat;
+  double DirectionCosines[6];
+  double Spacing[3];
+  double Slope;
+  double Intercept;
+  RescaleMode Mode;
+  int OutputType;
+  unsigned long SliceLength; // decoded bytes per slice
+  vtkIdType OutputSliceSize; // bytes per slice of the volume
+};
+
+//----------------------------------------------------------------------------
+struct SliceInfo
+{
+  double Origin[3];
+  bool Decoded = false;
+};
+
+//----------------------------------------------------------------------------
+int GetVTKScalarType(gdcm::PixelFormat::ScalarType scalarType)
+{
+  switch (scalarType)
+    {
+    case gdcm::PixelFormat::UINT8: return VTK_UNSIGNED_CHAR;
+    case gdcm::PixelFormat::INT8: return VTK_SIGNED_CHAR;
+    case gdcm::PixelFormat::UINT16: return VTK_UNSIGNED_SHORT;
+    case gdcm::PixelFormat::INT16: return VTK_SHORT;
+    case gdcm::PixelFormat::UINT32: return VTK_UNSIGNED_INT;
+    case gdcm::PixelFormat::INT32: return VTK_INT;
+    case gdcm::PixelFormat::FLOAT32: return VTK_FLOAT;
+    case gdcm::PixelFormat::FLOAT64: return VTK_DOUBLE;
+    default: return -1;
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Get the range of the 16-bit values of \a image.
+template <class T>
+bool GetStoredRange(const gdcm::Image& image, vtkIdType count, double range[2])
+{
+  std::vector<T> values(count);
+  if (count == 0 || !image.GetBuffer(reinterpret_cast<char*>(values.data())))
+    {
+    return false;
+    }
+  const auto minmax = std::minmax_element(values.begin(), values.end());
+  range[0] = *minmax.first;
+  range[1] = *minmax.second;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+/// Add \a intercept to the \a count 16-bit values of \a data in place,
+/// saturating the results to 16-bit signed integers.
+/// Return the number of saturated values.
+template <class T>
+vtkIdType RescaleToShort(char* data, vtkIdType count, int intercept)
+{
+  static_assert(sizeof(T) == sizeof(short), "16-bit values are rescaled in place");
+  const T* values = reinterpret_cast<const T*>(data);
+  short* output = reinterpret_cast<short*>(data);
+  vtkIdType saturated = 0;
+  for (vtkIdType index = 0; index < count; ++index)
+    {
+    const int value = static_cast<int>(values[index]) + intercept;
+    const int clamped = std::min(std::max(value, static_cast<int>(VTK_SHORT_MIN)), static_cast<int>(VTK_SHORT_MAX));
+    saturated += clamped != value ? 1 : 0;
+    output[index] = static_cast<short>(clamped);
+    }
+  return saturated;
+}
+
+//----------------------------------------------------------------------------
+/// Choose how the series is stored in the volume from its first slice.
+/// Return false if the pixel data is not supported.
+bool ComputeSeriesFormat(const gdcm::Image& image, SeriesFormat& format)
+{
+  const gdcm::PixelFormat& pixelFormat = image.GetPixelFormat();
+  const int storedType = GetVTKScalarType(pixelFormat.GetScalarType());
+  if (storedType < 0 || pixelFormat.GetSamplesPerPixel() != 1
+      || (image.GetNumberOfDimensions() > 2 && image.GetDimension(2) > 1))
+    {
+    return false;
+    }
+  format.Columns = image.GetDimension(0);
+  format.Rows = image.GetDimension(1);
+  format.PixelFormat = pixelFormat;
+  std::copy(image.GetDirectionCosines(), image.GetDirectionCosines() + 6, format.DirectionCosines);
+  std::copy(image.GetSpacing(), image.GetSpacing() + 3, format.Spacing);
+  format.Slope = image.GetSlope();
+  format.Intercept = image.GetIntercept();
+  format.SliceLength = image.GetBufferLength();
+  const vtkIdType pixelCount = static_cast<vtkIdType>(format.Columns) * format.Rows;
+  if (format.SliceLength != static_cast<unsigned long>(pixelCount * pixelFormat.GetPixelSize()))
+    {
+    return false;
+    }
+
+  const bool sixteenBits = storedType == VTK_UNSIGNED_SHORT || storedType == VTK_SHORT;
+  const bool shortRescale = sixteenBits && format.Slope == 1.0 && format.Intercept == std::floor(format.Intercept);
+  // Range of the rescaled values, computed from the stored bits. Many CT
+  // series store 16 bits (unsigned, with an intercept of -1024) whose
+  // values only use 12 bits: the range of the first slice is used then.
+  double range[2] = { static_cast<double>(pixelFormat.GetMin()), static_cast<double>(pixelFormat.GetMax()) };
+  if (shortRescale && (range[0] + format.Intercept < VTK_SHORT_MIN || range[1] + format.Intercept > VTK_SHORT_MAX))
+    {
+    const bool hasRange = storedType == VTK_UNSIGNED_SHORT ?
+      GetStoredRange<unsigned short>(image, pixelCount, range) : GetStoredRange<short>(image, pixelCount, range);
+    if (!hasRange)
+      {
+      return false;
+      }
+    }
+  if (format.Slope == 1.0 && format.Intercept == 0.0)
+    {
+    format.Mode = NoRescale;
+    format.OutputType = storedType;
+    }
+  else if (shortRescale && range[0] + format.Intercept >= VTK_SHORT_MIN && range[1] + format.Intercept <= VTK_SHORT_MAX)
+    {
+    format.Mode = ShortRescale;
+    format.OutputType = VTK_SHORT;
+    }
+  else
+    {
+    format.Mode = FloatRescale;
+    format.OutputType = VTK_FLOAT;
+    }
+  format.OutputSliceSize = pixelCount * vtkDataArray::GetDataTypeSize(format.OutputType);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void RescaleToFloat(const char* input, float* output, vtkIdType count, double slope, double intercept)
+{
+  const T* values = reinterpret_cast<const T*>(input);
+  for (vtkIdType index = 0; index < count; ++index)
+    {
+    output[index] = static_cast<float>(values[index] * slope + intercept);
+    }
+}
+
+//----------------------------------------------------------------------------
+class DecodeSlicesFunctor
+{
+public:
+  DecodeSlicesFunctor(const std::vector<std::string>& fileNames, const SeriesFormat& format,
+    char* scalars, std::vector<SliceInfo>& slices, vtkIdType step, const std::atomic<bool>& abortRequested)
+    : FileNames(fileNames)
+    , Format(format)
+    , Scalars(scalars)
+    , Slices(slices)
+    , Step(step)
+    , AbortRequested(abortRequested)
+    {
+    }
+
+  /// Decode the slices \a begin * Step to \a end * Step (excluded) that are not decoded yet,
+  /// until the decoding is aborted.
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType k = begin * this->Step; k < end * this->Step; k += this->Step)
+      {
+      if (this->AbortRequested)
+        {
+        return;
+        }
+      if (this->Slices[k].Decoded)
+        {
+        continue;
+        }
+      gdcm::ImageReader reader;
+      reader.SetFileName(this->FileNames[k].c_str());
+      if (reader.Read())
+        {
+        this->DecodeSlice(reader.GetImage(), k);
+        }
+      }
+    }
+
+  /// Decode the pixel data of \a image into slice \a k of the volume.
+  void DecodeSlice(const gdcm::Image& image, vtkIdType k)
+    {
+    const SeriesFormat& format = this->Format;
+    if (image.GetDimension(0) != format.Columns || image.GetDimension(1) != format.Rows
+        || !(image.GetPixelFormat() == format.PixelFormat) || image.GetBufferLength() != format.SliceLength)
+      {
+      return;
+      }
+    const double* directionCosines = image.GetDirectionCosines();
+    for (int component = 0; component < 6; ++component)
+      {
+      if (std::fabs(directionCosines[component] - format.DirectionCosines[component]) > 1e-4)
+        {
+        return;
+        }
+      }
+    SliceInfo& slice = this->Slices[k];
+    std::copy(image.GetOrigin(), image.GetOrigin() + 3, slice.Origin);
+
+    char* output = this->Scalars + k * format.OutputSliceSize;
+    const vtkIdType pixelCount = static_cast<vtkIdType>(format.Columns) * format.Rows;
+    if (format.Mode != FloatRescale)
+      {
+      // The rescale of the first slice was checked to fit the output type
+      if (image.GetSlope() != format.Slope || image.GetIntercept() != format.Intercept
+          || !image.GetBuffer(output))
+        {
+        return;
+        }
+      if (format.Mode == ShortRescale)
+        {
+        // Values of the other slices may not fit the range of the first one
+        const int intercept = static_cast<int>(format.Intercept);
+        this->SaturatedValues += format.PixelFormat.GetScalarType() == gdcm::PixelFormat::UINT16 ?
+          RescaleToShort<unsigned short>(output, pixelCount, intercept) :
+          RescaleToShort<short>(output, pixelCount, intercept);
+        }
+      }
+    else
+      {
+      std::vector<char>& buffer = this->Buffer.Local();
+      buffer.resize(format.SliceLength);
+      if (!image.GetBuffer(buffer.data()))
+        {
+        return;
+        }
+      float* values = reinterpret_cast<float*>(output);
+      const double slope = image.GetSlope();
+      const double intercept = image.GetIntercept();
+      switch (format.PixelFormat.GetScalarType())
+        {
+        case gdcm::PixelFormat::UINT8: RescaleToFloat<unsigned char>(buffer.data(), values, pixelCount, slope, intercept); break;
+        case gdcm::PixelFormat::INT8: RescaleToFloat<signed char>(buffer.data(), values, pixelCount, slope, intercept); break;
+        case gdcm::PixelFormat::UINT16: RescaleToFloat<unsigned short>(buffer.data(), values, pixelCount, slope, intercept); break;
+        case gdcm::PixelFormat::INT16: RescaleToFloat<short>(buffer.data(), values, pixelCount, slope, intercept); break;
+        case gdcm::PixelFormat::UINT32: RescaleToFloat<unsigned int>(buffer.data(), values, pixelCount, slope, intercept); break;
+        case gdcm::PixelFormat::INT32: RescaleToFloat<int>(buffer.data(), values, pixelCount, slope, intercept); break;
+        case gdcm::PixelFormat::FLOAT32: RescaleToFloat<float>(buffer.data(), values, pixelCount, slope, intercept); break;
+        case gdcm::PixelFormat::FLOAT64: RescaleToFloat<double>(buffer.data(), values, pixelCount, slope, intercept); break;
+        default: return;
+        }
+      }
+    slice.Decoded = true;
+    }
+
+  /// Number of rescaled values saturated to 16-bit signed integers.
+  std::atomic<vtkIdType> SaturatedValues{ 0 };
+
+private:
+  const std::vector<std::string>& FileNames;
+  const SeriesFormat& Format;
+  char* Scalars;
+  std::vector<SliceInfo>& Slices;
+  vtkIdType Step;
+  const std::atomic<bool>& AbortRequested;
+  vtkSMPThreadLocal<std::vector<char> > Buffer;
+};
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+class vtkTAVIDICOMSeriesReader::vtkInternal
+{
+public:
+  SeriesFormat Format;
+  std::vector<SliceInfo> Slices;
+  vtkSmartPointer<vtkImageData> ImageData;
+  vtkIdType SaturatedValues = 0;
+  std::atomic<bool> AbortRequested{ false };
+};
+
+//----------------------------------------------------------------------------
+vtkTAVIDICOMSeriesReader::vtkTAVIDICOMSeriesReader()
+  : Internal(new vtkInternal)
+  , DecodeTime(0.0)
+  , DecodedSize(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIDICOMSeriesReader::~vtkTAVIDICOMSeriesReader()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIDICOMSeriesReader::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfFileNames: " << this->FileNames.size() << "\n";
+  os << indent << "DecodeTime: " << this->DecodeTime << "\n";
+  os << indent << "DecodedSize: " << this->DecodedSize << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIDICOMSeriesReader::SetFileNames(const std::vector<std::string>& fileNames)
+{
+  this->FileNames = fileNames;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+const std::vector<std::string>& vtkTAVIDICOMSeriesReader::GetFileNames()
+{
+  return this->FileNames;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIDICOMSeriesReader::Read(vtkMRMLScalarVolumeNode* volumeNode)
+{
+  if (!volumeNode)
+    {
+    vtkErrorMacro("Read: No volume node");
+    return false;
+    }
+  if (!this->Initialize() || !this->DecodeSlices(1) || !this->UpdateVolumeNode(volumeNode))
+    {
+    return false;
+    }
+  vtkDebugMacro("Read: Decoded " << this->FileNames.size() << " slices of "
+    << (volumeNode->GetName() ? volumeNode->GetName() : "") << " in " << this->DecodeTime << " s with "
+    << vtkSMPTools::GetEstimatedNumberOfThreads() << " threads, "
+    << this->DecodedSize / (1024.0 * 1024.0) << " MB");
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkTAVIDICOMSeriesReader::ReadSeries(vtkMRMLScene* scene, const std::string& name,
+  const std::vector<std::string>& fileNames)
+{
+  if (!scene || fileNames.empty())
+    {
+    vtkGenericWarningMacro("vtkTAVIDICOMSeriesReader::ReadSeries: No scene or no file");
+    return nullptr;
+    }
+  vtkNew<vtkMRMLVolumeArchetypeStorageNode> storageNode;
+  storageNode->SetFileName(fileNames[0].c_str());
+  storageNode->ResetFileNameList();
+  for (const std::string& fileName : fileNames)
+    {
+    storageNode->AddFileName(fileName.c_str());
+    }
+  storageNode->SetSingleFile(fileNames.size() == 1);
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  volumeNode->SetName(scene->GetUniqueNameByString(name.c_str()));
+  scene->AddNode(storageNode);
+  scene->AddNode(volumeNode);
+  volumeNode->SetAndObserveStorageNodeID(storageNode->GetID());
+  vtkNew<vtkTAVIDICOMSeriesReader> reader;
+  reader->SetFileNames(fileNames);
+  if (!reader->Read(volumeNode) && !storageNode->ReadData(volumeNode))
+    {
+    scene->RemoveNode(volumeNode);
+    scene->RemoveNode(storageNode);
+    return nullptr;
+    }
+  volumeNode->CreateDefaultDisplayNodes();
+  return volumeNode;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIDICOMSeriesReader::Initialize()
+{
+  vtkInternal* internal = this->Internal;
+  internal->ImageData = nullptr;
+  internal->Slices.clear();
+  internal->SaturatedValues = 0;
+  internal->AbortRequested = false;
+  this->DecodeTime = 0.0;
+  this->DecodedSize = 0;
+  if (this->FileNames.empty())
+    {
+    vtkErrorMacro("Initialize: No file");
+    return false;
+    }
+  const double startTime = vtkTimerLog::GetUniversalTime();
+  const vtkIdType numberOfSlices = static_cast<vtkIdType>(this->FileNames.size());
+
+  // The first slice gives the format of the volume, it is decoded on this
+  // thread, which also loads the dictionaries of GDCM before the SMP threads
+  // use them.
+  gdcm::ImageReader firstReader;
+  firstReader.SetFileName(this->FileNames[0].c_str());
+  if (!firstReader.Read())
+    {
+    vtkErrorMacro("Initialize: Failed to read " << this->FileNames[0]);
+    return false;
+    }
+  const gdcm::Image& firstImage = firstReader.GetImage();
+  SeriesFormat& format = internal->Format;
+  if (!ComputeSeriesFormat(firstImage, format))
+    {
+    vtkWarningMacro("Initialize: Pixel data of " << this->FileNames[0] << " is not supported");
+    return false;
+    }
+
+  // Uninitialized, each slice is written once by its decoder
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(static_cast<int>(format.Columns), static_cast<int>(format.Rows),
+    static_cast<int>(numberOfSlices));
+  imageData->AllocateScalars(format.OutputType, 1);
+  internal->Slices.resize(numberOfSlices);
+  DecodeSlicesFunctor functor(this->FileNames, format,
+    static_cast<char*>(imageData->GetScalarPointer()), internal->Slices, 1, internal->AbortRequested);
+  functor.DecodeSlice(firstImage, 0);
+  functor(numberOfSlices - 1, numberOfSlices);
+  if (!internal->Slices[0].Decoded || !internal->Slices[numberOfSlices - 1].Decoded)
+    {
+    vtkErrorMacro("Initialize: Failed to decode " << this->FileNames[numberOfSlices - 1]
+      << ", or it does not match " << this->FileNames[0]);
+    internal->Slices.clear();
+    return false;
+    }
+  internal->ImageData = imageData;
+  internal->SaturatedValues = functor.SaturatedValues;
+  this->DecodeTime = vtkTimerLog::GetUniversalTime() - startTime;
+  this->DecodedSize = static_cast<vtkTypeInt64>(format.SliceLength) * (numberOfSlices > 1 ? 2 : 1);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIDICOMSeriesReader::DecodeSlices(int step)
+{
+  vtkInternal* internal = this->Internal;
+  if (!internal->ImageData || step < 1)
+    {
+    vtkErrorMacro("DecodeSlices: Not initialized");
+    return false;
+    }
+  const double startTime = vtkTimerLog::GetUniversalTime();
+  const vtkIdType numberOfSlices = static_cast<vtkIdType>(internal->Slices.size());
+  vtkIdType decodedBefore = 0;
+  for (const SliceInfo& slice : internal->Slices)
+    {
+    decodedBefore += slice.Decoded ? 1 : 0;
+    }
+  DecodeSlicesFunctor functor(this->FileNames, internal->Format,
+    static_cast<char*>(internal->ImageData->GetScalarPointer()), internal->Slices, step,
+    internal->AbortRequested);
+  // One slice per work item, decoding a slice takes milliseconds
+  vtkSMPTools::For(0, (numberOfSlices - 1) / step + 1, 1, functor);
+  if (internal->AbortRequested)
+    {
+    internal->SaturatedValues += functor.SaturatedValues;
+    this->DecodeTime += vtkTimerLog::GetUniversalTime() - startTime;
+    return false;
+    }
+
+  bool success = true;
+  vtkIdType decodedAfter = 0;
+  for (vtkIdType k = 0; k < numberOfSlices; ++k)
+    {
+    if (internal->Slices[k].Decoded)
+      {
+      ++decodedAfter;
+      }
+    else if (success && k % step == 0)
+      {
+      vtkErrorMacro("DecodeSlices: Failed to decode " << this->FileNames[k] << ", or it does not match "
+        << this->FileNames[0]);
+      success = false;
+      }
+    }
+  internal->SaturatedValues += functor.SaturatedValues;
+  this->DecodeTime += vtkTimerLog::GetUniversalTime() - startTime;
+  this->DecodedSize += static_cast<vtkTypeInt64>(internal->Format.SliceLength) * (decodedAfter - decodedBefore);
+  return success;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIDICOMSeriesReader::AbortDecoding()
+{
+  this->Internal->AbortRequested = true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIDICOMSeriesReader::IsSliceDecoded(int slice)
+{
+  const std::vector<SliceInfo>& slices = this->Internal->Slices;
+  return slice >= 0 && slice < static_cast<int>(slices.size()) && slices[slice].Decoded;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkTAVIDICOMSeriesReader::GetImageData()
+{
+  return this->Internal->ImageData;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIDICOMSeriesReader::GetIJKToRASMatrix(vtkMatrix4x4* ijkToRAS)
+{
+  vtkInternal* internal = this->Internal;
+  if (!ijkToRAS || !internal->ImageData)
+    {
+    return false;
+    }
+  const SeriesFormat& format = internal->Format;
+  const std::vector<SliceInfo>& slices = internal->Slices;
+  const vtkIdType numberOfSlices = static_cast<vtkIdType>(slices.size());
+
+  // Geometry, in LPS
+  double rowDirection[3] = { format.DirectionCosines[0], format.DirectionCosines[1], format.DirectionCosines[2] };
+  double columnDirection[3] = { format.DirectionCosines[3], format.DirectionCosines[4], format.DirectionCosines[5] };
+  double sliceDirection[3];
+  double sliceSpacing = format.Spacing[2];
+  vtkMath::Cross(rowDirection, columnDirection, sliceDirection);
+  if (numberOfSlices > 1)
+    {
+    double sliceVector[3];
+    vtkMath::Subtract(slices[numberOfSlices - 1].Origin, slices[0].Origin, sliceVector);
+    const double length = vtkMath::Normalize(sliceVector);
+    if (length > 0.0)
+      {
+      std::copy(sliceVector, sliceVector + 3, sliceDirection);
+      sliceSpacing = length / (numberOfSlices - 1);
+      }
+    }
+
+  // Volume nodes are in RAS
+  const double* directions[3] = { rowDirection, columnDirection, sliceDirection };
+  const double spacing[3] = { format.Spacing[0], format.Spacing[1], sliceSpacing };
+  ijkToRAS->Identity();
+  for (int column = 0; column < 3; ++column)
+    {
+    ijkToRAS->SetElement(0, column, -directions[column][0] * spacing[column]);
+    ijkToRAS->SetElement(1, column, -directions[column][1] * spacing[column]);
+    ijkToRAS->SetElement(2, column, directions[column][2] * spacing[column]);
+    }
+  ijkToRAS->SetElement(0, 3, -slices[0].Origin[0]);
+  ijkToRAS->SetElement(1, 3, -slices[0].Origin[1]);
+  ijkToRAS->SetElement(2, 3, slices[0].Origin[2]);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIDICOMSeriesReader::UpdateVolumeNode(vtkMRMLScalarVolumeNode* volumeNode)
+{
+  vtkInternal* internal = this->Internal;
+  const std::vector<SliceInfo>& slices = internal->Slices;
+  if (!volumeNode || !internal->ImageData
+      || std::any_of(slices.begin(), slices.end(), [](const SliceInfo& slice) { return !slice.Decoded; }))
+    {
+    vtkErrorMacro("UpdateVolumeNode: No volume node, or slices are not decoded");
+    return false;
+    }
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  this->GetIJKToRASMatrix(ijkToRAS);
+
+  const vtkIdType numberOfSlices = static_cast<vtkIdType>(slices.size());
+  if (numberOfSlices > 1)
+    {
+    const double sliceSpacing = std::sqrt(vtkMath::Distance2BetweenPoints(slices[numberOfSlices - 1].Origin,
+      slices[0].Origin)) / (numberOfSlices - 1);
+    for (vtkIdType k = 1; k < numberOfSlices; ++k)
+      {
+      const double distance = std::sqrt(vtkMath::Distance2BetweenPoints(slices[k].Origin, slices[k - 1].Origin));
+      if (std::fabs(distance - sliceSpacing) > 0.01 * sliceSpacing)
+        {
+        vtkWarningMacro("UpdateVolumeNode: Slice spacing of " << this->FileNames[0] << " is not uniform, "
+          << sliceSpacing << " mm is used");
+        break;
+        }
+      }
+    }
+
+  if (internal->SaturatedValues > 0)
+    {
+    vtkWarningMacro("UpdateVolumeNode: " << internal->SaturatedValues << " values of " << this->FileNames[0]
+      << " were saturated to 16-bit signed integers");
+    }
+
+  volumeNode->SetIJKToRASMatrix(ijkToRAS);
+  // The scalars may have been written by other threads since the image was allocated
+  internal->ImageData->Modified();
+  volumeNode->SetAndObserveImageData(internal->ImageData);
+  return true;
+}
@@ -0,0 +1,129 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVIDICOMSeriesReader_h
+#define __vtkTAVIDICOMSeriesReader_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <string>
+#include <vector>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkImageData;
+class vtkMatrix4x4;
+class vtkMRMLScalarVolumeNode;
+class vtkMRMLScene;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Read a series of single-frame DICOM files, decoding the slices in parallel.
+///
+/// The volume is allocated once from the first slice, then the pixel data of
+/// each file (uncompressed, JPEG, JPEG-Lossless, JPEG-LS or JPEG 2000) is
+/// decoded by GDCM on the SMP threads directly into its slice of the volume.
+/// Rescale slope and intercept are applied in place when the rescaled values
+/// fit the stored type (identity rescale) or 16-bit signed integers (CT),
+/// other series are rescaled to float through one buffer per thread, which
+/// doubles the memory of the volume and costs a copy per slice. The range of
+/// 16-bit values is given by the stored bits, or by the values of the first
+/// slice if it does not fit (e.g. 16 unsigned bits with an intercept of
+/// -1024): values of the other slices that do not fit 16-bit signed
+/// integers are then saturated, with a warning.
+///
+/// The files must be sorted along the slice axis and share the dimensions,
+/// pixel format and orientation of the first one. The geometry of the volume
+/// node is set from the positions of the first and last slices, like the
+/// archetype storage node does.
+///
+/// The throughput of the decoding (slices/s and MB/s of decoded pixels) is
+/// written to the log after each series.
+///
+/// Read() decodes the whole series. Progressive readers (see
+/// vtkTAVIVolumePyramid) call Initialize() then DecodeSlices() with a
+/// decreasing step to get every 4th, then every 2nd, then every slice,
+/// and UpdateVolumeNode() once all the slices are decoded.
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkTAVIDICOMSeriesReader : public vtkObject
+{
+public:
+  static vtkTAVIDICOMSeriesReader* New();
+  vtkTypeMacro(vtkTAVIDICOMSeriesReader, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Files of the series, sorted along the slice axis.
+  void SetFileNames(const std::vector<std::string>& fileNames);
+  const std::vector<std::string>& GetFileNames();
+
+  /// Read the series into the image data of \a volumeNode and set its geometry.
+  /// Return false if a file could not be read or does not match the first one.
+  bool Read(vtkMRMLScalarVolumeNode* volumeNode);
+
+  /// Add a volume node named \a name (made unique) and its archetype storage
+  /// node to \a scene, and read \a fileNames into it. Series the reader
+  /// does not support (multi-frame, color...) are read by the storage node.
+  /// Return nullptr, and remove the nodes, if the series could not be read.
+  static vtkMRMLScalarVolumeNode* ReadSeries(vtkMRMLScene* scene, const std::string& name,
+    const std::vector<std::string>& fileNames);
+
+  /// Allocate the volume from the first slice and decode the first and last
+  /// slices, which give the geometry.
+  /// Return false if the series is empty or its pixel data is not supported.
+  bool Initialize();
+
+  /// Decode the slices whose index is a multiple of \a step and that are not
+  /// decoded yet, in parallel. Only the image data is written, so that it can
+  /// be called from a background thread while the main thread runs.
+  /// Return false if one of these slices could not be decoded.
+  bool DecodeSlices(int step);
+
+  /// Stop DecodeSlices() after the slices being decoded, from another thread.
+  /// It then returns false without error. Cleared by Initialize().
+  void AbortDecoding();
+
+  bool IsSliceDecoded(int slice);
+
+  /// Image data being decoded, allocated by Initialize().
+  vtkImageData* GetImageData();
+
+  /// IJK to RAS matrix of the volume, from the first and last slices.
+  /// Return false if Initialize() was not successful.
+  bool GetIJKToRASMatrix(vtkMatrix4x4* ijkToRAS);
+
+  /// Set the image data and geometry of \a volumeNode.
+  /// Return false if some slices are not decoded.
+  bool UpdateVolumeNode(vtkMRMLScalarVolumeNode* volumeNode);
+
+  /// Statistics since the last Initialize().
+  vtkGetMacro(DecodeTime, double);
+  vtkGetMacro(DecodedSize, vtkTypeInt64);
+
+protected:
+  vtkTAVIDICOMSeriesReader();
+  ~vtkTAVIDICOMSeriesReader() override;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+  std::vector<std::string> FileNames;
+  double DecodeTime; // in seconds
+  vtkTypeInt64 DecodedSize; // in bytes
+
+private:
+  vtkTAVIDICOMSeriesReader(const vtkTAVIDICOMSeriesReader&) = delete;
+  void operator=(const vtkTAVIDICOMSeriesReader&) = delete;
+};
+
+#endif
@@ -0,0 +1,62 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVIImageSampling_h
+#define __vtkTAVIImageSampling_h
+
+// VTK includes
+#include <vtkType.h>
+
+// STD includes
+#include <cmath>
+#include <limits>
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Sampling kernels shared by the resampling and downsampling of the
+/// TAVI logic (cine player, curved planar reformation, volume pyramid).
+///
+/// Internal header: the kernels are inlined in the loops of their callers.
+namespace vtkTAVIImageSampling
+{
+
+//----------------------------------------------------------------------------
+/// Convert an interpolated value to the scalar type of the image, rounding
+/// to the nearest integer for integer types.
+template <class T>
+inline T RoundToScalar(double value)
+{
+  return std::numeric_limits<T>::is_integer ?
+    static_cast<T>(std::floor(value + 0.5)) : static_cast<T>(value);
+}
+
+//----------------------------------------------------------------------------
+/// Trilinear interpolation in the cell whose lower corner is \a p.
+/// \a step is the offset to the next voxel along each axis, 0 on the last
+/// index of an axis or on single-slice axes, \a weight the fractional part of
+/// the continuous index along each axis.
+template <class T>
+inline double InterpolateTrilinear(const T* p, const vtkIdType step[3], const double weight[3])
+{
+  const double c00 = p[0] + weight[0] * (p[step[0]] - p[0]);
+  const double c10 = p[step[1]] + weight[0] * (p[step[1] + step[0]] - p[step[1]]);
+  const double c01 = p[step[2]] + weight[0] * (p[step[2] + step[0]] - p[step[2]]);
+  const double c11 = p[step[2] + step[1]] + weight[0] * (p[step[2] + step[1] + step[0]] - p[step[2] + step[1]]);
+  const double c0 = c00 + weight[1] * (c10 - c00);
+  const double c1 = c01 + weight[1] * (c11 - c01);
+  return c0 + weight[2] * (c1 - c0);
+}
+
+} // end of namespace vtkTAVIImageSampling
+
+#endif
@@ -0,0 +1,439 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkTAVIMeasurementGraph.h"
+
+// MRML includes
+#include <vtkMRMLMarkupsNode.h>
+#include <vtkMRMLNode.h>
+#include <vtkMRMLTransformableNode.h>
+#include <vtkMRMLVolumeNode.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkObjectFactory.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTAVIMeasurementGraph);
+
+//----------------------------------------------------------------------------
+vtkTAVIMeasurementGraph::vtkTAVIMeasurementGraph()
+  : NumberOfComputedMeasurements(0)
+  , UpdateTime(0.0)
+{
+  this->NodeCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->NodeCallback->SetCallback(vtkTAVIMeasurementGraph::OnNodeModified);
+  this->NodeCallback->SetClientData(this);
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIMeasurementGraph::~vtkTAVIMeasurementGraph()
+{
+  this->Measurements.clear();
+  this->UpdateObservers();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIMeasurementGraph::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  for (const Measurement& measurement : this->Measurements)
+    {
+    os << indent << measurement.Name << ": " << measurement.Inputs.size() << " inputs, "
+      << measurement.Outputs.size() << " outputs, " << (measurement.Valid ? "valid" : "invalid")
+      << ", computed " << measurement.ComputeCount << " times\n";
+    }
+  os << indent << "NumberOfComputedMeasurements: " << this->NumberOfComputedMeasurements << "\n";
+  os << indent << "UpdateTime: " << this->UpdateTime << " ms\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIMeasurementGraph::AddMeasurement(const char* name)
+{
+  if (!name || this->GetMeasurementIndex(name) >= 0)
+    {
+    vtkErrorMacro("AddMeasurement: No name, or measurement " << (name ? name : "") << " already exists");
+    return false;
+    }
+  Measurement measurement;
+  measurement.Name = name;
+  measurement.Valid = false;
+  measurement.ComputeCount = 0;
+  this->Measurements.push_back(measurement);
+  this->Modified();
+  this->InvokeEvent(InvalidatedEvent);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIMeasurementGraph::RemoveMeasurement(const char* name)
+{
+  const int index = this->GetMeasurementIndex(name);
+  if (index < 0)
+    {
+    return;
+    }
+  // Measurements reading its outputs are computed from outdated values
+  for (int dependent = 0; dependent < static_cast<int>(this->Measurements.size()); ++dependent)
+    {
+    if (this->DependsOn(dependent, index))
+      {
+      this->Invalidate(dependent);
+      }
+    }
+  this->Measurements.erase(this->Measurements.begin() + index);
+  this->UpdateObservers();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIMeasurementGraph::RemoveAllMeasurements()
+{
+  if (this->Measurements.empty())
+    {
+    return;
+    }
+  this->Measurements.clear();
+  this->UpdateObservers();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIMeasurementGraph::HasMeasurement(const char* name)
+{
+  return this->GetMeasurementIndex(name) >= 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIMeasurementGraph::GetNumberOfMeasurements()
+{
+  return static_cast<int>(this->Measurements.size());
+}
+
+//----------------------------------------------------------------------------
+const char* vtkTAVIMeasurementGraph::GetNthMeasurementName(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->Measurements.size()))
+    {
+    return nullptr;
+    }
+  return this->Measurements[index].Name.c_str();
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIMeasurementGraph::AddMeasurementInput(const char* name, vtkMRMLNode* node)
+{
+  const int index = this->GetMeasurementIndex(name);
+  if (index < 0 || !node)
+    {
+    vtkErrorMacro("AddMeasurementInput: No measurement " << (name ? name : "") << " or no node");
+    return false;
+    }
+  Measurement& measurement = this->Measurements[index];
+  if (std::find(measurement.Inputs.begin(), measurement.Inputs.end(), node) != measurement.Inputs.end())
+    {
+    return true;
+    }
+  measurement.Inputs.push_back(node);
+  std::vector<int> order;
+  if (!this->SortMeasurements(order))
+    {
+    vtkErrorMacro("AddMeasurementInput: " << name << " would depend on itself through "
+      << (node->GetName() ? node->GetName() : ""));
+    this->Measurements[index].Inputs.pop_back();
+    return false;
+    }
+  this->UpdateObservers();
+  this->Invalidate(index);
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIMeasurementGraph::AddMeasurementOutput(const char* name, vtkMRMLNode* node)
+{
+  const int index = this->GetMeasurementIndex(name);
+  if (index < 0 || !node)
+    {
+    vtkErrorMacro("AddMeasurementOutput: No measurement " << (name ? name : "") << " or no node");
+    return false;
+    }
+  Measurement& measurement = this->Measurements[index];
+  if (std::find(measurement.Outputs.begin(), measurement.Outputs.end(), node) != measurement.Outputs.end())
+    {
+    return true;
+    }
+  measurement.Outputs.push_back(node);
+  std::vector<int> order;
+  if (!this->SortMeasurements(order))
+    {
+    vtkErrorMacro("AddMeasurementOutput: " << name << " would depend on itself through "
+      << (node->GetName() ? node->GetName() : ""));
+    this->Measurements[index].Outputs.pop_back();
+    return false;
+    }
+  for (int dependent = 0; dependent < static_cast<int>(this->Measurements.size()); ++dependent)
+    {
+    if (dependent != index && this->DependsOn(dependent, index))
+      {
+      this->Invalidate(dependent);
+      }
+    }
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIMeasurementGraph::InvalidateMeasurement(const char* name)
+{
+  const int index = this->GetMeasurementIndex(name);
+  if (index >= 0)
+    {
+    this->Invalidate(index);
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIMeasurementGraph::IsMeasurementValid(const char* name)
+{
+  const int index = this->GetMeasurementIndex(name);
+  return index >= 0 && this->Measurements[index].Valid;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIMeasurementGraph::HasInvalidMeasurements()
+{
+  return std::any_of(this->Measurements.begin(), this->Measurements.end(),
+    [](const Measurement& measurement) { return !measurement.Valid; });
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIMeasurementGraph::GetMeasurementComputeCount(const char* name)
+{
+  const int index = this->GetMeasurementIndex(name);
+  return index >= 0 ? this->Measurements[index].ComputeCount : 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIMeasurementGraph::Update()
+{
+  if (!this->HasInvalidMeasurements())
+    {
+    return 0;
+    }
+  const double startTime = vtkTimerLog::GetUniversalTime();
+
+  // Dependency order of the measurements, by name: observers may add or
+  // remove measurements while they compute.
+  std::vector<int> sortedIndices;
+  this->SortMeasurements(sortedIndices);
+  std::vector<std::string> order;
+  for (int index : sortedIndices)
+    {
+    order.push_back(this->Measurements[index].Name);
+    }
+
+  int numberOfComputedMeasurements = 0;
+  for (const std::string& name : order)
+    {
+    int index = this->GetMeasurementIndex(name.c_str());
+    if (index < 0 || this->Measurements[index].Valid)
+      {
+      continue;
+      }
+    this->InvokeEvent(ComputeMeasurementEvent, const_cast<char*>(name.c_str()));
+    index = this->GetMeasurementIndex(name.c_str());
+    if (index >= 0)
+      {
+      this->Measurements[index].Valid = true;
+      ++this->Measurements[index].ComputeCount;
+      // Not all the writes of the outputs are observed (e.g. a markups plane
+      // modified without point event): the dependents, which come next in
+      // the order, are invalidated explicitly.
+      for (int dependent = 0; dependent < static_cast<int>(this->Measurements.size()); ++dependent)
+        {
+        if (dependent != index && this->DependsOn(dependent, index))
+          {
+          this->Measurements[dependent].Valid = false;
+          }
+        }
+      }
+    ++numberOfComputedMeasurements;
+    }
+
+  this->NumberOfComputedMeasurements = numberOfComputedMeasurements;
+  this->UpdateTime = (vtkTimerLog::GetUniversalTime() - startTime) * 1000.0;
+  this->Modified();
+  return numberOfComputedMeasurements;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIMeasurementGraph::GetMeasurementIndex(const char* name)
+{
+  if (!name)
+    {
+    return -1;
+    }
+  for (int index = 0; index < static_cast<int>(this->Measurements.size()); ++index)
+    {
+    if (this->Measurements[index].Name == name)
+      {
+      return index;
+      }
+    }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIMeasurementGraph::DependsOn(int dependent, int measurement)
+{
+  for (const vtkWeakPointer<vtkMRMLNode>& output : this->Measurements[measurement].Outputs)
+    {
+    for (const vtkWeakPointer<vtkMRMLNode>& input : this->Measurements[dependent].Inputs)
+      {
+      if (output && output == input)
+        {
+        return true;
+        }
+      }
+    }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIMeasurementGraph::SortMeasurements(std::vector<int>& order)
+{
+  const int numberOfMeasurements = static_cast<int>(this->Measurements.size());
+  order.clear();
+  std::vector<int> remainingDependencies(numberOfMeasurements, 0);
+  for (int dependent = 0; dependent < numberOfMeasurements; ++dependent)
+    {
+    for (int dependency = 0; dependency < numberOfMeasurements; ++dependency)
+      {
+      remainingDependencies[dependent] += this->DependsOn(dependent, dependency) ? 1 : 0;
+      }
+    if (remainingDependencies[dependent] == 0)
+      {
+      order.push_back(dependent);
+      }
+    }
+  for (size_t next = 0; next < order.size(); ++next)
+    {
+    for (int dependent = 0; dependent < numberOfMeasurements; ++dependent)
+      {
+      if (this->DependsOn(dependent, order[next]) && --remainingDependencies[dependent] == 0)
+        {
+        order.push_back(dependent);
+        }
+      }
+    }
+  // Measurements left out are on a cycle, or depend on one
+  return static_cast<int>(order.size()) == numberOfMeasurements;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIMeasurementGraph::Invalidate(int measurement)
+{
+  std::vector<int> measurementsToInvalidate(1, measurement);
+  bool invalidated = false;
+  while (!measurementsToInvalidate.empty())
+    {
+    const int index = measurementsToInvalidate.back();
+    measurementsToInvalidate.pop_back();
+    if (!this->Measurements[index].Valid && index != measurement)
+      {
+      // Its dependents were invalidated with it
+      continue;
+      }
+    invalidated = invalidated || this->Measurements[index].Valid;
+    this->Measurements[index].Valid = false;
+    for (int dependent = 0; dependent < static_cast<int>(this->Measurements.size()); ++dependent)
+      {
+      if (dependent != index && this->DependsOn(dependent, index))
+        {
+        measurementsToInvalidate.push_back(dependent);
+        }
+      }
+    }
+  if (invalidated)
+    {
+    this->InvokeEvent(InvalidatedEvent);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIMeasurementGraph::OnNodeModified(vtkObject* caller,
+  unsigned long vtkNotUsed(eid), void* clientData, void* vtkNotUsed(callData))
+{
+  vtkTAVIMeasurementGraph* self = static_cast<vtkTAVIMeasurementGraph*>(clientData);
+  for (int index = 0; index < static_cast<int>(self->Measurements.size()); ++index)
+    {
+    const std::vector<vtkWeakPointer<vtkMRMLNode> >& inputs = self->Measurements[index].Inputs;
+    if (std::find(inputs.begin(), inputs.end(), caller) != inputs.end())
+      {
+      self->Invalidate(index);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIMeasurementGraph::UpdateObservers()
+{
+  for (vtkMRMLNode* node : this->ObservedNodes)
+    {
+    if (node)
+      {
+      node->RemoveObserver(this->NodeCallback);
+      }
+    }
+  this->ObservedNodes.clear();
+  for (const Measurement& measurement : this->Measurements)
+    {
+    for (vtkMRMLNode* node : measurement.Inputs)
+      {
+      if (!node || std::find(this->ObservedNodes.begin(), this->ObservedNodes.end(), node) != this->ObservedNodes.end())
+        {
+        continue;
+        }
+      this->ObservedNodes.push_back(node);
+      if (vtkMRMLMarkupsNode::SafeDownCast(node))
+        {
+        // Not ModifiedEvent, which is also invoked for changes of the
+        // selection, locking or name of the control points.
+        node->AddObserver(vtkMRMLMarkupsNode::PointModifiedEvent, this->NodeCallback);
+        node->AddObserver(vtkMRMLMarkupsNode::PointAddedEvent, this->NodeCallback);
+        node->AddObserver(vtkMRMLMarkupsNode::PointRemovedEvent, this->NodeCallback);
+        node->AddObserver(vtkMRMLMarkupsNode::PointPositionDefinedEvent, this->NodeCallback);
+        node->AddObserver(vtkMRMLMarkupsNode::PointPositionUndefinedEvent, this->NodeCallback);
+        }
+      else
+        {
+        node->AddObserver(vtkCommand::ModifiedEvent, this->NodeCallback);
+        }
+      if (vtkMRMLVolumeNode::SafeDownCast(node))
+        {
+        node->AddObserver(vtkMRMLVolumeNode::ImageDataModifiedEvent, this->NodeCallback);
+        }
+      if (vtkMRMLTransformableNode::SafeDownCast(node))
+        {
+        node->AddObserver(vtkMRMLTransformableNode::TransformModifiedEvent, this->NodeCallback);
+        }
+      }
+    }
+}
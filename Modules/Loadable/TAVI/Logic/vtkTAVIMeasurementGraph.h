@@ -0,0 +1,156 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVIMeasurementGraph_h
+#define __vtkTAVIMeasurementGraph_h
+
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <string>
+#include <vector>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkCallbackCommand;
+class vtkMRMLNode;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Dependency graph of the TAVI measurements, recomputing only what an edit invalidates.
+///
+/// Each measurement is registered with its input nodes (volumes, markups,
+/// planes, segmentations...) and the output nodes it writes (tables,
+/// contours, planes...). A measurement depends on the measurements whose
+/// outputs are among its inputs, e.g. the coronary heights depend on the
+/// annulus measurement through the annulus plane.
+///
+/// When an input node is modified (moved control point, new transform,
+/// new image data...), the measurements reading it and their dependents are
+/// invalidated and InvalidatedEvent is invoked. Nothing is computed until
+/// Update(), which invokes ComputeMeasurementEvent, with the name of the
+/// measurement as call data, for each invalid measurement in dependency
+/// order. The observers compute the measurement of that name. Calling
+/// Update() from a zero-interval single-shot timer started on InvalidatedEvent
+/// (as the TAVI module does) coalesces the edits of a drag into one update.
+///
+/// Example:
+/// \code{.py}
+/// graph = slicer.modules.tavi.logic().GetMeasurementGraph()
+/// graph.AddMeasurement("CoronaryHeights")
+/// graph.AddMeasurementInput("CoronaryHeights", annulusPlaneNode)
+/// graph.AddMeasurementInput("CoronaryHeights", ostiaNode)
+/// graph.AddMeasurementOutput("CoronaryHeights", coronaryTableNode)
+///
+/// @vtk.calldata_type(vtk.VTK_STRING)
+/// def onCompute(caller, event, name):
+///   if name == "CoronaryHeights":
+///     measureCoronaryHeights()
+/// graph.AddObserver(graph.ComputeMeasurementEvent, onCompute)
+/// \endcode
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkTAVIMeasurementGraph : public vtkObject
+{
+public:
+  static vtkTAVIMeasurementGraph* New();
+  vtkTypeMacro(vtkTAVIMeasurementGraph, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  enum
+  {
+    /// A measurement became invalid, Update() should be called.
+    InvalidatedEvent = vtkCommand::UserEvent + 1,
+    /// Compute the measurement whose name is the call data (const char*).
+    ComputeMeasurementEvent
+  };
+
+  /// Register a measurement, invalid until the next Update().
+  /// Return false if a measurement of that name already exists.
+  bool AddMeasurement(const char* name);
+  void RemoveMeasurement(const char* name);
+  void RemoveAllMeasurements();
+  bool HasMeasurement(const char* name);
+
+  int GetNumberOfMeasurements();
+  const char* GetNthMeasurementName(int index);
+
+  /// Nodes read by the measurement. Modifying them invalidates it.
+  bool AddMeasurementInput(const char* name, vtkMRMLNode* node);
+  /// Nodes written by the measurement. Measurements reading them depend on it.
+  /// Both return false if the measurement would depend on itself.
+  bool AddMeasurementOutput(const char* name, vtkMRMLNode* node);
+
+  /// Invalidate the measurement and its dependents, for changes that are not
+  /// node modifications (e.g. a threshold of the measurement).
+  void InvalidateMeasurement(const char* name);
+  bool IsMeasurementValid(const char* name);
+  /// Return true if some measurements are invalid.
+  bool HasInvalidMeasurements();
+
+  /// Number of times the measurement was computed.
+  int GetMeasurementComputeCount(const char* name);
+
+  /// Compute the invalid measurements, dependencies first. The dependents
+  /// of a computed measurement are computed next, whether or not writing
+  /// its outputs invoked an observed event.
+  /// Return the number of measurements computed.
+  int Update();
+
+  /// Statistics of the last Update() that computed measurements.
+  vtkGetMacro(NumberOfComputedMeasurements, int);
+  /// Time of the last Update() that computed measurements, in ms.
+  vtkGetMacro(UpdateTime, double);
+
+protected:
+  vtkTAVIMeasurementGraph();
+  ~vtkTAVIMeasurementGraph() override;
+
+  struct Measurement
+  {
+    std::string Name;
+    std::vector<vtkWeakPointer<vtkMRMLNode> > Inputs;
+    std::vector<vtkWeakPointer<vtkMRMLNode> > Outputs;
+    bool Valid;
+    int ComputeCount;
+  };
+
+  /// Index of the measurement named \a name, -1 if none.
+  int GetMeasurementIndex(const char* name);
+  /// Return true if measurement \a dependent reads an output of measurement \a measurement.
+  bool DependsOn(int dependent, int measurement);
+  /// Indices of the measurements, each after the ones it depends on.
+  /// Return false if some measurements depend on themselves.
+  bool SortMeasurements(std::vector<int>& order);
+  /// Invalidate the measurement and, transitively, its dependents.
+  void Invalidate(int measurement);
+
+  static void OnNodeModified(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+  /// Observe the input nodes of all the measurements.
+  void UpdateObservers();
+
+  std::vector<Measurement> Measurements;
+  std::vector<vtkWeakPointer<vtkMRMLNode> > ObservedNodes;
+  vtkSmartPointer<vtkCallbackCommand> NodeCallback;
+
+  int NumberOfComputedMeasurements;
+  double UpdateTime;
+
+private:
+  vtkTAVIMeasurementGraph(const vtkTAVIMeasurementGraph&) = delete;
+  void operator=(const vtkTAVIMeasurementGraph&) = delete;
+};
+
+#endif
@@ -0,0 +1,464 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkTAVIMeshBVH.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTAVIMeshBVH);
+
+namespace
+{
+
+/// Maximum number of triangles of a leaf
+const vtkIdType LeafSize = 4;
+/// Depth of the traversal stack, enough for any balanced tree of vtkIdType triangles
+const int StackSize = 128;
+
+//----------------------------------------------------------------------------
+double BoxDistance2(const double bounds[6], const double point[3])
+{
+  double distance2 = 0.0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    const double below = bounds[2 * axis] - point[axis];
+    const double above = point[axis] - bounds[2 * axis + 1];
+    const double outside = std::max(std::max(below, above), 0.0);
+    distance2 += outside * outside;
+    }
+  return distance2;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkTAVIMeshBVH::vtkTAVIMeshBVH()
+  : BuildTime(0.0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIMeshBVH::~vtkTAVIMeshBVH()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIMeshBVH::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfTriangles: " << this->GetNumberOfTriangles() << "\n";
+  os << indent << "NumberOfNodes: " << this->Nodes.size() << "\n";
+  os << indent << "BuildTime: " << this->BuildTime << " ms\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIMeshBVH::Initialize()
+{
+  this->Points.clear();
+  this->Triangles.clear();
+  this->Normals.clear();
+  this->EdgeNormals.clear();
+  this->PointNormals.clear();
+  this->Nodes.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkTAVIMeshBVH::GetNumberOfTriangles()
+{
+  return static_cast<vtkIdType>(this->Triangles.size() / 3);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIMeshBVH::Build(vtkPolyData* polyData)
+{
+  this->Initialize();
+  vtkPoints* points = polyData ? polyData->GetPoints() : nullptr;
+  vtkCellArray* polys = polyData ? polyData->GetPolys() : nullptr;
+  if (!points || !polys || polys->GetNumberOfCells() == 0)
+    {
+    vtkErrorMacro("Build: No polygons");
+    return false;
+    }
+  const double startTime = vtkTimerLog::GetUniversalTime();
+
+  const vtkIdType numberOfPoints = points->GetNumberOfPoints();
+  this->Points.resize(3 * numberOfPoints);
+  for (vtkIdType pointId = 0; pointId < numberOfPoints; ++pointId)
+    {
+    points->GetPoint(pointId, &this->Points[3 * pointId]);
+    }
+  // Polygons are split in fans of triangles
+  std::vector<vtkIdType> triangles;
+  vtkNew<vtkIdList> polygon;
+  for (polys->InitTraversal(); polys->GetNextCell(polygon);)
+    {
+    for (vtkIdType index = 2; index < polygon->GetNumberOfIds(); ++index)
+      {
+      triangles.push_back(polygon->GetId(0));
+      triangles.push_back(polygon->GetId(index - 1));
+      triangles.push_back(polygon->GetId(index));
+      }
+    }
+  const vtkIdType numberOfTriangles = static_cast<vtkIdType>(triangles.size() / 3);
+  if (numberOfTriangles == 0)
+    {
+    vtkErrorMacro("Build: No triangles");
+    return false;
+    }
+
+  // Unit normals and signed volume, which tells whether the triangles of a
+  // closed surface are oriented outwards.
+  std::vector<double> normals(3 * numberOfTriangles);
+  std::vector<double> centers(3 * numberOfTriangles);
+  double volume = 0.0;
+  for (vtkIdType triangle = 0; triangle < numberOfTriangles; ++triangle)
+    {
+    const double* p0 = &this->Points[3 * triangles[3 * triangle]];
+    const double* p1 = &this->Points[3 * triangles[3 * triangle + 1]];
+    const double* p2 = &this->Points[3 * triangles[3 * triangle + 2]];
+    double edge1[3];
+    double edge2[3];
+    vtkMath::Subtract(p1, p0, edge1);
+    vtkMath::Subtract(p2, p0, edge2);
+    vtkMath::Cross(edge1, edge2, &normals[3 * triangle]);
+    vtkMath::Normalize(&normals[3 * triangle]);
+    double cross[3];
+    vtkMath::Cross(p1, p2, cross);
+    volume += vtkMath::Dot(p0, cross) / 6.0;
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      centers[3 * triangle + axis] = (p0[axis] + p1[axis] + p2[axis]) / 3.0;
+      }
+    }
+  if (volume > 0.0)
+    {
+    for (double& component : normals)
+      {
+      component = -component;
+      }
+    }
+
+  // Pseudonormals of the points, weighted by the angles of the triangles,
+  // and of the edges, found by their point indices.
+  this->PointNormals.assign(3 * numberOfPoints, 0.0);
+  std::vector<double> edgeNormals(9 * numberOfTriangles, 0.0);
+  std::unordered_map<vtkIdType, vtkIdType> edgeIndices; // smallest point id * number of points + largest -> first edge
+  std::vector<vtkIdType> sharedEdges(3 * numberOfTriangles); // edge -> first edge with the same points
+  for (vtkIdType triangle = 0; triangle < numberOfTriangles; ++triangle)
+    {
+    const double* normal = &normals[3 * triangle];
+    for (int vertex = 0; vertex < 3; ++vertex)
+      {
+      const vtkIdType pointId = triangles[3 * triangle + vertex];
+      const vtkIdType nextPointId = triangles[3 * triangle + (vertex + 1) % 3];
+      const vtkIdType previousPointId = triangles[3 * triangle + (vertex + 2) % 3];
+      double toNext[3];
+      double toPrevious[3];
+      vtkMath::Subtract(&this->Points[3 * nextPointId], &this->Points[3 * pointId], toNext);
+      vtkMath::Subtract(&this->Points[3 * previousPointId], &this->Points[3 * pointId], toPrevious);
+      const double angle = vtkMath::AngleBetweenVectors(toNext, toPrevious);
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        this->PointNormals[3 * pointId + axis] += angle * normal[axis];
+        }
+
+      // Edge from this vertex to the next one
+      const vtkIdType key = std::min(pointId, nextPointId) * numberOfPoints + std::max(pointId, nextPointId);
+      const vtkIdType edge = 3 * triangle + vertex;
+      const vtkIdType firstEdge = edgeIndices.emplace(key, edge).first->second;
+      sharedEdges[edge] = firstEdge;
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        edgeNormals[3 * firstEdge + axis] += normal[axis];
+        }
+      }
+    }
+  for (vtkIdType edge = 0; edge < 3 * numberOfTriangles; ++edge)
+    {
+    if (sharedEdges[edge] != edge)
+      {
+      std::copy(&edgeNormals[3 * sharedEdges[edge]], &edgeNormals[3 * sharedEdges[edge]] + 3, &edgeNormals[3 * edge]);
+      }
+    }
+
+  // Nodes are built on a permutation of the triangles, then the triangles are
+  // sorted by leaf so that a leaf reads consecutive triangles.
+  std::vector<vtkIdType> order(numberOfTriangles);
+  for (vtkIdType triangle = 0; triangle < numberOfTriangles; ++triangle)
+    {
+    order[triangle] = triangle;
+    }
+  this->Nodes.reserve(2 * numberOfTriangles / LeafSize + 1);
+  this->BuildNode(0, numberOfTriangles, order, triangles, centers);
+  this->Triangles.resize(3 * numberOfTriangles);
+  this->Normals.resize(3 * numberOfTriangles);
+  this->EdgeNormals.resize(9 * numberOfTriangles);
+  for (vtkIdType index = 0; index < numberOfTriangles; ++index)
+    {
+    const vtkIdType triangle = order[index];
+    std::copy(&triangles[3 * triangle], &triangles[3 * triangle] + 3, &this->Triangles[3 * index]);
+    std::copy(&normals[3 * triangle], &normals[3 * triangle] + 3, &this->Normals[3 * index]);
+    std::copy(&edgeNormals[9 * triangle], &edgeNormals[9 * triangle] + 9, &this->EdgeNormals[9 * index]);
+    }
+
+  this->BuildTime = (vtkTimerLog::GetUniversalTime() - startTime) * 1000.0;
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIMeshBVH::BuildNode(vtkIdType begin, vtkIdType end, std::vector<vtkIdType>& order,
+  const std::vector<vtkIdType>& pointIds, const std::vector<double>& centers)
+{
+  const vtkIdType nodeIndex = static_cast<vtkIdType>(this->Nodes.size());
+  this->Nodes.push_back(Node());
+  double bounds[6];
+  double centerBounds[6];
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    bounds[2 * axis] = centerBounds[2 * axis] = std::numeric_limits<double>::max();
+    bounds[2 * axis + 1] = centerBounds[2 * axis + 1] = std::numeric_limits<double>::lowest();
+    }
+  for (vtkIdType index = begin; index < end; ++index)
+    {
+    const vtkIdType triangle = order[index];
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      for (int vertex = 0; vertex < 3; ++vertex)
+        {
+        const double coordinate = this->Points[3 * pointIds[3 * triangle + vertex] + axis];
+        bounds[2 * axis] = std::min(bounds[2 * axis], coordinate);
+        bounds[2 * axis + 1] = std::max(bounds[2 * axis + 1], coordinate);
+        }
+      centerBounds[2 * axis] = std::min(centerBounds[2 * axis], centers[3 * triangle + axis]);
+      centerBounds[2 * axis + 1] = std::max(centerBounds[2 * axis + 1], centers[3 * triangle + axis]);
+      }
+    }
+  std::copy(bounds, bounds + 6, this->Nodes[nodeIndex].Bounds);
+  if (end - begin <= LeafSize)
+    {
+    this->Nodes[nodeIndex].Index = begin;
+    this->Nodes[nodeIndex].Count = end - begin;
+    return;
+    }
+
+  // Median split of the triangle centers along the longest axis
+  int splitAxis = 0;
+  for (int axis = 1; axis < 3; ++axis)
+    {
+    if (centerBounds[2 * axis + 1] - centerBounds[2 * axis] >
+        centerBounds[2 * splitAxis + 1] - centerBounds[2 * splitAxis])
+      {
+      splitAxis = axis;
+      }
+    }
+  const vtkIdType middle = begin + (end - begin) / 2;
+  std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+    [&centers, splitAxis](vtkIdType left, vtkIdType right)
+    { return centers[3 * left + splitAxis] < centers[3 * right + splitAxis]; });
+
+  this->Nodes[nodeIndex].Count = 0;
+  this->BuildNode(begin, middle, order, pointIds, centers);
+  this->Nodes[nodeIndex].Index = static_cast<vtkIdType>(this->Nodes.size());
+  this->BuildNode(middle, end, order, pointIds, centers);
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVIMeshBVH::TriangleDistance2(vtkIdType triangle, const double point[3], double closestPoint[3],
+  int& feature) const
+{
+  // Closest point by Voronoi regions of the triangle, see Ericson,
+  // Real-Time Collision Detection, 5.1.5.
+  const double* a = &this->Points[3 * this->Triangles[3 * triangle]];
+  const double* b = &this->Points[3 * this->Triangles[3 * triangle + 1]];
+  const double* c = &this->Points[3 * this->Triangles[3 * triangle + 2]];
+  double ab[3];
+  double ac[3];
+  double ap[3];
+  vtkMath::Subtract(b, a, ab);
+  vtkMath::Subtract(c, a, ac);
+  vtkMath::Subtract(point, a, ap);
+  const double d1 = vtkMath::Dot(ab, ap);
+  const double d2 = vtkMath::Dot(ac, ap);
+  double v = 0.0;
+  double w = 0.0;
+  if (d1 <= 0.0 && d2 <= 0.0)
+    {
+    feature = VertexAFeature;
+    }
+  else
+    {
+    double bp[3];
+    vtkMath::Subtract(point, b, bp);
+    const double d3 = vtkMath::Dot(ab, bp);
+    const double d4 = vtkMath::Dot(ac, bp);
+    double cp[3];
+    vtkMath::Subtract(point, c, cp);
+    const double d5 = vtkMath::Dot(ab, cp);
+    const double d6 = vtkMath::Dot(ac, cp);
+    const double vc = d1 * d4 - d3 * d2;
+    const double vb = d5 * d2 - d1 * d6;
+    const double va = d3 * d6 - d5 * d4;
+    if (d3 >= 0.0 && d4 <= d3)
+      {
+      v = 1.0;
+      feature = VertexBFeature;
+      }
+    else if (d6 >= 0.0 && d5 <= d6)
+      {
+      w = 1.0;
+      feature = VertexCFeature;
+      }
+    else if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+      {
+      v = d1 / (d1 - d3);
+      feature = EdgeABFeature;
+      }
+    else if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+      {
+      w = d2 / (d2 - d6);
+      feature = EdgeCAFeature;
+      }
+    else if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+      {
+      w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+      v = 1.0 - w;
+      feature = EdgeBCFeature;
+      }
+    else
+      {
+      // Inside the face. Degenerate triangles are handled by their edges above.
+      feature = FaceFeature;
+      const double denominator = va + vb + vc;
+      v = denominator != 0.0 ? vb / denominator : 0.0;
+      w = denominator != 0.0 ? vc / denominator : 0.0;
+      }
+    }
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    closestPoint[axis] = a[axis] + ab[axis] * v + ac[axis] * w;
+    }
+  return vtkMath::Distance2BetweenPoints(point, closestPoint);
+}
+
+//----------------------------------------------------------------------------
+const double* vtkTAVIMeshBVH::GetFeatureNormal(vtkIdType triangle, int feature) const
+{
+  switch (feature)
+    {
+    case VertexAFeature:
+    case VertexBFeature:
+    case VertexCFeature:
+      return &this->PointNormals[3 * this->Triangles[3 * triangle + feature - VertexAFeature]];
+    case EdgeABFeature:
+    case EdgeBCFeature:
+    case EdgeCAFeature:
+      return &this->EdgeNormals[9 * triangle + 3 * (feature - EdgeABFeature)];
+    default:
+      return &this->Normals[3 * triangle];
+    }
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVIMeshBVH::FindClosestPoint(const double point[3], double closestPoint[3], vtkIdType& hintTriangle) const
+{
+  if (this->Nodes.empty())
+    {
+    return std::numeric_limits<double>::max();
+    }
+  const vtkIdType numberOfTriangles = static_cast<vtkIdType>(this->Triangles.size() / 3);
+  double bestDistance2 = std::numeric_limits<double>::max();
+  vtkIdType bestTriangle = -1;
+  int bestFeature = FaceFeature;
+  double candidate[3];
+  int feature = FaceFeature;
+  if (hintTriangle >= 0 && hintTriangle < numberOfTriangles)
+    {
+    bestDistance2 = this->TriangleDistance2(hintTriangle, point, closestPoint, bestFeature);
+    bestTriangle = hintTriangle;
+    }
+
+  vtkIdType stack[StackSize];
+  int stackSize = 0;
+  stack[stackSize++] = 0;
+  while (stackSize > 0)
+    {
+    const Node& node = this->Nodes[stack[--stackSize]];
+    if (BoxDistance2(node.Bounds, point) >= bestDistance2)
+      {
+      continue;
+      }
+    if (node.Count > 0)
+      {
+      for (vtkIdType triangle = node.Index; triangle < node.Index + node.Count; ++triangle)
+        {
+        const double distance2 = this->TriangleDistance2(triangle, point, candidate, feature);
+        if (distance2 < bestDistance2)
+          {
+          bestDistance2 = distance2;
+          bestTriangle = triangle;
+          bestFeature = feature;
+          std::copy(candidate, candidate + 3, closestPoint);
+          }
+        }
+      continue;
+      }
+    // The nearest child is pushed last, to be visited first
+    const vtkIdType first = &node - &this->Nodes[0] + 1;
+    const vtkIdType second = node.Index;
+    const double firstDistance2 = BoxDistance2(this->Nodes[first].Bounds, point);
+    const double secondDistance2 = BoxDistance2(this->Nodes[second].Bounds, point);
+    const bool firstIsNearest = firstDistance2 <= secondDistance2;
+    const vtkIdType nearest = firstIsNearest ? first : second;
+    const vtkIdType farthest = firstIsNearest ? second : first;
+    if (std::max(firstDistance2, secondDistance2) < bestDistance2)
+      {
+      stack[stackSize++] = farthest;
+      }
+    if (std::min(firstDistance2, secondDistance2) < bestDistance2)
+      {
+      stack[stackSize++] = nearest;
+      }
+    }
+
+  hintTriangle = bestTriangle;
+  double direction[3];
+  vtkMath::Subtract(point, closestPoint, direction);
+  const double distance = std::sqrt(bestDistance2);
+  return vtkMath::Dot(direction, this->GetFeatureNormal(bestTriangle, bestFeature)) >= 0.0 ? distance : -distance;
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVIMeshBVH::FindClosestPoint(const double point[3], double closestPoint[3]) const
+{
+  vtkIdType hintTriangle = -1;
+  return this->FindClosestPoint(point, closestPoint, hintTriangle);
+}
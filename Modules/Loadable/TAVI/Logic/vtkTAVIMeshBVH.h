@@ -0,0 +1,126 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVIMeshBVH_h
+#define __vtkTAVIMeshBVH_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkPolyData;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Bounding volume hierarchy of the triangles of a surface mesh, for closest point queries.
+///
+/// The hierarchy is a binary tree of axis-aligned boxes, split at the median
+/// triangle along the longest axis down to a few triangles per leaf, stored
+/// depth first in one array. A closest point query visits the nearest child
+/// first and skips the boxes farther than the closest triangle found so far,
+/// which takes a few dozen triangle tests instead of one per triangle.
+///
+/// Queries only read the hierarchy: they can run concurrently, for example
+/// from vtkSMPTools functors. A triangle hint (the closest triangle of the
+/// previous query of a moving point) gives a tight initial bound.
+///
+/// The signed distance is positive on the inner side of the surface, that is
+/// inside a closed mesh, whatever the orientation of its triangles. Its sign
+/// is given by the angle-weighted pseudonormal of the feature (face, edge or
+/// vertex) of the closest point, see Baerentzen and Aanaes, Signed distance
+/// computation using the angle weighted pseudonormal, IEEE TVCG 11(3), 2005:
+/// the face normal alone gives the wrong sign near the edges and vertices
+/// where the surface is concave.
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkTAVIMeshBVH : public vtkObject
+{
+public:
+  static vtkTAVIMeshBVH* New();
+  vtkTypeMacro(vtkTAVIMeshBVH, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Build the hierarchy of the polygons of \a polyData, in its coordinates.
+  /// Polygons are triangulated. Return false if there are no polygons.
+  bool Build(vtkPolyData* polyData);
+  void Initialize();
+
+  vtkIdType GetNumberOfTriangles();
+  /// Time of the last Build(), in ms.
+  vtkGetMacro(BuildTime, double);
+
+  /// Return the signed distance from \a point to the surface, and the closest
+  /// point of the surface. \a hintTriangle (-1 if none) is updated to the
+  /// closest triangle. Return the largest double if the hierarchy is empty.
+  double FindClosestPoint(const double point[3], double closestPoint[3], vtkIdType& hintTriangle) const;
+  double FindClosestPoint(const double point[3], double closestPoint[3]) const;
+
+protected:
+  vtkTAVIMeshBVH();
+  ~vtkTAVIMeshBVH() override;
+
+  struct Node
+  {
+    double Bounds[6];
+    /// Leaf: first triangle of Triangles. Inner node: index of the second
+    /// child, the first child follows the node.
+    vtkIdType Index;
+    /// Number of triangles of a leaf, 0 for inner nodes.
+    vtkIdType Count;
+  };
+
+  /// Build the node of the triangles order[begin] to order[end - 1], and its
+  /// children, sorting \a order so that each leaf has consecutive triangles.
+  void BuildNode(vtkIdType begin, vtkIdType end, std::vector<vtkIdType>& order,
+    const std::vector<vtkIdType>& pointIds, const std::vector<double>& centers);
+  /// Feature of a triangle where the closest point lies.
+  enum Feature
+  {
+    FaceFeature = 0,
+    VertexAFeature,
+    VertexBFeature,
+    VertexCFeature,
+    EdgeABFeature,
+    EdgeBCFeature,
+    EdgeCAFeature
+  };
+
+  /// Squared distance from \a point to triangle \a triangle, its closest point
+  /// and the feature of the triangle where it lies.
+  double TriangleDistance2(vtkIdType triangle, const double point[3], double closestPoint[3],
+    int& feature) const;
+  /// Pseudonormal of \a feature of \a triangle.
+  const double* GetFeatureNormal(vtkIdType triangle, int feature) const;
+
+  std::vector<double> Points;
+  /// Point indices of the triangles, 3 per triangle, sorted by leaf.
+  std::vector<vtkIdType> Triangles;
+  /// Unit normal of each triangle, pointing to the inner side of the surface.
+  std::vector<double> Normals;
+  /// Pseudonormals of the edges of each triangle (ab, bc, ca): sum of the
+  /// normals of the triangles sharing the edge.
+  std::vector<double> EdgeNormals;
+  /// Pseudonormal of each point: sum of the normals of its triangles,
+  /// weighted by their angle at the point.
+  std::vector<double> PointNormals;
+  std::vector<Node> Nodes;
+  double BuildTime;
+
+private:
+  vtkTAVIMeshBVH(const vtkTAVIMeshBVH&) = delete;
+  void operator=(const vtkTAVIMeshBVH&) = delete;
+};
+
+#endif
@@ -0,0 +1,792 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkTAVIModelLOD.h"
+
+// MRML includes
+#include <vtkMRMLModelDisplayNode.h>
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkCamera.h>
+#include <vtkInteractorObserver.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+#include <vtkQuadricDecimation.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkRenderer.h>
+#include <vtkTimerLog.h>
+#include <vtkTriangleFilter.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTAVIModelLOD);
+
+namespace
+{
+
+/// Attribute of the level nodes, their level
+const char* LevelAttributeName = "TAVI.ModelLODLevel";
+/// Ratio of the number of triangles of consecutive levels
+const double LevelReductionFactor = 4.0;
+
+//----------------------------------------------------------------------------
+bool IsLevelNode(vtkMRMLNode* node)
+{
+  return node && node->GetAttribute(LevelAttributeName) != nullptr;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkTAVIModelLOD::vtkTAVIModelLOD()
+  : Interacting(false)
+  , ViewNodeID(nullptr)
+  , MinimumNumberOfTriangles(200000)
+  , TrianglesPerPixel(1.0)
+  , MaximumInteractiveTriangles(300000)
+  , LastJobId(0)
+  , RenderedLevel(0)
+  , ThreadRunning(false)
+  , StopRequested(false)
+{
+  this->SceneCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->SceneCallback->SetCallback(vtkTAVIModelLOD::OnSceneEvent);
+  this->SceneCallback->SetClientData(this);
+  this->RendererCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->RendererCallback->SetCallback(vtkTAVIModelLOD::OnRendererEvent);
+  this->RendererCallback->SetClientData(this);
+  this->InteractorCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->InteractorCallback->SetCallback(vtkTAVIModelLOD::OnInteractorEvent);
+  this->InteractorCallback->SetClientData(this);
+  this->ResetFrameTimes();
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIModelLOD::~vtkTAVIModelLOD()
+{
+  this->SetRenderer(nullptr);
+  this->SetScene(nullptr);
+  this->SetViewNodeID(nullptr);
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ViewNodeID: " << (this->ViewNodeID ? this->ViewNodeID : "(none)") << "\n";
+  os << indent << "MinimumNumberOfTriangles: " << this->MinimumNumberOfTriangles << "\n";
+  os << indent << "TrianglesPerPixel: " << this->TrianglesPerPixel << "\n";
+  os << indent << "MaximumInteractiveTriangles: " << this->MaximumInteractiveTriangles << "\n";
+  for (const Model& model : this->Models)
+    {
+    vtkMRMLModelNode* modelNode = model.ModelNode;
+    os << indent << "Model " << (modelNode && modelNode->GetName() ? modelNode->GetName() : "") << ":";
+    for (int level = 0; level < NumberOfLevels; ++level)
+      {
+      os << " " << model.NumberOfTriangles[level];
+      }
+    os << " triangles, level " << model.ShownLevel << " shown\n";
+    }
+  for (int level = 0; level < NumberOfLevels; ++level)
+    {
+    os << indent << "Level " << level << ": " << this->FrameCounts[level] << " frames, "
+      << this->GetLevelFrameTime(level) << " ms\n";
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::SetScene(vtkMRMLScene* scene)
+{
+  if (this->Scene == scene)
+    {
+    return;
+    }
+  this->Stop();
+  this->RemoveAllModels();
+  std::vector<vtkMRMLNode*> modelNodes;
+  if (this->Scene)
+    {
+    this->Scene->RemoveObserver(this->SceneCallback);
+    this->Scene->GetNodesByClass("vtkMRMLModelNode", modelNodes);
+    for (vtkMRMLNode* modelNode : modelNodes)
+      {
+      modelNode->RemoveObserver(this->SceneCallback);
+      }
+    }
+  this->Scene = scene;
+  if (scene)
+    {
+    scene->AddObserver(vtkMRMLScene::NodeAddedEvent, this->SceneCallback);
+    scene->AddObserver(vtkMRMLScene::NodeRemovedEvent, this->SceneCallback);
+    scene->GetNodesByClass("vtkMRMLModelNode", modelNodes);
+    for (vtkMRMLNode* node : modelNodes)
+      {
+      if (!IsLevelNode(node))
+        {
+        node->AddObserver(vtkMRMLModelNode::MeshModifiedEvent, this->SceneCallback);
+        this->AddModel(vtkMRMLModelNode::SafeDownCast(node));
+        }
+      }
+    }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScene* vtkTAVIModelLOD::GetScene()
+{
+  return this->Scene;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::SetRenderer(vtkRenderer* renderer)
+{
+  if (this->Renderer == renderer)
+    {
+    return;
+    }
+  if (this->Renderer)
+    {
+    this->Renderer->RemoveObserver(this->RendererCallback);
+    }
+  // Models are shown at full detail in the previous renderer
+  this->Interacting = false;
+  this->SelectLevels();
+  this->Renderer = renderer;
+  if (renderer)
+    {
+    renderer->AddObserver(vtkCommand::EndEvent, this->RendererCallback);
+    }
+  this->UpdateInteractorObservers();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkRenderer* vtkTAVIModelLOD::GetRenderer()
+{
+  return this->Renderer;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::UpdateInteractorObservers()
+{
+  vtkRenderer* renderer = this->Renderer;
+  vtkRenderWindow* renderWindow = renderer ? renderer->GetRenderWindow() : nullptr;
+  vtkRenderWindowInteractor* interactor = renderWindow ? renderWindow->GetInteractor() : nullptr;
+  vtkInteractorObserver* interactorStyle = interactor ? interactor->GetInteractorStyle() : nullptr;
+  if (this->Interactor == interactor && this->InteractorStyle == interactorStyle)
+    {
+    return;
+    }
+  if (this->Interactor)
+    {
+    this->Interactor->RemoveObserver(this->InteractorCallback);
+    }
+  if (this->InteractorStyle)
+    {
+    this->InteractorStyle->RemoveObserver(this->InteractorCallback);
+    }
+  this->Interactor = interactor;
+  this->InteractorStyle = interactorStyle;
+  // Camera manipulations are reported by the interactor style
+  vtkObject* observedObjects[2] = { interactor, interactorStyle };
+  for (vtkObject* observedObject : observedObjects)
+    {
+    if (observedObject)
+      {
+      observedObject->AddObserver(vtkCommand::StartInteractionEvent, this->InteractorCallback);
+      observedObject->AddObserver(vtkCommand::EndInteractionEvent, this->InteractorCallback);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::OnSceneEvent(vtkObject* caller, unsigned long eid, void* clientData, void* callData)
+{
+  vtkTAVIModelLOD* self = static_cast<vtkTAVIModelLOD*>(clientData);
+  if (eid == vtkMRMLModelNode::MeshModifiedEvent)
+    {
+    self->AddModel(vtkMRMLModelNode::SafeDownCast(caller));
+    return;
+    }
+  vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(static_cast<vtkObject*>(callData));
+  if (!modelNode || IsLevelNode(modelNode))
+    {
+    return;
+    }
+  if (eid == vtkMRMLScene::NodeAddedEvent)
+    {
+    modelNode->AddObserver(vtkMRMLModelNode::MeshModifiedEvent, self->SceneCallback);
+    self->AddModel(modelNode);
+    }
+  else if (eid == vtkMRMLScene::NodeRemovedEvent)
+    {
+    modelNode->RemoveObserver(self->SceneCallback);
+    self->RemoveModel(modelNode);
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIModelLOD::AddModel(vtkMRMLModelNode* modelNode)
+{
+  if (!modelNode)
+    {
+    return false;
+    }
+  vtkPolyData* polyData = modelNode->GetPolyData();
+  const vtkIdType numberOfTriangles = polyData ? polyData->GetNumberOfPolys() : 0;
+  if (!this->Scene || numberOfTriangles < this->MinimumNumberOfTriangles)
+    {
+    this->RemoveModel(modelNode);
+    return false;
+    }
+  Model* model = this->GetModel(modelNode);
+  if (!model)
+    {
+    Model newModel;
+    newModel.ModelNode = modelNode;
+    newModel.ShownLevel = 0;
+    newModel.JobId = 0;
+    this->Models.push_back(newModel);
+    model = &this->Models.back();
+    }
+  this->ShowLevel(*model, 0);
+  this->RemoveLevelNodes(*model);
+  model->NumberOfTriangles[0] = numberOfTriangles;
+  model->BuildTime = 0.0;
+  const int previousJobId = model->JobId;
+  model->JobId = ++this->LastJobId;
+
+  // The thread copies the mesh: the shallow copy keeps its arrays if the
+  // mesh of the model is replaced meanwhile
+  Job job;
+  job.Id = model->JobId;
+  job.Levels[0] = vtkSmartPointer<vtkPolyData>::New();
+  job.Levels[0]->ShallowCopy(polyData);
+  job.Started = false;
+  job.Done = false;
+  job.BuildTime = 0.0;
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Jobs.remove_if([previousJobId](const Job& pendingJob)
+    { return pendingJob.Id == previousJobId && !pendingJob.Started; });
+  this->Jobs.push_back(job);
+  if (!this->ThreadRunning)
+    {
+    // The previous thread ended without the mutex
+    if (this->Thread.joinable())
+      {
+      this->Thread.join();
+      }
+    this->ThreadRunning = true;
+    this->StopRequested = false;
+    this->Thread = std::thread(&vtkTAVIModelLOD::BuildLevels, this);
+    }
+  }
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::BuildLevels()
+{
+  while (true)
+    {
+    Job* job = nullptr;
+    {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    for (Job& pendingJob : this->Jobs)
+      {
+      if (!pendingJob.Started)
+        {
+        job = &pendingJob;
+        break;
+        }
+      }
+    if (this->StopRequested || !job)
+      {
+      this->ThreadRunning = false;
+      return;
+      }
+    job->Started = true;
+    }
+
+    // Only this thread accesses the job until it is done. The arrays of the
+    // mesh are shared with the model: they are copied before being traversed.
+    const double startTime = vtkTimerLog::GetUniversalTime();
+    vtkNew<vtkPolyData> mesh;
+    mesh->DeepCopy(job->Levels[0]);
+    vtkNew<vtkTriangleFilter> triangleFilter;
+    triangleFilter->SetInputData(mesh);
+    triangleFilter->PassVertsOff();
+    triangleFilter->PassLinesOff();
+    triangleFilter->Update();
+    vtkSmartPointer<vtkPolyData> input = triangleFilter->GetOutput();
+    vtkSmartPointer<vtkPolyData> levels[NumberOfLevels];
+    for (int level = 1; level < NumberOfLevels; ++level)
+      {
+      vtkNew<vtkQuadricDecimation> decimation;
+      decimation->SetInputData(input);
+      decimation->SetTargetReduction(1.0 - 1.0 / LevelReductionFactor);
+      decimation->VolumePreservationOn();
+      decimation->Update();
+      levels[level] = vtkSmartPointer<vtkPolyData>::New();
+      levels[level]->ShallowCopy(decimation->GetOutput());
+      input = levels[level];
+      }
+
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    for (int level = 0; level < NumberOfLevels; ++level)
+      {
+      job->Levels[level] = levels[level];
+      }
+    job->BuildTime = vtkTimerLog::GetUniversalTime() - startTime;
+    job->Done = true;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::AddLevels(Model& model, Job& job)
+{
+  vtkMRMLScene* scene = this->Scene;
+  vtkMRMLModelNode* modelNode = model.ModelNode;
+  if (!scene || !modelNode)
+    {
+    return;
+    }
+  const std::string name = modelNode->GetName() ? modelNode->GetName() : "Model";
+  for (int level = 1; level < NumberOfLevels; ++level)
+    {
+    vtkPolyData* polyData = job.Levels[level];
+    if (!polyData)
+      {
+      continue;
+      }
+    vtkNew<vtkMRMLModelNode> levelNode;
+    levelNode->SetName(scene->GetUniqueNameByString((name + " LOD " + std::to_string(level)).c_str()));
+    levelNode->SetHideFromEditors(true);
+    levelNode->SetSaveWithScene(false);
+    levelNode->SetAttribute(LevelAttributeName, std::to_string(level).c_str());
+    levelNode->SetAndObservePolyData(polyData);
+    scene->AddNode(levelNode);
+    levelNode->CreateDefaultDisplayNodes();
+    vtkMRMLModelDisplayNode* levelDisplayNode = levelNode->GetModelDisplayNode();
+    if (levelDisplayNode)
+      {
+      levelDisplayNode->SetHideFromEditors(true);
+      levelDisplayNode->SetSaveWithScene(false);
+      levelDisplayNode->SetVisibility(false);
+      }
+    model.LevelNodes[level] = levelNode;
+    model.NumberOfTriangles[level] = polyData->GetNumberOfPolys();
+    }
+  model.JobId = 0;
+  model.BuildTime = job.BuildTime;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIModelLOD::UpdateModels()
+{
+  std::list<Job> doneJobs;
+  bool pending = false;
+  bool threadRunning = false;
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (std::list<Job>::iterator job = this->Jobs.begin(); job != this->Jobs.end();)
+    {
+    std::list<Job>::iterator next = std::next(job);
+    if (job->Done)
+      {
+      doneJobs.splice(doneJobs.end(), this->Jobs, job);
+      }
+    job = next;
+    }
+  pending = !this->Jobs.empty();
+  threadRunning = this->ThreadRunning;
+  }
+  if (!threadRunning && this->Thread.joinable())
+    {
+    this->Thread.join();
+    }
+  for (Job& job : doneJobs)
+    {
+    for (Model& model : this->Models)
+      {
+      // Levels of replaced meshes are dropped
+      if (model.JobId == job.Id)
+        {
+        this->AddLevels(model, job);
+        break;
+        }
+      }
+    }
+  this->UpdateInteractorObservers();
+  this->SelectLevels();
+  if (!doneJobs.empty())
+    {
+    this->Modified();
+    }
+  return pending;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::Stop()
+{
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->StopRequested = true;
+  }
+  if (this->Thread.joinable())
+    {
+    this->Thread.join();
+    }
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Jobs.clear();
+  this->ThreadRunning = false;
+  for (Model& model : this->Models)
+    {
+    model.JobId = 0;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::RemoveModel(vtkMRMLModelNode* modelNode)
+{
+  for (std::vector<Model>::iterator model = this->Models.begin(); model != this->Models.end(); ++model)
+    {
+    if (model->ModelNode == modelNode)
+      {
+      this->ShowLevel(*model, 0);
+      this->RemoveLevelNodes(*model);
+      this->Models.erase(model);
+      this->Modified();
+      return;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::RemoveAllModels()
+{
+  for (Model& model : this->Models)
+    {
+    this->ShowLevel(model, 0);
+    this->RemoveLevelNodes(model);
+    }
+  this->Models.clear();
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Jobs.remove_if([](const Job& job) { return !job.Started; });
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::RemoveLevelNodes(Model& model)
+{
+  vtkMRMLScene* scene = this->Scene;
+  for (int level = 0; level < NumberOfLevels; ++level)
+    {
+    vtkMRMLModelNode* levelNode = model.LevelNodes[level];
+    // Nodes are already being removed when the scene is closed
+    if (scene && levelNode && !scene->IsClosing())
+      {
+      scene->RemoveNode(levelNode);
+      }
+    model.LevelNodes[level] = nullptr;
+    model.NumberOfTriangles[level] = 0;
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIModelLOD::Model* vtkTAVIModelLOD::GetModel(vtkMRMLModelNode* modelNode)
+{
+  for (Model& model : this->Models)
+    {
+    if (modelNode && model.ModelNode == modelNode)
+      {
+      return &model;
+      }
+    }
+  return nullptr;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIModelLOD::GetNumberOfModels()
+{
+  return static_cast<int>(this->Models.size());
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLModelNode* vtkTAVIModelLOD::GetNthModelNode(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->Models.size()))
+    {
+    return nullptr;
+    }
+  return this->Models[index].ModelNode;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkTAVIModelLOD::GetLevelNumberOfTriangles(vtkMRMLModelNode* modelNode, int level)
+{
+  Model* model = this->GetModel(modelNode);
+  if (!model || level < 0 || level >= NumberOfLevels)
+    {
+    return 0;
+    }
+  return model->NumberOfTriangles[level];
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIModelLOD::GetShownLevel(vtkMRMLModelNode* modelNode)
+{
+  Model* model = this->GetModel(modelNode);
+  return model ? model->ShownLevel : 0;
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVIModelLOD::GetBuildTime(vtkMRMLModelNode* modelNode)
+{
+  Model* model = this->GetModel(modelNode);
+  return model ? model->BuildTime : 0.0;
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVIModelLOD::GetLevelFrameTime(int level)
+{
+  if (level < 0 || level >= NumberOfLevels || this->FrameCounts[level] == 0)
+    {
+    return 0.0;
+    }
+  return this->FrameTimeSums[level] / this->FrameCounts[level];
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIModelLOD::GetLevelNumberOfFrames(int level)
+{
+  if (level < 0 || level >= NumberOfLevels)
+    {
+    return 0;
+    }
+  return this->FrameCounts[level];
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::ResetFrameTimes()
+{
+  std::fill(this->FrameTimeSums, this->FrameTimeSums + NumberOfLevels, 0.0);
+  std::fill(this->FrameCounts, this->FrameCounts + NumberOfLevels, 0);
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::OnRendererEvent(vtkObject* vtkNotUsed(caller),
+  unsigned long eid, void* clientData, void* vtkNotUsed(callData))
+{
+  vtkTAVIModelLOD* self = static_cast<vtkTAVIModelLOD*>(clientData);
+  vtkRenderer* renderer = self->Renderer;
+  if (self->Models.empty() || !renderer || eid != vtkCommand::EndEvent)
+    {
+    return;
+    }
+  self->FrameTimeSums[self->RenderedLevel] += renderer->GetLastRenderTimeInSeconds() * 1000.0;
+  ++self->FrameCounts[self->RenderedLevel];
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::OnInteractorEvent(vtkObject* vtkNotUsed(caller),
+  unsigned long eid, void* clientData, void* vtkNotUsed(callData))
+{
+  vtkTAVIModelLOD* self = static_cast<vtkTAVIModelLOD*>(clientData);
+  self->Interacting = (eid == vtkCommand::StartInteractionEvent);
+  self->SelectLevels();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::SelectLevels()
+{
+  const int previousRenderedLevel = this->RenderedLevel;
+  this->RenderedLevel = 0;
+  for (Model& model : this->Models)
+    {
+    this->ShowLevel(model, this->Interacting ? this->GetInteractiveLevel(model) : 0);
+    this->RenderedLevel = std::max(this->RenderedLevel, model.ShownLevel);
+    }
+  // The last frame of the interaction was rendered with the coarse levels
+  if (previousRenderedLevel > 0 && this->RenderedLevel == 0 && this->Interactor)
+    {
+    this->Interactor->Render();
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIModelLOD::GetInteractiveLevel(const Model& model)
+{
+  vtkRenderer* renderer = this->Renderer;
+  vtkMRMLModelNode* modelNode = model.ModelNode;
+  vtkCamera* camera = renderer ? renderer->GetActiveCamera() : nullptr;
+  const int* size = renderer ? renderer->GetSize() : nullptr;
+  if (!modelNode || !camera || !size || size[0] <= 0 || size[1] <= 0)
+    {
+    return 0;
+    }
+  double bounds[6];
+  modelNode->GetRASBounds(bounds);
+  if (bounds[0] > bounds[1])
+    {
+    return 0;
+    }
+
+  // On-screen area of the bounding sphere of the model, in pixels
+  const double center[3] = { (bounds[0] + bounds[1]) / 2.0, (bounds[2] + bounds[3]) / 2.0,
+    (bounds[4] + bounds[5]) / 2.0 };
+  const double radius = std::sqrt((bounds[1] - bounds[0]) * (bounds[1] - bounds[0])
+    + (bounds[3] - bounds[2]) * (bounds[3] - bounds[2]) + (bounds[5] - bounds[4]) * (bounds[5] - bounds[4])) / 2.0;
+  double pixelsPerMm = 0.0;
+  if (camera->GetParallelProjection())
+    {
+    pixelsPerMm = size[1] / (2.0 * std::max(camera->GetParallelScale(), 1e-6));
+    }
+  else
+    {
+    const double distance = std::max(std::sqrt(vtkMath::Distance2BetweenPoints(center, camera->GetPosition())), 1e-6);
+    pixelsPerMm = size[1] / (2.0 * distance * std::tan(vtkMath::RadiansFromDegrees(camera->GetViewAngle()) / 2.0));
+    }
+  const double projectedRadius = radius * pixelsPerMm;
+  const double area = std::min(vtkMath::Pi() * projectedRadius * projectedRadius, static_cast<double>(size[0]) * size[1]);
+  const double requiredTriangles = this->TrianglesPerPixel * area;
+
+  // Coarsest level with enough triangles for its size, then coarser ones within the budget
+  int level = 0;
+  for (int coarseLevel = NumberOfLevels - 1; coarseLevel > 0; --coarseLevel)
+    {
+    if (model.LevelNodes[coarseLevel] && model.NumberOfTriangles[coarseLevel] >= requiredTriangles)
+      {
+      level = coarseLevel;
+      break;
+      }
+    }
+  while (level < NumberOfLevels - 1 && model.NumberOfTriangles[level] > this->MaximumInteractiveTriangles
+    && model.LevelNodes[level + 1])
+    {
+    ++level;
+    }
+  return level;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::ShowLevel(Model& model, int level)
+{
+  vtkMRMLModelNode* modelNode = model.ModelNode;
+  vtkMRMLModelDisplayNode* displayNode = modelNode ? modelNode->GetModelDisplayNode() : nullptr;
+  if (level == model.ShownLevel || !displayNode)
+    {
+    return;
+    }
+  if (level > 0 && model.ShownLevel == 0)
+    {
+    // Models hidden by the user stay hidden
+    if (!(displayNode->GetVisibility() && displayNode->GetVisibility3D())
+      || (this->ViewNodeID && !displayNode->IsDisplayableInView(this->ViewNodeID)))
+      {
+      return;
+      }
+    }
+  vtkMRMLModelNode* shownLevelNode = model.LevelNodes[model.ShownLevel];
+  if (shownLevelNode && shownLevelNode->GetDisplayNode())
+    {
+    shownLevelNode->GetDisplayNode()->SetVisibility(false);
+    }
+  vtkMRMLModelNode* levelNode = model.LevelNodes[level];
+  vtkMRMLModelDisplayNode* levelDisplayNode = levelNode ? levelNode->GetModelDisplayNode() : nullptr;
+  if (level > 0 && levelDisplayNode)
+    {
+    if (model.ShownLevel == 0)
+      {
+      model.ViewNodeIDs = displayNode->GetViewNodeIDs();
+      }
+    // The level looks like the model, in the 3D view of the renderer only
+    int wasModifying = levelDisplayNode->StartModify();
+    levelDisplayNode->CopyContent(displayNode);
+    levelDisplayNode->SetHideFromEditors(true);
+    levelDisplayNode->SetSaveWithScene(false);
+    levelDisplayNode->SetVisibility(true);
+    levelDisplayNode->SetVisibility3D(true);
+    levelDisplayNode->SetVisibility2D(false);
+    levelDisplayNode->SetViewNodeIDs(this->ViewNodeID ? std::vector<std::string>(1, this->ViewNodeID)
+      : model.ViewNodeIDs);
+    levelDisplayNode->EndModify(wasModifying);
+    levelNode->SetAndObserveTransformNodeID(modelNode->GetTransformNodeID());
+    if (model.ShownLevel == 0)
+      {
+      this->HideModel(model);
+      }
+    }
+  else
+    {
+    level = 0;
+    if (model.ShownLevel > 0)
+      {
+      // Views of the model when the level was shown
+      int wasModifying = displayNode->StartModify();
+      displayNode->SetViewNodeIDs(model.ViewNodeIDs);
+      displayNode->SetVisibility3D(true);
+      displayNode->EndModify(wasModifying);
+      }
+    }
+  model.ShownLevel = level;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIModelLOD::HideModel(Model& model)
+{
+  vtkMRMLModelNode* modelNode = model.ModelNode;
+  vtkMRMLModelDisplayNode* displayNode = modelNode ? modelNode->GetModelDisplayNode() : nullptr;
+  vtkMRMLScene* scene = this->Scene;
+  if (!displayNode)
+    {
+    return;
+    }
+  if (!this->ViewNodeID || !scene)
+    {
+    displayNode->SetVisibility3D(false);
+    return;
+    }
+  // The model stays visible in the other views, slice intersections included
+  std::vector<std::string> viewNodeIDs = model.ViewNodeIDs;
+  if (viewNodeIDs.empty())
+    {
+    std::vector<vtkMRMLNode*> viewNodes;
+    scene->GetNodesByClass("vtkMRMLAbstractViewNode", viewNodes);
+    for (vtkMRMLNode* viewNode : viewNodes)
+      {
+      viewNodeIDs.emplace_back(viewNode->GetID());
+      }
+    }
+  viewNodeIDs.erase(std::remove(viewNodeIDs.begin(), viewNodeIDs.end(), std::string(this->ViewNodeID)),
+    viewNodeIDs.end());
+  if (viewNodeIDs.empty())
+    {
+    displayNode->SetVisibility3D(false);
+    return;
+    }
+  displayNode->SetViewNodeIDs(viewNodeIDs);
+}
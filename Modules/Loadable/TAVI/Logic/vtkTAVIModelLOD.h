@@ -0,0 +1,226 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVIModelLOD_h
+#define __vtkTAVIModelLOD_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkCallbackCommand;
+class vtkInteractorObserver;
+class vtkMRMLModelNode;
+class vtkMRMLScene;
+class vtkPolyData;
+class vtkRenderWindowInteractor;
+class vtkRenderer;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Decimated levels of detail of the large surface models, shown in a 3D view while it is interacted with.
+///
+/// When a model of at least MinimumNumberOfTriangles triangles is added to
+/// the scene (or its mesh is replaced), its levels are built by a background
+/// thread, each with 4 times less triangles than the previous one. Level 0
+/// is the model itself. The mesh is copied by the thread: it is expected to
+/// be replaced rather than modified in place, which also queues a new build.
+/// The levels are hidden model nodes, not saved with the scene.
+/// UpdateModels() adds the levels built by the thread to the scene: it is
+/// called by a timer started on the ModifiedEvent of AddModel(), until it
+/// returns false.
+///
+/// When an interaction of the 3D view of Renderer starts (StartInteractionEvent
+/// of its interactor or interactor style), each model is shown at the coarsest
+/// level that has TrianglesPerPixel triangles per pixel of its on-screen size,
+/// within MaximumInteractiveTriangles. When it ends, the models are shown at
+/// full detail again and a still frame is rendered.
+///
+/// A level is shown by its own display node, restricted to the view
+/// ViewNodeID. Meanwhile the display node of the model excludes that view
+/// from its view node IDs (or is hidden in 3D if ViewNodeID is not set), and
+/// its view node IDs are restored with the full detail.
+///
+/// Frame times are recorded per coarsest level shown, to tune the thresholds.
+///
+/// Example:
+/// \code{.py}
+/// lod = slicer.modules.tavi.logic().GetModelLOD()
+/// threeDView = slicer.app.layoutManager().threeDWidget(0).threeDView()
+/// lod.SetRenderer(threeDView.renderWindow().GetRenderers().GetFirstRenderer())
+/// lod.SetViewNodeID(threeDView.mrmlViewNode().GetID())
+/// timer = qt.QTimer()
+/// timer.singleShot = True
+/// timer.connect("timeout()", lambda: lod.UpdateModels() and timer.start(250))
+/// lod.AddObserver(vtk.vtkCommand.ModifiedEvent, lambda caller, event: timer.start(250))
+/// \endcode
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkTAVIModelLOD : public vtkObject
+{
+public:
+  static vtkTAVIModelLOD* New();
+  vtkTypeMacro(vtkTAVIModelLOD, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  enum
+  {
+    NumberOfLevels = 4
+  };
+
+  /// Scene whose models get levels of detail.
+  void SetScene(vtkMRMLScene* scene);
+  vtkMRMLScene* GetScene();
+
+  /// Renderer of the 3D view in which the levels are switched.
+  void SetRenderer(vtkRenderer* renderer);
+  vtkRenderer* GetRenderer();
+
+  /// ID of the view node of the 3D view of Renderer, in which the levels are
+  /// shown. They are shown in all the 3D views if it is not set.
+  vtkSetStringMacro(ViewNodeID);
+  vtkGetStringMacro(ViewNodeID);
+
+  /// Models with less triangles are always shown at full detail.
+  vtkSetClampMacro(MinimumNumberOfTriangles, vtkIdType, 1000, VTK_ID_MAX);
+  vtkGetMacro(MinimumNumberOfTriangles, vtkIdType);
+
+  /// Triangles per pixel of the on-screen size of a model kept while interacting.
+  vtkSetClampMacro(TrianglesPerPixel, double, 0.01, 100.0);
+  vtkGetMacro(TrianglesPerPixel, double);
+
+  /// Largest number of triangles of a model shown while interacting,
+  /// whatever its on-screen size.
+  vtkSetClampMacro(MaximumInteractiveTriangles, vtkIdType, 1000, VTK_ID_MAX);
+  vtkGetMacro(MaximumInteractiveTriangles, vtkIdType);
+
+  /// Build the levels of \a modelNode, replacing the previous ones.
+  /// Return false if it has less than MinimumNumberOfTriangles triangles.
+  bool AddModel(vtkMRMLModelNode* modelNode);
+  /// Show the model at full detail and remove its levels from the scene.
+  void RemoveModel(vtkMRMLModelNode* modelNode);
+  void RemoveAllModels();
+
+  /// Add the levels built by the background thread to the scene and show
+  /// the models at full detail if the view is not interacted with. The
+  /// interactor of Renderer is observed again if it was replaced.
+  /// Return true while levels remain to be built.
+  bool UpdateModels();
+
+  /// Stop the background thread, after the model being decimated.
+  void Stop();
+
+  int GetNumberOfModels();
+  vtkMRMLModelNode* GetNthModelNode(int index);
+  /// Number of triangles of \a level of \a modelNode, 0 if it is not built.
+  vtkIdType GetLevelNumberOfTriangles(vtkMRMLModelNode* modelNode, int level);
+  /// Level shown in the 3D view, 0 for full detail.
+  int GetShownLevel(vtkMRMLModelNode* modelNode);
+  /// Time to build the levels of \a modelNode, in s.
+  double GetBuildTime(vtkMRMLModelNode* modelNode);
+
+  /// Average render time of the frames whose coarsest shown level was \a level, in ms.
+  double GetLevelFrameTime(int level);
+  int GetLevelNumberOfFrames(int level);
+  void ResetFrameTimes();
+
+protected:
+  vtkTAVIModelLOD();
+  ~vtkTAVIModelLOD() override;
+
+  struct Model
+  {
+    vtkWeakPointer<vtkMRMLModelNode> ModelNode;
+    vtkWeakPointer<vtkMRMLModelNode> LevelNodes[NumberOfLevels]; // none for level 0
+    vtkIdType NumberOfTriangles[NumberOfLevels];
+    int ShownLevel;
+    std::vector<std::string> ViewNodeIDs; // of the model display node, while a level is shown
+    int JobId; // build of the levels, 0 when they are built
+    double BuildTime;
+  };
+
+  /// Levels of one model, built by the background thread.
+  struct Job
+  {
+    int Id;
+    vtkSmartPointer<vtkPolyData> Levels[NumberOfLevels]; // shallow copy of the model mesh for level 0
+    bool Started;
+    bool Done;
+    double BuildTime;
+  };
+
+  /// Background thread: decimate the meshes of the jobs until none is left.
+  void BuildLevels();
+  /// Create the level nodes of the model of a finished job.
+  void AddLevels(Model& model, Job& job);
+
+  Model* GetModel(vtkMRMLModelNode* modelNode);
+  /// Remove the level nodes of \a model from the scene.
+  void RemoveLevelNodes(Model& model);
+
+  static void OnSceneEvent(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+  static void OnRendererEvent(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+  static void OnInteractorEvent(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+  /// Observe the interactor of Renderer and its interactor style.
+  void UpdateInteractorObservers();
+  /// Show each model at the level suited to its on-screen size and the
+  /// interaction, and render a still frame once the full detail is restored.
+  void SelectLevels();
+  /// Level of \a model suited to its on-screen size, while interacting.
+  int GetInteractiveLevel(const Model& model);
+  void ShowLevel(Model& model, int level);
+  /// Hide the model in the view ViewNodeID, in all the 3D views if it is not set.
+  void HideModel(Model& model);
+
+  vtkWeakPointer<vtkMRMLScene> Scene;
+  vtkWeakPointer<vtkRenderer> Renderer;
+  vtkSmartPointer<vtkCallbackCommand> SceneCallback;
+  vtkSmartPointer<vtkCallbackCommand> RendererCallback;
+  vtkWeakPointer<vtkRenderWindowInteractor> Interactor;
+  vtkWeakPointer<vtkInteractorObserver> InteractorStyle;
+  vtkSmartPointer<vtkCallbackCommand> InteractorCallback;
+  bool Interacting;
+  char* ViewNodeID;
+  vtkIdType MinimumNumberOfTriangles;
+  double TrianglesPerPixel;
+  vtkIdType MaximumInteractiveTriangles;
+
+  std::vector<Model> Models;
+  int LastJobId;
+
+  // Coarsest level shown by the render in progress
+  int RenderedLevel;
+  double FrameTimeSums[NumberOfLevels];
+  int FrameCounts[NumberOfLevels];
+
+  std::thread Thread;
+  // Shared with the background thread
+  std::mutex Mutex;
+  std::list<Job> Jobs;
+  bool ThreadRunning;
+  bool StopRequested;
+
+private:
+  vtkTAVIModelLOD(const vtkTAVIModelLOD&) = delete;
+  void operator=(const vtkTAVIModelLOD&) = delete;
+};
+
+#endif
@@ -0,0 +1,303 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkTAVIDICOMSeriesReader.h"
+#include "vtkTAVIPhaseManager.h"
+
+// MRML includes
+#include <vtkMRMLDisplayNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStorageNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkStringArray.h>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTAVIPhaseManager);
+
+//----------------------------------------------------------------------------
+vtkTAVIPhaseManager::vtkTAVIPhaseManager()
+  : MemoryBudget(static_cast<vtkTypeInt64>(4096) * 1024 * 1024)
+  , AccessCounter(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIPhaseManager::~vtkTAVIPhaseManager()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIPhaseManager::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "MemoryBudget: " << this->MemoryBudget << "\n";
+  os << indent << "NumberOfPhases: " << this->Phases.size() << "\n";
+  for (size_t phaseIndex = 0; phaseIndex < this->Phases.size(); ++phaseIndex)
+    {
+    const Phase& phase = this->Phases[phaseIndex];
+    os << indent.GetNextIndent() << phase.Name << ": "
+       << (phase.VolumeNode ? "loaded" : "not loaded")
+       << (phase.Pinned ? ", pinned" : "") << "\n";
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIPhaseManager::SetScene(vtkMRMLScene* scene)
+{
+  if (this->Scene == scene)
+    {
+    return;
+    }
+  this->RemoveAllPhases();
+  this->Scene = scene;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScene* vtkTAVIPhaseManager::GetScene()
+{
+  return this->Scene;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIPhaseManager::IsValidPhase(int phase)
+{
+  if (phase < 0 || phase >= static_cast<int>(this->Phases.size()))
+    {
+    vtkErrorMacro("Invalid phase " << phase);
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIPhaseManager::AddPhase(const char* name, vtkStringArray* fileNames)
+{
+  if (!fileNames || fileNames->GetNumberOfValues() == 0)
+    {
+    vtkErrorMacro("AddPhase: No file for phase " << (name ? name : ""));
+    return -1;
+    }
+  Phase phase;
+  phase.Name = name ? name : "";
+  for (vtkIdType fileIndex = 0; fileIndex < fileNames->GetNumberOfValues(); ++fileIndex)
+    {
+    phase.FileNames.push_back(fileNames->GetValue(fileIndex));
+    }
+  phase.Pinned = false;
+  phase.Size = 0;
+  phase.LastAccess = 0;
+  this->Phases.push_back(phase);
+  this->Modified();
+  return static_cast<int>(this->Phases.size()) - 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIPhaseManager::RemoveAllPhases()
+{
+  for (int phase = 0; phase < static_cast<int>(this->Phases.size()); ++phase)
+    {
+    this->UnloadPhase(phase);
+    }
+  this->Phases.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIPhaseManager::GetNumberOfPhases()
+{
+  return static_cast<int>(this->Phases.size());
+}
+
+//----------------------------------------------------------------------------
+const char* vtkTAVIPhaseManager::GetPhaseName(int phase)
+{
+  return this->IsValidPhase(phase) ? this->Phases[phase].Name.c_str() : nullptr;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIPhaseManager::SetPhasePinned(int phase, bool pinned)
+{
+  if (!this->IsValidPhase(phase) || this->Phases[phase].Pinned == pinned)
+    {
+    return;
+    }
+  this->Phases[phase].Pinned = pinned;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIPhaseManager::GetPhasePinned(int phase)
+{
+  return this->IsValidPhase(phase) && this->Phases[phase].Pinned;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIPhaseManager::IsPhaseLoaded(int phase)
+{
+  if (!this->IsValidPhase(phase))
+    {
+    return false;
+    }
+  // The volume node may have been removed from the scene by the user
+  vtkMRMLScalarVolumeNode* volumeNode = this->Phases[phase].VolumeNode;
+  return volumeNode && volumeNode->GetScene() && volumeNode->GetScene() == this->Scene;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkTAVIPhaseManager::GetPhaseVolumeNode(int phase)
+{
+  if (!this->IsValidPhase(phase))
+    {
+    return nullptr;
+    }
+  this->Phases[phase].LastAccess = ++this->AccessCounter;
+  if (this->IsPhaseLoaded(phase))
+    {
+    return this->Phases[phase].VolumeNode;
+    }
+  this->Phases[phase].VolumeNode = nullptr;
+
+  this->EvictPhases(this->EstimatePhaseSize(), phase);
+  if (!this->LoadPhase(phase))
+    {
+    return nullptr;
+    }
+  // The estimate may have been too low
+  this->EvictPhases(0, phase);
+  if (this->GetLoadedSize() > this->MemoryBudget)
+    {
+    vtkWarningMacro("GetPhaseVolumeNode: Pinned phases use " << this->GetLoadedSize() / (1024 * 1024)
+      << " MB, more than the memory budget of " << this->MemoryBudget / (1024 * 1024) << " MB");
+    }
+  return this->Phases[phase].VolumeNode;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIPhaseManager::LoadPhase(int phase)
+{
+  vtkMRMLScene* scene = this->Scene;
+  if (!scene)
+    {
+    vtkErrorMacro("LoadPhase: No scene");
+    return false;
+    }
+  Phase& phaseToLoad = this->Phases[phase];
+  vtkMRMLScalarVolumeNode* volumeNode = vtkTAVIDICOMSeriesReader::ReadSeries(
+    scene, phaseToLoad.Name, phaseToLoad.FileNames);
+  if (!volumeNode)
+    {
+    vtkErrorMacro("LoadPhase: Failed to read phase " << phaseToLoad.Name << " from " << phaseToLoad.FileNames[0]);
+    return false;
+    }
+
+  phaseToLoad.VolumeNode = volumeNode;
+  vtkImageData* imageData = volumeNode->GetImageData();
+  phaseToLoad.Size = imageData ? static_cast<vtkTypeInt64>(imageData->GetActualMemorySize()) * 1024 : 0;
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIPhaseManager::UnloadPhase(int phase)
+{
+  if (!this->IsPhaseLoaded(phase))
+    {
+    return;
+    }
+  vtkMRMLScalarVolumeNode* volumeNode = this->Phases[phase].VolumeNode;
+  vtkMRMLScene* scene = volumeNode->GetScene();
+  std::vector<vtkMRMLNode*> nodesToRemove;
+  for (int displayNodeIndex = 0; displayNodeIndex < volumeNode->GetNumberOfDisplayNodes(); ++displayNodeIndex)
+    {
+    nodesToRemove.push_back(volumeNode->GetNthDisplayNode(displayNodeIndex));
+    }
+  nodesToRemove.push_back(volumeNode->GetStorageNode());
+  nodesToRemove.push_back(volumeNode);
+  for (vtkMRMLNode* node : nodesToRemove)
+    {
+    if (node)
+      {
+      scene->RemoveNode(node);
+      }
+    }
+  this->Phases[phase].VolumeNode = nullptr;
+  this->Phases[phase].Size = 0;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkTAVIPhaseManager::GetLoadedSize()
+{
+  vtkTypeInt64 loadedSize = 0;
+  for (int phase = 0; phase < static_cast<int>(this->Phases.size()); ++phase)
+    {
+    if (this->IsPhaseLoaded(phase))
+      {
+      loadedSize += this->Phases[phase].Size;
+      }
+    }
+  return loadedSize;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkTAVIPhaseManager::EstimatePhaseSize()
+{
+  // Phases of a series have the same size, use the average of loaded phases
+  vtkTypeInt64 loadedSize = 0;
+  int numberOfLoadedPhases = 0;
+  for (int phase = 0; phase < static_cast<int>(this->Phases.size()); ++phase)
+    {
+    if (this->IsPhaseLoaded(phase))
+      {
+      loadedSize += this->Phases[phase].Size;
+      ++numberOfLoadedPhases;
+      }
+    }
+  return numberOfLoadedPhases > 0 ? loadedSize / numberOfLoadedPhases : 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIPhaseManager::EvictPhases(vtkTypeInt64 requiredSize, int keptPhase)
+{
+  vtkTypeInt64 loadedSize = this->GetLoadedSize();
+  while (loadedSize + requiredSize > this->MemoryBudget)
+    {
+    int leastRecentlyUsedPhase = -1;
+    for (int phase = 0; phase < static_cast<int>(this->Phases.size()); ++phase)
+      {
+      if (phase == keptPhase || this->Phases[phase].Pinned || !this->IsPhaseLoaded(phase))
+        {
+        continue;
+        }
+      if (leastRecentlyUsedPhase < 0 ||
+          this->Phases[phase].LastAccess < this->Phases[leastRecentlyUsedPhase].LastAccess)
+        {
+        leastRecentlyUsedPhase = phase;
+        }
+      }
+    if (leastRecentlyUsedPhase < 0)
+      {
+      // Only pinned phases are left
+      return;
+      }
+    loadedSize -= this->Phases[leastRecentlyUsedPhase].Size;
+    this->UnloadPhase(leastRecentlyUsedPhase);
+    }
+}
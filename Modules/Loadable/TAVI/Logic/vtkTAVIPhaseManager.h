@@ -0,0 +1,119 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVIPhaseManager_h
+#define __vtkTAVIPhaseManager_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <string>
+#include <vector>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkMRMLScalarVolumeNode;
+class vtkMRMLScene;
+class vtkStringArray;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Load the phases of 4D cardiac CT series on demand, under a memory budget.
+///
+/// Phases are registered with the files they are read from (typically the
+/// DICOM files of one cardiac phase, see the TAVIPhases DICOM plugin) and
+/// are only loaded in the scene when GetPhaseVolumeNode() is called.
+///
+/// The memory used by the loaded phases is kept below MemoryBudget by
+/// unloading the least recently accessed phases first. Pinned phases (for
+/// example the systolic and diastolic phases being analyzed) and the phase
+/// being accessed are never unloaded. Unloading a phase removes its volume
+/// node from the scene, it is read again from its files when accessed.
+///
+/// The budget is shared by all the registered phases, whatever their series.
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkTAVIPhaseManager : public vtkObject
+{
+public:
+  static vtkTAVIPhaseManager* New();
+  vtkTypeMacro(vtkTAVIPhaseManager, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Scene in which phases are loaded.
+  void SetScene(vtkMRMLScene* scene);
+  vtkMRMLScene* GetScene();
+
+  /// Maximum memory used by the loaded phases, in bytes.
+  vtkSetMacro(MemoryBudget, vtkTypeInt64);
+  vtkGetMacro(MemoryBudget, vtkTypeInt64);
+
+  /// Register a phase read from \a fileNames, sorted along the slice axis.
+  /// Return the index of the phase.
+  int AddPhase(const char* name, vtkStringArray* fileNames);
+  /// Unload and unregister all the phases.
+  void RemoveAllPhases();
+
+  int GetNumberOfPhases();
+  const char* GetPhaseName(int phase);
+
+  /// Pinned phases are never unloaded to respect the memory budget.
+  void SetPhasePinned(int phase, bool pinned);
+  bool GetPhasePinned(int phase);
+
+  /// Return the volume node of \a phase, loading it if needed.
+  /// Other phases may be unloaded to respect the memory budget.
+  /// Return nullptr if the phase could not be loaded.
+  vtkMRMLScalarVolumeNode* GetPhaseVolumeNode(int phase);
+
+  bool IsPhaseLoaded(int phase);
+  void UnloadPhase(int phase);
+
+  /// Memory used by the loaded phases, in bytes.
+  vtkTypeInt64 GetLoadedSize();
+
+protected:
+  vtkTAVIPhaseManager();
+  ~vtkTAVIPhaseManager() override;
+
+  struct Phase
+  {
+    std::string Name;
+    std::vector<std::string> FileNames;
+    bool Pinned;
+    vtkWeakPointer<vtkMRMLScalarVolumeNode> VolumeNode;
+    vtkTypeInt64 Size; // in bytes, valid when loaded
+    vtkTypeInt64 LastAccess;
+  };
+
+  bool IsValidPhase(int phase);
+  bool LoadPhase(int phase);
+
+  /// Unload the least recently accessed phases, except the pinned ones and
+  /// \a keptPhase, until \a requiredSize more bytes fit in the budget.
+  void EvictPhases(vtkTypeInt64 requiredSize, int keptPhase);
+
+  /// Expected size of a phase that is not loaded yet, in bytes.
+  vtkTypeInt64 EstimatePhaseSize();
+
+  vtkWeakPointer<vtkMRMLScene> Scene;
+  vtkTypeInt64 MemoryBudget;
+  std::vector<Phase> Phases;
+  vtkTypeInt64 AccessCounter;
+
+private:
+  vtkTAVIPhaseManager(const vtkTAVIPhaseManager&) = delete;
+  void operator=(const vtkTAVIPhaseManager&) = delete;
+};
+
+#endif
@@ -0,0 +1,425 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkTAVIMeshBVH.h"
+#include "vtkTAVIProsthesisFitting.h"
+
+// MRML includes
+#include <vtkMRMLDisplayNode.h>
+#include <vtkMRMLMarkupsNode.h>
+#include <vtkMRMLModelDisplayNode.h>
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLTransformNode.h>
+
+// VTK includes
+#include <vtkAssignAttribute.h>
+#include <vtkCallbackCommand.h>
+#include <vtkDoubleArray.h>
+#include <vtkGeneralTransform.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTAVIProsthesisFitting);
+
+namespace
+{
+
+/// Name of the point array of the valve mesh
+const char* InterferenceArrayName = "Interference";
+/// Diverging color table of Slicer, blue for the gaps and red for the interferences
+const char* InterferenceColorNodeID = "vtkMRMLColorTableNodeFileDivergingBlueRed.txt";
+
+//----------------------------------------------------------------------------
+/// Interference of valve points with the root surface: each point starts
+/// from the closest triangle of its previous query, which is usually the
+/// closest one again after a small move of the valve.
+class InterferenceFunctor
+{
+public:
+  InterferenceFunctor(const vtkTAVIMeshBVH* bvh, vtkPoints* points, vtkIdType* closestTriangles,
+    double* interferences)
+    : BVH(bvh)
+    , Points(points)
+    , ClosestTriangles(closestTriangles)
+    , Interferences(interferences)
+    {
+    }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    double point[3];
+    double closestPoint[3];
+    for (vtkIdType pointId = begin; pointId < end; ++pointId)
+      {
+      this->Points->GetPoint(pointId, point);
+      // The distance is positive inside the root, where the valve does not touch it
+      this->Interferences[pointId] = -this->BVH->FindClosestPoint(point, closestPoint, this->ClosestTriangles[pointId]);
+      }
+    }
+
+private:
+  const vtkTAVIMeshBVH* BVH;
+  vtkPoints* Points;
+  vtkIdType* ClosestTriangles;
+  double* Interferences;
+};
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkTAVIProsthesisFitting::vtkTAVIProsthesisFitting()
+  : ContactTolerance(0.5)
+  , InterferenceRange(3.0)
+  , AutoUpdate(false)
+  , Updating(false)
+  , CachedRootPolyDataTime(0)
+  , MaximumInterference(0.0)
+  , InterferenceFraction(0.0)
+  , ContactFraction(0.0)
+  , UpdateTime(0.0)
+{
+  this->NodeCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->NodeCallback->SetCallback(vtkTAVIProsthesisFitting::OnNodeModified);
+  this->NodeCallback->SetClientData(this);
+  this->RootBVH = vtkSmartPointer<vtkTAVIMeshBVH>::New();
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIProsthesisFitting::~vtkTAVIProsthesisFitting()
+{
+  this->AutoUpdate = false;
+  this->UpdateObservers();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIProsthesisFitting::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ContactTolerance: " << this->ContactTolerance << "\n";
+  os << indent << "InterferenceRange: " << this->InterferenceRange << "\n";
+  os << indent << "AutoUpdate: " << this->AutoUpdate << "\n";
+  os << indent << "MaximumInterference: " << this->MaximumInterference << "\n";
+  os << indent << "InterferenceFraction: " << this->InterferenceFraction << "\n";
+  os << indent << "ContactFraction: " << this->ContactFraction << "\n";
+  for (size_t index = 0; index < this->OstiumDistances.size(); ++index)
+    {
+    os << indent << "OstiumDistance " << index << ": " << this->OstiumDistances[index] << "\n";
+    }
+  os << indent << "UpdateTime: " << this->UpdateTime << "\n";
+  os << indent << "RootBVH:\n";
+  this->RootBVH->PrintSelf(os, indent.GetNextIndent());
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIProsthesisFitting::SetRootModelNode(vtkMRMLModelNode* modelNode)
+{
+  if (this->RootModelNode == modelNode)
+    {
+    return;
+    }
+  if (this->RootModelNode)
+    {
+    this->RootModelNode->RemoveObserver(this->NodeCallback);
+    }
+  this->RootModelNode = modelNode;
+  this->ClearCache();
+  this->UpdateObservers();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLModelNode* vtkTAVIProsthesisFitting::GetRootModelNode()
+{
+  return this->RootModelNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIProsthesisFitting::SetValveModelNode(vtkMRMLModelNode* modelNode)
+{
+  if (this->ValveModelNode == modelNode)
+    {
+    return;
+    }
+  if (this->ValveModelNode)
+    {
+    this->ValveModelNode->RemoveObserver(this->NodeCallback);
+    }
+  this->ValveModelNode = modelNode;
+  this->ClosestTriangles.clear();
+  this->UpdateObservers();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLModelNode* vtkTAVIProsthesisFitting::GetValveModelNode()
+{
+  return this->ValveModelNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIProsthesisFitting::SetOstiaNode(vtkMRMLMarkupsNode* markupsNode)
+{
+  if (this->OstiaNode == markupsNode)
+    {
+    return;
+    }
+  if (this->OstiaNode)
+    {
+    this->OstiaNode->RemoveObserver(this->NodeCallback);
+    }
+  this->OstiaNode = markupsNode;
+  this->UpdateObservers();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLMarkupsNode* vtkTAVIProsthesisFitting::GetOstiaNode()
+{
+  return this->OstiaNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIProsthesisFitting::SetAutoUpdate(bool autoUpdate)
+{
+  if (this->AutoUpdate == autoUpdate)
+    {
+    return;
+    }
+  this->AutoUpdate = autoUpdate;
+  this->UpdateObservers();
+  this->Modified();
+  if (autoUpdate)
+    {
+    this->Update();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIProsthesisFitting::UpdateObservers()
+{
+  if (this->RootModelNode)
+    {
+    this->RootModelNode->RemoveObserver(this->NodeCallback);
+    }
+  if (this->ValveModelNode)
+    {
+    this->ValveModelNode->RemoveObserver(this->NodeCallback);
+    }
+  if (this->OstiaNode)
+    {
+    this->OstiaNode->RemoveObserver(this->NodeCallback);
+    }
+  if (!this->AutoUpdate)
+    {
+    return;
+    }
+  if (this->RootModelNode)
+    {
+    this->RootModelNode->AddObserver(vtkMRMLModelNode::MeshModifiedEvent, this->NodeCallback);
+    this->RootModelNode->AddObserver(vtkMRMLTransformableNode::TransformModifiedEvent, this->NodeCallback);
+    }
+  if (this->ValveModelNode)
+    {
+    this->ValveModelNode->AddObserver(vtkMRMLModelNode::MeshModifiedEvent, this->NodeCallback);
+    this->ValveModelNode->AddObserver(vtkMRMLTransformableNode::TransformModifiedEvent, this->NodeCallback);
+    }
+  if (this->OstiaNode)
+    {
+    this->OstiaNode->AddObserver(vtkMRMLMarkupsNode::PointModifiedEvent, this->NodeCallback);
+    this->OstiaNode->AddObserver(vtkMRMLMarkupsNode::PointAddedEvent, this->NodeCallback);
+    this->OstiaNode->AddObserver(vtkMRMLMarkupsNode::PointRemovedEvent, this->NodeCallback);
+    this->OstiaNode->AddObserver(vtkMRMLTransformableNode::TransformModifiedEvent, this->NodeCallback);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIProsthesisFitting::OnNodeModified(vtkObject* vtkNotUsed(caller),
+  unsigned long vtkNotUsed(eid), void* clientData, void* vtkNotUsed(callData))
+{
+  vtkTAVIProsthesisFitting* self = static_cast<vtkTAVIProsthesisFitting*>(clientData);
+  self->Update();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIProsthesisFitting::ClearCache()
+{
+  this->RootBVH->Initialize();
+  this->CachedRootPolyData = nullptr;
+  this->CachedRootPolyDataTime = 0;
+  this->ClosestTriangles.clear();
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIProsthesisFitting::GetNumberOfOstia()
+{
+  return static_cast<int>(this->OstiumDistances.size());
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVIProsthesisFitting::GetOstiumDistance(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->OstiumDistances.size()))
+    {
+    vtkErrorMacro("GetOstiumDistance: Invalid index " << index);
+    return 0.0;
+    }
+  return this->OstiumDistances[index];
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVIProsthesisFitting::GetBuildTime()
+{
+  return this->RootBVH->GetBuildTime();
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIProsthesisFitting::Update()
+{
+  vtkMRMLModelNode* rootModelNode = this->RootModelNode;
+  vtkMRMLModelNode* valveModelNode = this->ValveModelNode;
+  vtkPolyData* rootPolyData = rootModelNode ? rootModelNode->GetPolyData() : nullptr;
+  vtkPolyData* valvePolyData = valveModelNode ? valveModelNode->GetPolyData() : nullptr;
+  if (!rootPolyData || !valvePolyData || !valvePolyData->GetPoints() || rootModelNode == valveModelNode)
+    {
+    return false;
+    }
+  if (this->Updating)
+    {
+    return false;
+    }
+  this->Updating = true;
+  const double startTime = vtkTimerLog::GetUniversalTime();
+
+  // The hierarchy is only built again if the root mesh changed
+  if (this->CachedRootPolyData != rootPolyData || this->CachedRootPolyDataTime != rootPolyData->GetMTime())
+    {
+    this->ClearCache();
+    if (!this->RootBVH->Build(rootPolyData))
+      {
+      vtkErrorMacro("Update: No surface in " << (rootModelNode->GetName() ? rootModelNode->GetName() : ""));
+      this->Updating = false;
+      return false;
+      }
+    this->CachedRootPolyData = rootPolyData;
+    this->CachedRootPolyDataTime = rootPolyData->GetMTime();
+    }
+
+  // Valve points in the coordinates of the root model
+  vtkNew<vtkGeneralTransform> valveToRoot;
+  vtkMRMLTransformNode::GetTransformBetweenNodes(valveModelNode->GetParentTransformNode(),
+    rootModelNode->GetParentTransformNode(), valveToRoot);
+  vtkNew<vtkPoints> valvePoints;
+  valvePoints->SetDataTypeToDouble();
+  valveToRoot->TransformPoints(valvePolyData->GetPoints(), valvePoints);
+  const vtkIdType numberOfPoints = valvePoints->GetNumberOfPoints();
+
+  vtkSmartPointer<vtkDoubleArray> interferences =
+    vtkDoubleArray::SafeDownCast(valvePolyData->GetPointData()->GetArray(InterferenceArrayName));
+  if (!interferences)
+    {
+    interferences = vtkSmartPointer<vtkDoubleArray>::New();
+    interferences->SetName(InterferenceArrayName);
+    valvePolyData->GetPointData()->AddArray(interferences);
+    }
+  interferences->SetNumberOfComponents(1);
+  interferences->SetNumberOfTuples(numberOfPoints);
+  if (static_cast<vtkIdType>(this->ClosestTriangles.size()) != numberOfPoints)
+    {
+    this->ClosestTriangles.assign(numberOfPoints, -1);
+    }
+  InterferenceFunctor functor(this->RootBVH, valvePoints, this->ClosestTriangles.data(), interferences->GetPointer(0));
+  vtkSMPTools::For(0, numberOfPoints, functor);
+
+  this->MaximumInterference = numberOfPoints > 0 ? -std::numeric_limits<double>::max() : 0.0;
+  vtkIdType numberOfInterferences = 0;
+  vtkIdType numberOfContacts = 0;
+  for (vtkIdType pointId = 0; pointId < numberOfPoints; ++pointId)
+    {
+    const double interference = interferences->GetValue(pointId);
+    this->MaximumInterference = std::max(this->MaximumInterference, interference);
+    numberOfInterferences += interference > 0.0 ? 1 : 0;
+    numberOfContacts += interference > -this->ContactTolerance ? 1 : 0;
+    }
+  this->InterferenceFraction = numberOfPoints > 0 ? static_cast<double>(numberOfInterferences) / numberOfPoints : 0.0;
+  this->ContactFraction = numberOfPoints > 0 ? static_cast<double>(numberOfContacts) / numberOfPoints : 0.0;
+
+  // Distance from the ostia to the valve
+  this->OstiumDistances.clear();
+  vtkMRMLMarkupsNode* ostiaNode = this->OstiaNode;
+  if (ostiaNode && numberOfPoints > 0)
+    {
+    vtkNew<vtkGeneralTransform> worldToRoot;
+    vtkMRMLTransformNode::GetTransformBetweenNodes(nullptr, rootModelNode->GetParentTransformNode(), worldToRoot);
+    for (int index = 0; index < ostiaNode->GetNumberOfControlPoints(); ++index)
+      {
+      double ostiumWorld[3];
+      double ostium[3];
+      ostiaNode->GetNthControlPointPositionWorld(index, ostiumWorld);
+      worldToRoot->TransformPoint(ostiumWorld, ostium);
+      double distance2 = std::numeric_limits<double>::max();
+      for (vtkIdType pointId = 0; pointId < numberOfPoints; ++pointId)
+        {
+        distance2 = std::min(distance2, vtkMath::Distance2BetweenPoints(ostium, valvePoints->GetPoint(pointId)));
+        }
+      this->OstiumDistances.push_back(std::sqrt(distance2));
+      }
+    }
+
+  // Modifying the mesh invokes MeshModifiedEvent, ignored while updating
+  valvePolyData->GetPointData()->SetActiveScalars(InterferenceArrayName);
+  valvePolyData->Modified();
+  this->UpdateValveDisplay();
+
+  this->UpdateTime = (vtkTimerLog::GetUniversalTime() - startTime) * 1000.0;
+  vtkDebugMacro("Update: " << numberOfPoints << " valve points against " << this->RootBVH->GetNumberOfTriangles()
+    << " root triangles in " << this->UpdateTime << " ms");
+  this->Updating = false;
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIProsthesisFitting::UpdateValveDisplay()
+{
+  vtkMRMLModelNode* valveModelNode = this->ValveModelNode;
+  if (!valveModelNode->GetDisplayNode() && valveModelNode->GetScene())
+    {
+    valveModelNode->CreateDefaultDisplayNodes();
+    }
+  vtkMRMLModelDisplayNode* displayNode = valveModelNode->GetModelDisplayNode();
+  if (!displayNode)
+    {
+    return;
+    }
+  int wasModifying = displayNode->StartModify();
+  displayNode->SetActiveScalar(InterferenceArrayName, vtkAssignAttribute::POINT_DATA);
+  displayNode->SetAndObserveColorNodeID(InterferenceColorNodeID);
+  displayNode->SetScalarRangeFlag(vtkMRMLDisplayNode::UseManualScalarRange);
+  displayNode->SetScalarRange(-this->InterferenceRange, this->InterferenceRange);
+  displayNode->SetScalarVisibility(true);
+  displayNode->EndModify(wasModifying);
+}
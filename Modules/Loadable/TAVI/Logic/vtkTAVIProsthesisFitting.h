@@ -0,0 +1,157 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVIProsthesisFitting_h
+#define __vtkTAVIProsthesisFitting_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkCallbackCommand;
+class vtkMRMLMarkupsNode;
+class vtkMRMLModelNode;
+class vtkPolyData;
+class vtkTAVIMeshBVH;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Interference map of a virtual valve prosthesis against the aortic root surface.
+///
+/// For each point of the valve model, the signed distance to the aortic root
+/// lumen surface is computed and stored in the "Interference" point array of
+/// the valve mesh: positive values are the depth of the valve beyond the wall
+/// (oversizing), negative values the gap between the valve and the wall. The
+/// valve model is colored by this array, red where it presses on the wall and
+/// blue where it does not touch it, over [-InterferenceRange, InterferenceRange].
+///
+/// The bounding volume hierarchy of the root surface is built once per mesh
+/// and reused while the valve is moved, the distances of the valve points
+/// being queried in parallel, each starting from the closest triangle of its
+/// previous query. With AutoUpdate, the map is updated whenever the valve or
+/// its transform is modified, which makes it follow the interactive
+/// positioning of the valve.
+///
+/// The distances from the coronary ostia (control points of OstiaNode) to
+/// the valve are also reported, to assess the risk of coronary obstruction.
+/// Distances are computed in the coordinates of the root model.
+///
+/// Example:
+/// \code{.py}
+/// fitting = slicer.modules.tavi.logic().GetProsthesisFitting()
+/// fitting.SetRootModelNode(aorticRootModelNode)
+/// fitting.SetValveModelNode(valveModelNode)
+/// fitting.SetOstiaNode(ostiaNode)
+/// fitting.SetAutoUpdate(True)
+/// print(fitting.GetMaximumInterference(), fitting.GetContactFraction())
+/// \endcode
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkTAVIProsthesisFitting : public vtkObject
+{
+public:
+  static vtkTAVIProsthesisFitting* New();
+  vtkTypeMacro(vtkTAVIProsthesisFitting, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Lumen surface of the aortic root, the LVOT and the ascending aorta.
+  /// The sign of the distances assumes a closed surface.
+  void SetRootModelNode(vtkMRMLModelNode* modelNode);
+  vtkMRMLModelNode* GetRootModelNode();
+
+  /// Valve prosthesis model, positioned by its parent transform.
+  /// Its mesh receives the "Interference" point array.
+  void SetValveModelNode(vtkMRMLModelNode* modelNode);
+  vtkMRMLModelNode* GetValveModelNode();
+
+  /// Optional coronary ostia, one control point per ostium.
+  void SetOstiaNode(vtkMRMLMarkupsNode* markupsNode);
+  vtkMRMLMarkupsNode* GetOstiaNode();
+
+  /// Gap below which a valve point is in contact with the wall, in mm.
+  vtkSetClampMacro(ContactTolerance, double, 0.0, 10.0);
+  vtkGetMacro(ContactTolerance, double);
+
+  /// Half width of the color range of the valve model, in mm.
+  vtkSetClampMacro(InterferenceRange, double, 0.1, 100.0);
+  vtkGetMacro(InterferenceRange, double);
+
+  /// Update the map when the valve, the root or the ostia are modified.
+  void SetAutoUpdate(bool autoUpdate);
+  vtkGetMacro(AutoUpdate, bool);
+  vtkBooleanMacro(AutoUpdate, bool);
+
+  /// Compute the interference map and statistics.
+  /// Return false if the root or the valve is missing or has no mesh.
+  bool Update();
+
+  /// Release the hierarchy of the root surface.
+  void ClearCache();
+
+  /// Statistics of the last Update().
+  /// Largest interference, negative (the smallest gap) if the valve does not touch the wall.
+  vtkGetMacro(MaximumInterference, double);
+  /// Fraction of the valve points beyond the wall.
+  vtkGetMacro(InterferenceFraction, double);
+  /// Fraction of the valve points beyond the wall or closer than ContactTolerance.
+  vtkGetMacro(ContactFraction, double);
+  /// Distance from each ostium to the closest valve point, in mm.
+  int GetNumberOfOstia();
+  double GetOstiumDistance(int index);
+  /// Time of the last Update(), in ms, including the BuildTime of the hierarchy if it was rebuilt.
+  vtkGetMacro(UpdateTime, double);
+  /// Time of the last build of the hierarchy of the root surface, in ms.
+  double GetBuildTime();
+
+protected:
+  vtkTAVIProsthesisFitting();
+  ~vtkTAVIProsthesisFitting() override;
+
+  static void OnNodeModified(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+  void UpdateObservers();
+
+  /// Color the valve model by the interference, if it has a display node.
+  void UpdateValveDisplay();
+
+  vtkWeakPointer<vtkMRMLModelNode> RootModelNode;
+  vtkWeakPointer<vtkMRMLModelNode> ValveModelNode;
+  vtkWeakPointer<vtkMRMLMarkupsNode> OstiaNode;
+  vtkSmartPointer<vtkCallbackCommand> NodeCallback;
+  double ContactTolerance;
+  double InterferenceRange;
+  bool AutoUpdate;
+  bool Updating;
+
+  // Hierarchy of the root surface and the mesh it was built from
+  vtkSmartPointer<vtkTAVIMeshBVH> RootBVH;
+  vtkWeakPointer<vtkPolyData> CachedRootPolyData;
+  vtkMTimeType CachedRootPolyDataTime;
+  /// Closest root triangle of each valve point at the last Update().
+  std::vector<vtkIdType> ClosestTriangles;
+
+  double MaximumInterference;
+  double InterferenceFraction;
+  double ContactFraction;
+  std::vector<double> OstiumDistances;
+  double UpdateTime;
+
+private:
+  vtkTAVIProsthesisFitting(const vtkTAVIProsthesisFitting&) = delete;
+  void operator=(const vtkTAVIProsthesisFitting&) = delete;
+};
+
+#endif
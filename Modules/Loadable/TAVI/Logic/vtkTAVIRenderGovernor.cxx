@@ -0,0 +1,334 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkTAVIRenderGovernor.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkFixedPointVolumeRayCastMapper.h>
+#include <vtkGPUVolumeRayCastMapper.h>
+#include <vtkInteractorObserver.h>
+#include <vtkObjectFactory.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkRenderer.h>
+#include <vtkVolume.h>
+#include <vtkVolumeCollection.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTAVIRenderGovernor);
+
+namespace
+{
+
+/// Quality levels, each roughly halving the cost of the previous one:
+/// factor of the sample distance along the rays, and image sample distance.
+const double LevelSampleDistanceFactors[vtkTAVIRenderGovernor::NumberOfLevels] =
+  { 1.0, 2.0, 2.0, 4.0, 4.0, 8.0, 8.0, 8.0 };
+const double LevelImageSampleDistances[vtkTAVIRenderGovernor::NumberOfLevels] =
+  { 1.0, 1.0, 1.5, 1.5, 2.0, 2.0, 3.0, 4.0 };
+
+/// A frame slower than the target by this ratio moves to a coarser level
+const double SlowFrameRatio = 1.25;
+/// A frame faster than the target by this ratio moves to a finer level,
+/// which would still be faster than the target.
+const double FastFrameRatio = 0.4;
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkTAVIRenderGovernor::vtkTAVIRenderGovernor()
+  : Interacting(false)
+  , Enabled(true)
+  , TargetFrameRate(10.0)
+  , Level(0)
+  , RenderedLevel(0)
+  , RenderedInteractive(false)
+  , LastInteractiveFrameTime(0.0)
+  , LastStillFrameTime(0.0)
+{
+  this->RendererCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->RendererCallback->SetCallback(vtkTAVIRenderGovernor::OnRendererEvent);
+  this->RendererCallback->SetClientData(this);
+  this->InteractorCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->InteractorCallback->SetCallback(vtkTAVIRenderGovernor::OnInteractorEvent);
+  this->InteractorCallback->SetClientData(this);
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIRenderGovernor::~vtkTAVIRenderGovernor()
+{
+  this->SetRenderer(nullptr);
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRenderGovernor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Enabled: " << this->Enabled << "\n";
+  os << indent << "TargetFrameRate: " << this->TargetFrameRate << "\n";
+  os << indent << "Level: " << this->Level << "\n";
+  os << indent << "NumberOfMappers: " << this->Mappers.size() << "\n";
+  os << indent << "LastInteractiveFrameTime: " << this->LastInteractiveFrameTime << " ms\n";
+  os << indent << "LastStillFrameTime: " << this->LastStillFrameTime << " ms\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRenderGovernor::SetRenderer(vtkRenderer* renderer)
+{
+  if (this->Renderer == renderer)
+    {
+    return;
+    }
+  this->RestoreMappers();
+  if (this->Renderer)
+    {
+    this->Renderer->RemoveObserver(this->RendererCallback);
+    }
+  this->Interacting = false;
+  this->Renderer = renderer;
+  if (renderer)
+    {
+    renderer->AddObserver(vtkCommand::StartEvent, this->RendererCallback);
+    renderer->AddObserver(vtkCommand::EndEvent, this->RendererCallback);
+    }
+  this->UpdateInteractorObservers();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkRenderer* vtkTAVIRenderGovernor::GetRenderer()
+{
+  return this->Renderer;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRenderGovernor::SetEnabled(bool enabled)
+{
+  if (this->Enabled == enabled)
+    {
+    return;
+    }
+  this->Enabled = enabled;
+  if (!enabled)
+    {
+    this->RestoreMappers();
+    }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVIRenderGovernor::GetLevelSampleDistanceFactor(int level)
+{
+  return LevelSampleDistanceFactors[std::min(std::max(level, 0), static_cast<int>(NumberOfLevels) - 1)];
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVIRenderGovernor::GetLevelImageSampleDistance(int level)
+{
+  return LevelImageSampleDistances[std::min(std::max(level, 0), static_cast<int>(NumberOfLevels) - 1)];
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIRenderGovernor::GetNumberOfMappers()
+{
+  return static_cast<int>(this->Mappers.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRenderGovernor::UpdateInteractorObservers()
+{
+  vtkRenderer* renderer = this->Renderer;
+  vtkRenderWindow* renderWindow = renderer ? renderer->GetRenderWindow() : nullptr;
+  vtkRenderWindowInteractor* interactor = renderWindow ? renderWindow->GetInteractor() : nullptr;
+  vtkInteractorObserver* interactorStyle = interactor ? interactor->GetInteractorStyle() : nullptr;
+  if (this->Interactor == interactor && this->InteractorStyle == interactorStyle)
+    {
+    return;
+    }
+  if (this->Interactor)
+    {
+    this->Interactor->RemoveObserver(this->InteractorCallback);
+    }
+  if (this->InteractorStyle)
+    {
+    this->InteractorStyle->RemoveObserver(this->InteractorCallback);
+    }
+  this->Interactor = interactor;
+  this->InteractorStyle = interactorStyle;
+  // Camera manipulations are reported by the interactor style. The state is
+  // updated before other observers (e.g. vtkTAVIModelLOD) render a frame.
+  vtkObject* observedObjects[2] = { interactor, interactorStyle };
+  for (vtkObject* observedObject : observedObjects)
+    {
+    if (observedObject)
+      {
+      observedObject->AddObserver(vtkCommand::StartInteractionEvent, this->InteractorCallback, 1.0);
+      observedObject->AddObserver(vtkCommand::EndInteractionEvent, this->InteractorCallback, 1.0);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRenderGovernor::OnInteractorEvent(vtkObject* vtkNotUsed(caller),
+  unsigned long eid, void* clientData, void* vtkNotUsed(callData))
+{
+  vtkTAVIRenderGovernor* self = static_cast<vtkTAVIRenderGovernor*>(clientData);
+  self->Interacting = (eid == vtkCommand::StartInteractionEvent);
+  // The last frame of the interaction was rendered at a coarser level
+  if (!self->Interacting && self->Enabled && self->RenderedLevel != 0 && self->Interactor)
+    {
+    self->Interactor->Render();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRenderGovernor::OnRendererEvent(vtkObject* vtkNotUsed(caller),
+  unsigned long eid, void* clientData, void* vtkNotUsed(callData))
+{
+  vtkTAVIRenderGovernor* self = static_cast<vtkTAVIRenderGovernor*>(clientData);
+  vtkRenderer* renderer = self->Renderer;
+  if (!self->Enabled || !renderer)
+    {
+    return;
+    }
+  if (eid == vtkCommand::StartEvent)
+    {
+    // The interactor of the render window may have been replaced
+    self->UpdateInteractorObservers();
+    self->RenderedInteractive = self->Interacting;
+    self->RenderedLevel = self->RenderedInteractive ? self->Level : 0;
+    self->ApplyLevel(self->RenderedLevel);
+    return;
+    }
+  if (eid != vtkCommand::EndEvent || self->Mappers.empty())
+    {
+    return;
+    }
+  const double frameTime = renderer->GetLastRenderTimeInSeconds() * 1000.0;
+  if (!self->RenderedInteractive)
+    {
+    self->LastStillFrameTime = frameTime;
+    return;
+    }
+  // One step per frame, the next frame tells whether it was enough
+  self->LastInteractiveFrameTime = frameTime;
+  const double targetFrameTime = 1000.0 / self->TargetFrameRate;
+  if (frameTime > SlowFrameRatio * targetFrameTime && self->Level < NumberOfLevels - 1)
+    {
+    ++self->Level;
+    }
+  else if (frameTime < FastFrameRatio * targetFrameTime && self->Level > 0)
+    {
+    --self->Level;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRenderGovernor::ApplyLevel(int level)
+{
+  vtkRenderer* renderer = this->Renderer;
+  vtkVolumeCollection* volumes = renderer ? renderer->GetVolumes() : nullptr;
+  if (!volumes)
+    {
+    return;
+    }
+  const double sampleDistanceFactor = vtkTAVIRenderGovernor::GetLevelSampleDistanceFactor(level);
+  const double imageSampleDistance = vtkTAVIRenderGovernor::GetLevelImageSampleDistance(level);
+  std::vector<MapperState> mappers;
+  vtkCollectionSimpleIterator it;
+  volumes->InitTraversal(it);
+  while (vtkVolume* volume = volumes->GetNextVolume(it))
+    {
+    vtkFixedPointVolumeRayCastMapper* cpuMapper = vtkFixedPointVolumeRayCastMapper::SafeDownCast(volume->GetMapper());
+    vtkGPUVolumeRayCastMapper* gpuMapper = vtkGPUVolumeRayCastMapper::SafeDownCast(volume->GetMapper());
+    vtkVolumeMapper* mapper = cpuMapper ? static_cast<vtkVolumeMapper*>(cpuMapper) : gpuMapper;
+    if (!mapper)
+      {
+      continue;
+      }
+    const double currentSampleDistance = cpuMapper ? cpuMapper->GetSampleDistance() : gpuMapper->GetSampleDistance();
+    const double currentImageSampleDistance =
+      cpuMapper ? cpuMapper->GetImageSampleDistance() : gpuMapper->GetImageSampleDistance();
+    MapperState state;
+    std::vector<MapperState>::iterator previousState = std::find_if(this->Mappers.begin(), this->Mappers.end(),
+      [mapper](const MapperState& mapperState) { return mapperState.Mapper == mapper; });
+    if (previousState != this->Mappers.end() && previousState->SampleDistance == currentSampleDistance
+        && previousState->ImageSampleDistance == currentImageSampleDistance)
+      {
+      state = *previousState;
+      }
+    else
+      {
+      // New mapper, or distances set by the volume rendering module since the last frame
+      state.Mapper = mapper;
+      state.BaseSampleDistance = currentSampleDistance;
+      state.BaseImageSampleDistance = currentImageSampleDistance;
+      state.BaseAutoAdjust = previousState != this->Mappers.end() ? previousState->BaseAutoAdjust :
+        (cpuMapper ? cpuMapper->GetAutoAdjustSampleDistances() != 0 : gpuMapper->GetAutoAdjustSampleDistances() != 0);
+      }
+    state.SampleDistance = state.BaseSampleDistance * sampleDistanceFactor;
+    state.ImageSampleDistance = std::max(state.BaseImageSampleDistance, imageSampleDistance);
+    if (cpuMapper)
+      {
+      cpuMapper->SetAutoAdjustSampleDistances(0);
+      cpuMapper->SetSampleDistance(state.SampleDistance);
+      cpuMapper->SetInteractiveSampleDistance(state.SampleDistance);
+      cpuMapper->SetImageSampleDistance(state.ImageSampleDistance);
+      // The setters clamp their value
+      state.SampleDistance = cpuMapper->GetSampleDistance();
+      state.ImageSampleDistance = cpuMapper->GetImageSampleDistance();
+      }
+    else
+      {
+      gpuMapper->SetAutoAdjustSampleDistances(0);
+      gpuMapper->SetSampleDistance(state.SampleDistance);
+      gpuMapper->SetImageSampleDistance(state.ImageSampleDistance);
+      state.SampleDistance = gpuMapper->GetSampleDistance();
+      state.ImageSampleDistance = gpuMapper->GetImageSampleDistance();
+      }
+    mappers.push_back(state);
+    }
+  // Mappers of the volumes that are not rendered anymore are forgotten
+  this->Mappers.swap(mappers);
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRenderGovernor::RestoreMappers()
+{
+  for (const MapperState& state : this->Mappers)
+    {
+    vtkFixedPointVolumeRayCastMapper* cpuMapper = vtkFixedPointVolumeRayCastMapper::SafeDownCast(state.Mapper);
+    vtkGPUVolumeRayCastMapper* gpuMapper = vtkGPUVolumeRayCastMapper::SafeDownCast(state.Mapper);
+    if (cpuMapper)
+      {
+      cpuMapper->SetSampleDistance(state.BaseSampleDistance);
+      cpuMapper->SetInteractiveSampleDistance(state.BaseSampleDistance);
+      cpuMapper->SetImageSampleDistance(state.BaseImageSampleDistance);
+      cpuMapper->SetAutoAdjustSampleDistances(state.BaseAutoAdjust ? 1 : 0);
+      }
+    else if (gpuMapper)
+      {
+      gpuMapper->SetSampleDistance(state.BaseSampleDistance);
+      gpuMapper->SetImageSampleDistance(state.BaseImageSampleDistance);
+      gpuMapper->SetAutoAdjustSampleDistances(state.BaseAutoAdjust ? 1 : 0);
+      }
+    }
+  this->Mappers.clear();
+  this->RenderedLevel = 0;
+}
@@ -0,0 +1,146 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVIRenderGovernor_h
+#define __vtkTAVIRenderGovernor_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <vector>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkCallbackCommand;
+class vtkInteractorObserver;
+class vtkRenderWindowInteractor;
+class vtkRenderer;
+class vtkVolumeMapper;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Hold a target frame rate of the volume rendering of a 3D view while it is interacted with.
+///
+/// The render time of each interactive frame of Renderer (between the
+/// StartInteractionEvent and EndInteractionEvent of its interactor or
+/// interactor style) moves the interactive quality
+/// level one step: coarser if the frame was slower than the target frame
+/// rate, finer if it was much faster. Each level roughly halves the cost of
+/// the previous one, by alternately doubling the sample distance along the
+/// rays and increasing the image sample distance (rays cast on a coarser
+/// grid of pixels, then interpolated). The level is kept for the next
+/// interaction.
+///
+/// Still frames are rendered at the sample distances set by the volume
+/// rendering module: when the interaction ends, a full quality frame is
+/// rendered if the last frame was interactive.
+///
+/// The CPU ray cast (vtkFixedPointVolumeRayCastMapper) and GPU ray cast
+/// mappers are governed. Their automatic sample distance adjustment is
+/// disabled while the governor is enabled, and restored when it is disabled.
+///
+/// Example:
+/// \code{.py}
+/// governor = slicer.modules.tavi.logic().GetRenderGovernor()
+/// threeDView = slicer.app.layoutManager().threeDWidget(0).threeDView()
+/// governor.SetRenderer(threeDView.renderWindow().GetRenderers().GetFirstRenderer())
+/// governor.SetTargetFrameRate(15)
+/// \endcode
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkTAVIRenderGovernor : public vtkObject
+{
+public:
+  static vtkTAVIRenderGovernor* New();
+  vtkTypeMacro(vtkTAVIRenderGovernor, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  enum
+  {
+    NumberOfLevels = 8
+  };
+
+  /// Renderer of the 3D view whose volumes are governed.
+  void SetRenderer(vtkRenderer* renderer);
+  vtkRenderer* GetRenderer();
+
+  void SetEnabled(bool enabled);
+  vtkGetMacro(Enabled, bool);
+  vtkBooleanMacro(Enabled, bool);
+
+  /// Frame rate to hold while interacting, in frames per second.
+  vtkSetClampMacro(TargetFrameRate, double, 1.0, 100.0);
+  vtkGetMacro(TargetFrameRate, double);
+
+  /// Interactive quality level, 0 for full quality.
+  vtkGetMacro(Level, int);
+  /// Sample distance factor and image sample distance of \a level.
+  static double GetLevelSampleDistanceFactor(int level);
+  static double GetLevelImageSampleDistance(int level);
+
+  /// Render time of the last interactive and still frames, in ms.
+  vtkGetMacro(LastInteractiveFrameTime, double);
+  vtkGetMacro(LastStillFrameTime, double);
+  /// Number of volume mappers governed.
+  int GetNumberOfMappers();
+
+protected:
+  vtkTAVIRenderGovernor();
+  ~vtkTAVIRenderGovernor() override;
+
+  /// Sample distances of a mapper set by the volume rendering module, and
+  /// the ones set by the governor. A mapper whose distances differ from the
+  /// governed ones was updated by the module: its distances become the base.
+  struct MapperState
+  {
+    vtkWeakPointer<vtkVolumeMapper> Mapper;
+    double BaseSampleDistance;
+    double BaseImageSampleDistance;
+    bool BaseAutoAdjust;
+    double SampleDistance;
+    double ImageSampleDistance;
+  };
+
+  static void OnRendererEvent(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+  static void OnInteractorEvent(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+  /// Observe the interactor of Renderer and its interactor style.
+  void UpdateInteractorObservers();
+  /// Set the sample distances of the volumes of Renderer for \a level.
+  void ApplyLevel(int level);
+  /// Restore the sample distances of the governed mappers.
+  void RestoreMappers();
+
+  vtkWeakPointer<vtkRenderer> Renderer;
+  vtkSmartPointer<vtkCallbackCommand> RendererCallback;
+  vtkWeakPointer<vtkRenderWindowInteractor> Interactor;
+  vtkWeakPointer<vtkInteractorObserver> InteractorStyle;
+  vtkSmartPointer<vtkCallbackCommand> InteractorCallback;
+  bool Interacting;
+  bool Enabled;
+  double TargetFrameRate;
+
+  std::vector<MapperState> Mappers;
+  int Level;
+  // Level of the frame in progress or last rendered
+  int RenderedLevel;
+  bool RenderedInteractive;
+  double LastInteractiveFrameTime;
+  double LastStillFrameTime;
+
+private:
+  vtkTAVIRenderGovernor(const vtkTAVIRenderGovernor&) = delete;
+  void operator=(const vtkTAVIRenderGovernor&) = delete;
+};
+
+#endif
@@ -0,0 +1,426 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkTAVIResultCache.h"
+
+// MRML includes
+#include <vtkMRMLDisplayableNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStorableNode.h>
+#include <vtkMRMLStorageNode.h>
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+#include <vtkTypeInt64Array.h>
+#include <vtksys/Directory.hxx>
+#include <vtksys/MD5.h>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTAVIResultCache);
+
+namespace
+{
+const char* ManifestFileName = "manifest.txt";
+const char* ManifestHeader = "TAVIResultCache 1";
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIResultCache::vtkTAVIResultCache()
+  : CacheDirectory(nullptr)
+  , MaximumSize(static_cast<vtkTypeInt64>(2048) * 1024 * 1024)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIResultCache::~vtkTAVIResultCache()
+{
+  this->SetCacheDirectory(nullptr);
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIResultCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "CacheDirectory: " << (this->CacheDirectory ? this->CacheDirectory : "(none)") << "\n";
+  os << indent << "MaximumSize: " << this->MaximumSize << "\n";
+}
+
+//----------------------------------------------------------------------------
+std::string vtkTAVIResultCache::ComputeKey(const std::string& seriesInstanceUID,
+  const std::string& algorithmVersion, const std::string& parameters)
+{
+  if (!vtkTAVIResultCache::IsValidKey(seriesInstanceUID))
+    {
+    return std::string();
+    }
+  // Separators make the hash unambiguous
+  std::string content = algorithmVersion + '\n' + parameters;
+  char hash[32];
+  vtksysMD5* md5 = vtksysMD5_New();
+  vtksysMD5_Initialize(md5);
+  vtksysMD5_Append(md5, reinterpret_cast<const unsigned char*>(content.c_str()),
+    static_cast<int>(content.size()));
+  vtksysMD5_FinalizeHex(md5, hash);
+  vtksysMD5_Delete(md5);
+  return seriesInstanceUID + "_" + std::string(hash, 32);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIResultCache::IsValidKey(const std::string& key)
+{
+  // Keys are directory names, only allow DICOM UID and hash characters
+  return !key.empty() && key[0] != '.' && std::all_of(key.begin(), key.end(), [](char c)
+    {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+      || c == '.' || c == '_' || c == '-';
+    });
+}
+
+//----------------------------------------------------------------------------
+std::string vtkTAVIResultCache::GetEntryDirectory(const std::string& key)
+{
+  if (!this->CacheDirectory || !vtkTAVIResultCache::IsValidKey(key))
+    {
+    return std::string();
+    }
+  return std::string(this->CacheDirectory) + "/" + key;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIResultCache::HasEntry(const std::string& key)
+{
+  std::string entryDirectory = this->GetEntryDirectory(key);
+  return !entryDirectory.empty()
+    && vtksys::SystemTools::FileExists(entryDirectory + "/" + ManifestFileName, true);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIResultCache::StoreNodes(const std::string& key, vtkCollection* nodes)
+{
+  std::string entryDirectory = this->GetEntryDirectory(key);
+  if (entryDirectory.empty() || !nodes)
+    {
+    vtkErrorMacro("StoreNodes: Invalid cache directory or key '" << key << "'");
+    return false;
+    }
+  std::ostringstream temporaryName;
+  temporaryName << this->CacheDirectory << "/.tmp-" << key << "-"
+    << static_cast<vtkTypeInt64>(vtksys::SystemTools::GetTime() * 1e6) << "-" << this;
+  const std::string temporaryDirectory = temporaryName.str();
+  if (!vtksys::SystemTools::MakeDirectory(temporaryDirectory))
+    {
+    vtkErrorMacro("StoreNodes: Failed to create " << temporaryDirectory);
+    return false;
+    }
+
+  std::ofstream manifest(temporaryDirectory + "/" + ManifestFileName);
+  manifest << ManifestHeader << "\n";
+  bool success = true;
+  for (int nodeIndex = 0; nodeIndex < nodes->GetNumberOfItems() && success; ++nodeIndex)
+    {
+    vtkMRMLStorableNode* node = vtkMRMLStorableNode::SafeDownCast(nodes->GetItemAsObject(nodeIndex));
+    vtkSmartPointer<vtkMRMLStorageNode> storageNode;
+    if (node)
+      {
+      storageNode = vtkSmartPointer<vtkMRMLStorageNode>::Take(node->CreateDefaultStorageNode());
+      }
+    if (!storageNode)
+      {
+      vtkWarningMacro("StoreNodes: Item " << nodeIndex << " is not a storable node, it is not cached");
+      continue;
+      }
+    // Uncompressed files are larger but much faster to read
+    storageNode->SetUseCompression(false);
+    std::ostringstream fileName;
+    fileName << "Node" << nodeIndex << "." << storageNode->GetDefaultWriteFileExtension();
+    storageNode->SetFileName((temporaryDirectory + "/" + fileName.str()).c_str());
+    success = storageNode->WriteData(node) != 0;
+    manifest << node->GetClassName() << "\t" << fileName.str() << "\t"
+      << (node->GetName() ? node->GetName() : "") << "\n";
+    }
+  manifest.close();
+  success = success && !manifest.fail();
+
+  if (success)
+    {
+    // A directory cannot be renamed over a non-empty one: the previous entry
+    // is renamed aside first, and removed once the new entry replaced it.
+    // Meanwhile readers miss the entry, they never see a partial one.
+    const std::string previousDirectory = temporaryDirectory + "-previous";
+    const bool replacing = vtksys::SystemTools::FileIsDirectory(entryDirectory)
+      && vtksys::SystemTools::RenameFile(entryDirectory, previousDirectory);
+    // Another process may have stored the same entry meanwhile
+    success = vtksys::SystemTools::RenameFile(temporaryDirectory, entryDirectory) || this->HasEntry(key);
+    if (replacing && !success)
+      {
+      vtksys::SystemTools::RenameFile(previousDirectory, entryDirectory);
+      }
+    if (vtksys::SystemTools::FileIsDirectory(previousDirectory))
+      {
+      vtksys::SystemTools::RemoveADirectory(previousDirectory);
+      }
+    }
+  if (vtksys::SystemTools::FileIsDirectory(temporaryDirectory))
+    {
+    vtksys::SystemTools::RemoveADirectory(temporaryDirectory);
+    }
+  if (!success)
+    {
+    vtkErrorMacro("StoreNodes: Failed to store entry " << key);
+    return false;
+    }
+  this->EvictEntries(key);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIResultCache::RestoreNodes(const std::string& key, vtkMRMLScene* scene,
+  vtkCollection* restoredNodes)
+{
+  if (!scene || !this->HasEntry(key))
+    {
+    return false;
+    }
+  const std::string entryDirectory = this->GetEntryDirectory(key);
+  const std::string manifestPath = entryDirectory + "/" + ManifestFileName;
+  std::ifstream manifest(manifestPath);
+  std::string line;
+  if (!std::getline(manifest, line) || line != ManifestHeader)
+    {
+    vtkWarningMacro("RestoreNodes: Invalid entry " << key << ", it is removed");
+    this->RemoveEntry(key);
+    return false;
+    }
+
+  std::vector<vtkSmartPointer<vtkMRMLNode>> addedNodes;
+  bool success = true;
+  while (success && std::getline(manifest, line))
+    {
+    std::vector<std::string> fields;
+    std::istringstream lineStream(line);
+    std::string field;
+    while (std::getline(lineStream, field, '\t'))
+      {
+      fields.push_back(field);
+      }
+    if (fields.size() < 2)
+      {
+      continue;
+      }
+    vtkSmartPointer<vtkMRMLNode> node = vtkSmartPointer<vtkMRMLNode>::Take(scene->CreateNodeByClass(fields[0].c_str()));
+    vtkMRMLStorableNode* storableNode = vtkMRMLStorableNode::SafeDownCast(node);
+    vtkSmartPointer<vtkMRMLStorageNode> storageNode;
+    if (storableNode)
+      {
+      storageNode = vtkSmartPointer<vtkMRMLStorageNode>::Take(storableNode->CreateDefaultStorageNode());
+      }
+    if (!storageNode)
+      {
+      success = false;
+      break;
+      }
+    if (fields.size() > 2)
+      {
+      node->SetName(fields[2].c_str());
+      }
+    scene->AddNode(node);
+    addedNodes.push_back(node);
+    storageNode->SetFileName((entryDirectory + "/" + fields[1]).c_str());
+    success = storageNode->ReadData(node) != 0;
+    vtkMRMLDisplayableNode* displayableNode = vtkMRMLDisplayableNode::SafeDownCast(node);
+    if (success && displayableNode)
+      {
+      displayableNode->CreateDefaultDisplayNodes();
+      }
+    }
+  if (!success)
+    {
+    vtkWarningMacro("RestoreNodes: Failed to read entry " << key << ", it is removed");
+    for (vtkMRMLNode* node : addedNodes)
+      {
+      scene->RemoveNode(node);
+      }
+    this->RemoveEntry(key);
+    return false;
+    }
+  if (restoredNodes)
+    {
+    for (vtkMRMLNode* node : addedNodes)
+      {
+      restoredNodes->AddItem(node);
+      }
+    }
+  // Mark the entry as recently used
+  vtksys::SystemTools::Touch(manifestPath, false);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIResultCache::RemoveEntry(const std::string& key)
+{
+  std::string entryDirectory = this->GetEntryDirectory(key);
+  if (entryDirectory.empty() || !vtksys::SystemTools::FileIsDirectory(entryDirectory))
+    {
+    return false;
+    }
+  return static_cast<bool>(vtksys::SystemTools::RemoveADirectory(entryDirectory));
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIResultCache::Clear()
+{
+  for (const Entry& entry : this->GetEntries())
+    {
+    this->RemoveEntry(entry.Key);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIResultCache::EvictEntries(const std::string& keptKey)
+{
+  std::vector<Entry> entries = this->GetEntries();
+  vtkTypeInt64 totalSize = 0;
+  for (const Entry& entry : entries)
+    {
+    totalSize += entry.Size;
+    }
+  for (auto it = entries.rbegin(); it != entries.rend() && totalSize > this->MaximumSize; ++it)
+    {
+    if (it->Key != keptKey && this->RemoveEntry(it->Key))
+      {
+      totalSize -= it->Size;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIResultCache::ReadEntry(const std::string& key, Entry& entry)
+{
+  if (!this->HasEntry(key))
+    {
+    return false;
+    }
+  const std::string entryDirectory = this->GetEntryDirectory(key);
+  entry.Key = key;
+  entry.Size = 0;
+  entry.LastAccessTime = vtksys::SystemTools::ModifiedTime(entryDirectory + "/" + ManifestFileName);
+  vtksys::Directory entryFiles;
+  entryFiles.Load(entryDirectory);
+  for (unsigned long entryFileIndex = 0; entryFileIndex < entryFiles.GetNumberOfFiles(); ++entryFileIndex)
+    {
+    std::string path = entryDirectory + "/" + entryFiles.GetFile(entryFileIndex);
+    if (!vtksys::SystemTools::FileIsDirectory(path))
+      {
+      entry.Size += static_cast<vtkTypeInt64>(vtksys::SystemTools::FileLength(path));
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+std::vector<vtkTAVIResultCache::Entry> vtkTAVIResultCache::GetEntries()
+{
+  std::vector<Entry> entries;
+  vtksys::Directory directory;
+  if (!this->CacheDirectory || !directory.Load(this->CacheDirectory))
+    {
+    return entries;
+    }
+  for (unsigned long fileIndex = 0; fileIndex < directory.GetNumberOfFiles(); ++fileIndex)
+    {
+    // Temporary directories and unrelated files are skipped
+    Entry entry;
+    if (this->ReadEntry(directory.GetFile(fileIndex), entry))
+      {
+      entries.push_back(entry);
+      }
+    }
+  std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+    {
+    return a.LastAccessTime != b.LastAccessTime ? a.LastAccessTime > b.LastAccessTime : a.Key < b.Key;
+    });
+  return entries;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIResultCache::GetNumberOfEntries()
+{
+  return static_cast<int>(this->GetEntries().size());
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkTAVIResultCache::GetTotalSize()
+{
+  vtkTypeInt64 totalSize = 0;
+  for (const Entry& entry : this->GetEntries())
+    {
+    totalSize += entry.Size;
+    }
+  return totalSize;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIResultCache::GetEntryKeys(vtkStringArray* keys, vtkTypeInt64Array* sizes,
+  vtkTypeInt64Array* lastAccessTimes)
+{
+  if (!keys)
+    {
+    return;
+    }
+  keys->Reset();
+  if (sizes)
+    {
+    sizes->Reset();
+    }
+  if (lastAccessTimes)
+    {
+    lastAccessTimes->Reset();
+    }
+  for (const Entry& entry : this->GetEntries())
+    {
+    keys->InsertNextValue(entry.Key);
+    if (sizes)
+      {
+      sizes->InsertNextValue(entry.Size);
+      }
+    if (lastAccessTimes)
+      {
+      lastAccessTimes->InsertNextValue(entry.LastAccessTime);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkTAVIResultCache::GetEntrySize(const std::string& key)
+{
+  Entry entry;
+  return this->ReadEntry(key, entry) ? entry.Size : -1;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkTAVIResultCache::GetEntryLastAccessTime(const std::string& key)
+{
+  Entry entry;
+  return this->ReadEntry(key, entry) ? entry.LastAccessTime : 0;
+}
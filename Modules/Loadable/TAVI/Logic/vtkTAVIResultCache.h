@@ -0,0 +1,138 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVIResultCache_h
+#define __vtkTAVIResultCache_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <string>
+#include <vector>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkCollection;
+class vtkMRMLScene;
+class vtkStringArray;
+class vtkTypeInt64Array;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Persistent on-disk cache of derived TAVI results.
+///
+/// Entries are keyed by the SeriesInstanceUID of the analyzed series and a
+/// hash of the algorithm version and parameters (see ComputeKey()), so that
+/// changing any of them naturally misses the cache.
+///
+/// An entry is a directory holding the storable nodes of the results
+/// (segmentations, centerlines, planes, tables...), each written by its
+/// default storage node without compression so that it is read back as
+/// fast as possible, and a manifest listing the node classes and names.
+/// Entries are written in a temporary directory then renamed, so that
+/// concurrent processes (see the batch mode) never see partial entries. A
+/// replaced entry is renamed aside before, then removed.
+///
+/// The modification time of the manifest is the last access time of the
+/// entry. When the total size exceeds MaximumSize, least recently used
+/// entries are removed.
+///
+/// Example:
+/// \code{.py}
+/// cache = slicer.modules.tavi.logic().GetResultCache()
+/// key = cache.ComputeKey(seriesInstanceUID, "1.2", json.dumps(parameters, sort_keys=True))
+/// if not cache.RestoreNodes(key, slicer.mrmlScene, restoredNodes):
+///     ... # analyze, then
+///     cache.StoreNodes(key, resultNodes)
+/// \endcode
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkTAVIResultCache : public vtkObject
+{
+public:
+  static vtkTAVIResultCache* New();
+  vtkTypeMacro(vtkTAVIResultCache, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Directory of the cache. It is created when the first entry is stored.
+  vtkSetStringMacro(CacheDirectory);
+  vtkGetStringMacro(CacheDirectory);
+
+  /// Maximum total size of the entries, in bytes.
+  vtkSetMacro(MaximumSize, vtkTypeInt64);
+  vtkGetMacro(MaximumSize, vtkTypeInt64);
+
+  /// Key of the results of \a algorithmVersion applied with \a parameters
+  /// on the series \a seriesInstanceUID.
+  static std::string ComputeKey(const std::string& seriesInstanceUID,
+    const std::string& algorithmVersion, const std::string& parameters);
+
+  bool HasEntry(const std::string& key);
+
+  /// Store the storable nodes of \a nodes under \a key, replacing any
+  /// previous entry, then evict least recently used entries if needed.
+  bool StoreNodes(const std::string& key, vtkCollection* nodes);
+
+  /// Add the nodes stored under \a key to \a scene. Restored nodes are
+  /// added to \a restoredNodes if not null. Return false on cache miss.
+  bool RestoreNodes(const std::string& key, vtkMRMLScene* scene, vtkCollection* restoredNodes = nullptr);
+
+  bool RemoveEntry(const std::string& key);
+
+  /// Remove all the entries.
+  void Clear();
+
+  /// Remove least recently used entries until the total size is below
+  /// MaximumSize. The entry \a keptKey is never removed.
+  void EvictEntries(const std::string& keptKey = std::string());
+
+  int GetNumberOfEntries();
+  vtkTypeInt64 GetTotalSize();
+  /// Keys of the entries, most recently used first, with their sizes and
+  /// last access times if \a sizes and \a lastAccessTimes are not null (see
+  /// GetEntrySize() and GetEntryLastAccessTime()). The cache directory is
+  /// scanned once.
+  void GetEntryKeys(vtkStringArray* keys, vtkTypeInt64Array* sizes = nullptr,
+    vtkTypeInt64Array* lastAccessTimes = nullptr);
+  /// Size of an entry, in bytes. Return -1 if there is no such entry.
+  vtkTypeInt64 GetEntrySize(const std::string& key);
+  /// Last access time of an entry, in seconds since epoch. Return 0 if there is no such entry.
+  vtkTypeInt64 GetEntryLastAccessTime(const std::string& key);
+
+protected:
+  vtkTAVIResultCache();
+  ~vtkTAVIResultCache() override;
+
+  struct Entry
+  {
+    std::string Key;
+    vtkTypeInt64 Size;
+    vtkTypeInt64 LastAccessTime;
+  };
+
+  /// Entries of the cache, most recently used first.
+  std::vector<Entry> GetEntries();
+  /// Read the size and last access time of the entry \a key.
+  /// Return false if there is no such entry.
+  bool ReadEntry(const std::string& key, Entry& entry);
+  std::string GetEntryDirectory(const std::string& key);
+  static bool IsValidKey(const std::string& key);
+
+  char* CacheDirectory;
+  vtkTypeInt64 MaximumSize;
+
+private:
+  vtkTAVIResultCache(const vtkTAVIResultCache&) = delete;
+  void operator=(const vtkTAVIResultCache&) = delete;
+};
+
+#endif
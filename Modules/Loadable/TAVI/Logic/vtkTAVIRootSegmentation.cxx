@@ -0,0 +1,787 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkTAVIRootSegmentation.h"
+
+// MRML includes
+#include <vtkMRMLMarkupsNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLSegmentationNode.h>
+#include <vtkMRMLTransformNode.h>
+
+// Segmentations includes
+#include <vtkOrientedImageData.h>
+#include <vtkSegment.h>
+#include <vtkSegmentation.h>
+#include <vtkSegmentationConverter.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkGeneralTransform.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTAVIRootSegmentation);
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Root of \a label, halving the paths on the way.
+int FindRoot(std::vector<int>& parents, int label)
+{
+  while (parents[label] != label)
+    {
+    parents[label] = parents[parents[label]];
+    label = parents[label];
+    }
+  return label;
+}
+
+//----------------------------------------------------------------------------
+/// Merge the sets of \a label1 and \a label2, under the smallest root.
+void MergeLabels(std::vector<int>& parents, int label1, int label2)
+{
+  const int root1 = FindRoot(parents, label1);
+  const int root2 = FindRoot(parents, label2);
+  if (root1 < root2)
+    {
+    parents[root2] = root1;
+    }
+  else if (root2 < root1)
+    {
+    parents[root1] = root2;
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Checksum of the thresholded voxels of slices [zBegin, zEnd): the slabs
+/// whose intensities changed without changing the lumen are not labeled again.
+template <class T>
+std::uint64_t ComputeChecksum(const T* scalars, int numberOfComponents, const int dimensions[3],
+  int zBegin, int zEnd, double lowerThreshold, double upperThreshold)
+{
+  // FNV-1a over 64 voxels at a time
+  const std::uint64_t prime = 1099511628211ULL;
+  std::uint64_t checksum = 14695981039346656037ULL;
+  std::uint64_t word = 0;
+  int bit = 0;
+  const vtkIdType sliceSize = static_cast<vtkIdType>(dimensions[0]) * dimensions[1];
+  const vtkIdType end = zEnd * sliceSize;
+  for (vtkIdType index = zBegin * sliceSize; index < end; ++index)
+    {
+    const double value = static_cast<double>(scalars[index * numberOfComponents]);
+    word |= static_cast<std::uint64_t>(value >= lowerThreshold && value <= upperThreshold) << bit;
+    if (++bit == 64)
+      {
+      checksum = (checksum ^ word) * prime;
+      word = 0;
+      bit = 0;
+      }
+    }
+  return (checksum ^ word) * prime;
+}
+
+//----------------------------------------------------------------------------
+/// Call \a function with each pair of overlapping runs of two rows, whose
+/// runs are sorted by column.
+template <class RunType1, class RunType2, class Function>
+void ForEachOverlap(RunType1* runs1, int count1, RunType2* runs2, int count2, Function function)
+{
+  int index1 = 0;
+  int index2 = 0;
+  while (index1 < count1 && index2 < count2)
+    {
+    const int end1 = runs1[index1].Start + runs1[index1].Length;
+    const int end2 = runs2[index2].Start + runs2[index2].Length;
+    if (runs1[index1].Start < end2 && runs2[index2].Start < end1)
+      {
+      function(runs1[index1], runs2[index2]);
+      }
+    // The run ending first does not overlap the next runs of the other row
+    if (end1 < end2)
+      {
+      ++index1;
+      }
+    else
+      {
+      ++index2;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Label the 6-connected components of the thresholded voxels of slices
+/// [zBegin, zEnd), run by run: the runs of a row take the labels of the runs
+/// they overlap in the previous row and in the same row of the previous
+/// slice, provisional labels being merged on the fly, then replaced by
+/// consecutive labels. Return the number of labels.
+template <class T, class RunType>
+int LabelComponents(const T* scalars, int numberOfComponents, const int dimensions[3],
+  int zBegin, int zEnd, double lowerThreshold, double upperThreshold,
+  std::vector<RunType>& runs, std::vector<int>& rowRuns)
+{
+  const int nx = dimensions[0];
+  const int ny = dimensions[1];
+  const int numberOfRows = (zEnd - zBegin) * ny;
+  const vtkIdType offset = static_cast<vtkIdType>(zBegin) * nx * ny;
+  runs.clear();
+  rowRuns.assign(numberOfRows + 1, 0);
+  std::vector<int> parents(1, 0);
+  auto connect = [&parents](RunType& run, const RunType& neighbor)
+    {
+    if (run.Label == 0)
+      {
+      run.Label = neighbor.Label;
+      }
+    else if (run.Label != neighbor.Label)
+      {
+      MergeLabels(parents, run.Label, neighbor.Label);
+      }
+    };
+  for (int row = 0; row < numberOfRows; ++row)
+    {
+    const int rowBegin = static_cast<int>(runs.size());
+    rowRuns[row] = rowBegin;
+    const T* rowScalars = scalars + (offset + static_cast<vtkIdType>(row) * nx) * numberOfComponents;
+    auto inside = [=](int x)
+      {
+      const double value = static_cast<double>(rowScalars[x * numberOfComponents]);
+      return value >= lowerThreshold && value <= upperThreshold;
+      };
+    for (int x = 0; x < nx; ++x)
+      {
+      if (!inside(x))
+        {
+        continue;
+        }
+      RunType run;
+      run.Start = x;
+      while (x + 1 < nx && inside(x + 1))
+        {
+        ++x;
+        }
+      run.Length = x + 1 - run.Start;
+      run.Label = 0;
+      runs.push_back(run);
+      }
+
+    // Neighbors already visited
+    const int count = static_cast<int>(runs.size()) - rowBegin;
+    if (row % ny > 0)
+      {
+      ForEachOverlap(runs.data() + rowBegin, count, runs.data() + rowRuns[row - 1],
+        rowBegin - rowRuns[row - 1], connect);
+      }
+    if (row >= ny)
+      {
+      ForEachOverlap(runs.data() + rowBegin, count, runs.data() + rowRuns[row - ny],
+        rowRuns[row - ny + 1] - rowRuns[row - ny], connect);
+      }
+    for (int index = rowBegin; index < static_cast<int>(runs.size()); ++index)
+      {
+      if (runs[index].Label == 0)
+        {
+        runs[index].Label = static_cast<int>(parents.size());
+        parents.push_back(runs[index].Label);
+        }
+      }
+    }
+  rowRuns[numberOfRows] = static_cast<int>(runs.size());
+
+  // Consecutive labels of the roots
+  std::vector<int> finalLabels(parents.size(), 0);
+  int numberOfLabels = 0;
+  for (int label = 1; label < static_cast<int>(parents.size()); ++label)
+    {
+    const int root = FindRoot(parents, label);
+    if (root == label)
+      {
+      finalLabels[label] = ++numberOfLabels;
+      }
+    }
+  for (RunType& run : runs)
+    {
+    run.Label = finalLabels[FindRoot(parents, run.Label)];
+    }
+  return numberOfLabels;
+}
+
+//----------------------------------------------------------------------------
+/// Label the slabs whose thresholded voxels changed. One slab per call, so
+/// that the threads take the remaining slabs as they finish theirs.
+class LabelSlabsFunctor
+{
+public:
+  LabelSlabsFunctor(vtkImageData* image, double lowerThreshold, double upperThreshold)
+    : Scalars(image->GetScalarPointer())
+    , ScalarType(image->GetScalarType())
+    , NumberOfComponents(image->GetNumberOfScalarComponents())
+    , LowerThreshold(lowerThreshold)
+    , UpperThreshold(upperThreshold)
+    {
+    image->GetDimensions(this->Dimensions);
+    }
+
+  template <class SlabType>
+  void Label(SlabType& slab, std::vector<unsigned char>& labeled, vtkIdType slabIndex)
+    {
+    std::uint64_t checksum = 0;
+    switch (this->ScalarType)
+      {
+      vtkTemplateMacro(checksum = ComputeChecksum(static_cast<const VTK_TT*>(this->Scalars), this->NumberOfComponents,
+        this->Dimensions, slab.ZBegin, slab.ZEnd, this->LowerThreshold, this->UpperThreshold));
+      }
+    if (slab.Labeled && slab.Checksum == checksum)
+      {
+      return;
+      }
+    switch (this->ScalarType)
+      {
+      vtkTemplateMacro(slab.NumberOfLabels = LabelComponents(static_cast<const VTK_TT*>(this->Scalars),
+        this->NumberOfComponents, this->Dimensions, slab.ZBegin, slab.ZEnd, this->LowerThreshold,
+        this->UpperThreshold, slab.Runs, slab.RowRuns));
+      }
+    slab.Checksum = checksum;
+    slab.Labeled = true;
+    labeled[slabIndex] = 1;
+    }
+
+private:
+  const void* Scalars;
+  int ScalarType;
+  int NumberOfComponents;
+  int Dimensions[3];
+  double LowerThreshold;
+  double UpperThreshold;
+};
+
+//----------------------------------------------------------------------------
+/// Write the components of the seeds into the labelmap, slab by slab.
+template <class SlabType>
+class WriteSegmentFunctor
+{
+public:
+  WriteSegmentFunctor(const std::vector<SlabType>& slabs, const std::vector<int>& labelOffsets,
+    const std::vector<int>& roots, const std::vector<unsigned char>& selected, unsigned char* output,
+    int rowLength, vtkIdType sliceSize, vtkIdType* numberOfVoxels)
+    : Slabs(slabs)
+    , LabelOffsets(labelOffsets)
+    , Roots(roots)
+    , Selected(selected)
+    , Output(output)
+    , RowLength(rowLength)
+    , SliceSize(sliceSize)
+    , NumberOfVoxels(numberOfVoxels)
+    {
+    }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType slabIndex = begin; slabIndex < end; ++slabIndex)
+      {
+      const SlabType& slab = this->Slabs[slabIndex];
+      const int labelOffset = this->LabelOffsets[slabIndex];
+      unsigned char* output = this->Output + slab.ZBegin * this->SliceSize;
+      std::fill(output, output + (slab.ZEnd - slab.ZBegin) * this->SliceSize, 0);
+      vtkIdType numberOfVoxels = 0;
+      const int numberOfRows = static_cast<int>(slab.RowRuns.size()) - 1;
+      for (int row = 0; row < numberOfRows; ++row)
+        {
+        unsigned char* rowOutput = output + static_cast<vtkIdType>(row) * this->RowLength;
+        for (int index = slab.RowRuns[row]; index < slab.RowRuns[row + 1]; ++index)
+          {
+          const auto& run = slab.Runs[index];
+          if (this->Selected[this->Roots[labelOffset + run.Label]])
+            {
+            std::fill(rowOutput + run.Start, rowOutput + run.Start + run.Length, 1);
+            numberOfVoxels += run.Length;
+            }
+          }
+        }
+      this->NumberOfVoxels[slabIndex] = numberOfVoxels;
+      }
+    }
+
+private:
+  const std::vector<SlabType>& Slabs;
+  const std::vector<int>& LabelOffsets;
+  const std::vector<int>& Roots;
+  const std::vector<unsigned char>& Selected;
+  unsigned char* Output;
+  int RowLength;
+  vtkIdType SliceSize;
+  vtkIdType* NumberOfVoxels;
+};
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkTAVIRootSegmentation::vtkTAVIRootSegmentation()
+  : SegmentName("Aortic root")
+  , LowerThreshold(200.0)
+  , UpperThreshold(1000.0)
+  , SlabThickness(32)
+  , AutoUpdate(false)
+  , Updating(false)
+  , CachedImageTime(0)
+  , CachedDimensions{ 0, 0, 0 }
+  , NumberOfLabeledSlabs(0)
+  , NumberOfSegmentVoxels(0)
+  , UpdateTime(0.0)
+{
+  this->NodeCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->NodeCallback->SetCallback(vtkTAVIRootSegmentation::OnNodeModified);
+  this->NodeCallback->SetClientData(this);
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIRootSegmentation::~vtkTAVIRootSegmentation()
+{
+  this->AutoUpdate = false;
+  this->UpdateObservers();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "SegmentName: " << this->SegmentName << "\n";
+  os << indent << "LowerThreshold: " << this->LowerThreshold << "\n";
+  os << indent << "UpperThreshold: " << this->UpperThreshold << "\n";
+  os << indent << "SlabThickness: " << this->SlabThickness << "\n";
+  os << indent << "AutoUpdate: " << this->AutoUpdate << "\n";
+  os << indent << "NumberOfSlabs: " << this->Slabs.size() << "\n";
+  os << indent << "NumberOfLabeledSlabs: " << this->NumberOfLabeledSlabs << "\n";
+  os << indent << "NumberOfSegmentVoxels: " << this->NumberOfSegmentVoxels << "\n";
+  os << indent << "UpdateTime: " << this->UpdateTime << " ms\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::SetInputVolumeNode(vtkMRMLScalarVolumeNode* volumeNode)
+{
+  if (this->InputVolumeNode == volumeNode)
+    {
+    return;
+    }
+  if (this->InputVolumeNode)
+    {
+    this->InputVolumeNode->RemoveObserver(this->NodeCallback);
+    }
+  this->InputVolumeNode = volumeNode;
+  this->ClearCache();
+  this->UpdateObservers();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkTAVIRootSegmentation::GetInputVolumeNode()
+{
+  return this->InputVolumeNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::SetSeedsNode(vtkMRMLMarkupsNode* markupsNode)
+{
+  if (this->SeedsNode == markupsNode)
+    {
+    return;
+    }
+  if (this->SeedsNode)
+    {
+    this->SeedsNode->RemoveObserver(this->NodeCallback);
+    }
+  this->SeedsNode = markupsNode;
+  this->UpdateObservers();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLMarkupsNode* vtkTAVIRootSegmentation::GetSeedsNode()
+{
+  return this->SeedsNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::SetSegmentationNode(vtkMRMLSegmentationNode* segmentationNode)
+{
+  if (this->SegmentationNode == segmentationNode)
+    {
+    return;
+    }
+  this->SegmentationNode = segmentationNode;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSegmentationNode* vtkTAVIRootSegmentation::GetSegmentationNode()
+{
+  return this->SegmentationNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::SetLowerThreshold(double threshold)
+{
+  if (this->LowerThreshold == threshold)
+    {
+    return;
+    }
+  this->LowerThreshold = threshold;
+  this->ClearCache();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::SetUpperThreshold(double threshold)
+{
+  if (this->UpperThreshold == threshold)
+    {
+    return;
+    }
+  this->UpperThreshold = threshold;
+  this->ClearCache();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::SetSlabThickness(int thickness)
+{
+  thickness = std::max(thickness, 1);
+  if (this->SlabThickness == thickness)
+    {
+    return;
+    }
+  this->SlabThickness = thickness;
+  this->ClearCache();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::SetAutoUpdate(bool autoUpdate)
+{
+  if (this->AutoUpdate == autoUpdate)
+    {
+    return;
+    }
+  this->AutoUpdate = autoUpdate;
+  this->UpdateObservers();
+  this->Modified();
+  if (autoUpdate)
+    {
+    this->Update();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::UpdateObservers()
+{
+  if (this->InputVolumeNode)
+    {
+    this->InputVolumeNode->RemoveObserver(this->NodeCallback);
+    }
+  if (this->SeedsNode)
+    {
+    this->SeedsNode->RemoveObserver(this->NodeCallback);
+    }
+  if (!this->AutoUpdate)
+    {
+    return;
+    }
+  if (this->InputVolumeNode)
+    {
+    this->InputVolumeNode->AddObserver(vtkMRMLVolumeNode::ImageDataModifiedEvent, this->NodeCallback);
+    }
+  if (this->SeedsNode)
+    {
+    this->SeedsNode->AddObserver(vtkMRMLMarkupsNode::PointModifiedEvent, this->NodeCallback);
+    this->SeedsNode->AddObserver(vtkMRMLMarkupsNode::PointAddedEvent, this->NodeCallback);
+    this->SeedsNode->AddObserver(vtkMRMLMarkupsNode::PointRemovedEvent, this->NodeCallback);
+    this->SeedsNode->AddObserver(vtkMRMLTransformableNode::TransformModifiedEvent, this->NodeCallback);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::OnNodeModified(vtkObject* vtkNotUsed(caller),
+  unsigned long vtkNotUsed(eid), void* clientData, void* vtkNotUsed(callData))
+{
+  vtkTAVIRootSegmentation* self = static_cast<vtkTAVIRootSegmentation*>(clientData);
+  self->Update();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::ClearCache()
+{
+  this->Slabs.clear();
+  this->CachedImage = nullptr;
+  this->CachedImageTime = 0;
+  std::fill(this->CachedDimensions, this->CachedDimensions + 3, 0);
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIRootSegmentation::GetNumberOfSlabs()
+{
+  return static_cast<int>(this->Slabs.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::LabelSlabs(vtkImageData* image)
+{
+  int dimensions[3];
+  image->GetDimensions(dimensions);
+  if (this->CachedImage != image || this->Slabs.empty()
+      || !std::equal(dimensions, dimensions + 3, this->CachedDimensions))
+    {
+    this->Slabs.clear();
+    for (int zBegin = 0; zBegin < dimensions[2]; zBegin += this->SlabThickness)
+      {
+      Slab slab;
+      slab.ZBegin = zBegin;
+      slab.ZEnd = std::min(zBegin + this->SlabThickness, dimensions[2]);
+      slab.NumberOfLabels = 0;
+      slab.Checksum = 0;
+      slab.Labeled = false;
+      this->Slabs.push_back(slab);
+      }
+    }
+  else if (this->CachedImageTime == image->GetMTime())
+    {
+    this->NumberOfLabeledSlabs = 0;
+    return;
+    }
+
+  std::vector<unsigned char> labeled(this->Slabs.size(), 0);
+  LabelSlabsFunctor functor(image, this->LowerThreshold, this->UpperThreshold);
+  std::vector<Slab>& slabs = this->Slabs;
+  vtkSMPTools::For(0, static_cast<vtkIdType>(slabs.size()), 1, [&](vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType slabIndex = begin; slabIndex < end; ++slabIndex)
+      {
+      functor.Label(slabs[slabIndex], labeled, slabIndex);
+      }
+    });
+  this->NumberOfLabeledSlabs = static_cast<int>(std::count(labeled.begin(), labeled.end(), 1));
+  this->CachedImage = image;
+  this->CachedImageTime = image->GetMTime();
+  std::copy(dimensions, dimensions + 3, this->CachedDimensions);
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIRootSegmentation::MergeSlabs(vtkImageData* image, std::vector<int>& labelOffsets, std::vector<int>& roots)
+{
+  int dimensions[3];
+  image->GetDimensions(dimensions);
+  const int ny = dimensions[1];
+
+  labelOffsets.resize(this->Slabs.size());
+  int numberOfLabels = 0;
+  for (size_t slabIndex = 0; slabIndex < this->Slabs.size(); ++slabIndex)
+    {
+    labelOffsets[slabIndex] = numberOfLabels;
+    numberOfLabels += this->Slabs[slabIndex].NumberOfLabels;
+    }
+  roots.resize(numberOfLabels + 1);
+  for (int label = 0; label <= numberOfLabels; ++label)
+    {
+    roots[label] = label;
+    }
+
+  // Rows of the last slice of each slab against the rows of the first slice of the next one
+  for (size_t slabIndex = 0; slabIndex + 1 < this->Slabs.size(); ++slabIndex)
+    {
+    const Slab& slab = this->Slabs[slabIndex];
+    const Slab& nextSlab = this->Slabs[slabIndex + 1];
+    const int labelOffset = labelOffsets[slabIndex];
+    const int nextLabelOffset = labelOffsets[slabIndex + 1];
+    const int lastSliceRow = (slab.ZEnd - slab.ZBegin - 1) * ny;
+    for (int y = 0; y < ny; ++y)
+      {
+      const int lastRow = lastSliceRow + y;
+      ForEachOverlap(slab.Runs.data() + slab.RowRuns[lastRow], slab.RowRuns[lastRow + 1] - slab.RowRuns[lastRow],
+        nextSlab.Runs.data() + nextSlab.RowRuns[y], nextSlab.RowRuns[y + 1] - nextSlab.RowRuns[y],
+        [&](const Run& run, const Run& nextRun)
+        {
+        MergeLabels(roots, labelOffset + run.Label, nextLabelOffset + nextRun.Label);
+        });
+      }
+    }
+  for (int label = 1; label <= numberOfLabels; ++label)
+    {
+    roots[label] = FindRoot(roots, label);
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIRootSegmentation::Update()
+{
+  vtkMRMLScalarVolumeNode* volumeNode = this->InputVolumeNode;
+  vtkMRMLMarkupsNode* seedsNode = this->SeedsNode;
+  vtkMRMLSegmentationNode* segmentationNode = this->SegmentationNode;
+  vtkImageData* image = volumeNode ? volumeNode->GetImageData() : nullptr;
+  if (!image || !image->GetPointData()->GetScalars() || !seedsNode || !segmentationNode
+      || !segmentationNode->GetSegmentation())
+    {
+    return false;
+    }
+  if (this->Updating)
+    {
+    return false;
+    }
+  // The segment is written in the coordinates of the parent transform of the
+  // segmentation node, which is left unchanged
+  vtkNew<vtkGeneralTransform> volumeToSegmentation;
+  vtkMRMLTransformNode::GetTransformBetweenNodes(volumeNode->GetParentTransformNode(),
+    segmentationNode->GetParentTransformNode(), volumeToSegmentation);
+  vtkNew<vtkTransform> volumeToSegmentationLinear;
+  if (!vtkMRMLTransformNode::IsGeneralTransformLinear(volumeToSegmentation, volumeToSegmentationLinear))
+    {
+    vtkErrorMacro("Update: The transform from the input volume to the segmentation is not linear");
+    return false;
+    }
+  this->Updating = true;
+  const double startTime = vtkTimerLog::GetUniversalTime();
+
+  this->LabelSlabs(image);
+  std::vector<int> labelOffsets;
+  std::vector<int> roots;
+  this->MergeSlabs(image, labelOffsets, roots);
+
+  // Components of the seeds
+  int dimensions[3];
+  image->GetDimensions(dimensions);
+  const vtkIdType sliceSize = static_cast<vtkIdType>(dimensions[0]) * dimensions[1];
+  std::vector<unsigned char> selected(roots.size(), 0);
+  vtkNew<vtkGeneralTransform> worldToIJK;
+  vtkMRMLTransformNode::GetTransformBetweenNodes(nullptr, volumeNode->GetParentTransformNode(), worldToIJK);
+  vtkNew<vtkMatrix4x4> rasToIJK;
+  volumeNode->GetRASToIJKMatrix(rasToIJK);
+  worldToIJK->PostMultiply();
+  worldToIJK->Concatenate(rasToIJK);
+  for (int index = 0; index < seedsNode->GetNumberOfControlPoints(); ++index)
+    {
+    double seedWorld[3];
+    double seedIJK[3];
+    seedsNode->GetNthControlPointPositionWorld(index, seedWorld);
+    worldToIJK->TransformPoint(seedWorld, seedIJK);
+    int ijk[3];
+    bool inside = true;
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      ijk[axis] = static_cast<int>(std::floor(seedIJK[axis] + 0.5));
+      inside = inside && ijk[axis] >= 0 && ijk[axis] < dimensions[axis];
+      }
+    if (!inside)
+      {
+      vtkWarningMacro("Update: Seed " << index << " is outside of the volume");
+      continue;
+      }
+    const size_t slabIndex = ijk[2] / this->SlabThickness;
+    const Slab& slab = this->Slabs[slabIndex];
+    const int row = (ijk[2] - slab.ZBegin) * dimensions[1] + ijk[1];
+    int label = 0;
+    for (int runIndex = slab.RowRuns[row]; runIndex < slab.RowRuns[row + 1] && label == 0; ++runIndex)
+      {
+      const Run& run = slab.Runs[runIndex];
+      if (ijk[0] >= run.Start && ijk[0] < run.Start + run.Length)
+        {
+        label = run.Label;
+        }
+      }
+    if (label == 0)
+      {
+      vtkWarningMacro("Update: Seed " << index << " is outside of the thresholds");
+      continue;
+      }
+    selected[roots[labelOffsets[slabIndex] + label]] = 1;
+    }
+
+  // Segment, its labelmap is reused unless other segments share it
+  vtkSegmentation* segmentation = segmentationNode->GetSegmentation();
+  const std::string labelmapName = vtkSegmentationConverter::GetBinaryLabelmapRepresentationName();
+  std::string segmentId = segmentation->GetSegmentIdBySegmentName(this->SegmentName);
+  if (segmentId.empty())
+    {
+    if (segmentation->GetNumberOfSegments() == 0)
+      {
+      segmentationNode->SetReferenceImageGeometryParameterFromVolumeNode(volumeNode);
+      }
+    segmentId = segmentation->AddEmptySegment("", this->SegmentName);
+    }
+  vtkSegment* segment = segmentation->GetSegment(segmentId);
+  vtkSmartPointer<vtkOrientedImageData> labelmap =
+    vtkOrientedImageData::SafeDownCast(segment->GetRepresentation(labelmapName));
+  std::vector<std::string> sharingSegmentIds;
+  if (labelmap)
+    {
+    segmentation->GetSegmentIDsSharingBinaryLabelmapRepresentation(segmentId, sharingSegmentIds, false);
+    }
+  const bool newLabelmap = !labelmap || !sharingSegmentIds.empty();
+  if (newLabelmap)
+    {
+    labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    }
+  int labelmapDimensions[3];
+  labelmap->GetDimensions(labelmapDimensions);
+  if (newLabelmap || labelmap->GetScalarType() != VTK_UNSIGNED_CHAR
+      || !std::equal(dimensions, dimensions + 3, labelmapDimensions))
+    {
+    labelmap->SetExtent(0, dimensions[0] - 1, 0, dimensions[1] - 1, 0, dimensions[2] - 1);
+    labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    }
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  volumeNode->GetIJKToRASMatrix(ijkToRAS);
+  vtkNew<vtkMatrix4x4> ijkToSegmentation;
+  vtkMatrix4x4::Multiply4x4(volumeToSegmentationLinear->GetMatrix(), ijkToRAS, ijkToSegmentation);
+  labelmap->SetImageToWorldMatrix(ijkToSegmentation);
+
+  std::vector<vtkIdType> numberOfVoxels(this->Slabs.size(), 0);
+  WriteSegmentFunctor<Slab> functor(this->Slabs, labelOffsets, roots, selected,
+    static_cast<unsigned char*>(labelmap->GetScalarPointer()), dimensions[0], sliceSize, numberOfVoxels.data());
+  vtkSMPTools::For(0, static_cast<vtkIdType>(this->Slabs.size()), 1, functor);
+  this->NumberOfSegmentVoxels = 0;
+  for (vtkIdType count : numberOfVoxels)
+    {
+    this->NumberOfSegmentVoxels += count;
+    }
+
+  labelmap->Modified();
+  segment->SetLabelValue(1);
+  if (newLabelmap)
+    {
+    segment->AddRepresentation(labelmapName, labelmap);
+    }
+  segmentation->InvokeEvent(vtkSegmentation::RepresentationModified, const_cast<char*>(segmentId.c_str()));
+  if (!segmentationNode->GetDisplayNode() && segmentationNode->GetScene())
+    {
+    segmentationNode->CreateDefaultDisplayNodes();
+    }
+
+  this->UpdateTime = (vtkTimerLog::GetUniversalTime() - startTime) * 1000.0;
+  vtkDebugMacro("Update: " << this->NumberOfLabeledSlabs << " of " << this->Slabs.size() << " slabs labeled, "
+    << this->NumberOfSegmentVoxels << " voxels in " << this->UpdateTime << " ms");
+  this->Updating = false;
+  this->Modified();
+  return true;
+}
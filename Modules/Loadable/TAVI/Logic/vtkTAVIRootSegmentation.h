@@ -0,0 +1,186 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVIRootSegmentation_h
+#define __vtkTAVIRootSegmentation_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkCallbackCommand;
+class vtkImageData;
+class vtkMRMLMarkupsNode;
+class vtkMRMLScalarVolumeNode;
+class vtkMRMLSegmentationNode;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Seeded segmentation of the contrast-filled aortic root, LVOT and ascending aorta, slab by slab.
+///
+/// The segment is the set of voxels between LowerThreshold and UpperThreshold
+/// (the contrast-enhanced lumen, below the calcifications) 6-connected to one
+/// of the control points of SeedsNode.
+///
+/// The volume is split in slabs of SlabThickness slices, whose connected
+/// components are labeled in parallel, one slab per task, with a grain of
+/// one slab so that idle threads take the remaining slabs (work stealing
+/// with the TBB backend of vtkSMPTools). The components touching across
+/// the boundaries of the slabs are then merged, and the components of the
+/// seeds are written in parallel into the binary labelmap of the segment,
+/// which is allocated once and reused by the next updates.
+///
+/// The labels of each slab are cached as runs of voxels along the rows, so
+/// that the cache grows with the thresholded voxels, not with the volume.
+/// Moving, adding or removing seeds only selects other components and writes
+/// the segment again. When the image data is modified, only the slabs whose
+/// voxels changed are labeled again.
+///
+/// The segment is written in the coordinates of the parent transform of the
+/// segmentation node, which must be linear relative to the parent transform
+/// of the input volume.
+/// With AutoUpdate, the segment is updated whenever the seeds are modified,
+/// for interactive corrections.
+///
+/// Example:
+/// \code{.py}
+/// segmentation = slicer.modules.tavi.logic().GetRootSegmentation()
+/// segmentation.SetInputVolumeNode(volumeNode)
+/// segmentation.SetSeedsNode(seedsNode)
+/// segmentation.SetSegmentationNode(segmentationNode)
+/// segmentation.SetAutoUpdate(True)
+/// \endcode
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkTAVIRootSegmentation : public vtkObject
+{
+public:
+  static vtkTAVIRootSegmentation* New();
+  vtkTypeMacro(vtkTAVIRootSegmentation, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Contrast-enhanced CT, in Hounsfield units.
+  void SetInputVolumeNode(vtkMRMLScalarVolumeNode* volumeNode);
+  vtkMRMLScalarVolumeNode* GetInputVolumeNode();
+
+  /// Seeds in the lumen, one control point per seed.
+  void SetSeedsNode(vtkMRMLMarkupsNode* markupsNode);
+  vtkMRMLMarkupsNode* GetSeedsNode();
+
+  /// Segmentation node receiving the segment named SegmentName. The segment
+  /// is created if it does not exist.
+  void SetSegmentationNode(vtkMRMLSegmentationNode* segmentationNode);
+  vtkMRMLSegmentationNode* GetSegmentationNode();
+  vtkSetStdStringFromCharMacro(SegmentName);
+  vtkGetCharFromStdStringMacro(SegmentName);
+
+  /// Intensity range of the lumen, in HU.
+  void SetLowerThreshold(double threshold);
+  vtkGetMacro(LowerThreshold, double);
+  void SetUpperThreshold(double threshold);
+  vtkGetMacro(UpperThreshold, double);
+
+  /// Number of slices of a slab.
+  void SetSlabThickness(int thickness);
+  vtkGetMacro(SlabThickness, int);
+
+  /// Update the segment when the seeds or the input volume are modified.
+  void SetAutoUpdate(bool autoUpdate);
+  vtkGetMacro(AutoUpdate, bool);
+  vtkBooleanMacro(AutoUpdate, bool);
+
+  /// Label the slabs that changed and write the segment.
+  /// Return false if the input, seeds or segmentation is missing.
+  bool Update();
+
+  /// Release the labels of the slabs.
+  void ClearCache();
+
+  /// Statistics of the last Update().
+  int GetNumberOfSlabs();
+  vtkGetMacro(NumberOfLabeledSlabs, int);
+  /// Number of voxels of the segment.
+  vtkGetMacro(NumberOfSegmentVoxels, vtkIdType);
+  /// Time of the last Update(), in ms.
+  vtkGetMacro(UpdateTime, double);
+
+protected:
+  vtkTAVIRootSegmentation();
+  ~vtkTAVIRootSegmentation() override;
+
+  /// Consecutive thresholded voxels of a row, of the same label.
+  struct Run
+  {
+    int Start; // first column
+    int Length;
+    int Label; // 1 to NumberOfLabels of the slab
+  };
+
+  /// Connected components of slices [ZBegin, ZEnd) of the thresholded input.
+  struct Slab
+  {
+    int ZBegin;
+    int ZEnd;
+    /// Runs of the slab, row by row.
+    std::vector<Run> Runs;
+    /// First run of each row (y + (z - ZBegin) * number of rows), and the
+    /// number of runs at the end.
+    std::vector<int> RowRuns;
+    int NumberOfLabels;
+    /// Checksum of the voxels of the slab, to find the slabs that changed.
+    std::uint64_t Checksum;
+    bool Labeled;
+  };
+
+  static void OnNodeModified(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+  void UpdateObservers();
+
+  /// Label the components of the slabs that are not labeled, in parallel.
+  void LabelSlabs(vtkImageData* image);
+  /// Merge the components of consecutive slabs touching across their boundary.
+  /// Return the root of each label, labels of slab s starting at \a labelOffsets[s] + 1.
+  void MergeSlabs(vtkImageData* image, std::vector<int>& labelOffsets, std::vector<int>& roots);
+
+  vtkWeakPointer<vtkMRMLScalarVolumeNode> InputVolumeNode;
+  vtkWeakPointer<vtkMRMLMarkupsNode> SeedsNode;
+  vtkWeakPointer<vtkMRMLSegmentationNode> SegmentationNode;
+  vtkSmartPointer<vtkCallbackCommand> NodeCallback;
+  std::string SegmentName;
+  double LowerThreshold;
+  double UpperThreshold;
+  int SlabThickness;
+  bool AutoUpdate;
+  bool Updating;
+
+  std::vector<Slab> Slabs;
+  // Input the cached slabs were labeled from
+  vtkWeakPointer<vtkImageData> CachedImage;
+  vtkMTimeType CachedImageTime;
+  int CachedDimensions[3];
+
+  int NumberOfLabeledSlabs;
+  vtkIdType NumberOfSegmentVoxels;
+  double UpdateTime;
+
+private:
+  vtkTAVIRootSegmentation(const vtkTAVIRootSegmentation&) = delete;
+  void operator=(const vtkTAVIRootSegmentation&) = delete;
+};
+
+#endif
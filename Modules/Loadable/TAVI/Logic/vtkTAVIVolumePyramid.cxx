@@ -0,0 +1,628 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TAVI Logic includes
+#include "vtkTAVIDICOMSeriesReader.h"
+#include "vtkTAVIImageSampling.h"
+#include "vtkTAVIVolumePyramid.h"
+
+// MRML includes
+#include <vtkMRMLApplicationLogic.h>
+#include <vtkMRMLScalarVolumeDisplayNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSelectionNode.h>
+#include <vtkMRMLSliceCompositeNode.h>
+#include <vtkMRMLSliceNode.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkSMPTools.h>
+#include <vtkStringArray.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+using vtkTAVIImageSampling::RoundToScalar;
+
+//----------------------------------------------------------------------------
+/// Average blocks of Factor x Factor pixels of every Factor-th slice.
+/// Blocks are truncated at the last row and column.
+template <class T>
+class DownsampleFunctor
+{
+public:
+  DownsampleFunctor(vtkImageData* input, int factor, vtkImageData* output)
+    : Input(static_cast<const T*>(input->GetScalarPointer()))
+    , Output(static_cast<T*>(output->GetScalarPointer()))
+    , Factor(factor)
+    {
+    input->GetDimensions(this->InputDimensions);
+    output->GetDimensions(this->OutputDimensions);
+    }
+
+  /// Compute the output rows \a begin to \a end, all slices together.
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    const int factor = this->Factor;
+    const vtkIdType inputRowSize = this->InputDimensions[0];
+    const vtkIdType inputSliceSize = inputRowSize * this->InputDimensions[1];
+    for (vtkIdType row = begin; row < end; ++row)
+      {
+      const vtkIdType k = row / this->OutputDimensions[1];
+      const int j = static_cast<int>(row % this->OutputDimensions[1]);
+      const int rowBegin = j * factor;
+      const int rowEnd = std::min(rowBegin + factor, this->InputDimensions[1]);
+      const T* inputSlice = this->Input + k * factor * inputSliceSize;
+      T* output = this->Output + row * this->OutputDimensions[0];
+      for (int i = 0; i < this->OutputDimensions[0]; ++i)
+        {
+        const int columnBegin = i * factor;
+        const int columnEnd = std::min(columnBegin + factor, this->InputDimensions[0]);
+        double sum = 0.0;
+        for (int inputRow = rowBegin; inputRow < rowEnd; ++inputRow)
+          {
+          const T* input = inputSlice + inputRow * inputRowSize;
+          for (int column = columnBegin; column < columnEnd; ++column)
+            {
+            sum += input[column];
+            }
+          }
+        output[i] = RoundToScalar<T>(sum / ((rowEnd - rowBegin) * (columnEnd - columnBegin)));
+        }
+      }
+    }
+
+private:
+  const T* Input;
+  T* Output;
+  int Factor;
+  int InputDimensions[3];
+  int OutputDimensions[3];
+};
+
+//----------------------------------------------------------------------------
+template <class T>
+void Downsample(vtkImageData* input, int factor, vtkImageData* output)
+{
+  DownsampleFunctor<T> functor(input, factor, output);
+  int dimensions[3];
+  output->GetDimensions(dimensions);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(dimensions[1]) * dimensions[2], functor);
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTAVIVolumePyramid);
+
+//----------------------------------------------------------------------------
+vtkTAVIVolumePyramid::vtkTAVIVolumePyramid()
+  : AutoSelectLevels(true)
+  , LoadStartTime(0.0)
+  , StopRequested(false)
+{
+  this->SliceNodeCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->SliceNodeCallback->SetCallback(vtkTAVIVolumePyramid::OnSliceNodeModified);
+  this->SliceNodeCallback->SetClientData(this);
+  for (Level& level : this->Levels)
+    {
+    level.State = Failed;
+    level.Time = 0.0;
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkTAVIVolumePyramid::~vtkTAVIVolumePyramid()
+{
+  this->Stop();
+  this->RemoveSliceNodeObservers();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIVolumePyramid::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Name: " << this->Name << "\n";
+  os << indent << "AutoSelectLevels: " << this->AutoSelectLevels << "\n";
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (int level = 0; level < NumberOfLevels; ++level)
+    {
+    os << indent << "Level " << level << ": state " << this->Levels[level].State
+      << ", decoded after " << this->Levels[level].Time << " s\n";
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIVolumePyramid::SetScene(vtkMRMLScene* scene)
+{
+  if (this->Scene == scene)
+    {
+    return;
+    }
+  this->Stop();
+  this->RemoveSliceNodeObservers();
+  for (Level& level : this->Levels)
+    {
+    level.VolumeNode = nullptr;
+    }
+  this->Scene = scene;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScene* vtkTAVIVolumePyramid::GetScene()
+{
+  return this->Scene;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIVolumePyramid::SetMRMLApplicationLogic(vtkMRMLApplicationLogic* applicationLogic)
+{
+  if (this->MRMLApplicationLogic == applicationLogic)
+    {
+    return;
+    }
+  this->MRMLApplicationLogic = applicationLogic;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLApplicationLogic* vtkTAVIVolumePyramid::GetMRMLApplicationLogic()
+{
+  return this->MRMLApplicationLogic;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIVolumePyramid::SetAutoSelectLevels(bool autoSelect)
+{
+  if (this->AutoSelectLevels == autoSelect)
+    {
+    return;
+    }
+  this->AutoSelectLevels = autoSelect;
+  this->UpdateSliceNodeObservers();
+  this->SelectLevels();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIVolumePyramid::Load(const char* name, vtkStringArray* fileNames)
+{
+  vtkMRMLScene* scene = this->Scene;
+  if (!scene || !fileNames || fileNames->GetNumberOfValues() == 0)
+    {
+    vtkErrorMacro("Load: No scene or no file");
+    return false;
+    }
+  this->Stop();
+  this->Name = name ? name : "Volume";
+  this->LoadStartTime = vtkTimerLog::GetUniversalTime();
+
+  std::vector<std::string> files;
+  for (vtkIdType index = 0; index < fileNames->GetNumberOfValues(); ++index)
+    {
+    files.push_back(fileNames->GetValue(index));
+    }
+  vtkNew<vtkTAVIDICOMSeriesReader> reader;
+  reader->SetFileNames(files);
+  const int coarsestLevel = NumberOfLevels - 1;
+  if (!reader->Initialize() || !reader->DecodeSlices(1 << coarsestLevel))
+    {
+    return false;
+    }
+
+  // The coarsest level is decoded on this thread, the finer ones in the background
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (Level& level : this->Levels)
+    {
+    level.Image = nullptr;
+    level.VolumeNode = nullptr;
+    level.State = Pending;
+    level.Time = 0.0;
+    }
+  Level& level = this->Levels[coarsestLevel];
+  level.Image = vtkTAVIVolumePyramid::BuildLevelImage(reader->GetImageData(), coarsestLevel);
+  level.State = Decoded;
+  level.Time = vtkTimerLog::GetUniversalTime() - this->LoadStartTime;
+  this->StopRequested = false;
+  }
+  this->Reader = reader;
+  this->AddLevel(coarsestLevel);
+
+  vtkMRMLApplicationLogic* applicationLogic = this->MRMLApplicationLogic;
+  vtkMRMLScalarVolumeNode* volumeNode = this->Levels[coarsestLevel].VolumeNode;
+  if (applicationLogic && applicationLogic->GetSelectionNode() && volumeNode)
+    {
+    applicationLogic->GetSelectionNode()->SetActiveVolumeID(volumeNode->GetID());
+    applicationLogic->PropagateBackgroundVolumeSelection(1);
+    }
+  this->UpdateSliceNodeObservers();
+  this->SelectLevels();
+
+  this->Thread = std::thread(&vtkTAVIVolumePyramid::DecodeLevels, this);
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIVolumePyramid::DecodeLevels()
+{
+  for (int levelIndex = NumberOfLevels - 2; levelIndex >= 0; --levelIndex)
+    {
+    {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    if (this->StopRequested)
+      {
+      return;
+      }
+    }
+    const bool decoded = this->Reader->DecodeSlices(1 << levelIndex);
+    vtkSmartPointer<vtkImageData> image;
+    if (decoded)
+      {
+      image = levelIndex > 0 ?
+        vtkTAVIVolumePyramid::BuildLevelImage(this->Reader->GetImageData(), levelIndex) :
+        vtkSmartPointer<vtkImageData>(this->Reader->GetImageData());
+      }
+    {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    Level& level = this->Levels[levelIndex];
+    level.Image = image;
+    level.State = decoded ? Decoded : Failed;
+    level.Time = vtkTimerLog::GetUniversalTime() - this->LoadStartTime;
+    if (!decoded)
+      {
+      // Finer levels need the slices that failed
+      for (int finerLevel = 0; finerLevel < levelIndex; ++finerLevel)
+        {
+        this->Levels[finerLevel].State = Failed;
+        }
+      }
+    }
+    this->LevelDecoded.notify_all();
+    if (!decoded)
+      {
+      return;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> vtkTAVIVolumePyramid::BuildLevelImage(vtkImageData* image, int level)
+{
+  const int factor = 1 << level;
+  int dimensions[3];
+  image->GetDimensions(dimensions);
+  vtkSmartPointer<vtkImageData> levelImage = vtkSmartPointer<vtkImageData>::New();
+  levelImage->SetDimensions((dimensions[0] + factor - 1) / factor, (dimensions[1] + factor - 1) / factor,
+    (dimensions[2] - 1) / factor + 1);
+  levelImage->AllocateScalars(image->GetScalarType(), 1);
+  switch (image->GetScalarType())
+    {
+    vtkTemplateMacro(Downsample<VTK_TT>(image, factor, levelImage));
+    }
+  return levelImage;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIVolumePyramid::AddLevel(int levelIndex)
+{
+  vtkMRMLScene* scene = this->Scene;
+  vtkSmartPointer<vtkImageData> image;
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  image = this->Levels[levelIndex].Image;
+  }
+  if (!scene || !image)
+    {
+    return;
+    }
+
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  std::string name = this->Name;
+  if (levelIndex > 0)
+    {
+    name += " " + std::to_string(1 << levelIndex) + "x";
+    }
+  volumeNode->SetName(scene->GetUniqueNameByString(name.c_str()));
+  if (levelIndex == 0)
+    {
+    // The background thread is done with the reader
+    this->Reader->UpdateVolumeNode(volumeNode);
+    }
+  else
+    {
+    // Voxels of the level are centered on the blocks they average
+    const double factor = 1 << levelIndex;
+    vtkNew<vtkMatrix4x4> blockToIJK;
+    blockToIJK->SetElement(0, 0, factor);
+    blockToIJK->SetElement(1, 1, factor);
+    blockToIJK->SetElement(2, 2, factor);
+    blockToIJK->SetElement(0, 3, (factor - 1.0) / 2.0);
+    blockToIJK->SetElement(1, 3, (factor - 1.0) / 2.0);
+    vtkNew<vtkMatrix4x4> ijkToRAS;
+    this->Reader->GetIJKToRASMatrix(ijkToRAS);
+    vtkNew<vtkMatrix4x4> levelIJKToRAS;
+    vtkMatrix4x4::Multiply4x4(ijkToRAS, blockToIJK, levelIJKToRAS);
+    volumeNode->SetIJKToRASMatrix(levelIJKToRAS);
+    volumeNode->SetAndObserveImageData(image);
+    }
+  scene->AddNode(volumeNode);
+  volumeNode->CreateDefaultDisplayNodes();
+
+  // Share the window/level of the levels already shown
+  vtkMRMLScalarVolumeDisplayNode* displayNode = volumeNode->GetScalarVolumeDisplayNode();
+  for (int otherLevel = NumberOfLevels - 1; otherLevel >= 0 && displayNode; --otherLevel)
+    {
+    vtkMRMLScalarVolumeNode* otherVolumeNode = this->Levels[otherLevel].VolumeNode;
+    vtkMRMLScalarVolumeDisplayNode* otherDisplayNode =
+      otherVolumeNode ? otherVolumeNode->GetScalarVolumeDisplayNode() : nullptr;
+    if (otherDisplayNode)
+      {
+      displayNode->SetAutoWindowLevel(false);
+      displayNode->SetWindowLevel(otherDisplayNode->GetWindow(), otherDisplayNode->GetLevel());
+      break;
+      }
+    }
+
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  Level& level = this->Levels[levelIndex];
+  level.VolumeNode = volumeNode;
+  level.State = Added;
+  // The volume node keeps the image
+  level.Image = nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIVolumePyramid::UpdateLevels()
+{
+  std::vector<int> decodedLevels;
+  bool pending = false;
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (int level = NumberOfLevels - 1; level >= 0; --level)
+    {
+    if (this->Levels[level].State == Decoded)
+      {
+      decodedLevels.push_back(level);
+      }
+    pending = pending || this->Levels[level].State == Pending;
+    }
+  }
+  if (!pending && this->Thread.joinable())
+    {
+    this->Thread.join();
+    }
+  for (int level : decodedLevels)
+    {
+    this->AddLevel(level);
+    }
+  if (!pending)
+    {
+    this->Reader = nullptr;
+    }
+  if (!decodedLevels.empty())
+    {
+    this->SelectLevels();
+    this->Modified();
+    }
+  return pending;
+}
+
+//----------------------------------------------------------------------------
+bool vtkTAVIVolumePyramid::WaitForLevel(int level)
+{
+  if (level < 0 || level >= NumberOfLevels)
+    {
+    vtkErrorMacro("WaitForLevel: Invalid level " << level);
+    return false;
+    }
+  {
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  // Pending levels are decoded or failed before the thread ends
+  this->LevelDecoded.wait(lock, [this, level]() { return this->Levels[level].State != Pending; });
+  }
+  this->UpdateLevels();
+  return this->GetLevelVolumeNode(level) != nullptr;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIVolumePyramid::Stop()
+{
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->StopRequested = true;
+  }
+  if (this->Reader)
+    {
+    // Slices not started yet are skipped
+    this->Reader->AbortDecoding();
+    }
+  if (this->Thread.joinable())
+    {
+    this->Thread.join();
+    }
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (Level& level : this->Levels)
+    {
+    if (level.State != Added)
+      {
+      level.State = Failed;
+      level.Image = nullptr;
+      }
+    }
+  }
+  this->Reader = nullptr;
+  this->UpdateSliceNodeObservers();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* vtkTAVIVolumePyramid::GetLevelVolumeNode(int level)
+{
+  if (level < 0 || level >= NumberOfLevels)
+    {
+    return nullptr;
+    }
+  return this->Levels[level].VolumeNode;
+}
+
+//----------------------------------------------------------------------------
+int vtkTAVIVolumePyramid::GetFinestLevel()
+{
+  for (int level = 0; level < NumberOfLevels; ++level)
+    {
+    if (this->Levels[level].VolumeNode)
+      {
+      return level;
+      }
+    }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+double vtkTAVIVolumePyramid::GetLevelTime(int level)
+{
+  if (level < 0 || level >= NumberOfLevels)
+    {
+    return 0.0;
+    }
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Levels[level].Time;
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIVolumePyramid::OnSliceNodeModified(vtkObject* vtkNotUsed(caller),
+  unsigned long vtkNotUsed(eid), void* clientData, void* vtkNotUsed(callData))
+{
+  static_cast<vtkTAVIVolumePyramid*>(clientData)->SelectLevels();
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIVolumePyramid::UpdateSliceNodeObservers()
+{
+  this->RemoveSliceNodeObservers();
+  vtkMRMLScene* scene = this->Scene;
+  if (!scene || !this->AutoSelectLevels || this->GetFinestLevel() < 0)
+    {
+    return;
+    }
+  std::vector<vtkMRMLNode*> sliceNodes;
+  scene->GetNodesByClass("vtkMRMLSliceNode", sliceNodes);
+  for (vtkMRMLNode* sliceNode : sliceNodes)
+    {
+    sliceNode->AddObserver(vtkCommand::ModifiedEvent, this->SliceNodeCallback);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIVolumePyramid::RemoveSliceNodeObservers()
+{
+  vtkMRMLScene* scene = this->Scene;
+  if (!scene)
+    {
+    return;
+    }
+  std::vector<vtkMRMLNode*> sliceNodes;
+  scene->GetNodesByClass("vtkMRMLSliceNode", sliceNodes);
+  for (vtkMRMLNode* sliceNode : sliceNodes)
+    {
+    sliceNode->RemoveObserver(this->SliceNodeCallback);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkTAVIVolumePyramid::SelectLevels()
+{
+  vtkMRMLScene* scene = this->Scene;
+  if (!scene || !this->AutoSelectLevels || this->GetFinestLevel() < 0)
+    {
+    return;
+    }
+  std::vector<vtkMRMLNode*> sliceNodes;
+  scene->GetNodesByClass("vtkMRMLSliceNode", sliceNodes);
+  std::vector<vtkMRMLNode*> compositeNodes;
+  scene->GetNodesByClass("vtkMRMLSliceCompositeNode", compositeNodes);
+  for (vtkMRMLNode* node : compositeNodes)
+    {
+    vtkMRMLSliceCompositeNode* compositeNode = vtkMRMLSliceCompositeNode::SafeDownCast(node);
+    const char* backgroundVolumeID = compositeNode ? compositeNode->GetBackgroundVolumeID() : nullptr;
+    int shownLevel = -1;
+    for (int level = 0; level < NumberOfLevels && backgroundVolumeID; ++level)
+      {
+      vtkMRMLScalarVolumeNode* volumeNode = this->Levels[level].VolumeNode;
+      if (volumeNode && volumeNode->GetID() && strcmp(volumeNode->GetID(), backgroundVolumeID) == 0)
+        {
+        shownLevel = level;
+        }
+      }
+    vtkMRMLSliceNode* sliceNode = nullptr;
+    for (vtkMRMLNode* sliceNodeCandidate : sliceNodes)
+      {
+      vtkMRMLSliceNode* candidate = vtkMRMLSliceNode::SafeDownCast(sliceNodeCandidate);
+      if (candidate && candidate->GetLayoutName() && compositeNode && compositeNode->GetLayoutName()
+          && strcmp(candidate->GetLayoutName(), compositeNode->GetLayoutName()) == 0)
+        {
+        sliceNode = candidate;
+        break;
+        }
+      }
+    if (shownLevel < 0 || !sliceNode || sliceNode->GetDimensions()[0] <= 0 || sliceNode->GetDimensions()[1] <= 0)
+      {
+      continue;
+      }
+
+    // Coarsest level whose pixels are not larger than the pixels of the view,
+    // the finest level if the view is zoomed in further.
+    const double pixelSize = std::min(sliceNode->GetFieldOfView()[0] / sliceNode->GetDimensions()[0],
+      sliceNode->GetFieldOfView()[1] / sliceNode->GetDimensions()[1]);
+    int selectedLevel = this->GetFinestLevel();
+    for (int level = NumberOfLevels - 1; level > selectedLevel; --level)
+      {
+      vtkMRMLScalarVolumeNode* volumeNode = this->Levels[level].VolumeNode;
+      if (volumeNode && std::min(volumeNode->GetSpacing()[0], volumeNode->GetSpacing()[1]) <= pixelSize)
+        {
+        selectedLevel = level;
+        break;
+        }
+      }
+    if (selectedLevel == shownLevel)
+      {
+      continue;
+      }
+    vtkMRMLScalarVolumeDisplayNode* shownDisplayNode = this->Levels[shownLevel].VolumeNode->GetScalarVolumeDisplayNode();
+    vtkMRMLScalarVolumeNode* selectedVolumeNode = this->Levels[selectedLevel].VolumeNode;
+    vtkMRMLScalarVolumeDisplayNode* selectedDisplayNode = selectedVolumeNode->GetScalarVolumeDisplayNode();
+    if (shownDisplayNode && selectedDisplayNode)
+      {
+      selectedDisplayNode->SetAutoWindowLevel(false);
+      selectedDisplayNode->SetWindowLevel(shownDisplayNode->GetWindow(), shownDisplayNode->GetLevel());
+      }
+    compositeNode->SetBackgroundVolumeID(selectedVolumeNode->GetID());
+    }
+}
@@ -0,0 +1,171 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkTAVIVolumePyramid_h
+#define __vtkTAVIVolumePyramid_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "vtkSlicerTAVIModuleLogicExport.h"
+
+class vtkCallbackCommand;
+class vtkImageData;
+class vtkMRMLApplicationLogic;
+class vtkMRMLScalarVolumeNode;
+class vtkMRMLScene;
+class vtkStringArray;
+class vtkTAVIDICOMSeriesReader;
+
+/// \ingroup Slicer_QtModules_TAVI
+/// \brief Load a large DICOM series progressively, through 4x and 2x downsampled levels.
+///
+/// Level 0 is the full resolution volume, level 1 and 2 are downsampled
+/// 2 and 4 times along each axis (in-plane pixels are averaged, slices are
+/// skipped). Load() decodes every 4th slice, builds level 2 and shows it in
+/// the slice views at once. A background thread then decodes every 2nd slice
+/// and builds level 1, then decodes the remaining slices. UpdateLevels(),
+/// called by a timer, adds the levels that became ready to the scene.
+///
+/// Each slice view showing the series switches to the coarsest ready level
+/// whose pixels are not larger than the pixels of the view: zooming in shows
+/// the full resolution as soon as it is decoded, zoomed out views stay on a
+/// coarse level, which is faster to reslice.
+///
+/// All levels share the RAS space of the full resolution volume, so coarse
+/// steps (e.g. seeding landmarks) can run on GetLevelVolumeNode(2) and be
+/// refined on GetLevelVolumeNode(0) after WaitForLevel(0).
+///
+/// Example:
+/// \code{.py}
+/// pyramid = slicer.modules.tavi.logic().GetVolumePyramid()
+/// pyramid.Load("CTA", fileNames)
+/// timer = qt.QTimer()
+/// timer.connect("timeout()", lambda: pyramid.UpdateLevels() or timer.stop())
+/// timer.start(100)
+/// \endcode
+class VTK_SLICER_TAVI_MODULE_LOGIC_EXPORT vtkTAVIVolumePyramid : public vtkObject
+{
+public:
+  static vtkTAVIVolumePyramid* New();
+  vtkTypeMacro(vtkTAVIVolumePyramid, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  enum
+  {
+    NumberOfLevels = 3
+  };
+
+  /// Scene in which the levels are added.
+  void SetScene(vtkMRMLScene* scene);
+  vtkMRMLScene* GetScene();
+
+  /// Application logic used to show the first level in the slice views.
+  void SetMRMLApplicationLogic(vtkMRMLApplicationLogic* applicationLogic);
+  vtkMRMLApplicationLogic* GetMRMLApplicationLogic();
+
+  /// Select the level shown in the slice views from their zoom.
+  void SetAutoSelectLevels(bool autoSelect);
+  vtkGetMacro(AutoSelectLevels, bool);
+  vtkBooleanMacro(AutoSelectLevels, bool);
+
+  /// Start loading the series \a fileNames, sorted along the slice axis, and
+  /// show its coarsest level. The previous series stops loading, its nodes
+  /// stay in the scene.
+  /// Return false if the series is not supported by vtkTAVIDICOMSeriesReader.
+  bool Load(const char* name, vtkStringArray* fileNames);
+
+  /// Add the levels decoded by the background thread to the scene and update
+  /// the slice views. Return true while levels remain to be decoded.
+  bool UpdateLevels();
+
+  /// Block until \a level is decoded, then add it to the scene.
+  /// Return false if it failed to decode or nothing is loading.
+  bool WaitForLevel(int level);
+
+  /// Stop the background thread, after the slices being decoded.
+  void Stop();
+
+  /// Volume node of \a level, nullptr until it is added to the scene.
+  vtkMRMLScalarVolumeNode* GetLevelVolumeNode(int level);
+  /// Finest level in the scene, -1 if none.
+  int GetFinestLevel();
+
+  /// Time from Load() to each level being decoded, in s. 0 if not decoded.
+  double GetLevelTime(int level);
+
+protected:
+  vtkTAVIVolumePyramid();
+  ~vtkTAVIVolumePyramid() override;
+
+  enum LevelState
+  {
+    Pending = 0,
+    Decoded,  ///< ready to be added to the scene by the main thread
+    Added,
+    Failed
+  };
+
+  struct Level
+  {
+    vtkSmartPointer<vtkImageData> Image; // full resolution image for level 0
+    vtkWeakPointer<vtkMRMLScalarVolumeNode> VolumeNode;
+    LevelState State;
+    double Time;
+  };
+
+  /// Background thread: decode the slices of levels 1 and 0.
+  void DecodeLevels();
+  /// Average the decoded slices of level 0 into a downsampled image.
+  static vtkSmartPointer<vtkImageData> BuildLevelImage(vtkImageData* image, int level);
+  /// Create the volume node of a decoded level. Must be called with the mutex unlocked.
+  void AddLevel(int level);
+
+  static void OnSliceNodeModified(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+  /// Observe the slice nodes of the scene while levels are shown and AutoSelectLevels is on.
+  void UpdateSliceNodeObservers();
+  void RemoveSliceNodeObservers();
+  /// Show the best level in each slice view showing one of the levels.
+  void SelectLevels();
+
+  vtkWeakPointer<vtkMRMLScene> Scene;
+  vtkWeakPointer<vtkMRMLApplicationLogic> MRMLApplicationLogic;
+  vtkSmartPointer<vtkCallbackCommand> SliceNodeCallback;
+  bool AutoSelectLevels;
+
+  std::string Name;
+  vtkSmartPointer<vtkTAVIDICOMSeriesReader> Reader;
+  double LoadStartTime;
+  std::thread Thread;
+
+  // Shared with the background thread
+  std::mutex Mutex;
+  std::condition_variable LevelDecoded;
+  bool StopRequested;
+  Level Levels[NumberOfLevels];
+
+private:
+  vtkTAVIVolumePyramid(const vtkTAVIVolumePyramid&) = delete;
+  void operator=(const vtkTAVIVolumePyramid&) = delete;
+};
+
+#endif
@@ -0,0 +1,196 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QDir>
+#include <QSettings>
+#include <QTimer>
+
+// Slicer includes
+#include <qSlicerCoreApplication.h>
+
+// TAVI Logic includes
+#include <vtkSlicerTAVILogic.h>
+#include <vtkTAVIMeasurementGraph.h>
+#include <vtkTAVIPhaseManager.h>
+#include <vtkTAVIRenderGovernor.h>
+#include <vtkTAVIResultCache.h>
+
+// TAVI includes
+#include "qSlicerTAVIModule.h"
+#include "qSlicerTAVIModuleWidget.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkNew.h>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+void onMeasurementsInvalidated(vtkObject* vtkNotUsed(caller),
+  unsigned long vtkNotUsed(eid), void* clientData, void* vtkNotUsed(callData))
+{
+  static_cast<QTimer*>(clientData)->start();
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+class qSlicerTAVIModulePrivate
+{
+public:
+  qSlicerTAVIModulePrivate();
+
+  /// Coalesce the invalidations of the measurement graph, e.g. while a
+  /// control point is dragged, into one update.
+  QTimer MeasurementUpdateTimer;
+  unsigned long MeasurementGraphObserverTag;
+};
+
+//-----------------------------------------------------------------------------
+// qSlicerTAVIModulePrivate methods
+
+//-----------------------------------------------------------------------------
+qSlicerTAVIModulePrivate::qSlicerTAVIModulePrivate()
+  : MeasurementGraphObserverTag(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// qSlicerTAVIModule methods
+
+//-----------------------------------------------------------------------------
+qSlicerTAVIModule::qSlicerTAVIModule(QObject* _parent)
+  : Superclass(_parent)
+  , d_ptr(new qSlicerTAVIModulePrivate)
+{
+}
+
+//-----------------------------------------------------------------------------
+qSlicerTAVIModule::~qSlicerTAVIModule()
+{
+  Q_D(qSlicerTAVIModule);
+  // The logic was created by setup() if the observer was added
+  vtkSlicerTAVILogic* taviLogic = d->MeasurementGraphObserverTag ?
+    vtkSlicerTAVILogic::SafeDownCast(this->logic()) : nullptr;
+  if (taviLogic)
+    {
+    taviLogic->GetMeasurementGraph()->RemoveObserver(d->MeasurementGraphObserverTag);
+    }
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerTAVIModule::helpText() const
+{
+  return "Native measurement engines for transcatheter aortic valve implantation (TAVI) planning. "
+    "The aortic annulus is measured on the oblique plane that best fits the hinge points: "
+    "candidate planes are sampled in parallel around the seed plane and the annulus contour "
+    "is extracted on each of them.";
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerTAVIModule::acknowledgementText() const
+{
+  return "";
+}
+
+//-----------------------------------------------------------------------------
+QStringList qSlicerTAVIModule::contributors() const
+{
+  QStringList moduleContributors;
+  moduleContributors << QString("TAVIMERCY");
+  return moduleContributors;
+}
+
+//-----------------------------------------------------------------------------
+QIcon qSlicerTAVIModule::icon() const
+{
+  return QIcon(":/Icons/TAVI.png");
+}
+
+//-----------------------------------------------------------------------------
+QStringList qSlicerTAVIModule::categories() const
+{
+  return QStringList() << "Cardiac";
+}
+
+//-----------------------------------------------------------------------------
+QStringList qSlicerTAVIModule::dependencies() const
+{
+  return QStringList() << "Markups" << "Segmentations";
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTAVIModule::setup()
+{
+  this->Superclass::setup();
+
+  // Result cache, see [ResultCache] in the application default settings.
+  // An empty directory means the application cache path, the size limit is in MB.
+  vtkSlicerTAVILogic* taviLogic = vtkSlicerTAVILogic::SafeDownCast(this->logic());
+  QSettings settings;
+  QString cacheDirectory = settings.value("ResultCache/Directory").toString();
+  if (cacheDirectory.isEmpty())
+    {
+    cacheDirectory = QDir(qSlicerCoreApplication::application()->cachePath()).filePath("TAVIResults");
+    }
+  vtkTAVIResultCache* resultCache = taviLogic->GetResultCache();
+  resultCache->SetCacheDirectory(cacheDirectory.toUtf8().constData());
+  resultCache->SetMaximumSize(settings.value("ResultCache/MaximumSize", 2048).toLongLong() * 1024 * 1024);
+
+  // Memory budget of the 4D phases, in MB
+  taviLogic->GetPhaseManager()->SetMemoryBudget(
+    settings.value("Phases/MemoryBudget", 4096).toLongLong() * 1024 * 1024);
+
+  // Frame rate held by the volume rendering while the 3D view is interacted with
+  vtkTAVIRenderGovernor* renderGovernor = taviLogic->GetRenderGovernor();
+  renderGovernor->SetEnabled(settings.value("VolumeRendering/FrameRateGovernor", true).toBool());
+  renderGovernor->SetTargetFrameRate(settings.value("VolumeRendering/TargetFrameRate", 10).toDouble());
+
+  // Invalid measurements are recomputed once the pending events (e.g. the
+  // mouse moves of a drag) are processed.
+  Q_D(qSlicerTAVIModule);
+  d->MeasurementUpdateTimer.setSingleShot(true);
+  d->MeasurementUpdateTimer.setInterval(0);
+  connect(&d->MeasurementUpdateTimer, SIGNAL(timeout()), this, SLOT(updateMeasurements()));
+  vtkNew<vtkCallbackCommand> invalidatedCallback;
+  invalidatedCallback->SetCallback(onMeasurementsInvalidated);
+  invalidatedCallback->SetClientData(&d->MeasurementUpdateTimer);
+  d->MeasurementGraphObserverTag = taviLogic->GetMeasurementGraph()->AddObserver(
+    vtkTAVIMeasurementGraph::InvalidatedEvent, invalidatedCallback);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTAVIModule::updateMeasurements()
+{
+  vtkSlicerTAVILogic* taviLogic = vtkSlicerTAVILogic::SafeDownCast(this->logic());
+  if (taviLogic)
+    {
+    taviLogic->GetMeasurementGraph()->Update();
+    }
+}
+
+//-----------------------------------------------------------------------------
+qSlicerAbstractModuleRepresentation* qSlicerTAVIModule
+::createWidgetRepresentation()
+{
+  return new qSlicerTAVIModuleWidget;
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLAbstractLogic* qSlicerTAVIModule::createLogic()
+{
+  return vtkSlicerTAVILogic::New();
+}
@@ -0,0 +1,74 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qSlicerTAVIModule_h
+#define __qSlicerTAVIModule_h
+
+// Slicer includes
+#include "qSlicerLoadableModule.h"
+
+#include "qSlicerTAVIModuleExport.h"
+
+class qSlicerTAVIModulePrivate;
+
+class Q_SLICER_QTMODULES_TAVI_EXPORT
+qSlicerTAVIModule
+  : public qSlicerLoadableModule
+{
+  Q_OBJECT
+  Q_PLUGIN_METADATA(IID "org.slicer.modules.loadable.qSlicerLoadableModule/1.0");
+  Q_INTERFACES(qSlicerLoadableModule);
+
+public:
+
+  typedef qSlicerLoadableModule Superclass;
+  explicit qSlicerTAVIModule(QObject *parent=0);
+  virtual ~qSlicerTAVIModule();
+
+  qSlicerGetTitleMacro("TAVI Measurements");
+
+  virtual QString helpText()const;
+  virtual QString acknowledgementText()const;
+  virtual QStringList contributors()const;
+
+  virtual QIcon icon()const;
+
+  virtual QStringList categories()const;
+  virtual QStringList dependencies() const;
+
+protected slots:
+  /// Compute the invalid measurements of the measurement graph of the logic.
+  void updateMeasurements();
+
+protected:
+
+  /// Initialize the module.
+  virtual void setup();
+
+  /// Create and return the widget representation associated to this module
+  virtual qSlicerAbstractModuleRepresentation * createWidgetRepresentation();
+
+  /// Create and return the logic associated to this module
+  virtual vtkMRMLAbstractLogic* createLogic();
+
+protected:
+  QScopedPointer<qSlicerTAVIModulePrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qSlicerTAVIModule);
+  Q_DISABLE_COPY(qSlicerTAVIModule);
+
+};
+
+#endif
@@ -0,0 +1,325 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QDebug>
+#include <QTimer>
+
+// Slicer includes
+#include <qMRMLSliceWidget.h>
+#include <qSlicerApplication.h>
+#include <qSlicerLayoutManager.h>
+#include "qSlicerTAVIModuleWidget.h"
+#include "ui_qSlicerTAVIModuleWidget.h"
+
+// TAVI Logic includes
+#include "vtkAorticAnnulusMeasurement.h"
+#include "vtkSlicerTAVILogic.h"
+#include "vtkTAVICinePlayer.h"
+#include "vtkTAVIMeasurementGraph.h"
+#include "vtkTAVIPhaseManager.h"
+
+// MRML includes
+#include <vtkMRMLMarkupsClosedCurveNode.h>
+#include <vtkMRMLMarkupsNode.h>
+#include <vtkMRMLMarkupsPlaneNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLSliceCompositeNode.h>
+#include <vtkMRMLTableNode.h>
+
+// VTK includes
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <cstring>
+
+namespace
+{
+/// Name of the live annulus measurement in the measurement graph
+const char* AnnulusMeasurementName = "Annulus";
+}
+
+//-----------------------------------------------------------------------------
+class qSlicerTAVIModuleWidgetPrivate: public Ui_qSlicerTAVIModuleWidget
+{
+public:
+  qSlicerTAVIModuleWidgetPrivate();
+
+  vtkSlicerTAVILogic* logic(qSlicerTAVIModuleWidget* widget)const;
+
+  /// Show the cine frames at the frame rate of the player.
+  QTimer CineTimer;
+  /// Background volume of the cine slice view before playing.
+  vtkWeakPointer<vtkMRMLSliceCompositeNode> CineCompositeNode;
+  QString CinePreviousBackgroundVolumeID;
+};
+
+//-----------------------------------------------------------------------------
+// qSlicerTAVIModuleWidgetPrivate methods
+
+//-----------------------------------------------------------------------------
+qSlicerTAVIModuleWidgetPrivate::qSlicerTAVIModuleWidgetPrivate()
+{
+}
+
+//-----------------------------------------------------------------------------
+vtkSlicerTAVILogic* qSlicerTAVIModuleWidgetPrivate::logic(qSlicerTAVIModuleWidget* widget)const
+{
+  return vtkSlicerTAVILogic::SafeDownCast(widget->logic());
+}
+
+//-----------------------------------------------------------------------------
+// qSlicerTAVIModuleWidget methods
+
+//-----------------------------------------------------------------------------
+qSlicerTAVIModuleWidget::qSlicerTAVIModuleWidget(QWidget* _parent)
+  : Superclass( _parent )
+  , d_ptr( new qSlicerTAVIModuleWidgetPrivate )
+{
+}
+
+//-----------------------------------------------------------------------------
+qSlicerTAVIModuleWidget::~qSlicerTAVIModuleWidget()
+{
+  Q_D(qSlicerTAVIModuleWidget);
+  vtkSlicerTAVILogic* logic = d->logic(this);
+  if (logic)
+    {
+    logic->GetMeasurementGraph()->RemoveMeasurement(AnnulusMeasurementName);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTAVIModuleWidget::setup()
+{
+  Q_D(qSlicerTAVIModuleWidget);
+  d->setupUi(this);
+  this->Superclass::setup();
+
+  // Live measurements are computed by the measurement graph of the logic,
+  // which only recomputes them when their inputs change.
+  vtkSlicerTAVILogic* logic = d->logic(this);
+  if (logic)
+    {
+    this->qvtkConnect(logic->GetMeasurementGraph(), vtkTAVIMeasurementGraph::ComputeMeasurementEvent,
+                      this, SLOT(onComputeMeasurement(vtkObject*, void*)));
+    }
+  foreach (qMRMLNodeComboBox* nodeComboBox, QList<qMRMLNodeComboBox*>()
+           << d->InputVolumeNodeComboBox << d->HingePointsNodeComboBox << d->OutputTableNodeComboBox
+           << d->OutputContourNodeComboBox << d->OutputPlaneNodeComboBox)
+    {
+    connect(nodeComboBox, SIGNAL(currentNodeChanged(vtkMRMLNode*)),
+            this, SLOT(updateLiveMeasurement()));
+    }
+  connect(d->LumenThresholdSliderWidget, SIGNAL(valueChanged(double)),
+          this, SLOT(onLumenThresholdChanged()));
+  connect(d->LiveUpdateCheckBox, SIGNAL(toggled(bool)),
+          this, SLOT(setLiveUpdate(bool)));
+  connect(d->MeasureAnnulusButton, SIGNAL(clicked()),
+          this, SLOT(measureAnnulus()));
+
+  d->CineTimer.setTimerType(Qt::PreciseTimer);
+  connect(&d->CineTimer, SIGNAL(timeout()), this, SLOT(onCineTimeout()));
+  connect(d->CinePlayButton, SIGNAL(toggled(bool)),
+          this, SLOT(setCinePlaying(bool)));
+  connect(d->CineFrameRateSpinBox, SIGNAL(valueChanged(int)),
+          this, SLOT(onCineFrameRateChanged(int)));
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTAVIModuleWidget::setLiveUpdate(bool enabled)
+{
+  Q_D(qSlicerTAVIModuleWidget);
+  if (d->LiveUpdateCheckBox->isChecked() != enabled)
+    {
+    d->LiveUpdateCheckBox->setChecked(enabled);
+    }
+  this->updateLiveMeasurement();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTAVIModuleWidget::updateLiveMeasurement()
+{
+  Q_D(qSlicerTAVIModuleWidget);
+  vtkSlicerTAVILogic* logic = d->logic(this);
+  if (!logic)
+    {
+    return;
+    }
+  vtkTAVIMeasurementGraph* graph = logic->GetMeasurementGraph();
+  graph->RemoveMeasurement(AnnulusMeasurementName);
+  vtkMRMLNode* volumeNode = d->InputVolumeNodeComboBox->currentNode();
+  vtkMRMLNode* hingePointsNode = d->HingePointsNodeComboBox->currentNode();
+  if (!d->LiveUpdateCheckBox->isChecked() || !volumeNode || !hingePointsNode)
+    {
+    return;
+    }
+  graph->AddMeasurement(AnnulusMeasurementName);
+  graph->AddMeasurementInput(AnnulusMeasurementName, volumeNode);
+  graph->AddMeasurementInput(AnnulusMeasurementName, hingePointsNode);
+  // Measurements of the scripted modules may depend on the annulus outputs
+  foreach (vtkMRMLNode* outputNode, QList<vtkMRMLNode*>() << d->OutputTableNodeComboBox->currentNode()
+           << d->OutputContourNodeComboBox->currentNode() << d->OutputPlaneNodeComboBox->currentNode())
+    {
+    if (outputNode)
+      {
+      graph->AddMeasurementOutput(AnnulusMeasurementName, outputNode);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTAVIModuleWidget::onLumenThresholdChanged()
+{
+  Q_D(qSlicerTAVIModuleWidget);
+  vtkSlicerTAVILogic* logic = d->logic(this);
+  if (logic)
+    {
+    logic->GetMeasurementGraph()->InvalidateMeasurement(AnnulusMeasurementName);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTAVIModuleWidget::onComputeMeasurement(vtkObject* vtkNotUsed(caller), void* callData)
+{
+  const char* name = static_cast<const char*>(callData);
+  if (name && strcmp(name, AnnulusMeasurementName) == 0)
+    {
+    this->measureAnnulus();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTAVIModuleWidget::measureAnnulus()
+{
+  Q_D(qSlicerTAVIModuleWidget);
+  vtkSlicerTAVILogic* logic = d->logic(this);
+  vtkMRMLScalarVolumeNode* volumeNode =
+    vtkMRMLScalarVolumeNode::SafeDownCast(d->InputVolumeNodeComboBox->currentNode());
+  vtkMRMLMarkupsNode* hingePointsNode =
+    vtkMRMLMarkupsNode::SafeDownCast(d->HingePointsNodeComboBox->currentNode());
+  if (!logic || !volumeNode || !hingePointsNode ||
+      hingePointsNode->GetNumberOfDefinedControlPoints() < 3)
+    {
+    return;
+    }
+  logic->GetAnnulusMeasurement()->SetLumenThreshold(d->LumenThresholdSliderWidget->value());
+  bool success = logic->MeasureAnnulus(volumeNode, hingePointsNode,
+    vtkMRMLTableNode::SafeDownCast(d->OutputTableNodeComboBox->currentNode()),
+    vtkMRMLMarkupsClosedCurveNode::SafeDownCast(d->OutputContourNodeComboBox->currentNode()),
+    vtkMRMLMarkupsPlaneNode::SafeDownCast(d->OutputPlaneNodeComboBox->currentNode()));
+  d->StatusLabel->setText(success ? tr("Annulus area: %1 mm2").arg(
+    logic->GetAnnulusMeasurement()->GetArea(), 0, 'f', 1) : tr("Annulus not found"));
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTAVIModuleWidget::setCinePlaying(bool playing)
+{
+  Q_D(qSlicerTAVIModuleWidget);
+  vtkSlicerTAVILogic* logic = d->logic(this);
+  if (!logic)
+    {
+    return;
+    }
+  vtkTAVICinePlayer* player = logic->GetCinePlayer();
+  if (playing && !player->IsPlaying())
+    {
+    qSlicerLayoutManager* layoutManager = qSlicerApplication::application()->layoutManager();
+    qMRMLSliceWidget* sliceWidget = layoutManager ?
+      layoutManager->sliceWidget(d->CineSliceViewComboBox->currentText()) : nullptr;
+    player->SetSliceNode(sliceWidget ? sliceWidget->mrmlSliceNode() : nullptr);
+    player->SetFrameRate(d->CineFrameRateSpinBox->value());
+    if (!sliceWidget || !player->Start())
+      {
+      d->CineStatisticsLabel->setText(tr("No phases to play"));
+      playing = false;
+      }
+    else
+      {
+      vtkMRMLSliceCompositeNode* compositeNode = sliceWidget->mrmlSliceCompositeNode();
+      d->CineCompositeNode = compositeNode;
+      d->CinePreviousBackgroundVolumeID = QString::fromUtf8(compositeNode->GetBackgroundVolumeID());
+      compositeNode->SetBackgroundVolumeID(player->GetFrameVolumeNode()->GetID());
+      d->CineTimer.start(qRound(1000. / player->GetFrameRate()));
+      }
+    }
+  else if (!playing)
+    {
+    d->CineTimer.stop();
+    player->Stop();
+    if (d->CineCompositeNode)
+      {
+      d->CineCompositeNode->SetBackgroundVolumeID(d->CinePreviousBackgroundVolumeID.isEmpty() ?
+        nullptr : d->CinePreviousBackgroundVolumeID.toUtf8().constData());
+      d->CineCompositeNode = nullptr;
+      }
+    }
+
+  bool wasBlocked = d->CinePlayButton->blockSignals(true);
+  d->CinePlayButton->setChecked(playing);
+  d->CinePlayButton->blockSignals(wasBlocked);
+  d->CinePlayButton->setText(playing ? tr("Stop") : tr("Play"));
+  d->CineSliceViewComboBox->setEnabled(!playing);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTAVIModuleWidget::onCineTimeout()
+{
+  Q_D(qSlicerTAVIModuleWidget);
+  vtkSlicerTAVILogic* logic = d->logic(this);
+  vtkTAVICinePlayer* player = logic ? logic->GetCinePlayer() : nullptr;
+  if (!player || !player->IsPlaying())
+    {
+    // Stopped by the logic, e.g. when the scene is closed
+    this->setCinePlaying(false);
+    return;
+    }
+  player->ShowNextFrame();
+
+  // Update the frame statistics about once per second
+  int numberOfFrames = player->GetNumberOfShownFrames() + player->GetNumberOfDroppedFrames();
+  if (numberOfFrames % qMax(1, qRound(player->GetFrameRate())) != 0)
+    {
+    return;
+    }
+  double meanInterval = player->GetMeanFrameInterval();
+  d->CineStatisticsLabel->setText(
+    tr("%1 fps, frame interval %2 +/- %3 ms (max %4 ms)\n"
+       "%5 frames dropped, %6/%7 frames ready, resampling %8 ms/frame")
+    .arg(meanInterval > 0. ? 1000. / meanInterval : 0., 0, 'f', 1)
+    .arg(meanInterval, 0, 'f', 1)
+    .arg(player->GetFrameIntervalStandardDeviation(), 0, 'f', 1)
+    .arg(player->GetMaximumFrameInterval(), 0, 'f', 1)
+    .arg(player->GetNumberOfDroppedFrames())
+    .arg(player->GetNumberOfReadyFrames())
+    .arg(logic->GetPhaseManager()->GetNumberOfPhases())
+    .arg(player->GetMeanResampleTime(), 0, 'f', 1));
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerTAVIModuleWidget::onCineFrameRateChanged(int frameRate)
+{
+  Q_D(qSlicerTAVIModuleWidget);
+  vtkSlicerTAVILogic* logic = d->logic(this);
+  if (!logic)
+    {
+    return;
+    }
+  logic->GetCinePlayer()->SetFrameRate(frameRate);
+  if (d->CineTimer.isActive())
+    {
+    d->CineTimer.setInterval(qRound(1000. / logic->GetCinePlayer()->GetFrameRate()));
+    logic->GetCinePlayer()->ResetFrameStatistics();
+    }
+}
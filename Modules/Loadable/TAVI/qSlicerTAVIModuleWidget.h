@@ -0,0 +1,67 @@
+/*==============================================================================
+
+  Copyright (c) Kitware, Inc.
+
+  See http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qSlicerTAVIModuleWidget_h
+#define __qSlicerTAVIModuleWidget_h
+
+// Slicer includes
+#include "qSlicerAbstractModuleWidget.h"
+
+#include "qSlicerTAVIModuleExport.h"
+
+class qSlicerTAVIModuleWidgetPrivate;
+class vtkMRMLNode;
+class vtkObject;
+
+class Q_SLICER_QTMODULES_TAVI_EXPORT qSlicerTAVIModuleWidget :
+  public qSlicerAbstractModuleWidget
+{
+  Q_OBJECT
+
+public:
+
+  typedef qSlicerAbstractModuleWidget Superclass;
+  qSlicerTAVIModuleWidget(QWidget *parent=0);
+  virtual ~qSlicerTAVIModuleWidget();
+
+public slots:
+  /// Measure the annulus using the selected nodes.
+  void measureAnnulus();
+
+  /// Measure the annulus each time the volume or a hinge point is modified,
+  /// through the measurement graph of the logic.
+  void setLiveUpdate(bool enabled);
+
+  /// Play the phases of the phase manager in the selected slice view.
+  void setCinePlaying(bool playing);
+
+protected slots:
+  /// Register the annulus measurement of the selected nodes in the measurement graph.
+  void updateLiveMeasurement();
+  void onLumenThresholdChanged();
+  void onComputeMeasurement(vtkObject* caller, void* callData);
+  void onCineTimeout();
+  void onCineFrameRateChanged(int frameRate);
+
+protected:
+  QScopedPointer<qSlicerTAVIModuleWidgetPrivate> d_ptr;
+
+  virtual void setup();
+
+private:
+  Q_DECLARE_PRIVATE(qSlicerTAVIModuleWidget);
+  Q_DISABLE_COPY(qSlicerTAVIModuleWidget);
+};
+
+#endif
@@ -1,8 +1,9 @@
+from datetime import datetime
 from typing import Optional
 
 import qt
 import slicer
-import SlicerCustomAppUtilities
+import vtk
 from slicer.ScriptedLoadableModule import (
     ScriptedLoadableModule,
     ScriptedLoadableModuleLogic,
@@ -127,33 +128,190 @@ class HomeWidget(ScriptedLoadableModuleWidget, VTKObservationMixin):
         self.settingsUI = slicer.util.childWidgetVariables(self.settingsDialog)
         self.settingsUI.CustomUICheckBox.toggled.connect(self.setCustomUIVisible)
         self.settingsUI.CustomStyleCheckBox.toggled.connect(self.toggleStyle)
+        self.settingsUI.ResultCacheMaximumSizeSpinBox.valueChanged.connect(self.setResultCacheMaximumSize)
+        self.settingsUI.ResultCacheClearButton.clicked.connect(self.clearResultCache)
+        self.settingsUI.FrameRateGovernorCheckBox.toggled.connect(self.setFrameRateGovernorEnabled)
+        self.settingsUI.TargetFrameRateSpinBox.valueChanged.connect(self.setTargetFrameRate)
         self.settingsAction.triggered.connect(self.raiseSettings)
 
     def toggleStyle(self, visible: bool):
-        if visible:
-            self.applyApplicationStyle()
-        else:
-            slicer.app.styleSheet = ""
+        self.setCustomThemeEnabled(visible)
+        # The module panel has its own palette, see setup()
+        self.uiWidget.setPalette(slicer.app.style().standardPalette())
+
+    def setCustomThemeEnabled(self, enabled: bool):
+        """Switch the application style between the custom and the Slicer theme.
+
+        The theme is implemented by qAppStyle, switching it does not re-polish the application widgets
+        like applying a style sheet would.
+        """
+        style = slicer.app.style()
+        # The style can be replaced from the application settings
+        if hasattr(style, "customThemeEnabled"):
+            style.customThemeEnabled = enabled
 
     def raiseSettings(self, _):
+        self.updateResultCacheSettings()
+        self.updateFrameRateGovernorSettings()
         self.settingsDialog.exec()
 
+    def taviLogic(self) -> Optional["slicer.vtkSlicerTAVILogic"]:
+        """Logic of the TAVI module, the module is loaded if needed"""
+        # Deferred modules are loaded on their first access, see HaltLazyModules.py
+        taviModule = getattr(slicer.modules, "tavi", None)
+        return taviModule.logic() if taviModule else None
+
+    def resultCache(self) -> Optional["slicer.vtkTAVIResultCache"]:
+        """Persistent cache of the TAVI results, the TAVI module is loaded if needed"""
+        logic = self.taviLogic()
+        return logic.GetResultCache() if logic else None
+
+    def updateResultCacheSettings(self):
+        cache = self.resultCache()
+        self.settingsUI.ResultCacheGroupBox.enabled = cache is not None
+        if cache is None:
+            return
+
+        megaByte = 1024 * 1024
+        wasBlocked = self.settingsUI.ResultCacheMaximumSizeSpinBox.blockSignals(True)
+        self.settingsUI.ResultCacheMaximumSizeSpinBox.value = cache.GetMaximumSize() // megaByte
+        self.settingsUI.ResultCacheMaximumSizeSpinBox.blockSignals(wasBlocked)
+
+        keys = vtk.vtkStringArray()
+        sizes = vtk.vtkTypeInt64Array()
+        lastAccessTimes = vtk.vtkTypeInt64Array()
+        cache.GetEntryKeys(keys, sizes, lastAccessTimes)
+        totalSize = 0
+        self.settingsUI.ResultCacheEntriesListWidget.clear()
+        for index in range(keys.GetNumberOfValues()):
+            key = keys.GetValue(index)
+            size = sizes.GetValue(index)
+            totalSize += size
+            lastAccess = datetime.fromtimestamp(lastAccessTimes.GetValue(index))
+            self.settingsUI.ResultCacheEntriesListWidget.addItem(
+                f"{key} ({size / megaByte:.1f} MB, last used {lastAccess:%Y-%m-%d %H:%M})",
+            )
+        self.settingsUI.ResultCacheSummaryLabel.text = (
+            f"{keys.GetNumberOfValues()} results, {totalSize / megaByte:.1f} MB in {cache.GetCacheDirectory()}"
+        )
+
+    def setResultCacheMaximumSize(self, maximumSize: int):
+        """Set the maximum size of the result cache, in MB"""
+        cache = self.resultCache()
+        if cache is None:
+            return
+        qt.QSettings().setValue("ResultCache/MaximumSize", maximumSize)
+        cache.SetMaximumSize(maximumSize * 1024 * 1024)
+        cache.EvictEntries()
+        self.updateResultCacheSettings()
+
+    def clearResultCache(self):
+        cache = self.resultCache()
+        if cache is None or not slicer.util.confirmOkCancelDisplay("Remove all the cached results?"):
+            return
+        cache.Clear()
+        self.updateResultCacheSettings()
+
+    def renderGovernor(self) -> Optional["slicer.vtkTAVIRenderGovernor"]:
+        """Frame rate governor of the 3D view, the TAVI module is loaded if needed"""
+        logic = self.taviLogic()
+        return logic.GetRenderGovernor() if logic else None
+
+    def updateFrameRateGovernorSettings(self):
+        governor = self.renderGovernor()
+        self.settingsUI.VolumeRenderingGroupBox.enabled = governor is not None
+        if governor is None:
+            return
+
+        wasBlocked = self.settingsUI.FrameRateGovernorCheckBox.blockSignals(True)
+        self.settingsUI.FrameRateGovernorCheckBox.checked = governor.GetEnabled()
+        self.settingsUI.FrameRateGovernorCheckBox.blockSignals(wasBlocked)
+        wasBlocked = self.settingsUI.TargetFrameRateSpinBox.blockSignals(True)
+        self.settingsUI.TargetFrameRateSpinBox.value = round(governor.GetTargetFrameRate())
+        self.settingsUI.TargetFrameRateSpinBox.blockSignals(wasBlocked)
+        self.settingsUI.TargetFrameRateSpinBox.enabled = governor.GetEnabled()
+
+        self.settingsUI.FrameRateGovernorSummaryLabel.text = (
+            f"Interactive level {governor.GetLevel()} of {governor.NumberOfLevels - 1}, "
+            f"last frames {governor.GetLastInteractiveFrameTime():.0f} ms interacting, "
+            f"{governor.GetLastStillFrameTime():.0f} ms still"
+        )
+
+    def setFrameRateGovernorEnabled(self, enabled: bool):
+        governor = self.renderGovernor()
+        if governor is None:
+            return
+        qt.QSettings().setValue("VolumeRendering/FrameRateGovernor", enabled)
+        governor.SetEnabled(enabled)
+        self.updateFrameRateGovernorSettings()
+
+    def setTargetFrameRate(self, frameRate: int):
+        """Set the frame rate held while interacting, in frames per second"""
+        governor = self.renderGovernor()
+        if governor is None:
+            return
+        qt.QSettings().setValue("VolumeRendering/TargetFrameRate", frameRate)
+        governor.SetTargetFrameRate(frameRate)
+        self.updateFrameRateGovernorSettings()
+
     def setCustomUIVisible(self, visible: bool):
         self.setSlicerUIVisible(not visible)
 
     def applyApplicationStyle(self):
-        SlicerCustomAppUtilities.applyStyle([slicer.app], self.resourcePath("Home.qss"))
+        self.setCustomThemeEnabled(True)
         self.styleThreeDWidget()
         self.styleSliceWidgets()
 
     def styleThreeDWidget(self):
-        viewNode = slicer.app.layoutManager().threeDWidget(0).mrmlViewNode()  # noqa: F841
+        threeDWidget = slicer.app.layoutManager().threeDWidget(0)
+        viewNode = threeDWidget.mrmlViewNode()  # noqa: F841
         # viewNode.SetBackgroundColor(0.0, 0.0, 0.0)
         # viewNode.SetBackgroundColor2(0.0, 0.0, 0.0)
         # viewNode.SetBoxVisible(False)
         # viewNode.SetAxisLabelsVisible(False)
         # viewNode.SetOrientationMarkerType(slicer.vtkMRMLViewNode.OrientationMarkerTypeAxes)
 
+        # Large models and volumes are rotated at a lower quality. Not to defeat the lazy loading of the
+        # modules, the 3D view is only configured once the TAVI module is loaded.
+        factoryManager = slicer.app.moduleManager().factoryManager()
+        if factoryManager.isLoaded("TAVI"):
+            self.configureThreeDViewRendering()
+        else:
+            factoryManager.moduleLoaded.connect(self.onModuleLoaded)
+
+    def onModuleLoaded(self, moduleName: str):
+        if moduleName == "TAVI":
+            slicer.app.moduleManager().factoryManager().moduleLoaded.disconnect(self.onModuleLoaded)
+            self.configureThreeDViewRendering()
+
+    def configureThreeDViewRendering(self):
+        """Switch the large models of the first 3D view to decimated levels and hold the frame rate of its
+        volume rendering while it is interacted with"""
+        logic = self.taviLogic()
+        if logic is None:
+            return
+        threeDView = slicer.app.layoutManager().threeDWidget(0).threeDView()
+        renderer = threeDView.renderWindow().GetRenderers().GetFirstRenderer()
+        logic.GetModelLOD().SetRenderer(renderer)
+        logic.GetModelLOD().SetViewNodeID(threeDView.mrmlViewNode().GetID())
+        logic.GetRenderGovernor().SetRenderer(renderer)
+        # The levels are switched on the interaction events of the view. They are built by a background
+        # thread, the timer adds them to the scene while builds are pending.
+        self.modelLODTimer = qt.QTimer()
+        self.modelLODTimer.singleShot = True
+        self.modelLODTimer.setInterval(250)
+        self.modelLODTimer.timeout.connect(self.updateModelLOD)
+        self.addObserver(logic.GetModelLOD(), vtk.vtkCommand.ModifiedEvent, self.onModelLODModified)
+        self.updateModelLOD()
+
+    def onModelLODModified(self, caller, event):
+        if not self.modelLODTimer.active:
+            self.modelLODTimer.start()
+
+    def updateModelLOD(self):
+        if slicer.modules.tavi.logic().GetModelLOD().UpdateModels():
+            self.modelLODTimer.start()
+
     def styleSliceWidgets(self):
         for name in slicer.app.layoutManager().sliceViewNames():
             sliceWidget = slicer.app.layoutManager().sliceWidget(name)
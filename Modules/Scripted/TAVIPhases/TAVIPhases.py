@@ -0,0 +1,271 @@
+import logging
+from typing import Optional
+
+import qt
+import slicer
+import vtk
+from DICOMLib import DICOMLoadable, DICOMPlugin
+from slicer.ScriptedLoadableModule import ScriptedLoadableModule
+
+# DICOM attributes identifying the cardiac phase of an image, by order of preference
+PHASE_TAGS = {
+    "NominalPercentageOfCardiacPhase": "0020,9241",
+    "NominalCardiacTriggerDelayTime": "0020,9153",
+    "TriggerTime": "0018,1060",
+}
+
+# Minimum number of phases of a 4D series, and of images of a phase
+MINIMUM_COUNT = 2
+
+# Phases loaded and kept in memory, in percent of the R-R interval
+SYSTOLIC_PHASE = 35.0
+DIASTOLIC_PHASE = 75.0
+
+# Preferred over the scalar volume plugin (0.5), below the phases plugin
+SERIES_CONFIDENCE = 0.55
+
+
+class TAVIPhases(ScriptedLoadableModule):
+    """Registers the TAVIPhases DICOM plugin, which loads 4D cardiac CT series phase by phase,
+    and the TAVISeries DICOM plugin, which loads single-phase series with parallel decoding.
+    """
+
+    def __init__(self, parent: Optional[qt.QWidget]):
+        ScriptedLoadableModule.__init__(self, parent)
+        self.parent.title = "TAVI Phases"
+        self.parent.categories = ["Cardiac"]
+        self.parent.dependencies = ["DICOM", "TAVI"]
+        self.parent.contributors = ["TAVIMERCY"]
+        self.parent.helpText = """Load the phases of gated cardiac CT series on demand, under the memory budget
+set by "Phases/MemoryBudget" in the application settings. Only the systolic and diastolic phases are loaded
+when the series is imported, other phases are loaded by the phase manager of the TAVI module when accessed:
+<pre>slicer.modules.tavi.logic().GetPhaseManager().GetPhaseVolumeNode(phaseIndex)</pre>
+Single-phase series of single-frame images are loaded by the TAVI module, which decodes the slices in parallel.
+In the main window they are loaded progressively, from a 4x downsampled level to the full resolution."""
+        self.parent.acknowledgementText = ""
+        self.parent.hidden = True
+
+        # The DICOM module may be instantiated after this module
+        try:
+            slicer.modules.dicomPlugins  # noqa: B018
+        except AttributeError:
+            slicer.modules.dicomPlugins = {}
+        slicer.modules.dicomPlugins["TAVIPhasesPlugin"] = TAVIPhasesPluginClass
+        slicer.modules.dicomPlugins["TAVISeriesPlugin"] = TAVISeriesPluginClass
+
+
+class TAVIPhasesPluginClass(DICOMPlugin):
+    """Load 4D cardiac CT series through the phase manager of the TAVI module."""
+
+    def __init__(self):
+        super().__init__()
+        self.loadType = "Cardiac phases (on demand)"
+        self.tags["seriesDescription"] = "0008,103e"
+        self.tags["position"] = "0020,0032"
+        self.tags["orientation"] = "0020,0037"
+        self.tags.update(PHASE_TAGS)
+
+    def examine(self, fileLists: list[list[str]]) -> list[DICOMLoadable]:
+        loadables = []
+        for files in fileLists:
+            loadables += self.examineFiles(files)
+        return loadables
+
+    def examineFiles(self, files: list[str]) -> list[DICOMLoadable]:
+        phaseTag, phases = self.groupFilesByPhase(files)
+        if not phases:
+            return []
+        seriesDescription = slicer.dicomDatabase.fileValue(files[0], self.tags["seriesDescription"]) or "Unnamed"
+        loadable = DICOMLoadable()
+        loadable.files = files
+        loadable.name = f"{seriesDescription} ({len(phases)} phases)"
+        loadable.tooltip = f"{len(phases)} cardiac phases identified by {phaseTag}, loaded on demand"
+        loadable.selected = True
+        # Preferred over the volume and sequence plugins, which would load all the phases
+        loadable.confidence = 0.9
+        loadable.phases = phases
+        loadable.phasePercentages = self.phasePercentages(phaseTag, [value for _, value, _ in phases])
+        return [loadable]
+
+    def groupFilesByPhase(self, files: list[str]) -> tuple[str, list[tuple[str, float, list[str]]]]:
+        """Return the tag identifying the phases and the (name, value, sorted files) of each phase.
+
+        Files are grouped by the first phase tag giving at least two phases of the same number of images.
+        """
+        for tagName, tag in PHASE_TAGS.items():
+            groups: dict[float, list[str]] = {}
+            for file in files:
+                try:
+                    value = float(slicer.dicomDatabase.fileValue(file, tag))
+                except ValueError:
+                    groups = {}
+                    break
+                groups.setdefault(value, []).append(file)
+            groupSizes = {len(groupFiles) for groupFiles in groups.values()}
+            if len(groups) < MINIMUM_COUNT or len(groupSizes) != 1 or groupSizes.pop() < MINIMUM_COUNT:
+                continue
+            unit = "%" if tagName == "NominalPercentageOfCardiacPhase" else " ms"
+            phases = [
+                (f"{value:g}{unit}", value, self.sortFilesAlongNormal(groupFiles))
+                for value, groupFiles in sorted(groups.items())
+            ]
+            return tagName, phases
+        return "", []
+
+    def sortFilesAlongNormal(self, files: list[str]) -> list[str]:
+        try:
+            orientationValue = slicer.dicomDatabase.fileValue(files[0], self.tags["orientation"])
+            orientation = [float(v) for v in orientationValue.split("\\")]
+            normal = [0.0, 0.0, 0.0]
+            vtk.vtkMath.Cross(orientation[:3], orientation[3:6], normal)
+
+            def distance(file: str) -> float:
+                position = [float(v) for v in slicer.dicomDatabase.fileValue(file, self.tags["position"]).split("\\")]
+                return vtk.vtkMath.Dot(position, normal)
+
+            return sorted(files, key=distance)
+        except (ValueError, IndexError):
+            return files
+
+    @staticmethod
+    def phasePercentages(phaseTag: str, values: list[float]) -> list[float]:
+        """Position of each phase in the R-R interval, in percent"""
+        if phaseTag == "NominalPercentageOfCardiacPhase":
+            return values
+        # Trigger times are sorted, assume they span the R-R interval evenly
+        return [100.0 * index / len(values) for index in range(len(values))]
+
+    def load(self, loadable: DICOMLoadable) -> Optional[slicer.vtkMRMLScalarVolumeNode]:
+        phaseManager = slicer.modules.tavi.logic().GetPhaseManager()
+        phaseIndices = []
+        for phaseName, _, files in loadable.phases:
+            fileNames = vtk.vtkStringArray()
+            for file in files:
+                fileNames.InsertNextValue(file)
+            phaseIndices.append(phaseManager.AddPhase(f"{loadable.name} {phaseName}", fileNames))
+
+        def closestPhase(percentage: float) -> int:
+            distances = [abs(p - percentage) for p in loadable.phasePercentages]
+            return phaseIndices[distances.index(min(distances))]
+
+        # Load the analyzed phases now and keep them in memory
+        analyzedPhases = [closestPhase(SYSTOLIC_PHASE), closestPhase(DIASTOLIC_PHASE)]
+        volumeNodes = []
+        for phaseIndex in analyzedPhases:
+            phaseManager.SetPhasePinned(phaseIndex, True)
+            volumeNodes.append(phaseManager.GetPhaseVolumeNode(phaseIndex))
+        if not all(volumeNodes):
+            return None
+        if slicer.app.layoutManager():
+            slicer.util.setSliceViewerLayers(background=volumeNodes[0], fit=True)
+        return volumeNodes[0]
+
+
+class TAVISeriesPluginClass(TAVIPhasesPluginClass):
+    """Load single-phase series of single-frame images through the parallel reader of the TAVI module.
+
+    With the main window, the series is loaded progressively by the volume pyramid of the TAVI module:
+    its 4x downsampled level is returned and shown at once, the 2x and full resolution levels are added
+    to the scene as they are decoded. Without main window (scripts, batch processing) the full
+    resolution volume is returned.
+
+    Series that are not uniform (several orientations or image sizes, multi-frame or color images)
+    are left to the scalar volume plugin.
+    """
+
+    # Series loading in the volume pyramid and timer adding its levels, shared by the plugin instances
+    pyramidLoadable = None
+    pyramidTimer = None
+
+    def __init__(self):
+        super().__init__()
+        self.loadType = "Scalar Volume (parallel decoding)"
+        self.tags["numberOfFrames"] = "0028,0008"
+        self.tags["samplesPerPixel"] = "0028,0002"
+        self.tags["rows"] = "0028,0010"
+        self.tags["columns"] = "0028,0011"
+
+    def examineFiles(self, files: list[str]) -> list[DICOMLoadable]:
+        # 4D series are loaded by the phases plugin
+        _, phases = self.groupFilesByPhase(files)
+        if phases or not self.isUniformSeries(files):
+            return []
+        seriesDescription = slicer.dicomDatabase.fileValue(files[0], self.tags["seriesDescription"]) or "Unnamed"
+        loadable = DICOMLoadable()
+        loadable.files = self.sortFilesAlongNormal(files)
+        loadable.name = seriesDescription
+        loadable.tooltip = f"{len(files)} images, decoded in parallel"
+        loadable.selected = True
+        loadable.confidence = SERIES_CONFIDENCE
+        return [loadable]
+
+    def isUniformSeries(self, files: list[str]) -> bool:
+        """Return true if the files are single-frame grayscale images of the same size and orientation,
+        at distinct positions.
+        """
+
+        def value(file: str, tagName: str) -> str:
+            return slicer.dicomDatabase.fileValue(file, self.tags[tagName])
+
+        try:
+            size = (value(files[0], "rows"), value(files[0], "columns"))
+            orientation = [float(v) for v in value(files[0], "orientation").split("\\")]
+            positions = set()
+            for file in files:
+                if value(file, "numberOfFrames") not in ("", "1") or value(file, "samplesPerPixel") not in ("", "1"):
+                    return False
+                if (value(file, "rows"), value(file, "columns")) != size:
+                    return False
+                fileOrientation = [float(v) for v in value(file, "orientation").split("\\")]
+                if len(fileOrientation) != 6 or max(abs(a - b) for a, b in zip(fileOrientation, orientation)) > 1e-4:
+                    return False
+                positions.add(value(file, "position"))
+        except (ValueError, IndexError):
+            return False
+        return len(positions) == len(files)
+
+    def load(self, loadable: DICOMLoadable) -> Optional[slicer.vtkMRMLScalarVolumeNode]:
+        fileNames = vtk.vtkStringArray()
+        for file in loadable.files:
+            fileNames.InsertNextValue(file)
+        logic = slicer.modules.tavi.logic()
+        if slicer.util.mainWindow():
+            pyramid = logic.GetVolumePyramid()
+            # The pyramid loads one series at a time, the previous one is completed first
+            if TAVISeriesPluginClass.pyramidLoadable:
+                pyramid.WaitForLevel(0)
+                TAVISeriesPluginClass.updatePyramidLevels()
+            if pyramid.Load(loadable.name, fileNames):
+                volumeNode = pyramid.GetLevelVolumeNode(pyramid.NumberOfLevels - 1)
+                self.addSeriesInSubjectHierarchy(loadable, volumeNode)
+                TAVISeriesPluginClass.pyramidLoadable = (self, loadable)
+                if not TAVISeriesPluginClass.pyramidTimer:
+                    TAVISeriesPluginClass.pyramidTimer = qt.QTimer()
+                    TAVISeriesPluginClass.pyramidTimer.setInterval(100)
+                    TAVISeriesPluginClass.pyramidTimer.connect("timeout()", TAVISeriesPluginClass.updatePyramidLevels)
+                TAVISeriesPluginClass.pyramidTimer.start()
+                return volumeNode
+        # Series not supported by the pyramid are read by the storage node
+        volumeNode = logic.LoadDICOMSeries(loadable.name, fileNames)
+        if volumeNode:
+            self.addSeriesInSubjectHierarchy(loadable, volumeNode)
+        return volumeNode
+
+    @staticmethod
+    def updatePyramidLevels() -> None:
+        """Add the levels decoded by the volume pyramid to the scene, and the full resolution
+        volume to the subject hierarchy once it is added.
+        """
+        pyramid = slicer.modules.tavi.logic().GetVolumePyramid()
+        if pyramid.UpdateLevels():
+            return
+        TAVISeriesPluginClass.pyramidTimer.stop()
+        if not TAVISeriesPluginClass.pyramidLoadable:
+            return
+        plugin, loadable = TAVISeriesPluginClass.pyramidLoadable
+        TAVISeriesPluginClass.pyramidLoadable = None
+        volumeNode = pyramid.GetLevelVolumeNode(0)
+        if volumeNode:
+            plugin.addSeriesInSubjectHierarchy(loadable, volumeNode)
+        else:
+            logging.error(f"Failed to load the full resolution of {loadable.name}")